@@ -0,0 +1,59 @@
+#include "bench_common.h"
+#include "doobius/dbg/custom_assert.h"
+
+#include <numeric>
+
+// The previous DOOBIUS_FMT_VERIFY: formats the message on every call, whether or not the expression holds
+#define EAGER_FMT_VERIFY(EXPR, _FMT, _ARG)              \
+    do {                                                \
+        boost::format sfmt(_FMT);                       \
+        sfmt % _ARG;                                    \
+        BOOST_VERIFY_MSG((EXPR), sfmt.str().c_str());   \
+    } while (0)
+
+/**
+ * Cost of a passing formatted verify against an unchecked loop doing the same comparison, and against the old eager
+ * formatting. Args: --iterations N
+ */
+DOOBIUS_BENCHMARK(assert_passing)
+{
+	namespace Bench = Doobius::Bench;
+	const std::int64_t iterations = ctx.getIntArg("iterations", 20000000);
+	std::vector<int> values(1024);
+	std::iota(values.begin(), values.end(), 0);
+	const std::string regName = "BenchNotifReg";
+
+	auto report = [&](const char* caseName, std::int64_t caseIterations, double ns) {
+		Bench::json::object metrics;
+		metrics["iterations"] = caseIterations;
+		metrics["ns_per_check"] = ns;
+		ctx.report("assert_passing", caseName, std::move(metrics));
+	};
+
+	std::int64_t checked = 0;
+	double baselineNs = Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+		checked += values[i & 1023] >= 0;
+		Bench::doNotOptimize(checked);
+	});
+	report("no_check", iterations, baselineNs);
+
+	double plainNs = Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+		DOOBIUS_VERIFY(values[i & 1023] >= 0, "Value went negative");
+		Bench::doNotOptimize(values[i & 1023]);
+	});
+	report("verify_literal_msg", iterations, plainNs);
+
+	double lazyNs = Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+		DOOBIUS_FMT_VERIFY(values[i & 1023] >= 0, "Value %1% at %2% went negative in %3%", values[i & 1023] % (i & 1023) % regName);
+		Bench::doNotOptimize(values[i & 1023]);
+	});
+	report("fmt_verify_lazy", iterations, lazyNs);
+
+	// The eager version is orders of magnitude slower, so run fewer iterations of it
+	const std::int64_t eagerIterations = std::max<std::int64_t>(1, iterations / 100);
+	double eagerNs = Bench::measureNsPerOp(eagerIterations, [&](std::int64_t i) {
+		EAGER_FMT_VERIFY(values[i & 1023] >= 0, "Value %1% at %2% went negative in %3%", values[i & 1023] % (i & 1023) % regName);
+		Bench::doNotOptimize(values[i & 1023]);
+	});
+	report("fmt_verify_eager", eagerIterations, eagerNs);
+}
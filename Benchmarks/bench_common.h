@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Doobius {
+	namespace Bench {
+		namespace json = boost::json;
+
+		/**
+		 * \brief Handed to every benchmark. Holds the extra command line arguments and collects the JSON results that
+		 * bench_main prints once all selected benchmarks have run.
+		 *
+		 */
+		class BenchmarkContext {
+		private:
+			std::map<std::string, std::string> m_args;
+			json::array m_results;
+		public:
+			BenchmarkContext(std::map<std::string, std::string> args) : m_args(std::move(args)) {}
+
+			// Every result is tagged with the benchmark and case name so runs can be diffed case by case
+			void report(const std::string& benchName, const std::string& caseName, json::object metrics) {
+				metrics["benchmark"] = benchName;
+				metrics["case"] = caseName;
+				m_results.push_back(std::move(metrics));
+			}
+
+			bool hasArg(const std::string& name) const { return m_args.find(name) != m_args.end(); }
+
+			std::int64_t getIntArg(const std::string& name, std::int64_t defaultVal) const {
+				auto it = m_args.find(name);
+				return it == m_args.end() ? defaultVal : std::stoll(it->second);
+			}
+
+			std::string getStrArg(const std::string& name, const std::string& defaultVal) const {
+				auto it = m_args.find(name);
+				return it == m_args.end() ? defaultVal : it->second;
+			}
+
+			const json::array& getResults() const { return m_results; }
+		};
+
+		using BenchmarkFn = void (*)(BenchmarkContext&);
+
+		class BenchmarkRegistry {
+		private:
+			std::map<std::string, BenchmarkFn> m_benchmarks;
+		public:
+			static BenchmarkRegistry& get() {
+				static BenchmarkRegistry _registry;
+				return _registry;
+			}
+
+			bool add(const char* name, BenchmarkFn fn) {
+				m_benchmarks[name] = fn;
+				return true;
+			}
+
+			const std::map<std::string, BenchmarkFn>& getBenchmarks() const { return m_benchmarks; }
+		};
+
+		// Keeps the optimizer from discarding a value that is otherwise unused
+		template<typename T>
+		inline void doNotOptimize(const T& val) {
+#if defined(_MSC_VER)
+			static_cast<void>(*reinterpret_cast<const volatile char*>(&val));
+			_ReadWriteBarrier();
+#else
+			asm volatile("" : : "g"(&val) : "memory");
+#endif
+		}
+
+		using BenchClock = std::chrono::steady_clock;
+
+		inline std::int64_t elapsedNs(BenchClock::time_point start, BenchClock::time_point end) {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		}
+
+		// Runs fn iterations times and returns the average cost of one call in nanoseconds
+		template<typename Fn>
+		inline double measureNsPerOp(std::int64_t iterations, Fn&& fn) {
+			BenchClock::time_point start = BenchClock::now();
+			for (std::int64_t i = 0; i < iterations; ++i) {
+				fn(i);
+			}
+			return static_cast<double>(elapsedNs(start, BenchClock::now())) / static_cast<double>(iterations);
+		}
+
+		/**
+		 * \brief Sorts the samples in place and summarizes them. Percentiles use nearest-rank.
+		 */
+		inline json::object summarizeLatencies(std::vector<std::int64_t>& samplesNs) {
+			json::object summary;
+			if (samplesNs.empty()) {
+				return summary;
+			}
+			std::sort(samplesNs.begin(), samplesNs.end());
+			auto percentile = [&samplesNs](double p) {
+				std::size_t idx = static_cast<std::size_t>(p * static_cast<double>(samplesNs.size() - 1) + 0.5);
+				return samplesNs[idx];
+			};
+			double sum = 0.0;
+			for (std::int64_t s : samplesNs) {
+				sum += static_cast<double>(s);
+			}
+			summary["samples"] = samplesNs.size();
+			summary["min_ns"] = samplesNs.front();
+			summary["mean_ns"] = sum / static_cast<double>(samplesNs.size());
+			summary["p50_ns"] = percentile(0.50);
+			summary["p99_ns"] = percentile(0.99);
+			summary["p999_ns"] = percentile(0.999);
+			summary["max_ns"] = samplesNs.back();
+			return summary;
+		}
+	}
+}
+
+#define DOOBIUS_BENCHMARK(NAME) \
+	static void NAME##_benchmark(Doobius::Bench::BenchmarkContext& ctx); \
+	static const bool NAME##_benchmarkRegistered = Doobius::Bench::BenchmarkRegistry::get().add(#NAME, &NAME##_benchmark); \
+	static void NAME##_benchmark(Doobius::Bench::BenchmarkContext& ctx)
@@ -0,0 +1,71 @@
+#include "bench_common.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Usage: Benchmarks [--list] [--bench name1,name2] [--out results.json] [--key value ...]
+ * Runs every registered benchmark unless --bench narrows it down. Any other --key value pair is passed through to
+ * the benchmarks (e.g. --iterations 100000). Results are printed as one JSON array.
+ */
+int main(int argc, char* argv[]) {
+	namespace Bench = Doobius::Bench;
+
+	std::map<std::string, std::string> args;
+	for (int i = 1; i < argc; ++i) {
+		std::string key = argv[i];
+		if (key.rfind("--", 0) != 0) {
+			std::cerr << "Ignoring unexpected argument " << key << '\n';
+			continue;
+		}
+		key = key.substr(2);
+		if (i + 1 < argc && std::string_view(argv[i + 1]).rfind("--", 0) != 0) {
+			args[key] = argv[++i];
+		}
+		else {
+			args[key] = "";
+		}
+	}
+	args["exe_dir"] = std::filesystem::absolute(argv[0]).parent_path().string();
+
+	const auto& benchmarks = Bench::BenchmarkRegistry::get().getBenchmarks();
+	if (args.count("list")) {
+		for (const auto& [name, fn] : benchmarks) {
+			std::cout << name << '\n';
+		}
+		return 0;
+	}
+
+	std::vector<std::string> selected;
+	if (args.count("bench")) {
+		std::istringstream selIss(args["bench"]);
+		std::string name;
+		while (std::getline(selIss, name, ',')) {
+			if (benchmarks.find(name) == benchmarks.end()) {
+				std::cerr << "Unknown benchmark " << name << " (see --list)\n";
+				return 1;
+			}
+			selected.push_back(name);
+		}
+	}
+	else {
+		for (const auto& [name, fn] : benchmarks) {
+			selected.push_back(name);
+		}
+	}
+
+	Bench::BenchmarkContext ctx(args);
+	for (const std::string& name : selected) {
+		std::cerr << "Running " << name << "...\n";
+		benchmarks.at(name)(ctx);
+	}
+
+	std::string resultJson = boost::json::serialize(ctx.getResults());
+	if (args.count("out")) {
+		std::ofstream outFile(args["out"]);
+		outFile << resultJson << '\n';
+	}
+	std::cout << resultJson << '\n';
+	return 0;
+}
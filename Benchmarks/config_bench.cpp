@@ -0,0 +1,196 @@
+#include "bench_common.h"
+#include "doobius/dbg/config_registry.h"
+#include "doobius/dbg/logging.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+	namespace Config = Doobius::Config;
+
+	// One module's config: every fourth field of each type is per build, like log_config.json
+	struct BenchConfigFile {
+		std::filesystem::path path;
+		std::unique_ptr<Config::ConfigSchema> schema;
+		std::vector<Config::ConfigKey<std::int64_t>> intKeys;
+		std::vector<Config::ConfigKey<double>> doubleKeys;
+		std::vector<Config::ConfigKey<bool>> boolKeys;
+		std::vector<Config::ConfigKey<std::string>> stringKeys;
+	};
+
+	std::string fieldName(std::int64_t i) {
+		return "field_" + std::to_string(i);
+	}
+
+	Config::ConfigScope scopeOf(std::int64_t i) {
+		return (i / 4) % 4 == 0 ? Config::ConfigScope::PER_BUILD : Config::ConfigScope::GLOBAL;
+	}
+
+	std::vector<BenchConfigFile> writeConfigSet(const std::filesystem::path& dir, std::int64_t numFiles, std::int64_t fieldsPerFile) {
+		std::filesystem::create_directories(dir);
+		std::vector<BenchConfigFile> files(static_cast<std::size_t>(numFiles));
+		for (std::int64_t f = 0; f < numFiles; ++f) {
+			BenchConfigFile& file = files[static_cast<std::size_t>(f)];
+			file.path = dir / ("module_" + std::to_string(f) + ".json");
+			file.schema = std::make_unique<Config::ConfigSchema>("bench_module_" + std::to_string(f));
+
+			std::ostringstream json;
+			json << "{\n";
+			for (std::int64_t i = 0; i < fieldsPerFile; ++i) {
+				std::ostringstream val;
+				switch (i % 4) {
+				case 0:
+					val << i * 37;
+					file.intKeys.push_back(file.schema->add<std::int64_t>(fieldName(i), 0, scopeOf(i), true));
+					break;
+				case 1:
+					val << static_cast<double>(i) * 0.125;
+					file.doubleKeys.push_back(file.schema->add<double>(fieldName(i), 0.0, scopeOf(i), true));
+					break;
+				case 2:
+					val << ((i & 8) ? "true" : "false");
+					file.boolKeys.push_back(file.schema->add<bool>(fieldName(i), false, scopeOf(i), true));
+					break;
+				default:
+					val << "\"asset/path/for/" << fieldName(i) << ".bin\"";
+					file.stringKeys.push_back(file.schema->add<std::string>(fieldName(i), "", scopeOf(i), true));
+					break;
+				}
+				json << "  \"" << fieldName(i) << "\": ";
+				if (scopeOf(i) == Config::ConfigScope::PER_BUILD) {
+					json << "{ \"dbg\": " << val.str() << ", \"rel-dev\": " << val.str() << ", \"rel\": " << val.str() << " }";
+				}
+				else {
+					json << val.str();
+				}
+				json << (i + 1 < fieldsPerFile ? ",\n" : "\n");
+			}
+			json << "}\n";
+			std::ofstream(file.path, std::ios::trunc) << json.str();
+		}
+		return files;
+	}
+
+	// What LogManager::initLogging did before the registry: stream the file into a string, parse, walk the tree
+	std::uint64_t parseAndWalk(const BenchConfigFile& file, std::int64_t fieldsPerFile) {
+		std::ifstream configStream(file.path);
+		std::ostringstream contents;
+		contents << configStream.rdbuf();
+		const Bench::json::value root = Bench::json::parse(contents.str());
+		const Bench::json::object& rootObj = root.as_object();
+
+		std::uint64_t checksum = 0;
+		for (std::int64_t i = 0; i < fieldsPerFile; ++i) {
+			const Bench::json::value* val = &rootObj.at(fieldName(i));
+			if (scopeOf(i) == Config::ConfigScope::PER_BUILD) {
+				val = &val->as_object().at(Doobius::Log::getConfigString());
+			}
+			switch (i % 4) {
+			case 0: checksum += static_cast<std::uint64_t>(val->as_int64()); break;
+			case 1: checksum += static_cast<std::uint64_t>(val->as_double()); break;
+			case 2: checksum += val->as_bool() ? 1 : 0; break;
+			default: checksum += val->as_string().size(); break;
+			}
+		}
+		return checksum;
+	}
+
+	std::uint64_t loadAndRead(const BenchConfigFile& file) {
+		const Config::ConfigSection& section = Config::ConfigRegistry::get().load(*file.schema, file.path);
+		std::uint64_t checksum = 0;
+		for (const auto& key : file.intKeys) {
+			checksum += static_cast<std::uint64_t>(section.get(key));
+		}
+		for (const auto& key : file.doubleKeys) {
+			checksum += static_cast<std::uint64_t>(section.get(key));
+		}
+		for (const auto& key : file.boolKeys) {
+			checksum += section.get(key) ? 1 : 0;
+		}
+		for (const auto& key : file.stringKeys) {
+			checksum += section.get(key).size();
+		}
+		return checksum;
+	}
+
+	std::uintmax_t sumFileBytes(const std::filesystem::path& dir, const std::string& extension) {
+		std::uintmax_t total = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+			if (entry.path().extension() == extension) {
+				total += entry.file_size();
+			}
+		}
+		return total;
+	}
+}
+
+/**
+ * Startup cost of reading a large config set and every field in it: parse-and-walk as initLogging used to, the
+ * ConfigRegistry compiling every file (first launch after an edit, cache written), and the registry mapping caches
+ * that are already valid (every other launch). Args: --files N, --fields N (per file), --iterations N
+ */
+DOOBIUS_BENCHMARK(config_startup)
+{
+	const std::int64_t numFiles = ctx.getIntArg("files", 64);
+	const std::int64_t fieldsPerFile = ctx.getIntArg("fields", 256);
+	const std::int64_t iterations = ctx.getIntArg("iterations", 20);
+	const std::filesystem::path benchDir = std::filesystem::path(ctx.getStrArg("exe_dir", ".")) / "BenchmarkConfigs";
+	const std::filesystem::path cacheDir = benchDir / "cache";
+	std::filesystem::remove_all(benchDir);
+	const std::vector<BenchConfigFile> files = writeConfigSet(benchDir, numFiles, fieldsPerFile);
+
+	Config::ConfigRegistry& registry = Config::ConfigRegistry::get();
+	const std::filesystem::path prevCacheDir = registry.getCacheDir();
+	registry.setCacheDir(cacheDir);
+
+	auto report = [&](const std::string& caseName, double nsPerStartup) {
+		Bench::json::object metrics;
+		metrics["files"] = numFiles;
+		metrics["fields_per_file"] = fieldsPerFile;
+		metrics["iterations"] = iterations;
+		metrics["ms_per_startup"] = nsPerStartup / 1e6;
+		metrics["us_per_file"] = nsPerStartup / 1e3 / static_cast<double>(numFiles);
+		ctx.report("config_startup", caseName, std::move(metrics));
+	};
+
+	report("json_parse_walk", Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+		std::uint64_t checksum = 0;
+		for (const BenchConfigFile& file : files) {
+			checksum += parseAndWalk(file, fieldsPerFile);
+		}
+		Bench::doNotOptimize(checksum);
+	}));
+
+	// Cache removal happens inside the timed loop but is cheap next to compiling
+	report("registry_compile", Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+		registry.clear();
+		std::filesystem::remove_all(cacheDir);
+		std::uint64_t checksum = 0;
+		for (const BenchConfigFile& file : files) {
+			checksum += loadAndRead(file);
+		}
+		Bench::doNotOptimize(checksum);
+	}));
+
+	report("registry_cached", Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+		registry.clear();
+		std::uint64_t checksum = 0;
+		for (const BenchConfigFile& file : files) {
+			checksum += loadAndRead(file);
+		}
+		Bench::doNotOptimize(checksum);
+	}));
+
+	Bench::json::object sizes;
+	sizes["json_bytes"] = sumFileBytes(benchDir, ".json");
+	sizes["cache_bytes"] = sumFileBytes(cacheDir, ".cfgcache");
+	ctx.report("config_startup", "sizes", std::move(sizes));
+
+	registry.clear();
+	registry.setCacheDir(prevCacheDir);
+	if (!ctx.hasArg("keep_configs")) {
+		std::filesystem::remove_all(benchDir);
+	}
+}
@@ -0,0 +1,174 @@
+#include "bench_common.h"
+#include "doobius/core/ecs.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+
+	struct Position {
+		float x, y, z;
+	};
+
+	struct Velocity {
+		float dx, dy, dz;
+	};
+
+	struct Health {
+		float hp;
+	};
+
+	struct Renderable {
+		std::uint32_t meshId;
+	};
+
+	// The layout the ECS replaces: one heap object per entity, updated through a virtual call
+	class GameObject {
+	public:
+		Position position;
+		Velocity velocity;
+		float padding[8];	// Other per-object state that shares the cache lines
+
+		virtual ~GameObject() = default;
+		virtual void update(float dt) {
+			position.x += velocity.dx * dt;
+			position.y += velocity.dy * dt;
+			position.z += velocity.dz * dt;
+		}
+	};
+
+	void reportIteration(Bench::BenchmarkContext& ctx, const std::string& caseName, std::int64_t numEntities, std::int64_t iterations, double ns) {
+		Bench::json::object metrics;
+		metrics["entities"] = numEntities;
+		metrics["iterations"] = iterations;
+		metrics["ns_per_pass"] = ns;
+		metrics["ns_per_entity"] = ns / static_cast<double>(numEntities);
+		ctx.report("ecs_iterate", caseName + "/" + std::to_string(numEntities), std::move(metrics));
+	}
+}
+
+/**
+ * position += velocity * dt over 10^4, 10^5 and 10^6 entities: cached ECS query (per entity and per chunk), the same
+ * query over entities spread across 8 archetypes, and heap-allocated objects with a virtual update visited in shuffled
+ * allocation order. Args: --min_entities N, --max_entities N, --iterations N (passes at 10^4, scaled down for larger counts)
+ */
+DOOBIUS_BENCHMARK(ecs_iterate)
+{
+	const std::int64_t minEntities = ctx.getIntArg("min_entities", 10000);
+	const std::int64_t maxEntities = ctx.getIntArg("max_entities", 1000000);
+	const std::int64_t baseIterations = ctx.getIntArg("iterations", 2000);
+	const float dt = 1.0f / 60.0f;
+
+	for (std::int64_t numEntities = minEntities; numEntities <= maxEntities; numEntities *= 10) {
+		const std::int64_t iterations = std::max<std::int64_t>(5, baseIterations * minEntities / numEntities);
+
+		Doobius::World world;
+		for (std::int64_t i = 0; i < numEntities; ++i) {
+			world.createEntity(Position{ 0, 0, 0 }, Velocity{ 1, 2, 3 });
+		}
+		reportIteration(ctx, "ecs_for_each", numEntities, iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			world.forEach<Position, const Velocity>([dt](Doobius::EntityId, Position& position, const Velocity& velocity) {
+				position.x += velocity.dx * dt;
+				position.y += velocity.dy * dt;
+				position.z += velocity.dz * dt;
+			});
+		}));
+		reportIteration(ctx, "ecs_for_each_chunk", numEntities, iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			world.forEachChunk<Position, const Velocity>([dt](std::size_t count, const Doobius::EntityId*, Position* positions, const Velocity* velocities) {
+				for (std::size_t i = 0; i < count; ++i) {
+					positions[i].x += velocities[i].dx * dt;
+					positions[i].y += velocities[i].dy * dt;
+					positions[i].z += velocities[i].dz * dt;
+				}
+			});
+		}));
+
+		// Same matching entities, split over every combination of two extra components
+		Doobius::World mixedWorld;
+		for (std::int64_t i = 0; i < numEntities; ++i) {
+			const Doobius::EntityId entity = mixedWorld.createEntity(Position{ 0, 0, 0 }, Velocity{ 1, 2, 3 });
+			if (i & 1) {
+				mixedWorld.addComponent(entity, Health{ 100 });
+			}
+			if (i & 2) {
+				mixedWorld.addComponent(entity, Renderable{ 7 });
+			}
+		}
+		reportIteration(ctx, "ecs_mixed_archetypes", numEntities, iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			mixedWorld.forEachChunk<Position, const Velocity>([dt](std::size_t count, const Doobius::EntityId*, Position* positions, const Velocity* velocities) {
+				for (std::size_t i = 0; i < count; ++i) {
+					positions[i].x += velocities[i].dx * dt;
+					positions[i].y += velocities[i].dy * dt;
+					positions[i].z += velocities[i].dz * dt;
+				}
+			});
+		}));
+
+		std::vector<std::unique_ptr<GameObject>> objects;
+		objects.reserve(static_cast<std::size_t>(numEntities));
+		for (std::int64_t i = 0; i < numEntities; ++i) {
+			objects.push_back(std::make_unique<GameObject>());
+			objects.back()->velocity = { 1, 2, 3 };
+		}
+		// Long-running games don't visit objects in allocation order
+		std::shuffle(objects.begin(), objects.end(), std::mt19937(1234));
+		reportIteration(ctx, "heap_objects_virtual", numEntities, iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			for (const std::unique_ptr<GameObject>& object : objects) {
+				object->update(dt);
+			}
+		}));
+
+		float checksum = 0;
+		world.forEach<const Position>([&](Doobius::EntityId, const Position& position) { checksum += position.x; });
+		Bench::doNotOptimize(checksum);
+	}
+}
+
+/**
+ * Structural change throughput: creating entities with two components, adding and removing a third through a command
+ * buffer, then destroying them. Args: --entities N, --rounds N
+ */
+DOOBIUS_BENCHMARK(ecs_structural)
+{
+	const std::int64_t numEntities = ctx.getIntArg("entities", 100000);
+	const std::int64_t rounds = ctx.getIntArg("rounds", 10);
+	std::vector<Doobius::EntityId> entities(static_cast<std::size_t>(numEntities));
+
+	Doobius::World world;
+	Doobius::CommandBuffer commands(world);
+	auto reportOps = [&](const std::string& caseName, double ns) {
+		Bench::json::object metrics;
+		metrics["entities"] = numEntities;
+		metrics["ns_per_op"] = ns / static_cast<double>(numEntities);
+		ctx.report("ecs_structural", caseName, std::move(metrics));
+	};
+
+	double createNs = 0, deferredAddNs = 0, deferredRemoveNs = 0, destroyNs = 0;
+	for (std::int64_t round = 0; round < rounds; ++round) {
+		createNs += Bench::measureNsPerOp(1, [&](std::int64_t) {
+			for (Doobius::EntityId& entity : entities) {
+				entity = world.createEntity(Position{ 0, 0, 0 }, Velocity{ 1, 1, 1 });
+			}
+		});
+		deferredAddNs += Bench::measureNsPerOp(1, [&](std::int64_t) {
+			world.forEach<const Position>([&](Doobius::EntityId entity, const Position&) { commands.addComponent(entity, Health{ 1 }); });
+			commands.playback();
+		});
+		deferredRemoveNs += Bench::measureNsPerOp(1, [&](std::int64_t) {
+			world.forEach<const Health>([&](Doobius::EntityId entity, const Health&) { commands.removeComponent<Health>(entity); });
+			commands.playback();
+		});
+		destroyNs += Bench::measureNsPerOp(1, [&](std::int64_t) {
+			for (Doobius::EntityId entity : entities) {
+				world.destroyEntity(entity);
+			}
+		});
+	}
+	reportOps("create", createNs / rounds);
+	reportOps("deferred_add", deferredAddNs / rounds);
+	reportOps("deferred_remove", deferredRemoveNs / rounds);
+	reportOps("destroy", destroyNs / rounds);
+}
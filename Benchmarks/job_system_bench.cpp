@@ -0,0 +1,123 @@
+#include "bench_common.h"
+#include "doobius/core/job_system.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+
+	Doobius::JobSystem::JobSystemConfig makeConfig(int numThreads) {
+		Doobius::JobSystem::JobSystemConfig config;
+		config.numWorkers = numThreads - 1;
+		return config;
+	}
+
+	// Roughly fixed amount of arithmetic per element so the scaling numbers aren't just memory bandwidth
+	inline double elementWork(std::size_t i) {
+		double x = static_cast<double>(i);
+		for (int k = 0; k < 16; ++k) {
+			x = std::sqrt(x + 1.0);
+		}
+		return x;
+	}
+
+	// Binary task tree: every node forks one child job and recurses into the other, down to leaves of leafWork
+	double taskTree(Doobius::JobSystem& jobs, std::uint32_t depth, std::size_t leafWork) {
+		if (depth == 0) {
+			double sum = 0.0;
+			for (std::size_t i = 0; i < leafWork; ++i) {
+				sum += elementWork(i);
+			}
+			return sum;
+		}
+		double left = 0.0;
+		Doobius::JobCounter counter;
+		jobs.run([&]() { left = taskTree(jobs, depth - 1, leafWork); }, &counter);
+		const double right = taskTree(jobs, depth - 1, leafWork);
+		jobs.wait(counter);
+		return left + right;
+	}
+
+	void reportScaling(Bench::BenchmarkContext& ctx, const std::string& bench, const std::string& caseName, int numThreads,
+		double ns, double singleThreadNs, const Doobius::JobSystemStats& stats) {
+		Bench::json::object metrics;
+		metrics["threads"] = numThreads;
+		metrics["ns_per_run"] = ns;
+		metrics["speedup"] = singleThreadNs / ns;
+		metrics["efficiency"] = singleThreadNs / ns / numThreads;
+		metrics["jobs_executed"] = stats.executed;
+		metrics["jobs_stolen"] = stats.stolen;
+		metrics["jobs_heap_allocated"] = stats.heapAllocated;
+		ctx.report(bench, caseName + "/" + std::to_string(numThreads) + "t", std::move(metrics));
+	}
+}
+
+/**
+ * parallelFor over a compute-bound array at a few grain sizes, on 1..N threads (a fresh JobSystem per thread count).
+ * Args: --elements N, --iterations N, --max_threads N
+ */
+DOOBIUS_BENCHMARK(job_parallel_for)
+{
+	const std::int64_t numElements = ctx.getIntArg("elements", 1 << 20);
+	const std::int64_t iterations = ctx.getIntArg("iterations", 20);
+	const int maxThreads = static_cast<int>(ctx.getIntArg("max_threads", std::max(1u, std::thread::hardware_concurrency())));
+
+	std::vector<double> out(static_cast<std::size_t>(numElements));
+	for (std::size_t grainSize : { std::size_t{ 256 }, std::size_t{ 4096 }, std::size_t{ 65536 } }) {
+		double singleThreadNs = 0.0;
+		for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+			Doobius::JobSystem jobs;
+			jobs.start(makeConfig(numThreads));
+			const double ns = Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+				jobs.parallelFor(0, out.size(), grainSize, [&](std::size_t begin, std::size_t end) {
+					for (std::size_t i = begin; i < end; ++i) {
+						out[i] = elementWork(i);
+					}
+				});
+			});
+			Bench::doNotOptimize(out.data());
+			if (numThreads == 1) {
+				singleThreadNs = ns;
+			}
+			jobs.stop();
+			reportScaling(ctx, "job_parallel_for", "grain_" + std::to_string(grainSize), numThreads, ns, singleThreadNs, jobs.getStats());
+		}
+	}
+}
+
+/**
+ * Fine-grained fork-join: a binary tree of 2^depth tiny leaf jobs with a counter wait at every node, on 1..N threads.
+ * This is mostly scheduler overhead, so ns_per_job is the number to watch. Args: --depth N, --leaf_work N,
+ * --iterations N, --max_threads N
+ */
+DOOBIUS_BENCHMARK(job_task_graph)
+{
+	const std::uint32_t depth = static_cast<std::uint32_t>(ctx.getIntArg("depth", 14));
+	const std::size_t leafWork = static_cast<std::size_t>(ctx.getIntArg("leaf_work", 8));
+	const std::int64_t iterations = ctx.getIntArg("iterations", 20);
+	const int maxThreads = static_cast<int>(ctx.getIntArg("max_threads", std::max(1u, std::thread::hardware_concurrency())));
+	const double numJobs = std::ldexp(1.0, static_cast<int>(depth)) - 1.0;
+
+	double singleThreadNs = 0.0;
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		Doobius::JobSystem jobs;
+		jobs.start(makeConfig(numThreads));
+		double result = 0.0;
+		const double ns = Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			result = taskTree(jobs, depth, leafWork);
+		});
+		Bench::doNotOptimize(result);
+		if (numThreads == 1) {
+			singleThreadNs = ns;
+		}
+		jobs.stop();
+		reportScaling(ctx, "job_task_graph", "depth_" + std::to_string(depth), numThreads, ns, singleThreadNs, jobs.getStats());
+
+		Bench::json::object perJob;
+		perJob["threads"] = numThreads;
+		perJob["ns_per_job"] = ns / numJobs;
+		ctx.report("job_task_graph", "per_job/" + std::to_string(numThreads) + "t", std::move(perJob));
+	}
+}
@@ -0,0 +1,84 @@
+#include "bench_common.h"
+#include "doobius/dbg/log_format.h"
+
+#include <boost/log/attributes/constant.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace {
+	namespace pt = boost::posix_time;
+	using RecordFormatter = void (*)(logging::record_view const&, logging::formatting_ostream&);
+
+	// Timestamps advance by a few tens of microseconds per record, roughly what a busy frame produces
+	std::vector<logging::record_view> makeFormatRecords(std::size_t count) {
+		std::vector<logging::record_view> records;
+		records.reserve(count);
+		const pt::ptime start = pt::microsec_clock::universal_time();
+		for (std::size_t i = 0; i < count; ++i) {
+			logging::attribute_set recAttrs;
+			recAttrs.insert("Severity", attrs::constant<severity_level>(severity_level::warning));
+			recAttrs.insert("TimeStamp", attrs::constant<pt::ptime>(start + pt::microseconds(37 * i)));
+			recAttrs.insert("File", attrs::constant<std::string>("notif_registry.cpp"));
+			recAttrs.insert("Line", attrs::constant<std::uint_least32_t>(static_cast<std::uint_least32_t>(100 + i % 400)));
+			recAttrs.insert("LineID", attrs::constant<unsigned int>(static_cast<unsigned int>(i)));
+			if (i % 2 == 0) {
+				recAttrs.insert("Tag", attrs::constant<std::string>("BenchTag"));
+			}
+
+			logging::record rec = logging::core::get()->open_record(recAttrs);
+			if (!rec) {
+				continue;
+			}
+			{
+				logging::record_ostream recStrm(rec);
+				recStrm << "cb" << i << " is now listening to channel" << (i % 7) << " in RootNotifReg";
+				recStrm.flush();
+			}
+			records.push_back(rec.lock());
+		}
+		return records;
+	}
+
+	double nsPerRecord(RecordFormatter formatter, const std::vector<logging::record_view>& records, std::int64_t iterations) {
+		std::string out;
+		logging::formatting_ostream strm(out);
+		return Doobius::Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+			out.clear();
+			formatter(records[static_cast<std::size_t>(i) % records.size()], strm);
+			strm.flush();
+			Doobius::Bench::doNotOptimize(out);
+		});
+	}
+}
+
+DOOBIUS_BENCHMARK(log_format)
+{
+	std::filesystem::path logDir = std::filesystem::path(ctx.getStrArg("exe_dir", ".")) / "BenchmarkLogs";
+	DOOBIUS_LOG_MNG().initLogging(logDir);
+	BOOST_LOG_NAMED_SCOPE("LogFormatBench");
+
+	const std::int64_t iterations = ctx.getIntArg("iterations", 500000);
+	std::vector<logging::record_view> records = makeFormatRecords(1024);
+
+	struct FormatterCase {
+		const char* name;
+		RecordFormatter formatter;
+	};
+	const FormatterCase cases[] = {
+		{ "file_legacy", &Doobius::Log::fileLogRecordFormat },
+		{ "file_fast", &Doobius::Log::fastFileLogRecordFormat },
+		{ "console_legacy", &Doobius::Log::consoleLogRecordFormat },
+		{ "console_fast", &Doobius::Log::fastConsoleLogRecordFormat },
+	};
+
+	for (const FormatterCase& fmtCase : cases) {
+		// One untimed pass so every case starts with warm caches
+		nsPerRecord(fmtCase.formatter, records, static_cast<std::int64_t>(records.size()));
+		double ns = nsPerRecord(fmtCase.formatter, records, iterations);
+
+		Doobius::Bench::json::object metrics;
+		metrics["iterations"] = iterations;
+		metrics["ns_per_record"] = ns;
+		metrics["records_per_sec"] = 1e9 / ns;
+		ctx.report("log_format", fmtCase.name, std::move(metrics));
+	}
+}
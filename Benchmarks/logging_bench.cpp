@@ -0,0 +1,142 @@
+#include "bench_common.h"
+#include "doobius/dbg/logging.h"
+
+#include <fstream>
+#include <thread>
+
+namespace {
+	struct LoggingBenchCase {
+		std::string name;
+		bool consoleSink;
+		bool emitted;					// info (passes the filter) vs trace (suppressed)
+		bool longMessage;
+		std::int64_t rotationSizeInMb;
+	};
+
+	const std::string g_shortMessage = "Callback cb7 is now listening to InputChannel";
+	const std::string g_longMessage(512, 'x');
+
+	/**
+	 * Writes a log config in the same shape as log_config.json with every build config set to the same values, so the
+	 * benchmark measures the same pipeline whichever configuration it was built in.
+	 */
+	std::filesystem::path writeBenchLogConfig(const std::filesystem::path& dir, const LoggingBenchCase& benchCase) {
+		auto perConfig = [](Doobius::Bench::json::value val) {
+			return Doobius::Bench::json::object{ { "dbg", val }, { "rel-dev", val }, { "rel", val } };
+		};
+		Doobius::Bench::json::object config;
+		config["min_severity"] = perConfig("debug");
+		config["console_min_severity"] = perConfig("debug");
+		config["log_file_prefix"] = perConfig(Doobius::Bench::json::value(benchCase.name));
+		config["rotation_size"] = perConfig(benchCase.rotationSizeInMb);
+		config["console_sink_enabled"] = perConfig(benchCase.consoleSink);
+
+		std::filesystem::create_directories(dir);
+		std::filesystem::path configPath = dir / (benchCase.name + "_config.json");
+		std::ofstream configFile(configPath);
+		configFile << Doobius::Bench::json::serialize(config);
+		return configPath;
+	}
+
+	void logOnce(bool emitted, const std::string& msg, std::int64_t i) {
+		if (emitted) {
+			DOOBIUS_CLOG(info) << msg << ' ' << i;
+		}
+		else {
+			DOOBIUS_CLOG(trace) << msg << ' ' << i;
+		}
+	}
+
+	void runLoggingCase(Doobius::Bench::BenchmarkContext& ctx, const LoggingBenchCase& benchCase, int numThreads, std::int64_t callsPerThread) {
+		namespace Bench = Doobius::Bench;
+		const std::filesystem::path caseDir = std::filesystem::path(ctx.getStrArg("exe_dir", ".")) / "BenchmarkLogs" / benchCase.name;
+
+		DOOBIUS_LOG_MNG().shutdownLogging();
+		std::filesystem::remove_all(caseDir);
+		DOOBIUS_LOG_MNG().initLogging(caseDir, writeBenchLogConfig(caseDir, benchCase));
+
+		const std::string& msg = benchCase.longMessage ? g_longMessage : g_shortMessage;
+		std::vector<std::vector<std::int64_t>> perThreadLatencies(numThreads);
+		std::vector<std::thread> workers;
+
+		Bench::BenchClock::time_point wallStart = Bench::BenchClock::now();
+		for (int t = 0; t < numThreads; ++t) {
+			workers.emplace_back([&, t]() {
+				BOOST_LOG_NAMED_SCOPE("LoggingBench");
+				std::vector<std::int64_t>& latencies = perThreadLatencies[t];
+				latencies.reserve(static_cast<std::size_t>(callsPerThread));
+				for (std::int64_t i = 0; i < callsPerThread; ++i) {
+					Bench::BenchClock::time_point callStart = Bench::BenchClock::now();
+					logOnce(benchCase.emitted, msg, i);
+					latencies.push_back(Bench::elapsedNs(callStart, Bench::BenchClock::now()));
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		logging::core::get()->flush();
+		const std::int64_t wallNs = Bench::elapsedNs(wallStart, Bench::BenchClock::now());
+
+		std::vector<std::int64_t> allLatencies;
+		for (auto& latencies : perThreadLatencies) {
+			allLatencies.insert(allLatencies.end(), latencies.begin(), latencies.end());
+		}
+
+		std::uintmax_t bytesWritten = 0, numFiles = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(caseDir)) {
+			if (entry.path().extension() == ".log") {
+				bytesWritten += entry.file_size();
+				++numFiles;
+			}
+		}
+
+		DOOBIUS_LOG_MNG().shutdownLogging();
+		if (!ctx.hasArg("keep_logs")) {
+			std::filesystem::remove_all(caseDir);
+		}
+
+		Bench::json::object metrics = Bench::summarizeLatencies(allLatencies);
+		metrics["threads"] = numThreads;
+		metrics["calls_per_thread"] = callsPerThread;
+		metrics["console_sink"] = benchCase.consoleSink;
+		metrics["emitted"] = benchCase.emitted;
+		metrics["message_bytes"] = msg.size();
+		metrics["rotation_size_mb"] = benchCase.rotationSizeInMb;
+		metrics["wall_ms"] = static_cast<double>(wallNs) / 1e6;
+		metrics["calls_per_sec"] = static_cast<double>(numThreads * callsPerThread) * 1e9 / static_cast<double>(wallNs);
+		metrics["log_bytes_written"] = bytesWritten;
+		metrics["log_files"] = numFiles;
+		ctx.report("logging_throughput", benchCase.name + "_t" + std::to_string(numThreads), std::move(metrics));
+	}
+}
+
+/**
+ * Per-call latency (each DOOBIUS_CLOG timed individually, so ~20ns of clock overhead is included in every sample)
+ * and aggregate throughput of the logging pipeline, for 1..max_threads threads.
+ * Args: --max_threads N (default hardware concurrency), --calls N per thread, --keep_logs
+ */
+DOOBIUS_BENCHMARK(logging_throughput)
+{
+	const int maxThreads = static_cast<int>(ctx.getIntArg("max_threads", std::max(1u, std::thread::hardware_concurrency())));
+	const std::int64_t calls = ctx.getIntArg("calls", 20000);
+
+	constexpr std::int64_t noRotationMb = 4096;
+	const LoggingBenchCase cases[] = {
+		{ "suppressed_file_short", false, false, false, noRotationMb },
+		{ "emitted_file_short", false, true, false, noRotationMb },
+		{ "emitted_file_long", false, true, true, noRotationMb },
+		{ "emitted_console_file_short", true, true, false, noRotationMb },
+		{ "emitted_console_file_long", true, true, true, noRotationMb },
+		{ "emitted_file_long_rotating", false, true, true, 1 },
+	};
+
+	for (const LoggingBenchCase& benchCase : cases) {
+		for (int numThreads = 1; ; numThreads = std::min(numThreads * 2, maxThreads)) {
+			runLoggingCase(ctx, benchCase, numThreads, calls);
+			if (numThreads == maxThreads) {
+				break;
+			}
+		}
+	}
+}
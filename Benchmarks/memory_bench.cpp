@@ -0,0 +1,142 @@
+#include "bench_common.h"
+#include "doobius/common/block_pool.h"
+#include "doobius/common/frame_arena.h"
+
+#include <cstdlib>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+	namespace DMem = Doobius::Memory;
+
+	void reportAlloc(Bench::BenchmarkContext& ctx, const std::string& bench, const std::string& caseName, std::int64_t ops, double nsPerOp) {
+		Bench::json::object metrics;
+		metrics["ops"] = ops;
+		metrics["ns_per_op"] = nsPerOp;
+		ctx.report(bench, caseName, std::move(metrics));
+	}
+
+	// Same pseudo-random sizes for every allocator, mostly small like the engine's strings and nodes
+	std::vector<std::size_t> makeSizes(std::size_t count) {
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<std::size_t> small(8, 128);
+		std::uniform_int_distribution<std::size_t> medium(129, 1024);
+		std::vector<std::size_t> sizes(count);
+		for (std::size_t& size : sizes) {
+			size = (rng() % 8 == 0) ? medium(rng) : small(rng);
+		}
+		return sizes;
+	}
+}
+
+/**
+ * One 64 byte allocation freed straight away: the best case for every allocator and the floor for the pool fast path.
+ * Args: --iterations N
+ */
+DOOBIUS_BENCHMARK(alloc_single)
+{
+	const std::int64_t iterations = ctx.getIntArg("iterations", 20000000);
+
+	reportAlloc(ctx, "alloc_single", "malloc", iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+		void* p = std::malloc(64);
+		Bench::doNotOptimize(p);
+		std::free(p);
+	}));
+
+	reportAlloc(ctx, "alloc_single", "block_pool", iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+		void* p = DMem::BlockPools::allocate(64);
+		Bench::doNotOptimize(p);
+		DMem::BlockPools::deallocate(p, 64);
+	}));
+
+	DMem::FrameArena arena;
+	reportAlloc(ctx, "alloc_single", "frame_arena", iterations, Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+		void* p = arena.allocate(64);
+		Bench::doNotOptimize(p);
+		// Reset every 4096 allocations, about what a busy frame would take
+		if ((i & 4095) == 4095) {
+			arena.reset();
+		}
+	}));
+}
+
+/**
+ * A frame's worth of mixed-size allocations (8..1024 bytes) kept alive together, then all freed, which is where
+ * fragmentation and free-list walks show up. Args: --batch N, --rounds N
+ */
+DOOBIUS_BENCHMARK(alloc_batch)
+{
+	const std::size_t batch = static_cast<std::size_t>(ctx.getIntArg("batch", 4096));
+	const std::int64_t rounds = ctx.getIntArg("rounds", 2000);
+	const std::vector<std::size_t> sizes = makeSizes(batch);
+	std::vector<void*> ptrs(batch);
+	const std::int64_t ops = rounds * static_cast<std::int64_t>(batch);
+
+	reportAlloc(ctx, "alloc_batch", "malloc", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		for (std::size_t i = 0; i < batch; ++i) {
+			ptrs[i] = std::malloc(sizes[i]);
+		}
+		Bench::doNotOptimize(ptrs.data());
+		for (std::size_t i = 0; i < batch; ++i) {
+			std::free(ptrs[i]);
+		}
+	}) / static_cast<double>(batch));
+
+	reportAlloc(ctx, "alloc_batch", "block_pool", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		for (std::size_t i = 0; i < batch; ++i) {
+			ptrs[i] = DMem::BlockPools::allocate(sizes[i]);
+		}
+		Bench::doNotOptimize(ptrs.data());
+		for (std::size_t i = 0; i < batch; ++i) {
+			DMem::BlockPools::deallocate(ptrs[i], sizes[i]);
+		}
+	}) / static_cast<double>(batch));
+
+	DMem::FrameArena arena;
+	reportAlloc(ctx, "alloc_batch", "frame_arena", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		for (std::size_t i = 0; i < batch; ++i) {
+			ptrs[i] = arena.allocate(sizes[i]);
+		}
+		Bench::doNotOptimize(ptrs.data());
+		arena.reset();
+	}) / static_cast<double>(batch));
+}
+
+/**
+ * Filling and destroying a node container through std::pmr: default heap resource, the block pools and the frame
+ * arena, against a plain std::map. Args: --nodes N, --rounds N
+ */
+DOOBIUS_BENCHMARK(alloc_pmr_map)
+{
+	const int nodes = static_cast<int>(ctx.getIntArg("nodes", 10000));
+	const std::int64_t rounds = ctx.getIntArg("rounds", 200);
+	const std::int64_t ops = rounds * nodes;
+
+	reportAlloc(ctx, "alloc_pmr_map", "std_map", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		std::map<int, int> map;
+		for (int i = 0; i < nodes; ++i) {
+			map.emplace(i, i);
+		}
+		Bench::doNotOptimize(map.size());
+	}) / nodes);
+
+	reportAlloc(ctx, "alloc_pmr_map", "pmr_block_pool", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		std::pmr::map<int, int> map(DMem::getBlockPoolResource());
+		for (int i = 0; i < nodes; ++i) {
+			map.emplace(i, i);
+		}
+		Bench::doNotOptimize(map.size());
+	}) / nodes);
+
+	reportAlloc(ctx, "alloc_pmr_map", "pmr_frame_arena", ops, Bench::measureNsPerOp(rounds, [&](std::int64_t) {
+		DMem::FrameArena::advanceFrame();
+		std::pmr::map<int, int> map(DMem::getFrameArenaResource());
+		for (int i = 0; i < nodes; ++i) {
+			map.emplace(i, i);
+		}
+		Bench::doNotOptimize(map.size());
+	}) / nodes);
+}
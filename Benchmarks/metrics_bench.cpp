@@ -0,0 +1,104 @@
+#include "bench_common.h"
+#include "doobius/common/metrics_registry.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+	namespace DPerf = Doobius::Perf;
+
+	// Starts every worker at once so the contended window covers the whole measurement
+	template<typename Fn>
+	double runContended(int numThreads, std::int64_t opsPerThread, Fn&& op) {
+		std::atomic<int> ready{ 0 };
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> workers;
+		for (int t = 0; t < numThreads; ++t) {
+			workers.emplace_back([&]() {
+				ready.fetch_add(1);
+				while (!go.load(std::memory_order_acquire)) {
+				}
+				for (std::int64_t i = 0; i < opsPerThread; ++i) {
+					op(i);
+				}
+			});
+		}
+		while (ready.load() != numThreads) {
+		}
+		Bench::BenchClock::time_point start = Bench::BenchClock::now();
+		go.store(true, std::memory_order_release);
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		return static_cast<double>(Bench::elapsedNs(start, Bench::BenchClock::now()));
+	}
+
+	void reportContended(Bench::BenchmarkContext& ctx, const std::string& caseName, int numThreads, std::int64_t opsPerThread, double totalNs) {
+		const double totalOps = static_cast<double>(opsPerThread) * numThreads;
+		Bench::json::object metrics;
+		metrics["threads"] = numThreads;
+		metrics["ops_per_thread"] = opsPerThread;
+		metrics["wall_ns_per_op"] = totalNs / totalOps;
+		metrics["thread_ns_per_op"] = totalNs / static_cast<double>(opsPerThread);
+		metrics["mops_per_s"] = totalOps / totalNs * 1e3;
+		ctx.report("metrics_contention", caseName + "/" + std::to_string(numThreads) + "t", std::move(metrics));
+	}
+}
+
+/**
+ * Many threads hammering one counter: the sharded Counter against a single shared atomic and a mutex-guarded integer,
+ * plus Histogram::observe and Gauge::add on the same footing. Args: --ops N (per thread), --max_threads N
+ */
+DOOBIUS_BENCHMARK(metrics_contention)
+{
+	const std::int64_t opsPerThread = ctx.getIntArg("ops", 2000000);
+	const int maxThreads = static_cast<int>(ctx.getIntArg("max_threads", std::max(2u, std::thread::hardware_concurrency())));
+
+	DPerf::MetricsRegistry& metrics = DPerf::MetricsRegistry::get();
+	DPerf::Counter& counter = metrics.getCounter("bench_contended_total", "Benchmark counter");
+	DPerf::Gauge& gauge = metrics.getGauge("bench_contended_gauge", "Benchmark gauge");
+	DPerf::Histogram& histogram = metrics.getHistogram("bench_contended_ms", "Benchmark histogram", { 0.1, 0.5, 1, 2, 4, 8, 16, 33, 100 });
+
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		reportContended(ctx, "sharded_counter", numThreads, opsPerThread, runContended(numThreads, opsPerThread, [&](std::int64_t) {
+			counter.inc();
+		}));
+
+		alignas(64) std::atomic<std::uint64_t> shared{ 0 };
+		reportContended(ctx, "shared_atomic", numThreads, opsPerThread, runContended(numThreads, opsPerThread, [&](std::int64_t) {
+			shared.fetch_add(1, std::memory_order_relaxed);
+		}));
+
+		// Fewer ops for the mutex, it gets slow enough with many threads to dominate the run
+		std::mutex mutex;
+		std::uint64_t guarded = 0;
+		const std::int64_t mutexOps = std::max<std::int64_t>(1, opsPerThread / 10);
+		reportContended(ctx, "mutex_counter", numThreads, mutexOps, runContended(numThreads, mutexOps, [&](std::int64_t) {
+			std::lock_guard<std::mutex> lock(mutex);
+			++guarded;
+		}));
+		Bench::doNotOptimize(guarded);
+
+		reportContended(ctx, "sharded_gauge", numThreads, opsPerThread, runContended(numThreads, opsPerThread, [&](std::int64_t i) {
+			gauge.add((i & 1) ? 1 : -1);
+		}));
+
+		reportContended(ctx, "histogram_observe", numThreads, opsPerThread, runContended(numThreads, opsPerThread, [&](std::int64_t i) {
+			histogram.observe(static_cast<double>(i & 31));
+		}));
+	}
+
+	// Cost of one export with everything above registered, since the exporter thread pays it on every period
+	std::string rendered;
+	const std::int64_t renderIterations = ctx.getIntArg("render_iterations", 1000);
+	double renderNs = Bench::measureNsPerOp(renderIterations, [&](std::int64_t) {
+		rendered = metrics.renderPrometheus();
+	});
+	Bench::json::object renderMetrics;
+	renderMetrics["iterations"] = renderIterations;
+	renderMetrics["ns_per_render"] = renderNs;
+	renderMetrics["bytes"] = rendered.size();
+	ctx.report("metrics_contention", "render_prometheus", std::move(renderMetrics));
+}
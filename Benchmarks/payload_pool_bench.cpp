@@ -0,0 +1,89 @@
+#include "bench_common.h"
+#include "doobius/common/notif_registry.h"
+#include "doobius/common/payload_pool.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace Doobius::Literals;
+
+namespace {
+	namespace Bench = Doobius::Bench;
+	namespace Memory = Doobius::Memory;
+	namespace Notification = Doobius::Notification;
+
+	inline void fill(std::byte* data, std::size_t bytes, std::int64_t i) {
+		std::memset(data, static_cast<int>(i & 0xFF), bytes);
+	}
+
+	/**
+	 * Registers numSubscribers callbacks on one channel; every one keeps what it gets until the next update, the way a
+	 * renderer keeps the last mesh delta. keep turns the notification into whatever the subscriber stores.
+	 */
+	template<typename T, typename Stored, typename KeepFn>
+	void subscribeKeepers(Notification::NotificationRegistry& registry, std::vector<Stored>& kept, std::int64_t numSubscribers, KeepFn keep) {
+		kept.resize(static_cast<std::size_t>(numSubscribers));
+		registry.createNotificationChannel("payloads");
+		for (std::int64_t s = 0; s < numSubscribers; ++s) {
+			const std::string cbName = "keeper_" + std::to_string(s);
+			registry.registerCallback<T>([&kept, s, keep](const T& payload) { kept[static_cast<std::size_t>(s)] = keep(payload); }, cbName);
+			registry.registerCallbackToChannel(cbName, "payloads");
+		}
+	}
+}
+
+/**
+ * Publishing a large payload to subscribers that keep it: a std::vector every subscriber copies, against a pooled
+ * PayloadHandle every subscriber shares. Args: --iterations N, --subscribers N, --min_bytes N, --max_bytes N (x8 per case)
+ */
+DOOBIUS_BENCHMARK(payload_pool)
+{
+	const std::int64_t iterations = ctx.getIntArg("iterations", 2000);
+	const std::int64_t numSubscribers = ctx.getIntArg("subscribers", 8);
+	const std::int64_t minBytes = ctx.getIntArg("min_bytes", 4096);
+	const std::int64_t maxBytes = ctx.getIntArg("max_bytes", 1 << 20);
+
+	for (std::int64_t payloadBytes = minBytes; payloadBytes <= maxBytes; payloadBytes *= 8) {
+		const std::size_t bytes = static_cast<std::size_t>(payloadBytes);
+		const std::string sizeSuffix = "/" + std::to_string(payloadBytes);
+		auto report = [&](const std::string& caseName, double nsPerPublish, Bench::json::object metrics) {
+			metrics["payload_bytes"] = payloadBytes;
+			metrics["subscribers"] = numSubscribers;
+			metrics["ns_per_publish"] = nsPerPublish;
+			metrics["gb_per_s"] = static_cast<double>(payloadBytes) / nsPerPublish;
+			ctx.report("payload_pool", caseName + sizeSuffix, std::move(metrics));
+		};
+
+		{
+			Notification::NotificationRegistry registry("PayloadBenchCopy");
+			std::vector<std::vector<std::byte>> kept;
+			subscribeKeepers<std::vector<std::byte>>(registry, kept, numSubscribers, [](const std::vector<std::byte>& payload) { return payload; });
+			std::vector<std::byte> payload(bytes);
+			report("vector_copy", Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+				fill(payload.data(), bytes, i);
+				registry.updateChannel("payloads"_sid, payload);
+			}), {});
+		}
+
+		{
+			Notification::NotificationRegistry registry("PayloadBenchPooled");
+			std::vector<Memory::PayloadHandle> kept;
+			subscribeKeepers<Memory::PayloadHandle>(registry, kept, numSubscribers, [](const Memory::PayloadHandle& payload) { return payload; });
+			const Memory::PayloadPoolStats before = Memory::PayloadPool::getStats();
+			const double nsPerPublish = Bench::measureNsPerOp(iterations, [&](std::int64_t i) {
+				Memory::MutablePayload payload = Memory::PayloadPool::acquire(bytes);
+				fill(payload.data(), bytes, i);
+				registry.updateChannel("payloads"_sid, std::move(payload).publish());
+			});
+			const Memory::PayloadPoolStats after = Memory::PayloadPool::getStats();
+			Bench::json::object metrics;
+			const std::size_t sizeClass = Memory::payloadSizeClassOf(bytes);
+			if (bytes <= Memory::g_payloadMaxPooledSize) {
+				metrics["pool_heap_allocations"] = after.sizeClasses[sizeClass].heapAllocations - before.sizeClasses[sizeClass].heapAllocations;
+				metrics["pool_buffers"] = after.sizeClasses[sizeClass].buffers;
+			}
+			report("pooled_handle", nsPerPublish, std::move(metrics));
+		}
+	}
+	Memory::PayloadPool::trim();
+}
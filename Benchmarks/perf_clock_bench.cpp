@@ -0,0 +1,48 @@
+#include "bench_common.h"
+#include "doobius/common/perf_clock.h"
+
+namespace {
+	using ReadClockFn = std::uint64_t (*)();
+
+	std::uint64_t readHighResolution() {
+		return static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	}
+}
+
+/**
+ * Cost of one read of each clock source CodeTimer and the profiler could sit on. Args: --iterations N
+ */
+DOOBIUS_BENCHMARK(perf_clock)
+{
+	namespace DPerf = Doobius::Perf;
+	const std::int64_t iterations = ctx.getIntArg("iterations", 10000000);
+
+	struct ClockCase {
+		const char* name;
+		ReadClockFn read;
+	};
+	const ClockCase cases[] = {
+		{ "high_resolution_clock", &readHighResolution },
+		{ "steady_clock", &DPerf::PerfClock::readSteady },
+#if DOOBIUS_HAS_TSC
+		{ "rdtsc", &DPerf::PerfClock::readTsc },
+		{ "rdtscp", &DPerf::PerfClock::readTscOrdered },
+#endif
+		{ "perf_clock_now", &DPerf::PerfClock::now },
+		{ "perf_clock_now_ordered", &DPerf::PerfClock::nowOrdered },
+	};
+
+	DPerf::PerfClock& clock = DPerf::PerfClock::get();
+	for (const ClockCase& clockCase : cases) {
+		double ns = Doobius::Bench::measureNsPerOp(iterations, [&](std::int64_t) {
+			Doobius::Bench::doNotOptimize(clockCase.read());
+		});
+
+		Doobius::Bench::json::object metrics;
+		metrics["iterations"] = iterations;
+		metrics["ns_per_read"] = ns;
+		metrics["perf_clock_source"] = clock.getSource() == DPerf::ClockSource::TSC ? "tsc" : "steady_clock";
+		metrics["ticks_per_ns"] = clock.getTicksPerNs();
+		ctx.report("perf_clock", clockCase.name, std::move(metrics));
+	}
+}
@@ -0,0 +1,159 @@
+#include "bench_common.h"
+#include "doobius/common/triple_buffer.h"
+
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	namespace Bench = Doobius::Bench;
+
+	struct BenchSnapshot {
+		std::uint64_t sequence = 0;
+		std::int64_t publishNs = 0;
+		std::vector<std::uint8_t> state;
+	};
+
+	inline std::int64_t nowNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Bench::BenchClock::now().time_since_epoch()).count();
+	}
+
+	// Fills the simulation state the way a producer would, touching every byte
+	inline void simulate(std::vector<std::uint8_t>& state, std::uint64_t sequence) {
+		std::memset(state.data(), static_cast<int>(sequence & 0xFF), state.size());
+	}
+
+	// The current pattern: the producer copies its state in under a mutex and the consumer copies it back out
+	class MutexCopyChannel {
+	private:
+		std::mutex m_mutex;
+		BenchSnapshot m_shared;
+		BenchSnapshot m_producerState;
+		BenchSnapshot m_consumerCopy;
+	public:
+		MutexCopyChannel(std::size_t stateBytes) {
+			m_shared.state.resize(stateBytes);
+			m_producerState.state.resize(stateBytes);
+			m_consumerCopy.state.resize(stateBytes);
+		}
+
+		void publish(std::uint64_t sequence) {
+			simulate(m_producerState.state, sequence);
+			m_producerState.sequence = sequence;
+			m_producerState.publishNs = nowNs();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_shared.sequence = m_producerState.sequence;
+			m_shared.publishNs = m_producerState.publishNs;
+			std::memcpy(m_shared.state.data(), m_producerState.state.data(), m_shared.state.size());
+		}
+
+		const BenchSnapshot* poll(std::uint64_t lastSequence) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_shared.sequence == lastSequence) {
+				return nullptr;
+			}
+			m_consumerCopy.sequence = m_shared.sequence;
+			m_consumerCopy.publishNs = m_shared.publishNs;
+			std::memcpy(m_consumerCopy.state.data(), m_shared.state.data(), m_shared.state.size());
+			return &m_consumerCopy;
+		}
+	};
+
+	// The producer simulates straight into the back buffer and the consumer reads the front buffer in place
+	class TripleBufferChannel {
+	private:
+		Doobius::Notification::TripleBuffer<BenchSnapshot> m_buffer;
+	public:
+		TripleBufferChannel(std::size_t stateBytes) : m_buffer(BenchSnapshot{ 0, 0, std::vector<std::uint8_t>(stateBytes) }) {}
+
+		void publish(std::uint64_t sequence) {
+			BenchSnapshot& back = m_buffer.backBuffer();
+			simulate(back.state, sequence);
+			back.sequence = sequence;
+			back.publishNs = nowNs();
+			m_buffer.publish();
+		}
+
+		const BenchSnapshot* poll(std::uint64_t) {
+			return m_buffer.update() ? &m_buffer.front() : nullptr;
+		}
+	};
+
+	/**
+	 * One producer publishing every intervalNs while one consumer spins on poll(). Records publish-to-read latency for
+	 * every snapshot the consumer sees, plus the cost of the producer's publish and the consumer's poll calls.
+	 */
+	template<typename Channel>
+	Bench::json::object runHandOff(std::size_t stateBytes, std::int64_t numSnapshots, std::int64_t intervalNs) {
+		Channel channel(stateBytes);
+		std::vector<std::int64_t> publishNs;
+		publishNs.reserve(static_cast<std::size_t>(numSnapshots));
+
+		std::thread producer([&]() {
+			std::int64_t nextPublish = nowNs();
+			for (std::int64_t seq = 1; seq <= numSnapshots; ++seq) {
+				while (nowNs() < nextPublish) {
+				}
+				nextPublish += intervalNs;
+				const std::int64_t start = nowNs();
+				channel.publish(static_cast<std::uint64_t>(seq));
+				publishNs.push_back(nowNs() - start);
+			}
+		});
+
+		std::vector<std::int64_t> latencies;
+		latencies.reserve(static_cast<std::size_t>(numSnapshots));
+		std::uint64_t lastSequence = 0, checksum = 0;
+		std::int64_t numPolls = 0, pollNs = 0;
+		while (lastSequence < static_cast<std::uint64_t>(numSnapshots)) {
+			const std::int64_t pollStart = nowNs();
+			const BenchSnapshot* snapshot = channel.poll(lastSequence);
+			const std::int64_t pollEnd = nowNs();
+			pollNs += pollEnd - pollStart;
+			++numPolls;
+			if (snapshot == nullptr) {
+				continue;
+			}
+			latencies.push_back(pollEnd - snapshot->publishNs);
+			checksum += snapshot->state[snapshot->state.size() / 2];
+			lastSequence = snapshot->sequence;
+		}
+		producer.join();
+		Bench::doNotOptimize(checksum);
+
+		const double numSeen = static_cast<double>(latencies.size());
+		Bench::json::object metrics = Bench::summarizeLatencies(latencies);
+		metrics["state_bytes"] = stateBytes;
+		metrics["published"] = numSnapshots;
+		metrics["seen_fraction"] = numSeen / static_cast<double>(numSnapshots);
+		metrics["mean_poll_ns"] = static_cast<double>(pollNs) / static_cast<double>(numPolls);
+		std::int64_t totalPublishNs = 0;
+		for (std::int64_t ns : publishNs) {
+			totalPublishNs += ns;
+		}
+		metrics["mean_publish_ns"] = static_cast<double>(totalPublishNs) / static_cast<double>(numSnapshots);
+		return metrics;
+	}
+}
+
+/**
+ * Latest-state hand-off from a simulation thread to a consumer thread: TripleBuffer against a mutex-protected copy in
+ * and out. Latency is publish-to-read per snapshot the consumer saw. Needs two free cores, both threads spin.
+ * Args: --snapshots N, --interval_ns N (producer period), --min_bytes N, --max_bytes N (state size, x16 per case)
+ */
+DOOBIUS_BENCHMARK(triple_buffer)
+{
+	const std::int64_t numSnapshots = ctx.getIntArg("snapshots", 100000);
+	const std::int64_t intervalNs = ctx.getIntArg("interval_ns", 10000);
+	const std::int64_t minBytes = ctx.getIntArg("min_bytes", 256);
+	const std::int64_t maxBytes = ctx.getIntArg("max_bytes", 65536);
+
+	for (std::int64_t stateBytes = minBytes; stateBytes <= maxBytes; stateBytes *= 16) {
+		const std::string sizeSuffix = "/" + std::to_string(stateBytes);
+		ctx.report("triple_buffer", "mutex_copy" + sizeSuffix,
+			runHandOff<MutexCopyChannel>(static_cast<std::size_t>(stateBytes), numSnapshots, intervalNs));
+		ctx.report("triple_buffer", "triple_buffer" + sizeSuffix,
+			runHandOff<TripleBufferChannel>(static_cast<std::size_t>(stateBytes), numSnapshots, intervalNs));
+	}
+}
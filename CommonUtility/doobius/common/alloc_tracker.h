@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Global operator new/delete are only replaced in instrumented builds: Debug and DebugUnitTests unless overridden
+#if !defined(DOOBIUS_ALLOC_TRACKING_ENABLED)
+#if defined(Debug_CONFIG) || defined(DebugUnitTests_CONFIG)
+#define DOOBIUS_ALLOC_TRACKING_ENABLED 1
+#else
+#define DOOBIUS_ALLOC_TRACKING_ENABLED 0
+#endif
+#endif
+
+#define DOOBIUS_ALLOC_SCOPE_CONCAT_IMPL(A, B) A##B
+#define DOOBIUS_ALLOC_SCOPE_CONCAT(A, B) DOOBIUS_ALLOC_SCOPE_CONCAT_IMPL(A, B)
+
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+// Attributes heap allocations in the enclosing scope to NAME. Profile zones and frame scopes already do this.
+#define DOOBIUS_ALLOC_SCOPE(NAME) Doobius::Perf::AllocScope DOOBIUS_ALLOC_SCOPE_CONCAT(_doobiusAllocScope, __LINE__)(NAME)
+#else
+#define DOOBIUS_ALLOC_SCOPE(NAME) ((void)0)
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		struct AllocStats {
+			std::uint64_t allocs = 0;
+			std::uint64_t bytes = 0;
+			std::uint64_t frees = 0;
+		};
+
+		struct AllocScopeStats {
+			std::string name;
+			std::uint64_t allocs = 0;
+			std::uint64_t bytes = 0;
+		};
+
+		/**
+		 * \brief Counts what the replaced global operator new/delete see, per thread and in total, and attributes each
+		 * allocation's count and size to the innermost named scope active on the allocating thread. Per-scope stats
+		 * live in a fixed table keyed by the name pointer so the tracker never allocates itself.
+		 *
+		 * When DOOBIUS_ALLOC_TRACKING_ENABLED is 0 nothing is replaced and every stat stays at 0.
+		 */
+		class AllocTracker {
+		private:
+			AllocTracker() = default;
+			~AllocTracker() = default;
+		public:
+			AllocTracker(const AllocTracker&) = delete;
+			AllocTracker& operator=(const AllocTracker&) = delete;
+			AllocTracker(AllocTracker&&) = delete;
+			AllocTracker& operator=(AllocTracker&&) = delete;
+
+			static AllocTracker& get();
+
+			static constexpr bool isEnabled() { return DOOBIUS_ALLOC_TRACKING_ENABLED != 0; }
+
+			// NAME must outlive the tracker (a string literal or a static string), only the pointer is kept
+			static void pushScope(const char* name);
+			static void popScope();
+
+			AllocStats getGlobalStats() const;
+			// Stats of the calling thread since it started
+			AllocStats getThreadStats() const;
+			// Sorted by bytes, largest first. Allocations outside any scope are reported as "(unscoped)".
+			std::vector<AllocScopeStats> getScopeStats() const;
+
+			void resetScopeStats();
+			void logReport() const;
+		};
+
+		class AllocScope {
+		public:
+			explicit AllocScope(const char* name) { AllocTracker::pushScope(name); }
+			~AllocScope() { AllocTracker::popScope(); }
+
+			AllocScope(const AllocScope&) = delete;
+			AllocScope& operator=(const AllocScope&) = delete;
+		};
+
+		/**
+		 * \brief Number of heap allocations the calling thread makes while running fn. Meant for tests, e.g.
+		 * BOOST_TEST(countThreadAllocations([&] { reg.updateChannel(...); }) == 0u); always 0 without tracking.
+		 */
+		template<typename Fn>
+		inline std::uint64_t countThreadAllocations(Fn&& fn) {
+			const std::uint64_t before = AllocTracker::get().getThreadStats().allocs;
+			fn();
+			return AllocTracker::get().getThreadStats().allocs - before;
+		}
+	};
+};
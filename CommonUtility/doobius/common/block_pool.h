@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "doobius/common/virtual_memory.h"
+
+namespace Doobius {
+	namespace Memory {
+		// Block sizes 16, 32, 64, ... g_poolMaxBlockSize; anything bigger goes to the heap
+		constexpr std::size_t g_poolMinBlockSize = 16;
+		constexpr std::size_t g_poolNumSizeClasses = 8;
+		constexpr std::size_t g_poolMaxBlockSize = g_poolMinBlockSize << (g_poolNumSizeClasses - 1);
+		// Threads carve blocks out of slabs this big, taken from one shared reserved region
+		constexpr std::size_t g_poolSlabSize = std::size_t{ 64 } << 10;
+
+		constexpr std::size_t poolSizeClassOf(std::size_t size) {
+			std::size_t sizeClass = 0;
+			while ((g_poolMinBlockSize << sizeClass) < size) {
+				++sizeClass;
+			}
+			return sizeClass;
+		}
+
+		struct BlockPoolStats {
+			std::uint64_t slabs = 0;
+			std::size_t committedBytes = 0;
+			// Blocks handed out and not returned yet, per size class. Only counted with DOOBIUS_MEMORY_DEBUG.
+			std::array<std::int64_t, g_poolNumSizeClasses> outstanding{};
+			// Freed blocks found modified when they were handed out again
+			std::uint64_t poisonViolations = 0;
+		};
+
+		/**
+		 * \brief Thread-local pools of fixed-size blocks, one per power-of-two size class. Allocating pops the calling
+		 * thread's free list for the class, or carves the next block from its current slab; freeing pushes onto the
+		 * freeing thread's list, so a block freed on another thread simply migrates there. Free lists of exiting
+		 * threads are handed to whichever thread next runs out. Slabs are never returned to the OS.
+		 *
+		 * Callers must pass the size they allocated with when freeing, as std::pmr does.
+		 */
+		class BlockPools {
+		private:
+			BlockPools() = default;
+		public:
+			// size 0 is treated as 1. Blocks are aligned to their size class up to 64 bytes.
+			static void* allocate(std::size_t size);
+			static void deallocate(void* p, std::size_t size);
+
+			static BlockPoolStats getStats();
+			// Logs every size class with blocks still outstanding and returns how many there are; always 0 without
+			// DOOBIUS_MEMORY_DEBUG
+			static std::int64_t reportLeaks();
+		};
+
+		/**
+		 * \brief std::pmr adapter over BlockPools, for long-lived node containers that churn small allocations, e.g.
+		 * std::pmr::unordered_map<int, Foo> map(getBlockPoolResource()). Requests bigger than g_poolMaxBlockSize or
+		 * aligned past 64 bytes go to the upstream resource.
+		 */
+		class BlockPoolResource : public std::pmr::memory_resource {
+		private:
+			std::pmr::memory_resource* m_upstream;
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+		public:
+			explicit BlockPoolResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : m_upstream(upstream) {}
+		};
+
+		std::pmr::memory_resource* getBlockPoolResource();
+	};
+};
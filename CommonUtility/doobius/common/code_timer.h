@@ -1,14 +1,33 @@
 #pragma once
+#include <optional>
+
 #include "doobius/dbg/logging.h"
+#include "doobius/common/perf_clock.h"
+#include "doobius/common/perf_counters.h"
+#include "doobius/common/timing_registry.h"
 
 namespace Doobius {
 	namespace Perf {
+		enum class CodeTimerMode {
+			LOG,			// Logs a line at debug severity when started and when ended
+			AGGREGATE,		// Records the duration into the TimingRegistry without logging
+			COUNTERS		// Like LOG, plus hardware counter deltas, IPC and miss rates where the platform allows
+		};
+
 		class CodeTimer {
 		private:
-			std::string m_timerName;
-			std::chrono::high_resolution_clock::time_point m_start;
+			StringId m_timerName;
+			CodeTimerMode m_mode;
+			TimerId m_timerId;
+			std::uint64_t m_startTicks;
+			std::optional<PerfCounterScope> m_counterScope;
 		public:
-			CodeTimer(const char* name);
+			CodeTimer(const char* name, CodeTimerMode mode = CodeTimerMode::LOG);
+			// Same, without interning the name on every construction
+			CodeTimer(StringId name, CodeTimerMode mode = CodeTimerMode::LOG);
+			// Aggregating timer for an id from TimingRegistry::getTimerId; skips the name lookup on hot paths
+			explicit CodeTimer(TimerId timerId);
+			// Logs (LOG mode) or records (AGGREGATE mode) and returns the elapsed microseconds
 			long long end() const;
 		};
 	};
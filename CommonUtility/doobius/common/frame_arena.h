@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "doobius/common/virtual_memory.h"
+
+namespace Doobius {
+	namespace Memory {
+		struct FrameArenaStats {
+			std::size_t used = 0;
+			std::size_t highWater = 0;			// Most bytes used in any one frame
+			std::size_t committed = 0;
+			std::uint64_t allocs = 0;			// Since the arena was created
+			std::uint64_t overflowAllocs = 0;	// Served from the heap because the reservation ran out
+		};
+
+		/**
+		 * \brief Linear allocator over a reserved VirtualRegion: allocating is a pointer bump, freeing is a no-op and
+		 * reset() drops everything at once. Pages are committed as the bump pointer first reaches them and stay
+		 * committed, so after a few frames an arena never calls into the OS again. Past the reservation it falls back
+		 * to heap blocks that are freed on the next reset.
+		 *
+		 * Every thread gets its own through forThread(), which resets lazily: the first use after advanceFrame() has
+		 * been called starts a new frame. Memory from it is only valid until the end of the tick it was taken in.
+		 */
+		class FrameArena {
+		public:
+			struct FrameArenaConfig {
+				std::size_t reserveBytes = std::size_t{ 256 } << 20;
+				bool hugePages = true;
+			};
+		private:
+			VirtualRegion m_region;
+			std::size_t m_used;
+			std::size_t m_committed;
+			std::size_t m_highWater;
+			std::uint64_t m_allocs;
+			std::uint64_t m_overflowAllocs;
+			std::vector<std::pair<void*, std::size_t>> m_overflowBlocks;	// Pointer and alignment
+			std::uint64_t m_frameEpoch;
+
+			void* allocateSlow(std::size_t size, std::size_t alignment);
+		public:
+			FrameArena();
+			explicit FrameArena(const FrameArenaConfig& config);
+			~FrameArena();
+
+			FrameArena(const FrameArena&) = delete;
+			FrameArena& operator=(const FrameArena&) = delete;
+
+			// alignment must be a power of two. Never returns nullptr.
+			inline void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+				++m_allocs;
+				const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_region.getBase());
+				const std::uintptr_t start = (base + m_used + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+				const std::size_t end = static_cast<std::size_t>(start - base) + size;
+				if (end > m_committed) {
+					return allocateSlow(size, alignment);
+				}
+				m_used = end;
+#if DOOBIUS_MEMORY_DEBUG
+				std::memset(reinterpret_cast<void*>(start), g_poisonAllocated, size);
+#endif
+				return reinterpret_cast<void*>(start);
+			}
+
+			template<typename T>
+			inline T* allocateArray(std::size_t count) {
+				return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+			}
+
+			// Invalidates everything allocated so far. In debug builds the old contents are overwritten with g_poisonFreed.
+			void reset();
+
+			FrameArenaStats getStats() const;
+
+			// The calling thread's arena, reset first if advanceFrame() was called since this thread last used it
+			static FrameArena& forThread();
+			// Starts a new frame for every thread's arena; Root calls it at the top of every engine loop tick
+			static void advanceFrame();
+			static std::uint64_t getFrameEpoch();
+		};
+
+		/**
+		 * \brief std::pmr adapter allocating from the calling thread's frame arena, for containers that only live for a
+		 * tick: std::pmr::vector<int> scratch(getFrameArenaResource()). Deallocation does nothing.
+		 */
+		class FrameArenaResource : public std::pmr::memory_resource {
+		protected:
+			void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+			void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+		};
+
+		std::pmr::memory_resource* getFrameArenaResource();
+	};
+};
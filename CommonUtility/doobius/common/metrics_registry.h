@@ -0,0 +1,180 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Doobius {
+	namespace Perf {
+		constexpr std::size_t g_numMetricShards = 32;
+
+		// Hands out shard indices round robin; a thread keeps the one it got the first time it touched any metric
+		std::size_t nextMetricShardIdx();
+
+		inline std::size_t getMetricShardIdx() {
+			thread_local const std::size_t shardIdx = nextMetricShardIdx();
+			return shardIdx;
+		}
+
+		using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+		enum class MetricType {
+			COUNTER,
+			GAUGE,
+			HISTOGRAM
+		};
+
+		/**
+		 * \brief Monotonic counter split into cache-line sized shards. Threads only contend when they share a shard,
+		 * which needs more than g_numMetricShards threads touching the same counter. Reads sum every shard.
+		 */
+		class Counter {
+		private:
+			struct alignas(64) Shard {
+				std::atomic<std::uint64_t> value{ 0 };
+			};
+			std::array<Shard, g_numMetricShards> m_shards;
+		public:
+			inline void inc(std::uint64_t amount = 1) {
+				m_shards[getMetricShardIdx()].value.fetch_add(amount, std::memory_order_relaxed);
+			}
+
+			std::uint64_t value() const;
+		};
+
+		/**
+		 * \brief Value that can go up and down, sharded like Counter so add() stays cheap from many threads.
+		 */
+		class Gauge {
+		private:
+			struct alignas(64) Shard {
+				std::atomic<std::int64_t> value{ 0 };
+			};
+			std::array<Shard, g_numMetricShards> m_shards;
+		public:
+			inline void add(std::int64_t delta) {
+				m_shards[getMetricShardIdx()].value.fetch_add(delta, std::memory_order_relaxed);
+			}
+			inline void sub(std::int64_t delta) { add(-delta); }
+
+			// Adds the difference to the current total, so an add() racing with it on another thread can be lost
+			void set(std::int64_t newValue);
+
+			std::int64_t value() const;
+		};
+
+		/**
+		 * \brief Fixed-bucket histogram in the Prometheus sense: bucket i counts observations <= upperBounds[i], with an
+		 * implicit +Inf bucket at the end. Every shard has its own run of cache lines for the counts and the sum.
+		 */
+		class Histogram {
+		public:
+			struct Snapshot {
+				std::vector<double> upperBounds;
+				std::vector<std::uint64_t> bucketCounts;	// Not cumulative, one more entry than upperBounds
+				std::uint64_t count = 0;
+				double sum = 0.0;
+			};
+		private:
+			struct alignas(64) CacheLine {
+				std::atomic<std::uint64_t> words[8];
+			};
+
+			const std::vector<double> m_upperBounds;
+			// Per shard: [sum bits][bucket 0]...[+Inf bucket], padded to whole cache lines
+			const std::size_t m_linesPerShard;
+			std::unique_ptr<CacheLine[]> m_lines;
+
+			inline std::atomic<std::uint64_t>& word(std::size_t shardIdx, std::size_t wordIdx) const {
+				return m_lines[shardIdx * m_linesPerShard + wordIdx / 8].words[wordIdx % 8];
+			}
+		public:
+			explicit Histogram(std::vector<double> upperBounds);
+
+			void observe(double value);
+
+			Snapshot snapshot() const;
+			inline const std::vector<double>& getUpperBounds() const { return m_upperBounds; }
+		};
+
+		/**
+		 * \brief Process-wide home for counters, gauges and histograms, exported as Prometheus text. Lookups take a
+		 * lock, so grab the reference once and keep it; updates through the reference are lock-free. Metrics are never
+		 * removed, so references stay valid until exit.
+		 *
+		 * Callback metrics are sampled at export time instead, for values another module already keeps (LogManager's
+		 * record counts are registered this way when the registry is first used).
+		 */
+		class MetricsRegistry {
+		private:
+			struct MetricSeries {
+				std::string labelStr;	// Already rendered, e.g. registry="Root",channel="Input"
+				std::unique_ptr<Counter> counter;
+				std::unique_ptr<Gauge> gauge;
+				std::unique_ptr<Histogram> histogram;
+				std::function<double()> callback;
+			};
+
+			struct MetricFamily {
+				std::string help;
+				MetricType type;
+				std::vector<std::unique_ptr<MetricSeries>> series;
+			};
+
+			MetricsRegistry();
+			~MetricsRegistry();
+
+			MetricSeries& getSeries(const std::string& name, const std::string& help, MetricType type, const MetricLabels& labels);
+			void registerBuiltinMetrics();
+			void exporterLoop(std::filesystem::path path, std::chrono::milliseconds period);
+
+			mutable std::mutex m_mutex;
+			std::map<std::string, MetricFamily> m_families;
+
+			std::mutex m_exporterMutex;
+			std::condition_variable m_exporterCv;
+			bool m_stopExporter;
+			std::thread m_exporter;
+		public:
+			MetricsRegistry(const MetricsRegistry&) = delete;
+			MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+			MetricsRegistry(MetricsRegistry&&) = delete;
+			MetricsRegistry& operator=(MetricsRegistry&&) = delete;
+
+			static MetricsRegistry& get();
+
+			// Each returns the existing series if one with the same name and labels was already created
+			Counter& getCounter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+			Gauge& getGauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+			// upperBounds must be sorted; a later call for an existing series gets that series' original bounds
+			Histogram& getHistogram(const std::string& name, const std::string& help, std::vector<double> upperBounds, const MetricLabels& labels = {});
+
+			/**
+			 * \brief Counter or gauge whose value is read from fn each time the registry is rendered. Replaces the
+			 * callback of an existing series with the same name and labels. fn runs under the registry lock, so it
+			 * must not touch the registry itself.
+			 */
+			void registerCallback(const std::string& name, const std::string& help, MetricType type, std::function<double()> fn, const MetricLabels& labels = {});
+
+			std::string renderPrometheus() const;
+
+			// Writes to a temporary file next to path and renames it over path, so scrapers never see half a snapshot
+			bool writePrometheusFile(const std::filesystem::path& path) const;
+
+			// Starts a background thread writing path every period. Restarts the exporter if one is already running.
+			void startExporter(const std::filesystem::path& path, std::chrono::milliseconds period);
+			// Stops the background thread after one last write
+			void stopExporter();
+		};
+	};
+};
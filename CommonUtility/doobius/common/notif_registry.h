@@ -7,6 +7,7 @@
 
 #include <boost/function.hpp>
 #include <boost/any.hpp>
+#include <typeinfo>
 #include <boost/container/small_vector.hpp>
 #include <boost/container/flat_map.hpp>
 #include <boost/bimap.hpp>
@@ -19,6 +20,8 @@
 #include <typeindex>
 
 #include "doobius/dbg/custom_assert.h"
+#include "doobius/dbg/string_id.h"
+#include "doobius/common/metrics_registry.h"
 
 namespace Doobius {
 	namespace Notification {
@@ -30,13 +33,16 @@ namespace Doobius {
 		class NotificationRegistry {
 		private:
 			/**
-			 * \brief A callback wrapper containing void<const boost::any&> and a name you can associate with the callback.
+			 * \brief A callback wrapper containing void<const void*> and a name you can associate with the callback.
 			 * Intended for use with the NotificationRegistry. Each callback \b must return void.
 			 *
+			 * The data is passed by pointer so a dispatch never copies it (or allocates the holder a boost::any needs);
+			 * argType is what the callback was registered for and updateChannel checks it before every call.
 			 */
 			struct NotificationCallback {
-				std::string notifieeName;
-				boost::function<void(const boost::any&)> cb;
+				StringId notifieeName;
+				const std::type_info* argType;
+				boost::function<void(const void*)> cb;
 			};
 
 			using CbId = unsigned int;
@@ -47,8 +53,9 @@ namespace Doobius {
 			using CbStr = std::string;
 			using ChannelStr = std::string;
 			using NotificationCallbackRegistry = cont::small_flat_map<CbId, NotificationCallback, g_numNotifCbsOk>;
-			using CallbackIdMapping = boost::bimap<CbId, CbStr>;
-			using ChannelIdMapping = boost::bimap<ChannelId, ChannelStr>;
+			// Names are interned, so every lookup by name compares integers
+			using CallbackIdMapping = boost::bimap<CbId, StringId>;
+			using ChannelIdMapping = boost::bimap<ChannelId, StringId>;
 
 			struct ChannelSubscription {
 				CbId cbId;
@@ -90,6 +97,15 @@ namespace Doobius {
 			CbId m_cbIdCounter;
 			ChannelId m_chlIdCounter;
 
+			// Shared with any other registry of the same name, labelled registry="<name>". Each registry only adds and
+			// subtracts its own changes so the gauges hold the total over all of them.
+			Perf::Counter* m_updatesMetric;
+			Perf::Counter* m_missedUpdatesMetric;
+			Perf::Counter* m_callbacksInvokedMetric;
+			Perf::Gauge* m_callbacksMetric;
+			Perf::Gauge* m_channelsMetric;
+
+			void initMetrics();
 			void unsubCallbackFromChannel(CbId cbId, ChannelId chlId);
 		public:
 			enum class UpdateStatus {
@@ -101,34 +117,63 @@ namespace Doobius {
 
 			NotificationRegistry();
 			NotificationRegistry(const std::string& nameOfNotifReg);
+			// Takes whatever is still registered back out of the shared gauges
+			~NotificationRegistry();
+
+			NotificationRegistry(const NotificationRegistry&) = delete;
+			NotificationRegistry& operator=(const NotificationRegistry&) = delete;
+
+			// Every call taking a channel or callback name also takes a StringId ("Input"_sid, internString(name)), which
+			// skips interning the name on each call. The string overloads intern and forward.
 
-			void createNotificationChannel(const ChannelStr& channelName);
+			void createNotificationChannel(StringId channelName);
+			inline void createNotificationChannel(const ChannelStr& channelName) { createNotificationChannel(internString(channelName)); }
 
 			template<typename T, typename CbType>
-			void registerCallback(CbType&& cb, const CbStr& cbName);
+			void registerCallback(CbType&& cb, StringId cbName);
+			template<typename T, typename CbType>
+			inline void registerCallback(CbType&& cb, const CbStr& cbName) { registerCallback<T>(std::forward<CbType>(cb), internString(cbName)); }
 
 			template<typename T, typename CbType, typename BindingClass>
-			void registerBoundCallback(BindingClass* classInst, CbType&& cb, const CbStr& cbName);
+			void registerBoundCallback(BindingClass* classInst, CbType&& cb, StringId cbName);
+			template<typename T, typename CbType, typename BindingClass>
+			inline void registerBoundCallback(BindingClass* classInst, CbType&& cb, const CbStr& cbName) {
+				registerBoundCallback<T>(classInst, std::forward<CbType>(cb), internString(cbName));
+			}
 
-			UpdateStatus registerCallbackToChannel(const CbStr& cbName, const ChannelStr& chlName);
+			UpdateStatus registerCallbackToChannel(StringId cbName, StringId chlName);
+			inline UpdateStatus registerCallbackToChannel(const CbStr& cbName, const ChannelStr& chlName) {
+				return registerCallbackToChannel(internString(cbName), internString(chlName));
+			}
 
 			template<typename T>
-			UpdateStatus updateChannel(const ChannelStr& chlName, const T& notifData);
+			UpdateStatus updateChannel(StringId chlName, const T& notifData);
+			template<typename T>
+			inline UpdateStatus updateChannel(const ChannelStr& chlName, const T& notifData) { return updateChannel(internString(chlName), notifData); }
 
-			UpdateStatus unsubCallbackFromChannel(const CbStr& cbName, const ChannelStr& chlName);
+			UpdateStatus unsubCallbackFromChannel(StringId cbName, StringId chlName);
+			inline UpdateStatus unsubCallbackFromChannel(const CbStr& cbName, const ChannelStr& chlName) {
+				return unsubCallbackFromChannel(internString(cbName), internString(chlName));
+			}
 
-			UpdateStatus unsubCallbackFromAllChannels(const CbStr& cbName);
+			UpdateStatus unsubCallbackFromAllChannels(StringId cbName);
+			inline UpdateStatus unsubCallbackFromAllChannels(const CbStr& cbName) { return unsubCallbackFromAllChannels(internString(cbName)); }
 
-			UpdateStatus unsubAllCallbacksFromChannel(const ChannelStr& chlName);
+			UpdateStatus unsubAllCallbacksFromChannel(StringId chlName);
+			inline UpdateStatus unsubAllCallbacksFromChannel(const ChannelStr& chlName) { return unsubAllCallbacksFromChannel(internString(chlName)); }
 
-			void destroyChannel(const ChannelStr& chlName);
+			void destroyChannel(StringId chlName);
+			inline void destroyChannel(const ChannelStr& chlName) { destroyChannel(internString(chlName)); }
 
-			void removeCallback(const CbStr& cbName);
+			void removeCallback(StringId cbName);
+			inline void removeCallback(const CbStr& cbName) { removeCallback(internString(cbName)); }
 
 			// For debugging:
 
-			int getNumCbsListeningTo(const ChannelStr& chlName) const;
-			int getNumChannelsListenedBy(const CbStr& cbName) const;
+			int getNumCbsListeningTo(StringId chlName) const;
+			inline int getNumCbsListeningTo(const ChannelStr& chlName) const { return getNumCbsListeningTo(internString(chlName)); }
+			int getNumChannelsListenedBy(StringId cbName) const;
+			inline int getNumChannelsListenedBy(const CbStr& cbName) const { return getNumChannelsListenedBy(internString(cbName)); }
 			int getNumCbsRegistered() const;
 			int getNumChannelsRegistered() const;
 		};
@@ -144,7 +189,7 @@ namespace Doobius {
 		}
 
 		template<typename T, typename CbType>
-		inline void NotificationRegistry::registerCallback(CbType&& cb, const CbStr& cbName)
+		inline void NotificationRegistry::registerCallback(CbType&& cb, StringId cbName)
 		{
 			DOOBIUS_FMT_DASSERT(m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end(), "Found callback %1% already registered in notification registry %2%", cbName % m_nameOfNotifReg);
 
@@ -155,16 +200,18 @@ namespace Doobius {
 			m_callbackReg[m_cbIdCounter] =
 			{
 				cbName,
-				[cb = std::forward<CbType>(cb)](const boost::any& genericArg) {
-					cb(boost::any_cast<const T&>(genericArg));
+				&typeid(T),
+				[cb = std::forward<CbType>(cb)](const void* genericArg) {
+					cb(*static_cast<const T*>(genericArg));
 				}
 			};
+			m_callbacksMetric->add(1);
 
 			DOOBIUS_CLOG(trace) << cbName << " is now registered in " << m_nameOfNotifReg;
 		}
 
 		template<typename T, typename CbType, typename BindingClass>
-		inline void NotificationRegistry::registerBoundCallback(BindingClass* classInst, CbType&& cb, const CbStr& cbName) {
+		inline void NotificationRegistry::registerBoundCallback(BindingClass* classInst, CbType&& cb, StringId cbName) {
 			DOOBIUS_FMT_DASSERT(m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end(), "Found callback %1% already registered in notification registry %2%", cbName % m_nameOfNotifReg);
 
 			m_cbIdMap.insert(CallbackIdMapping::value_type(++m_cbIdCounter, cbName));
@@ -174,25 +221,29 @@ namespace Doobius {
 			m_callbackReg[m_cbIdCounter] =
 			{
 				cbName,
-				[classInst, cb = std::forward<CbType>(cb)](const boost::any& genericArg) {
-					(classInst->*cb)(boost::any_cast<const T&>(genericArg));
+				&typeid(T),
+				[classInst, cb = std::forward<CbType>(cb)](const void* genericArg) {
+					(classInst->*cb)(*static_cast<const T*>(genericArg));
 				}
 			};
+			m_callbacksMetric->add(1);
 
 			DOOBIUS_CLOG(trace) << cbName << " is now registered in " << m_nameOfNotifReg;
 		}
 
 		template<typename T>
-		inline NotificationRegistry::UpdateStatus NotificationRegistry::updateChannel(const ChannelStr& chlName, const T& notifData)
+		inline NotificationRegistry::UpdateStatus NotificationRegistry::updateChannel(StringId chlName, const T& notifData)
 		{
 			if (m_chlIdMap.right.find(chlName) == m_chlIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << chlName << " channel has either been deleted previously and all its callbacks de-registered or never existed from/in " << m_nameOfNotifReg;
+				m_missedUpdatesMetric->inc();
 				return UpdateStatus::UPDATE_CHANNEL_MISSING;
 			}
 			ChannelId chlId = m_chlIdMap.right.at(chlName);
 			size_t count = m_registrations.get<ChannelTag>().count(chlId);
 			if (count == 0) {
 				DOOBIUS_CLOG(warning) << chlName << " channel has no callbacks listening in yet updateChannel() was called with it";
+				m_missedUpdatesMetric->inc();
 				return UpdateStatus::UPDATE_EMPTY;
 			}
 
@@ -206,8 +257,16 @@ namespace Doobius {
 #endif
 			for (ChannelIter it = pit.first; it != pit.second; ++it) {
 				DOOBIUS_FMT_DASSERT(m_callbackReg.find(it->cbId) != m_callbackReg.end(), "Couldn't find %1% CbId in the callback registry inside %2%", it->cbId % m_nameOfNotifReg);
-				m_callbackReg.at(it->cbId).cb(notifData);
+				const NotificationCallback& callback = m_callbackReg.at(it->cbId);
+				if (*callback.argType != typeid(T)) {
+					// Same failure the boost::any_cast this replaced reported
+					DOOBIUS_CLOG(error) << callback.notifieeName << " expects " << callback.argType->name() << " but " << chlName << " was updated with " << typeid(T).name();
+					throw boost::bad_any_cast();
+				}
+				callback.cb(&notifData);
 			}
+			m_updatesMetric->inc();
+			m_callbacksInvokedMetric->inc(count);
 
 			return UpdateStatus::UPDATE_OK;
 		}
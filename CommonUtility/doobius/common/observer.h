@@ -5,6 +5,7 @@
 #include <string>
 
 #include "doobius/dbg/custom_assert.h"
+#include "doobius/dbg/string_id.h"
 
 namespace Doobius {
 	namespace Notification {
@@ -23,7 +24,8 @@ namespace Doobius {
 		class IDirectNotifiee : virtual public DirectNotifieeCommon {
 		protected:
 			IDirectNotifiee() = default;
-			virtual void onNotify(const DirectNotifDType& data, const std::string& notifierName) = 0;
+			// notifierName can be compared against "Source"_sid and streamed like a string
+			virtual void onNotify(const DirectNotifDType& data, StringId notifierName) = 0;
 			virtual ~IDirectNotifiee() = default;
 		};
 
@@ -38,10 +40,14 @@ namespace Doobius {
 			BOOST_STATIC_ASSERT_MSG(std::is_base_of_v<IDirectNotifiee<DirectNotifDType>, SourceNotifiee>,
 				"SourceNotifiee must inherit (very specifically) from IDirectNotifiee<DirectNotifDType>");
 		private:
-			std::string m_sourceName;
+			StringId m_sourceName;
 			std::unordered_set<SourceNotifiee*> m_notifieeList;
 		public:
-			DirectNotifier(const char* sourceName) : m_sourceName(sourceName)
+			DirectNotifier(const char* sourceName) : DirectNotifier(internString(sourceName))
+			{
+			}
+
+			DirectNotifier(StringId sourceName) : m_sourceName(sourceName)
 			{
 				DOOBIUS_CLOG(trace) << "Direct source of notifications called " << m_sourceName << " now created";
 			}
@@ -0,0 +1,191 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "doobius/dbg/custom_assert.h"
+
+namespace Doobius {
+	namespace Memory {
+		// Payload capacities 4KB, 8KB, ... g_payloadMaxPooledSize; bigger payloads are allocated and freed every time
+		constexpr std::size_t g_payloadMinPooledSize = std::size_t{ 4 } << 10;
+		constexpr std::size_t g_payloadNumSizeClasses = 11;
+		constexpr std::size_t g_payloadMaxPooledSize = g_payloadMinPooledSize << (g_payloadNumSizeClasses - 1);
+		// Size class index used for payloads bigger than g_payloadMaxPooledSize
+		constexpr std::uint32_t g_payloadOversizeClass = static_cast<std::uint32_t>(g_payloadNumSizeClasses);
+
+		constexpr std::size_t payloadSizeClassOf(std::size_t size) {
+			std::size_t sizeClass = 0;
+			while ((g_payloadMinPooledSize << sizeClass) < size) {
+				++sizeClass;
+			}
+			return sizeClass;
+		}
+
+		struct PayloadSizeClassStats {
+			std::size_t capacity = 0;
+			// Buffers this class got from the heap and still owns, whether in use or on the free list
+			std::uint64_t buffers = 0;
+			std::uint64_t free = 0;
+			std::uint64_t acquires = 0;
+			// Acquires the free list couldn't serve
+			std::uint64_t heapAllocations = 0;
+		};
+
+		struct PayloadPoolStats {
+			std::array<PayloadSizeClassStats, g_payloadNumSizeClasses> sizeClasses{};
+			std::uint64_t oversizeAcquires = 0;
+			std::uint64_t oversizeInUse = 0;
+			// Payloads acquired and not released yet, pooled and oversize
+			std::uint64_t inUse = 0;
+			// Capacity of every pooled buffer, in use or free
+			std::size_t pooledBytes = 0;
+		};
+
+		namespace Detail {
+			// Sits in front of every payload's bytes, in the same allocation
+			struct alignas(64) PayloadHeader {
+				std::atomic<std::uint32_t> refCount;
+				std::uint32_t sizeClass;
+				std::size_t size;
+				PayloadHeader* nextFree;
+
+				inline std::byte* data() { return reinterpret_cast<std::byte*>(this + 1); }
+			};
+
+			void releasePayload(PayloadHeader* header);
+		}
+
+		class MutablePayload;
+
+		/**
+		 * \brief Shared, read-only reference to a pooled payload. Copying bumps an intrusive atomic count and never
+		 * allocates, so a handle can go through NotificationRegistry::updateChannel<PayloadHandle> and any subscriber
+		 * can keep a copy past the callback; the buffer goes back to its pool when the last copy is dropped, on
+		 * whichever thread that happens.
+		 */
+		class PayloadHandle {
+		private:
+			Detail::PayloadHeader* m_header;
+
+			explicit PayloadHandle(Detail::PayloadHeader* header) : m_header(header) {}
+			friend class MutablePayload;
+		public:
+			PayloadHandle() : m_header(nullptr) {}
+
+			PayloadHandle(const PayloadHandle& other) : m_header(other.m_header) {
+				if (m_header) {
+					// Whoever copies already holds a reference, so nothing can be released concurrently
+					m_header->refCount.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			PayloadHandle(PayloadHandle&& other) noexcept : m_header(std::exchange(other.m_header, nullptr)) {}
+
+			PayloadHandle& operator=(PayloadHandle other) noexcept {
+				std::swap(m_header, other.m_header);
+				return *this;
+			}
+
+			~PayloadHandle() {
+				reset();
+			}
+
+			void reset() {
+				if (Detail::PayloadHeader* header = std::exchange(m_header, nullptr)) {
+					// acq_rel so every reader's accesses happen before the buffer is reused
+					if (header->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+						Detail::releasePayload(header);
+					}
+				}
+			}
+
+			inline explicit operator bool() const { return m_header != nullptr; }
+			inline const std::byte* data() const { return m_header ? m_header->data() : nullptr; }
+			inline std::size_t size() const { return m_header ? m_header->size : 0; }
+			// Only a hint when other threads hold copies
+			inline std::uint32_t useCount() const { return m_header ? m_header->refCount.load(std::memory_order_relaxed) : 0; }
+
+			// The payload as an array of T; trailing bytes that don't make a whole T are left out
+			template<typename T>
+			std::span<const T> view() const {
+				static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= alignof(Detail::PayloadHeader), "Payloads hold raw bytes");
+				return std::span<const T>(reinterpret_cast<const T*>(data()), size() / sizeof(T));
+			}
+		};
+
+		/**
+		 * \brief A payload straight out of the pool, writable and owned by the caller only. Fill it, then publish() it
+		 * into a PayloadHandle; the bytes aren't copied. Dropping it unpublished returns the buffer.
+		 */
+		class MutablePayload {
+		private:
+			Detail::PayloadHeader* m_header;
+			std::size_t m_capacity;
+
+			MutablePayload(Detail::PayloadHeader* header, std::size_t capacity) : m_header(header), m_capacity(capacity) {}
+			friend class PayloadPool;
+		public:
+			MutablePayload(const MutablePayload&) = delete;
+			MutablePayload& operator=(const MutablePayload&) = delete;
+
+			MutablePayload(MutablePayload&& other) noexcept : m_header(std::exchange(other.m_header, nullptr)), m_capacity(other.m_capacity) {}
+
+			MutablePayload& operator=(MutablePayload&& other) noexcept {
+				std::swap(m_header, other.m_header);
+				std::swap(m_capacity, other.m_capacity);
+				return *this;
+			}
+
+			~MutablePayload() {
+				if (m_header) {
+					Detail::releasePayload(m_header);
+				}
+			}
+
+			inline std::byte* data() { return m_header->data(); }
+			inline std::size_t size() const { return m_header->size; }
+			inline std::size_t capacity() const { return m_capacity; }
+
+			// Shrinks or grows the payload within its buffer, contents are kept
+			void resize(std::size_t size) {
+				DOOBIUS_FMT_DASSERT(size <= m_capacity, "Payload resized to %1% bytes but its buffer holds %2%", size % m_capacity);
+				m_header->size = size;
+			}
+
+			template<typename T>
+			std::span<T> view() {
+				static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= alignof(Detail::PayloadHeader), "Payloads hold raw bytes");
+				return std::span<T>(reinterpret_cast<T*>(data()), size() / sizeof(T));
+			}
+
+			// Nothing can write to the bytes afterwards
+			PayloadHandle publish() && {
+				DOOBIUS_DASSERT(m_header, "Payload was already published");
+				return PayloadHandle(std::exchange(m_header, nullptr));
+			}
+		};
+
+		/**
+		 * \brief Process-wide pools of payload buffers for large notifications (mesh deltas, network snapshots), one
+		 * free list per power-of-two capacity. Buffers are allocated the first time a class runs dry and are kept
+		 * until trim(), so a publisher acquiring, filling and publishing at a steady rate stops touching the heap once
+		 * every class it uses has as many buffers as are alive at once. Safe to use from any thread.
+		 */
+		class PayloadPool {
+		private:
+			PayloadPool() = default;
+		public:
+			// The payload's size starts at bytes; its capacity is bytes rounded up to the size class
+			static MutablePayload acquire(std::size_t bytes);
+
+			static PayloadPoolStats getStats();
+			// Frees every buffer on the free lists and returns how many bytes that was
+			static std::size_t trim();
+		};
+	};
+};
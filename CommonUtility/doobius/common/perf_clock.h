@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DOOBIUS_HAS_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define DOOBIUS_HAS_TSC 0
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		enum class ClockSource {
+			TSC,
+			STEADY
+		};
+
+		/**
+		 * \brief Cheap timestamp source for timing small scopes. Reads the TSC when the CPU reports an invariant one
+		 * (constant rate across P/C-states and synchronised between cores) and falls back to steady_clock otherwise.
+		 * Ticks are only meaningful relative to each other; convert with ticksToNs when reporting, not when recording.
+		 *
+		 * Calibration against steady_clock happens once, the first time the clock is used, and spins for a few ms.
+		 */
+		class PerfClock {
+		private:
+			PerfClock();
+			~PerfClock() = default;
+
+			ClockSource m_source;
+			bool m_invariantTsc;
+			double m_nsPerTick;
+			double m_ticksPerNs;
+		public:
+			PerfClock(const PerfClock&) = delete;
+			PerfClock& operator=(const PerfClock&) = delete;
+			PerfClock(PerfClock&&) = delete;
+			PerfClock& operator=(PerfClock&&) = delete;
+
+			static PerfClock& get();
+
+			static inline std::uint64_t readSteady() {
+				return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+			}
+
+#if DOOBIUS_HAS_TSC
+			static inline std::uint64_t readTsc() { return __rdtsc(); }
+
+			// Waits for earlier instructions to finish before reading, use it to close an interval
+			static inline std::uint64_t readTscOrdered() {
+				unsigned int aux;
+				return __rdtscp(&aux);
+			}
+#endif
+
+			static inline std::uint64_t now() {
+#if DOOBIUS_HAS_TSC
+				if (get().m_source == ClockSource::TSC) {
+					return readTsc();
+				}
+#endif
+				return readSteady();
+			}
+
+			static inline std::uint64_t nowOrdered() {
+#if DOOBIUS_HAS_TSC
+				if (get().m_source == ClockSource::TSC) {
+					return readTscOrdered();
+				}
+#endif
+				return readSteady();
+			}
+
+			inline double ticksToNs(std::uint64_t ticks) const { return static_cast<double>(ticks) * m_nsPerTick; }
+			inline std::uint64_t nsToTicks(double ns) const { return static_cast<std::uint64_t>(ns * m_ticksPerNs); }
+
+			/**
+			 * \brief Re-measures the TSC rate over calibrationTime. Ticks taken before the call are converted with the
+			 * new rate, so only call it while nothing is being timed.
+			 */
+			void calibrate(std::chrono::milliseconds calibrationTime);
+
+			/**
+			 * \brief Switches to steady_clock even on an invariant TSC, or back to the TSC if there is one. Returns the
+			 * source in use afterwards. Same caveat as calibrate.
+			 */
+			ClockSource setSource(ClockSource source);
+
+			inline ClockSource getSource() const { return m_source; }
+			inline bool hasInvariantTsc() const { return m_invariantTsc; }
+			inline double getTicksPerNs() const { return m_ticksPerNs; }
+		};
+	};
+};
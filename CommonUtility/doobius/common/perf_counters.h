@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace Doobius {
+	namespace Perf {
+		enum class PerfCounter : std::size_t {
+			CYCLES,
+			INSTRUCTIONS,
+			L1D_MISSES,
+			LLC_MISSES,
+			BRANCH_MISSES,
+			COUNT
+		};
+
+		constexpr std::size_t g_numPerfCounters = static_cast<std::size_t>(PerfCounter::COUNT);
+
+		const char* perfCounterName(PerfCounter counter);
+
+		struct PerfCounterValues {
+			std::array<std::uint64_t, g_numPerfCounters> values{};
+			// Bit i is set when counter i was read; unset counters are left at 0
+			std::uint32_t availableMask = 0;
+
+			inline bool has(PerfCounter counter) const { return (availableMask >> static_cast<std::size_t>(counter)) & 1u; }
+			inline std::uint64_t get(PerfCounter counter) const { return values[static_cast<std::size_t>(counter)]; }
+		};
+
+		/**
+		 * \brief Counter deltas over one scope plus the wall time it took. Rates come back as 0 when the counters they
+		 * need weren't available.
+		 */
+		struct PerfCounterSample {
+			double elapsedNs = 0;
+			PerfCounterValues deltas;
+
+			double getIpc() const;
+			// Misses per thousand instructions
+			double getMpki(PerfCounter missCounter) const;
+			std::string toString() const;
+		};
+
+		/**
+		 * \brief Group of hardware counters for the calling thread, opened through perf_event_open and read with one
+		 * syscall. Counters the kernel or the CPU won't give us are left out individually; if none open (not Linux,
+		 * containers, perf_event_paranoid) the group is unavailable and reads return an empty mask.
+		 *
+		 */
+		class PerfCounterGroup {
+		private:
+			std::array<int, g_numPerfCounters> m_fds;
+			int m_leaderFd;
+			std::uint32_t m_availableMask;
+			std::size_t m_numOpen;
+
+			PerfCounterGroup();
+		public:
+			~PerfCounterGroup();
+
+			PerfCounterGroup(const PerfCounterGroup&) = delete;
+			PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+			PerfCounterGroup(PerfCounterGroup&&) = delete;
+			PerfCounterGroup& operator=(PerfCounterGroup&&) = delete;
+
+			// Opened the first time a thread asks for it; counters only count the thread that opened them
+			static PerfCounterGroup& forCurrentThread();
+
+			// Values are scaled up if the kernel had to multiplex the group
+			PerfCounterValues read() const;
+
+			inline bool isAvailable() const { return m_availableMask != 0; }
+			inline std::uint32_t getAvailableMask() const { return m_availableMask; }
+		};
+
+		/**
+		 * \brief Reads the calling thread's counters and PerfClock on construction and again on end(). Falls back to wall
+		 * time only when counters aren't available. Must end on the thread that created it.
+		 */
+		class PerfCounterScope {
+		private:
+			const PerfCounterGroup& m_group;
+			PerfCounterValues m_start;
+			std::uint64_t m_startTicks;
+		public:
+			PerfCounterScope();
+			PerfCounterSample end() const;
+		};
+	};
+};
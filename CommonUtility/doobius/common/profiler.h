@@ -0,0 +1,184 @@
+#pragma once
+#include "doobius/common/alloc_tracker.h"
+#include "doobius/common/perf_clock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Profiling zones are compiled out of Release builds unless explicitly requested
+#if !defined(DOOBIUS_PROFILING_ENABLED)
+#if defined(Release_CONFIG)
+#define DOOBIUS_PROFILING_ENABLED 0
+#else
+#define DOOBIUS_PROFILING_ENABLED 1
+#endif
+#endif
+
+#define DOOBIUS_PROFILE_CONCAT_IMPL(A, B) A##B
+#define DOOBIUS_PROFILE_CONCAT(A, B) DOOBIUS_PROFILE_CONCAT_IMPL(A, B)
+
+#if DOOBIUS_PROFILING_ENABLED
+/**
+ * Opens a profiling zone that closes at the end of the enclosing scope. NAME must outlive the profiler (a string
+ * literal or a static string), only the pointer is stored.
+ */
+#define DOOBIUS_PROFILE_SCOPE(NAME) Doobius::Perf::ProfileZone DOOBIUS_PROFILE_CONCAT(_doobiusProfileZone, __LINE__)(NAME)
+#define DOOBIUS_PROFILE_THREAD_NAME(NAME) Doobius::Perf::Profiler::get().setCurrentThreadName(NAME)
+#else
+#define DOOBIUS_PROFILE_SCOPE(NAME) ((void)0)
+#define DOOBIUS_PROFILE_THREAD_NAME(NAME) ((void)0)
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		constexpr std::size_t g_defaultProfileRingCapacity = 1 << 14;
+
+		// Writes str as the inside of a JSON string literal. Shared by everything that writes Chrome trace files.
+		void writeJsonEscaped(std::ostream& os, const char* str);
+
+		struct ProfileEvent {
+			enum class Type : std::uint8_t {
+				BEGIN,
+				END
+			};
+
+			const char* name;
+			std::uint64_t ticks;
+			Type type;
+		};
+
+		/**
+		 * \brief Single-producer/single-consumer ring of profile events owned by one thread. The owning thread pushes
+		 * without locking; the collector drains from any thread.
+		 *
+		 */
+		class ProfileEventRing {
+		private:
+			std::vector<ProfileEvent> m_events;
+			const std::uint64_t m_mask;
+			alignas(64) std::atomic<std::uint64_t> m_writePos;
+			alignas(64) std::atomic<std::uint64_t> m_readPos;
+			std::atomic<std::uint64_t> m_droppedZones;
+
+			// Only touched by the owning thread
+			std::uint32_t m_openZones;
+		public:
+			const std::uint32_t threadIdx;
+			std::string threadName;
+
+			ProfileEventRing(std::size_t capacity, std::uint32_t _threadIdx);
+
+			/**
+			 * \brief Pushes a BEGIN event if there is room for it, its END, and the END of every zone already open on
+			 * this thread. If this returns false the zone must not push an END either.
+			 */
+			bool tryBegin(const char* name, std::uint64_t ticks);
+			void end(const char* name, std::uint64_t ticks);
+
+			template<typename Fn>
+			std::size_t drain(Fn&& fn);
+
+			inline std::uint64_t getNumDroppedZones() const { return m_droppedZones.load(std::memory_order_relaxed); }
+		};
+
+		struct CollectedProfileEvent {
+			ProfileEvent event;
+			std::uint32_t threadIdx;
+		};
+
+		/**
+		 * \brief Owns every thread's ring and turns what they recorded into a Chrome Trace Event file that can be loaded
+		 * in chrome://tracing or Perfetto. Nothing here is touched on the hot path except through ProfileZone.
+		 *
+		 */
+		class Profiler {
+		private:
+			Profiler();
+			~Profiler() = default;
+
+			mutable std::mutex m_mutex;
+			std::vector<std::unique_ptr<ProfileEventRing>> m_rings;
+			std::vector<CollectedProfileEvent> m_collected;
+			std::size_t m_ringCapacity;
+			const std::uint64_t m_startTicks;
+
+			ProfileEventRing& registerCurrentThread();
+		public:
+			Profiler(const Profiler&) = delete;
+			Profiler& operator=(const Profiler&) = delete;
+			Profiler(Profiler&&) = delete;
+			Profiler& operator=(Profiler&&) = delete;
+
+			static Profiler& get();
+
+			// Ring of the calling thread, created on first use
+			ProfileEventRing& getThreadRing();
+
+			void setCurrentThreadName(const std::string& name);
+
+			// Applies to threads that record their first zone after this call
+			void setThreadRingCapacity(std::size_t capacity);
+
+			// Moves everything the rings hold so far into the collector. Call periodically on long runs.
+			std::size_t collect();
+
+			// Collects, writes everything collected so far as Chrome trace JSON and clears it. Returns events written.
+			std::size_t writeChromeTrace(const std::filesystem::path& tracePath);
+
+			std::uint64_t getNumDroppedZones() const;
+
+			static inline std::uint64_t nowTicks() { return PerfClock::now(); }
+			static double ticksToNs(std::uint64_t ticks);
+		};
+
+		/**
+		 * \brief RAII profiling zone. Use through DOOBIUS_PROFILE_SCOPE so it disappears from builds with profiling off.
+		 */
+		class ProfileZone {
+		private:
+			const char* m_name;
+			ProfileEventRing* m_ring;
+		public:
+			explicit ProfileZone(const char* name) : m_name(name), m_ring(&Profiler::get().getThreadRing())
+			{
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+				AllocTracker::pushScope(m_name);
+#endif
+				if (!m_ring->tryBegin(m_name, Profiler::nowTicks())) {
+					m_ring = nullptr;
+				}
+			}
+
+			~ProfileZone()
+			{
+				if (m_ring) {
+					m_ring->end(m_name, Profiler::nowTicks());
+				}
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+				AllocTracker::popScope();
+#endif
+			}
+
+			ProfileZone(const ProfileZone&) = delete;
+			ProfileZone& operator=(const ProfileZone&) = delete;
+		};
+
+		template<typename Fn>
+		inline std::size_t ProfileEventRing::drain(Fn&& fn)
+		{
+			const std::uint64_t readPos = m_readPos.load(std::memory_order_relaxed);
+			const std::uint64_t writePos = m_writePos.load(std::memory_order_acquire);
+			for (std::uint64_t pos = readPos; pos != writePos; ++pos) {
+				fn(m_events[pos & m_mask]);
+			}
+			m_readPos.store(writePos, std::memory_order_release);
+			return static_cast<std::size_t>(writePos - readPos);
+		}
+	};
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Doobius {
+	namespace Perf {
+		struct SamplingStats {
+			std::uint64_t samples = 0;
+			// Samples lost because the thread's buffer was full
+			std::uint64_t dropped = 0;
+			// Ticks that landed on a thread that never called registerCurrentThread
+			std::uint64_t unregistered = 0;
+		};
+
+		/**
+		 * \brief Statistical CPU profiler for Linux. SIGPROF fires at a fixed rate of process CPU time and the signal
+		 * handler copies the interrupted thread's raw return addresses into that thread's preallocated buffer; it never
+		 * allocates, locks or symbolizes. Symbols are only resolved afterwards, when writing collapsed stacks for
+		 * flamegraph.pl / speedscope.
+		 *
+		 * Only threads that called registerCurrentThread are sampled. On other platforms start() logs and returns false.
+		 */
+		class SamplingProfiler {
+		public:
+			struct SamplingConfig {
+				int frequencyHz = 997;					// Off a round number so sampling doesn't lock step with frame timers
+				std::size_t bufferWordsPerThread = 1 << 20;	// Each sample takes its depth + 1 words
+				std::size_t maxDepth = 64;
+			};
+
+			struct ThreadSampleBuffer {
+				std::vector<void*> words;
+				std::atomic<std::size_t> used;
+				std::atomic<std::uint64_t> numSamples;
+				std::atomic<std::uint64_t> dropped;
+				std::string threadName;
+
+				explicit ThreadSampleBuffer(std::size_t numWords, std::string _threadName);
+			};
+		private:
+			SamplingProfiler();
+			~SamplingProfiler();
+
+			mutable std::mutex m_mutex;
+			SamplingConfig m_config;
+			std::vector<std::unique_ptr<ThreadSampleBuffer>> m_buffers;
+			std::atomic<bool> m_running;
+		public:
+			SamplingProfiler(const SamplingProfiler&) = delete;
+			SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+			SamplingProfiler(SamplingProfiler&&) = delete;
+			SamplingProfiler& operator=(SamplingProfiler&&) = delete;
+
+			static SamplingProfiler& get();
+
+			// Allocates the calling thread's buffer. Safe to call again, the second call only renames the thread.
+			void registerCurrentThread(const std::string& threadName);
+
+			// Registers the calling thread if needed and arms the timer. Returns false if sampling isn't supported.
+			bool start(const SamplingConfig& config);
+			bool start();
+			void stop();
+			inline bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+			SamplingStats getStats() const;
+
+			/**
+			 * \brief Aggregates identical stacks, symbolizes each distinct address once with boost::stacktrace and writes
+			 * one "thread;outer;...;inner count" line per stack. Returns the number of distinct stacks written.
+			 */
+			std::size_t writeCollapsedStacks(const std::filesystem::path& outPath) const;
+
+			// Drops everything sampled so far; buffers stay allocated
+			void clear();
+		};
+	};
+};
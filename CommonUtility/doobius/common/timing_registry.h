@@ -0,0 +1,172 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include "doobius/dbg/string_id.h"
+
+namespace Doobius {
+	namespace Perf {
+		using TimerId = std::uint32_t;
+
+		/**
+		 * \brief HDR-style bucket layout: values below 2^g_histSubBucketBits get their own bucket, above that every
+		 * power of two is split into 2^(g_histSubBucketBits - 1) linear buckets, so any recorded value is off by at most
+		 * ~1.6% of itself. Values past 2^g_histMaxValueBits are clamped into the last bucket.
+		 */
+		constexpr unsigned int g_histSubBucketBits = 6;
+		constexpr unsigned int g_histMaxValueBits = 44;
+		constexpr std::size_t g_histNumBuckets = ((g_histMaxValueBits - g_histSubBucketBits) << (g_histSubBucketBits - 1)) + (std::size_t{ 1 } << g_histSubBucketBits);
+
+		inline std::size_t histBucketIndex(std::uint64_t value) {
+			if (value < (std::uint64_t{ 1 } << g_histSubBucketBits)) {
+				return static_cast<std::size_t>(value);
+			}
+			value = std::min(value, (std::uint64_t{ 1 } << g_histMaxValueBits) - 1);
+			// shift >= 1 here, and value >> shift lands in [2^(subBits - 1), 2^subBits)
+			const unsigned int shift = static_cast<unsigned int>(std::bit_width(value)) - g_histSubBucketBits;
+			return static_cast<std::size_t>((std::uint64_t{ shift } << (g_histSubBucketBits - 1)) + (value >> shift));
+		}
+
+		std::uint64_t histBucketLowerBound(std::size_t idx);
+		std::uint64_t histBucketUpperBound(std::size_t idx);
+
+		struct TimingStats {
+			std::uint64_t count = 0;
+			double minNs = 0;
+			double meanNs = 0;
+			double p50Ns = 0;
+			double p90Ns = 0;
+			double p99Ns = 0;
+			double maxNs = 0;
+		};
+
+		/**
+		 * \brief Plain histogram of PerfClock ticks used to merge the per-thread histograms and compute statistics.
+		 */
+		class TimingHistogram {
+		private:
+			std::vector<std::uint64_t> m_buckets;
+			std::uint64_t m_count;
+			std::uint64_t m_sumTicks;
+			std::uint64_t m_minTicks;
+			std::uint64_t m_maxTicks;
+		public:
+			TimingHistogram();
+
+			void record(std::uint64_t ticks);
+			void merge(const TimingHistogram& other);
+			// Removes an earlier snapshot of the same timer. Min/max are then only known to bucket precision.
+			void subtract(const TimingHistogram& earlier);
+
+			// Tick value at quantile q in [0, 1], taken from the middle of the bucket it falls in
+			std::uint64_t valueAtQuantile(double q) const;
+			TimingStats getStats() const;
+
+			inline std::uint64_t getCount() const { return m_count; }
+
+			friend class ThreadTimingHistogram;
+		};
+
+		/**
+		 * \brief One thread's histogram for one timer. Only the owning thread records, so the counters are updated with
+		 * plain relaxed load/store pairs rather than locked increments; readers on other threads may see a sample
+		 * half-recorded, which only makes a snapshot a sample out of date.
+		 */
+		class ThreadTimingHistogram {
+		private:
+			std::array<std::atomic<std::uint64_t>, g_histNumBuckets> m_buckets;
+			std::atomic<std::uint64_t> m_count;
+			std::atomic<std::uint64_t> m_sumTicks;
+			std::atomic<std::uint64_t> m_minTicks;
+			std::atomic<std::uint64_t> m_maxTicks;
+
+			static inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t val) {
+				counter.store(counter.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+			}
+		public:
+			ThreadTimingHistogram();
+
+			inline void record(std::uint64_t ticks) {
+				bump(m_buckets[histBucketIndex(ticks)], 1);
+				bump(m_sumTicks, ticks);
+				if (ticks < m_minTicks.load(std::memory_order_relaxed)) {
+					m_minTicks.store(ticks, std::memory_order_relaxed);
+				}
+				if (ticks > m_maxTicks.load(std::memory_order_relaxed)) {
+					m_maxTicks.store(ticks, std::memory_order_relaxed);
+				}
+				m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+			void mergeInto(TimingHistogram& hist) const;
+		};
+
+		/**
+		 * \brief Aggregates timings by name. Each thread records into its own histograms, which are only allocated the
+		 * first time that thread records a given timer, and they are merged when stats are requested.
+		 *
+		 */
+		class TimingRegistry {
+		private:
+			struct ThreadTimings {
+				// Guards growth of histograms against readers; the owning thread reads it without locking
+				std::mutex mutex;
+				std::vector<std::unique_ptr<ThreadTimingHistogram>> histograms;
+			};
+
+			TimingRegistry();
+			~TimingRegistry() = default;
+
+			mutable std::mutex m_mutex;
+			std::unordered_map<StringId, TimerId> m_timerIds;
+			std::vector<std::string> m_timerNames;
+			std::vector<std::unique_ptr<ThreadTimings>> m_threads;
+			std::vector<TimingHistogram> m_lastSummary;
+			std::chrono::steady_clock::time_point m_lastSummaryTime;
+
+			ThreadTimings& getThreadTimings();
+			ThreadTimingHistogram& growThreadHistograms(ThreadTimings& timings, TimerId timerId);
+			std::vector<TimingHistogram> mergeAll() const;
+		public:
+			TimingRegistry(const TimingRegistry&) = delete;
+			TimingRegistry& operator=(const TimingRegistry&) = delete;
+			TimingRegistry(TimingRegistry&&) = delete;
+			TimingRegistry& operator=(TimingRegistry&&) = delete;
+
+			static TimingRegistry& get();
+
+			// Looks the name up under a lock; keep the id (e.g. in a static) for anything timed per frame
+			TimerId getTimerId(StringId name);
+			inline TimerId getTimerId(const std::string& name) { return getTimerId(internString(name)); }
+			std::string getTimerName(TimerId timerId) const;
+
+			void recordTicks(TimerId timerId, std::uint64_t ticks);
+
+			TimingHistogram getHistogram(TimerId timerId) const;
+			TimingStats getStats(TimerId timerId) const;
+
+			// Every timer's stats since startup, as { "timerName": { "count": .., "min_ns": .., ... }, ... }
+			boost::json::object getJsonSnapshot() const;
+
+			/**
+			 * \brief Logs one table row per timer with the stats of the samples recorded since the previous summary.
+			 * Timers that recorded nothing in that window are left out. Drive summaries from one thread only.
+			 */
+			void logSummary();
+
+			// Calls logSummary if at least period has passed since the last one. Cheap enough to call every frame.
+			bool logSummaryEvery(std::chrono::milliseconds period);
+		};
+	};
+};
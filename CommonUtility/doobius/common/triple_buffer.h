@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "doobius/common/observer.h"
+
+namespace Doobius {
+	namespace Notification {
+		/**
+		 * \brief Hands the latest value of some state from one producer thread to one consumer thread without either
+		 * side waiting. The producer fills the back buffer and publishes it with a single atomic exchange; the consumer
+		 * swaps in the newest published buffer whenever it likes and reads it for as long as it wants. Snapshots the
+		 * consumer never got to are overwritten, so this is for "latest state" (simulation -> render/network) and not
+		 * for a stream of events that must all arrive.
+		 *
+		 * Exactly one thread may call the producer half (backBuffer/publish) and one the consumer half
+		 * (update/front/getFrontSequence). T is copied or written in place, never shared, so reads can't tear.
+		 */
+		template<typename T>
+		class TripleBuffer {
+		private:
+			// Bit set on the shared index when it holds a buffer the consumer hasn't picked up yet
+			static constexpr std::uint32_t g_freshBit = 0x4;
+			static constexpr std::uint32_t g_indexMask = 0x3;
+
+			// Slots on their own cache lines so the producer writing one doesn't stall the consumer reading another
+			struct alignas(64) Slot {
+				T value{};
+				std::uint64_t sequence = 0;
+			};
+
+			Slot m_slots[3];
+			// Producer-owned
+			alignas(64) std::uint32_t m_backIdx;
+			std::uint64_t m_numPublished;
+			// Index of the buffer in flight between the two, plus g_freshBit
+			alignas(64) std::atomic<std::uint32_t> m_sharedIdx;
+			// Consumer-owned
+			alignas(64) std::uint32_t m_frontIdx;
+		public:
+			TripleBuffer() : m_backIdx(0), m_numPublished(0), m_sharedIdx(1), m_frontIdx(2) {}
+
+			// Every slot starts as a copy of initial so the consumer can read before anything is published
+			explicit TripleBuffer(const T& initial) : TripleBuffer() {
+				for (Slot& slot : m_slots) {
+					slot.value = initial;
+				}
+			}
+
+			TripleBuffer(const TripleBuffer&) = delete;
+			TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+			// ----- Producer ----- //
+
+			/**
+			 * \brief The buffer the next publish() hands over. It holds whatever was published two or three snapshots
+			 * ago (or whatever the consumer last released), so overwrite every field that matters.
+			 */
+			inline T& backBuffer() { return m_slots[m_backIdx].value; }
+
+			// Publishes the back buffer and returns the sequence number (1-based) the consumer will see for it
+			inline std::uint64_t publish() {
+				m_slots[m_backIdx].sequence = ++m_numPublished;
+				// release: the writes to the back buffer are visible once the consumer acquires this index
+				m_backIdx = m_sharedIdx.exchange(m_backIdx | g_freshBit, std::memory_order_acq_rel) & g_indexMask;
+				return m_numPublished;
+			}
+
+			template<typename U>
+			inline std::uint64_t publish(U&& value) {
+				backBuffer() = std::forward<U>(value);
+				return publish();
+			}
+
+			inline std::uint64_t getNumPublished() const { return m_numPublished; }
+
+			// ----- Consumer ----- //
+
+			// Any thread may ask, but only the consumer can act on it
+			inline bool hasNewSnapshot() const { return (m_sharedIdx.load(std::memory_order_relaxed) & g_freshBit) != 0; }
+
+			/**
+			 * \brief Swaps in the newest published snapshot if there is one. Returns false and keeps the current front
+			 * buffer otherwise. References from front() stay valid until the next update() that returns true.
+			 */
+			inline bool update() {
+				if (!hasNewSnapshot()) {
+					return false;
+				}
+				m_frontIdx = m_sharedIdx.exchange(m_frontIdx, std::memory_order_acq_rel) & g_indexMask;
+				return true;
+			}
+
+			inline const T& front() const { return m_slots[m_frontIdx].value; }
+
+			// Sequence publish() returned for the snapshot in front(), 0 before the first one arrives
+			inline std::uint64_t getFrontSequence() const { return m_slots[m_frontIdx].sequence; }
+
+			inline const T& read() {
+				update();
+				return front();
+			}
+		};
+
+		// What TripleBufferNotifier observers receive. The snapshot itself is read by the consumer through the buffer.
+		struct SnapshotNotice {
+			std::uint64_t sequence;
+		};
+
+		/**
+		 * \brief A TripleBuffer whose publish() also tells DirectNotifier observers that a new snapshot is available, so
+		 * code written against IDirectNotifiee<SnapshotNotice> can wake its consumer thread instead of polling.
+		 * onNotify runs synchronously on the producer thread: notifiees should only signal (set a flag, post to a queue,
+		 * notify a condition variable) and leave reading the snapshot to the consumer. Add and remove notifiees before
+		 * the producer starts publishing, DirectNotifier isn't thread-safe.
+		 */
+		template<typename SourceNotifiee, typename T>
+		class TripleBufferNotifier {
+		private:
+			TripleBuffer<T> m_buffer;
+			DirectNotifier<SourceNotifiee, SnapshotNotice> m_notifier;
+		public:
+			TripleBufferNotifier(const char* sourceName) : m_notifier(sourceName) {}
+			TripleBufferNotifier(StringId sourceName) : m_notifier(sourceName) {}
+
+			inline void addNotifiee(SourceNotifiee* notifiee) { m_notifier.addNotifiee(notifiee); }
+			inline void removeNotifiee(SourceNotifiee* notifiee) { m_notifier.removeNotifiee(notifiee); }
+
+			inline T& backBuffer() { return m_buffer.backBuffer(); }
+
+			inline std::uint64_t publish() {
+				const std::uint64_t sequence = m_buffer.publish();
+				m_notifier.notifyAll(SnapshotNotice{ sequence });
+				return sequence;
+			}
+
+			template<typename U>
+			inline std::uint64_t publish(U&& value) {
+				m_buffer.backBuffer() = std::forward<U>(value);
+				return publish();
+			}
+
+			// The consumer half (update/front/read) lives on the buffer
+			inline TripleBuffer<T>& getBuffer() { return m_buffer; }
+		};
+	};
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Poisoning, use-after-free checks and leak counts in the memory services: Debug and DebugUnitTests unless overridden
+#if !defined(DOOBIUS_MEMORY_DEBUG)
+#if defined(Debug_CONFIG) || defined(DebugUnitTests_CONFIG)
+#define DOOBIUS_MEMORY_DEBUG 1
+#else
+#define DOOBIUS_MEMORY_DEBUG 0
+#endif
+#endif
+
+namespace Doobius {
+	namespace Memory {
+		constexpr std::size_t g_hugePageSize = std::size_t{ 2 } << 20;
+
+		// Written over memory handed out but not yet initialized, and over memory that was given back
+		constexpr unsigned char g_poisonAllocated = 0xCD;
+		constexpr unsigned char g_poisonFreed = 0xDD;
+
+		std::size_t getPageSize();
+
+		/**
+		 * \brief Contiguous range of address space reserved up front and committed piece by piece, so an allocator can
+		 * grow in place without ever moving or touching the general heap. With hugePages the range is 2MB aligned and
+		 * committed pieces are offered to the kernel as transparent huge pages; on Windows, large pages need a
+		 * privilege most processes don't have, so the flag is ignored there.
+		 *
+		 * Nothing is ever decommitted before the region is destroyed.
+		 */
+		class VirtualRegion {
+		private:
+			unsigned char* m_base;
+			std::size_t m_reserved;
+			std::size_t m_committed;
+			bool m_hugePages;
+
+			void release();
+		public:
+			VirtualRegion();
+			VirtualRegion(std::size_t reserveBytes, bool hugePages);
+			~VirtualRegion();
+
+			VirtualRegion(const VirtualRegion&) = delete;
+			VirtualRegion& operator=(const VirtualRegion&) = delete;
+			VirtualRegion(VirtualRegion&& other) noexcept;
+			VirtualRegion& operator=(VirtualRegion&& other) noexcept;
+
+			// Makes [base, base + bytes) usable, rounded up to whole pages. Returns false past the reservation.
+			bool commitUpTo(std::size_t bytes);
+
+			inline unsigned char* getBase() const { return m_base; }
+			inline std::size_t getReserved() const { return m_reserved; }
+			inline std::size_t getCommitted() const { return m_committed; }
+			inline bool usesHugePages() const { return m_hugePages; }
+			inline bool isValid() const { return m_base != nullptr; }
+		};
+	};
+};
@@ -0,0 +1,278 @@
+#include "doobius/common/alloc_tracker.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <sstream>
+
+namespace Doobius {
+	namespace Perf {
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+		namespace {
+			constexpr std::size_t g_numAllocScopeSlots = 1024;
+			constexpr std::size_t g_maxAllocScopeDepth = 64;
+			constexpr std::size_t g_unscopedSlot = 0;
+			constexpr std::size_t g_overflowSlot = 1;
+
+			struct AllocScopeSlot {
+				std::atomic<const char*> name;
+				std::atomic<std::uint64_t> allocs;
+				std::atomic<std::uint64_t> bytes;
+			};
+
+			// Zero-initialised before any dynamic initialisation, so allocations from static constructors are safe
+			AllocScopeSlot g_allocScopeSlots[g_numAllocScopeSlots];
+			std::atomic<std::uint64_t> g_totalAllocs{ 0 };
+			std::atomic<std::uint64_t> g_totalBytes{ 0 };
+			std::atomic<std::uint64_t> g_totalFrees{ 0 };
+
+			struct ThreadAllocState {
+				AllocScopeSlot* scopeStack[g_maxAllocScopeDepth];
+				std::uint32_t depth;
+				std::uint64_t allocs;
+				std::uint64_t bytes;
+				std::uint64_t frees;
+			};
+
+			thread_local ThreadAllocState t_allocState{};
+
+			AllocScopeSlot& findScopeSlot(const char* name) {
+				const std::size_t hash = static_cast<std::size_t>((reinterpret_cast<std::uintptr_t>(name) >> 3) * 0x9E3779B97F4A7C15ull);
+				constexpr std::size_t numHashed = g_numAllocScopeSlots - 2;
+				for (std::size_t probe = 0; probe < 32; ++probe) {
+					AllocScopeSlot& slot = g_allocScopeSlots[2 + (hash + probe) % numHashed];
+					const char* slotName = slot.name.load(std::memory_order_acquire);
+					if (slotName == name) {
+						return slot;
+					}
+					if (slotName == nullptr) {
+						const char* expected = nullptr;
+						if (slot.name.compare_exchange_strong(expected, name, std::memory_order_acq_rel) || expected == name) {
+							return slot;
+						}
+					}
+				}
+				return g_allocScopeSlots[g_overflowSlot];
+			}
+
+			inline void recordAlloc(std::size_t size) {
+				ThreadAllocState& state = t_allocState;
+				++state.allocs;
+				state.bytes += size;
+				g_totalAllocs.fetch_add(1, std::memory_order_relaxed);
+				g_totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+				AllocScopeSlot& slot = state.depth == 0 ? g_allocScopeSlots[g_unscopedSlot]
+					: *state.scopeStack[std::min<std::size_t>(state.depth, g_maxAllocScopeDepth) - 1];
+				slot.allocs.fetch_add(1, std::memory_order_relaxed);
+				slot.bytes.fetch_add(size, std::memory_order_relaxed);
+			}
+
+			inline void recordFree() {
+				++t_allocState.frees;
+				g_totalFrees.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void* trackedAlloc(std::size_t size) noexcept {
+				size = size ? size : 1;
+				for (;;) {
+					if (void* ptr = std::malloc(size)) {
+						recordAlloc(size);
+						return ptr;
+					}
+					std::new_handler handler = std::get_new_handler();
+					if (!handler) {
+						return nullptr;
+					}
+					handler();
+				}
+			}
+
+			void* trackedAlignedAlloc(std::size_t size, std::align_val_t alignVal) noexcept {
+				const std::size_t align = static_cast<std::size_t>(alignVal);
+				size = size ? size : 1;
+				for (;;) {
+#if defined(_MSC_VER)
+					void* ptr = _aligned_malloc(size, align);
+#else
+					void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+					if (ptr) {
+						recordAlloc(size);
+						return ptr;
+					}
+					std::new_handler handler = std::get_new_handler();
+					if (!handler) {
+						return nullptr;
+					}
+					handler();
+				}
+			}
+
+			void trackedFree(void* ptr) noexcept {
+				if (ptr) {
+					recordFree();
+					std::free(ptr);
+				}
+			}
+
+			void trackedAlignedFree(void* ptr) noexcept {
+				if (ptr) {
+					recordFree();
+#if defined(_MSC_VER)
+					_aligned_free(ptr);
+#else
+					std::free(ptr);
+#endif
+				}
+			}
+		}
+
+		void AllocTracker::pushScope(const char* name)
+		{
+			ThreadAllocState& state = t_allocState;
+			if (state.depth < g_maxAllocScopeDepth) {
+				state.scopeStack[state.depth] = &findScopeSlot(name);
+			}
+			++state.depth;
+		}
+
+		void AllocTracker::popScope()
+		{
+			--t_allocState.depth;
+		}
+
+		AllocStats AllocTracker::getGlobalStats() const
+		{
+			return { g_totalAllocs.load(std::memory_order_relaxed), g_totalBytes.load(std::memory_order_relaxed), g_totalFrees.load(std::memory_order_relaxed) };
+		}
+
+		AllocStats AllocTracker::getThreadStats() const
+		{
+			return { t_allocState.allocs, t_allocState.bytes, t_allocState.frees };
+		}
+
+		std::vector<AllocScopeStats> AllocTracker::getScopeStats() const
+		{
+			// The same name can sit in several slots when it comes from different string literals
+			std::map<std::string, AllocScopeStats> byName;
+			for (std::size_t i = 0; i < g_numAllocScopeSlots; ++i) {
+				const AllocScopeSlot& slot = g_allocScopeSlots[i];
+				const std::uint64_t allocs = slot.allocs.load(std::memory_order_relaxed);
+				if (allocs == 0) {
+					continue;
+				}
+				const char* name = i == g_unscopedSlot ? "(unscoped)" : i == g_overflowSlot ? "(scope table full)" : slot.name.load(std::memory_order_acquire);
+				AllocScopeStats& stats = byName[name];
+				stats.name = name;
+				stats.allocs += allocs;
+				stats.bytes += slot.bytes.load(std::memory_order_relaxed);
+			}
+
+			std::vector<AllocScopeStats> scopeStats;
+			for (auto& [name, stats] : byName) {
+				scopeStats.push_back(std::move(stats));
+			}
+			std::sort(scopeStats.begin(), scopeStats.end(), [](const AllocScopeStats& lhs, const AllocScopeStats& rhs) {
+				return lhs.bytes > rhs.bytes;
+			});
+			return scopeStats;
+		}
+
+		void AllocTracker::resetScopeStats()
+		{
+			for (AllocScopeSlot& slot : g_allocScopeSlots) {
+				slot.allocs.store(0, std::memory_order_relaxed);
+				slot.bytes.store(0, std::memory_order_relaxed);
+			}
+		}
+#else
+		void AllocTracker::pushScope(const char*) {}
+		void AllocTracker::popScope() {}
+		AllocStats AllocTracker::getGlobalStats() const { return {}; }
+		AllocStats AllocTracker::getThreadStats() const { return {}; }
+		std::vector<AllocScopeStats> AllocTracker::getScopeStats() const { return {}; }
+		void AllocTracker::resetScopeStats() {}
+#endif
+
+		AllocTracker& AllocTracker::get()
+		{
+			static AllocTracker _allocTracker;
+			return _allocTracker;
+		}
+
+		void AllocTracker::logReport() const
+		{
+			BOOST_LOG_NAMED_SCOPE("AllocTracker");
+			if (!isEnabled()) {
+				DOOBIUS_CLOG(info) << "Allocation tracking is not compiled into this build";
+				return;
+			}
+
+			const AllocStats global = getGlobalStats();
+			std::ostringstream table;
+			table << "Heap allocations: " << global.allocs << " allocs, " << global.bytes << " bytes, " << global.frees << " frees\n"
+				<< std::left << std::setw(32) << "scope" << std::right << std::setw(12) << "allocs" << std::setw(14) << "bytes";
+			for (const AllocScopeStats& stats : getScopeStats()) {
+				table << '\n' << std::left << std::setw(32) << stats.name << std::right << std::setw(12) << stats.allocs << std::setw(14) << stats.bytes;
+			}
+			DOOBIUS_CLOG(info) << table.str();
+		}
+	};
+};
+
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+namespace DPerf = Doobius::Perf;
+
+void* operator new(std::size_t size) {
+	if (void* ptr = DPerf::trackedAlloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	if (void* ptr = DPerf::trackedAlloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return DPerf::trackedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return DPerf::trackedAlloc(size); }
+
+void* operator new(std::size_t size, std::align_val_t align) {
+	if (void* ptr = DPerf::trackedAlignedAlloc(size, align)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+	if (void* ptr = DPerf::trackedAlignedAlloc(size, align)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return DPerf::trackedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return DPerf::trackedAlignedAlloc(size, align); }
+
+void operator delete(void* ptr) noexcept { DPerf::trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { DPerf::trackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { DPerf::trackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { DPerf::trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { DPerf::trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { DPerf::trackedFree(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { DPerf::trackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { DPerf::trackedAlignedFree(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { DPerf::trackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { DPerf::trackedAlignedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { DPerf::trackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { DPerf::trackedAlignedFree(ptr); }
+#endif
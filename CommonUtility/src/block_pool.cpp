@@ -0,0 +1,263 @@
+#include "doobius/common/block_pool.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace Doobius {
+	namespace Memory {
+		namespace {
+			// Address space for every pool slab in the process; only what slabs are carved from gets committed. 32-bit
+			// processes don't have 16GB of address space to give
+			constexpr std::size_t g_poolReserveBytes = std::size_t{ sizeof(void*) == 8 ? 16u : 1u } << 30;
+
+			struct FreeBlock {
+				FreeBlock* next;
+			};
+
+			constexpr std::size_t blockSizeOf(std::size_t sizeClass) {
+				return g_poolMinBlockSize << sizeClass;
+			}
+
+			class SlabSource {
+			private:
+				std::mutex m_mutex;
+				VirtualRegion m_region;
+				std::size_t m_used;
+				std::uint64_t m_numSlabs;
+
+				// Free lists left behind by threads that exited
+				std::array<FreeBlock*, g_poolNumSizeClasses> m_orphans;
+			public:
+				std::array<std::atomic<std::int64_t>, g_poolNumSizeClasses> outstanding;
+				std::atomic<std::uint64_t> poisonViolations;
+
+				SlabSource() : m_region(g_poolReserveBytes, true), m_used{ 0 }, m_numSlabs{ 0 }, m_orphans{}, poisonViolations{ 0 }
+				{
+					for (std::atomic<std::int64_t>& count : outstanding) {
+						count.store(0, std::memory_order_relaxed);
+					}
+				}
+
+				static SlabSource& get() {
+					// Never destroyed: threads can still free blocks while statics are being torn down
+					static SlabSource* source = new SlabSource();
+					return *source;
+				}
+
+				unsigned char* takeSlab() {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_region.commitUpTo(m_used + g_poolSlabSize)) {
+						return nullptr;
+					}
+					unsigned char* slab = m_region.getBase() + m_used;
+					m_used += g_poolSlabSize;
+					++m_numSlabs;
+					return slab;
+				}
+
+				FreeBlock* takeOrphans(std::size_t sizeClass) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					return std::exchange(m_orphans[sizeClass], nullptr);
+				}
+
+				void giveOrphans(std::size_t sizeClass, FreeBlock* head) {
+					FreeBlock* tail = head;
+					while (tail->next) {
+						tail = tail->next;
+					}
+					std::lock_guard<std::mutex> lock(m_mutex);
+					tail->next = m_orphans[sizeClass];
+					m_orphans[sizeClass] = head;
+				}
+
+				void fillStats(BlockPoolStats& stats) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					stats.slabs = m_numSlabs;
+					stats.committedBytes = m_region.getCommitted();
+				}
+			};
+
+			struct ThreadPool {
+				FreeBlock* freeList = nullptr;
+				unsigned char* bumpPos = nullptr;
+				unsigned char* bumpEnd = nullptr;
+			};
+
+			struct ThreadPools {
+				std::array<ThreadPool, g_poolNumSizeClasses> pools;
+
+				~ThreadPools() {
+					for (std::size_t sizeClass = 0; sizeClass < g_poolNumSizeClasses; ++sizeClass) {
+						ThreadPool& pool = pools[sizeClass];
+						// Blocks not carved yet go back on the list too, so nothing in the slab is lost
+						while (pool.bumpPos && pool.bumpPos + blockSizeOf(sizeClass) <= pool.bumpEnd) {
+#if DOOBIUS_MEMORY_DEBUG
+							std::memset(pool.bumpPos, g_poisonFreed, blockSizeOf(sizeClass));
+#endif
+							FreeBlock* block = reinterpret_cast<FreeBlock*>(pool.bumpPos);
+							block->next = pool.freeList;
+							pool.freeList = block;
+							pool.bumpPos += blockSizeOf(sizeClass);
+						}
+						if (pool.freeList) {
+							SlabSource::get().giveOrphans(sizeClass, pool.freeList);
+						}
+					}
+				}
+			};
+
+			thread_local ThreadPools t_pools;
+
+#if DOOBIUS_MEMORY_DEBUG
+			void checkPoison(unsigned char* block, std::size_t blockSize) {
+				for (std::size_t i = sizeof(FreeBlock); i < blockSize; ++i) {
+					if (block[i] != g_poisonFreed) {
+						SlabSource::get().poisonViolations.fetch_add(1, std::memory_order_relaxed);
+						DOOBIUS_CLOG(error) << "Pool block " << static_cast<void*>(block) << " of " << blockSize << " bytes was written to after it was freed (offset " << i << ")";
+						return;
+					}
+				}
+			}
+#endif
+
+			// Free list and slab both empty: adopt an exited thread's blocks, or start a new slab
+			void* refill(ThreadPool& pool, std::size_t sizeClass) {
+				const std::size_t blockSize = blockSizeOf(sizeClass);
+				if (FreeBlock* orphans = SlabSource::get().takeOrphans(sizeClass)) {
+					pool.freeList = orphans->next;
+#if DOOBIUS_MEMORY_DEBUG
+					checkPoison(reinterpret_cast<unsigned char*>(orphans), blockSize);
+#endif
+					return orphans;
+				}
+				unsigned char* slab = SlabSource::get().takeSlab();
+				if (!slab) {
+					DOOBIUS_CLOG(error) << "Block pool reservation exhausted, falling back to the heap";
+					return nullptr;
+				}
+				pool.bumpPos = slab + blockSize;
+				pool.bumpEnd = slab + g_poolSlabSize;
+				return slab;
+			}
+		}
+
+		void* BlockPools::allocate(std::size_t size)
+		{
+			if (size > g_poolMaxBlockSize) {
+				return ::operator new(size);
+			}
+			const std::size_t sizeClass = poolSizeClassOf(size);
+			const std::size_t blockSize = blockSizeOf(sizeClass);
+			ThreadPool& pool = t_pools.pools[sizeClass];
+
+			unsigned char* block;
+			if (pool.freeList) {
+				block = reinterpret_cast<unsigned char*>(pool.freeList);
+				pool.freeList = pool.freeList->next;
+#if DOOBIUS_MEMORY_DEBUG
+				checkPoison(block, blockSize);
+#endif
+			}
+			else if (pool.bumpPos + blockSize <= pool.bumpEnd && pool.bumpPos) {
+				block = pool.bumpPos;
+				pool.bumpPos += blockSize;
+			}
+			else {
+				block = static_cast<unsigned char*>(refill(pool, sizeClass));
+				if (!block) {
+					// Still a full, equally aligned block of this class, so once freed it simply joins the free list and
+					// never goes back to the heap
+					block = static_cast<unsigned char*>(::operator new(blockSize, std::align_val_t{ std::min(blockSize, std::size_t{ 64 }) }));
+				}
+			}
+#if DOOBIUS_MEMORY_DEBUG
+			SlabSource::get().outstanding[sizeClass].fetch_add(1, std::memory_order_relaxed);
+			std::memset(block, g_poisonAllocated, blockSize);
+#endif
+			return block;
+		}
+
+		void BlockPools::deallocate(void* p, std::size_t size)
+		{
+			if (!p) {
+				return;
+			}
+			if (size > g_poolMaxBlockSize) {
+				::operator delete(p);
+				return;
+			}
+			const std::size_t sizeClass = poolSizeClassOf(size);
+#if DOOBIUS_MEMORY_DEBUG
+			SlabSource::get().outstanding[sizeClass].fetch_sub(1, std::memory_order_relaxed);
+			std::memset(p, g_poisonFreed, blockSizeOf(sizeClass));
+#endif
+			ThreadPool& pool = t_pools.pools[sizeClass];
+			FreeBlock* block = static_cast<FreeBlock*>(p);
+			block->next = pool.freeList;
+			pool.freeList = block;
+		}
+
+		BlockPoolStats BlockPools::getStats()
+		{
+			SlabSource& source = SlabSource::get();
+			BlockPoolStats stats;
+			source.fillStats(stats);
+			for (std::size_t sizeClass = 0; sizeClass < g_poolNumSizeClasses; ++sizeClass) {
+				stats.outstanding[sizeClass] = source.outstanding[sizeClass].load(std::memory_order_relaxed);
+			}
+			stats.poisonViolations = source.poisonViolations.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+		std::int64_t BlockPools::reportLeaks()
+		{
+			BOOST_LOG_NAMED_SCOPE("BlockPools");
+			const BlockPoolStats stats = getStats();
+			std::int64_t total = 0;
+			for (std::size_t sizeClass = 0; sizeClass < g_poolNumSizeClasses; ++sizeClass) {
+				if (stats.outstanding[sizeClass] != 0) {
+					DOOBIUS_CLOG(warning) << stats.outstanding[sizeClass] << " pool blocks of " << blockSizeOf(sizeClass) << " bytes were never freed";
+					total += stats.outstanding[sizeClass];
+				}
+			}
+			if (total == 0) {
+				DOOBIUS_CLOG(info) << "No pool blocks leaked (" << stats.slabs << " slabs, " << stats.committedBytes << " bytes committed)";
+			}
+			return total;
+		}
+
+		void* BlockPoolResource::do_allocate(std::size_t bytes, std::size_t alignment)
+		{
+			if (bytes > g_poolMaxBlockSize || alignment > 64) {
+				return m_upstream->allocate(bytes, alignment);
+			}
+			// A block is aligned to its own size up to 64, so asking for at least alignment bytes is enough
+			return BlockPools::allocate(std::max(bytes, alignment));
+		}
+
+		void BlockPoolResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+		{
+			if (bytes > g_poolMaxBlockSize || alignment > 64) {
+				m_upstream->deallocate(p, bytes, alignment);
+				return;
+			}
+			BlockPools::deallocate(p, std::max(bytes, alignment));
+		}
+
+		bool BlockPoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+		{
+			return this == &other;
+		}
+
+		std::pmr::memory_resource* getBlockPoolResource()
+		{
+			static BlockPoolResource resource;
+			return &resource;
+		}
+	};
+};
@@ -2,16 +2,42 @@
 
 namespace Doobius {
 	namespace Perf {
-		CodeTimer::CodeTimer(const char* name) : m_timerName(name), m_start(std::chrono::high_resolution_clock::now()) {
-			BOOST_LOG_NAMED_SCOPE("Timing");
-			DOOBIUS_CLOG(debug) << "Started timer " << m_timerName;
+		CodeTimer::CodeTimer(const char* name, CodeTimerMode mode) : CodeTimer(internString(name), mode) {
+		}
+
+		CodeTimer::CodeTimer(StringId name, CodeTimerMode mode) : m_timerName(name), m_mode(mode), m_timerId(0), m_startTicks(0) {
+			if (m_mode == CodeTimerMode::AGGREGATE) {
+				m_timerId = TimingRegistry::get().getTimerId(m_timerName);
+			}
+			else {
+				BOOST_LOG_NAMED_SCOPE("Timing");
+				DOOBIUS_CLOG(debug) << "Started timer " << m_timerName;
+			}
+			if (m_mode == CodeTimerMode::COUNTERS) {
+				m_counterScope.emplace();
+			}
+			m_startTicks = PerfClock::now();
+		}
+
+		CodeTimer::CodeTimer(TimerId timerId) : m_mode(CodeTimerMode::AGGREGATE), m_timerId(timerId), m_startTicks(PerfClock::now()) {
 		}
 
 		long long CodeTimer::end() const {
+			const std::uint64_t endTicks = PerfClock::nowOrdered();
+			if (m_mode == CodeTimerMode::AGGREGATE) {
+				TimingRegistry::get().recordTicks(m_timerId, endTicks - m_startTicks);
+				return static_cast<long long>(PerfClock::get().ticksToNs(endTicks - m_startTicks) / 1e3);
+			}
+
 			BOOST_LOG_NAMED_SCOPE("Timing");
-			auto end = std::chrono::high_resolution_clock::now();
-			auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - m_start);
-			long long int microsecs = duration.count(), millisecs = 0, secs = 0;
+			if (m_counterScope) {
+				PerfCounterSample sample = m_counterScope->end();
+				DOOBIUS_CLOG(debug) << m_timerName << " took " << sample.toString();
+				return static_cast<long long>(sample.elapsedNs / 1e3);
+			}
+
+			const long long totalMicrosecs = static_cast<long long>(PerfClock::get().ticksToNs(endTicks - m_startTicks) / 1e3);
+			long long int microsecs = totalMicrosecs, millisecs = 0, secs = 0;
 			if (microsecs >= 1e3) {
 				millisecs = microsecs / 1e3;
 				microsecs -= millisecs * 1e3;
@@ -22,7 +48,7 @@ namespace Doobius {
 			}
 			DOOBIUS_CLOG(debug) << m_timerName << " took " << secs << "s " << millisecs << "ms " << microsecs << "us to complete";
 
-			return duration.count();
+			return totalMicrosecs;
 		}
 	};
-};
\ No newline at end of file
+};
@@ -0,0 +1,125 @@
+#include "doobius/common/frame_arena.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+
+namespace Doobius {
+	namespace Memory {
+		namespace {
+			std::atomic<std::uint64_t> g_frameEpoch{ 0 };
+		}
+
+		FrameArena::FrameArena() : FrameArena(FrameArenaConfig{})
+		{
+		}
+
+		FrameArena::FrameArena(const FrameArenaConfig& config) : m_region(config.reserveBytes, config.hugePages), m_used{ 0 }, m_committed{ 0 },
+			m_highWater{ 0 }, m_allocs{ 0 }, m_overflowAllocs{ 0 }, m_frameEpoch{ g_frameEpoch.load(std::memory_order_relaxed) }
+		{
+		}
+
+		FrameArena::~FrameArena()
+		{
+			reset();
+		}
+
+		void* FrameArena::allocateSlow(std::size_t size, std::size_t alignment)
+		{
+			const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_region.getBase());
+			const std::uintptr_t start = (base + m_used + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+			const std::size_t end = static_cast<std::size_t>(start - base) + size;
+			if (m_region.isValid() && m_region.commitUpTo(end)) {
+				m_committed = m_region.getCommitted();
+				m_used = end;
+#if DOOBIUS_MEMORY_DEBUG
+				std::memset(reinterpret_cast<void*>(start), g_poisonAllocated, size);
+#endif
+				return reinterpret_cast<void*>(start);
+			}
+
+			if (m_overflowAllocs == 0) {
+				DOOBIUS_CLOG(warning) << "Frame arena reservation of " << m_region.getReserved() << " bytes exhausted, falling back to the heap";
+			}
+			++m_overflowAllocs;
+			void* block = ::operator new(std::max<std::size_t>(size, 1), std::align_val_t(alignment));
+			m_overflowBlocks.emplace_back(block, alignment);
+#if DOOBIUS_MEMORY_DEBUG
+			std::memset(block, g_poisonAllocated, size);
+#endif
+			return block;
+		}
+
+		void FrameArena::reset()
+		{
+			m_highWater = std::max(m_highWater, m_used);
+#if DOOBIUS_MEMORY_DEBUG
+			// Anything still reading last frame's memory now sees 0xDD instead of plausible data
+			if (m_used > 0) {
+				std::memset(m_region.getBase(), g_poisonFreed, m_used);
+			}
+#endif
+			m_used = 0;
+			for (const std::pair<void*, std::size_t>& block : m_overflowBlocks) {
+				::operator delete(block.first, std::align_val_t(block.second));
+			}
+			m_overflowBlocks.clear();
+		}
+
+		FrameArenaStats FrameArena::getStats() const
+		{
+			FrameArenaStats stats;
+			stats.used = m_used;
+			stats.highWater = std::max(m_highWater, m_used);
+			stats.committed = m_committed;
+			stats.allocs = m_allocs;
+			stats.overflowAllocs = m_overflowAllocs;
+			return stats;
+		}
+
+		FrameArena& FrameArena::forThread()
+		{
+			thread_local std::unique_ptr<FrameArena> t_arena;
+			if (!t_arena) {
+				t_arena = std::make_unique<FrameArena>();
+			}
+			const std::uint64_t epoch = g_frameEpoch.load(std::memory_order_acquire);
+			if (t_arena->m_frameEpoch != epoch) {
+				t_arena->reset();
+				t_arena->m_frameEpoch = epoch;
+			}
+			return *t_arena;
+		}
+
+		void FrameArena::advanceFrame()
+		{
+			g_frameEpoch.fetch_add(1, std::memory_order_acq_rel);
+		}
+
+		std::uint64_t FrameArena::getFrameEpoch()
+		{
+			return g_frameEpoch.load(std::memory_order_acquire);
+		}
+
+		void* FrameArenaResource::do_allocate(std::size_t bytes, std::size_t alignment)
+		{
+			return FrameArena::forThread().allocate(bytes, alignment);
+		}
+
+		void FrameArenaResource::do_deallocate(void*, std::size_t, std::size_t)
+		{
+		}
+
+		bool FrameArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+		{
+			return this == &other;
+		}
+
+		std::pmr::memory_resource* getFrameArenaResource()
+		{
+			static FrameArenaResource resource;
+			return &resource;
+		}
+	};
+};
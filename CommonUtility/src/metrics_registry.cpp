@@ -0,0 +1,363 @@
+#include "doobius/common/metrics_registry.h"
+#include "doobius/dbg/logging.h"
+#include "doobius/dbg/custom_assert.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+			std::atomic<std::size_t> g_nextMetricShardIdx{ 0 };
+
+			bool isValidMetricName(const std::string& name) {
+				if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+					return false;
+				}
+				return std::all_of(name.begin(), name.end(), [](char c) {
+					return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == ':';
+				});
+			}
+
+			void appendEscaped(std::string& out, const std::string& str, bool escapeQuotes) {
+				for (char c : str) {
+					if (c == '\\') {
+						out += "\\\\";
+					}
+					else if (c == '\n') {
+						out += "\\n";
+					}
+					else if (c == '"' && escapeQuotes) {
+						out += "\\\"";
+					}
+					else {
+						out += c;
+					}
+				}
+			}
+
+			std::string renderLabels(const MetricLabels& labels) {
+				std::string labelStr;
+				for (const auto& [key, value] : labels) {
+					DOOBIUS_FMT_DASSERT(isValidMetricName(key) && key.find(':') == std::string::npos, "Invalid metric label name %1%", key);
+					if (!labelStr.empty()) {
+						labelStr += ',';
+					}
+					labelStr += key;
+					labelStr += "=\"";
+					appendEscaped(labelStr, value, true);
+					labelStr += '"';
+				}
+				return labelStr;
+			}
+
+			void appendValue(std::string& out, double value) {
+				if (std::isnan(value)) {
+					out += "NaN";
+					return;
+				}
+				if (std::isinf(value)) {
+					out += value > 0 ? "+Inf" : "-Inf";
+					return;
+				}
+				char buf[32];
+				// Whole numbers print without an exponent or trailing ".0", everything else as the shortest round-trip form
+				const std::to_chars_result res = std::abs(value) < 9007199254740992.0 && value == std::floor(value)
+					? std::to_chars(buf, buf + sizeof(buf), static_cast<std::int64_t>(value))
+					: std::to_chars(buf, buf + sizeof(buf), value);
+				out.append(buf, res.ptr);
+			}
+
+			void appendSample(std::string& out, const std::string& name, const char* suffix, const std::string& labelStr, const std::string& extraLabel, double value) {
+				out += name;
+				out += suffix;
+				if (!labelStr.empty() || !extraLabel.empty()) {
+					out += '{';
+					out += labelStr;
+					if (!labelStr.empty() && !extraLabel.empty()) {
+						out += ',';
+					}
+					out += extraLabel;
+					out += '}';
+				}
+				out += ' ';
+				appendValue(out, value);
+				out += '\n';
+			}
+
+			const char* metricTypeString(MetricType type) {
+				switch (type) {
+				case MetricType::COUNTER:   return "counter";
+				case MetricType::GAUGE:     return "gauge";
+				case MetricType::HISTOGRAM: return "histogram";
+				default:                    return "untyped";
+				}
+			}
+		}
+
+		std::size_t nextMetricShardIdx()
+		{
+			return g_nextMetricShardIdx.fetch_add(1, std::memory_order_relaxed) % g_numMetricShards;
+		}
+
+		std::uint64_t Counter::value() const
+		{
+			std::uint64_t total = 0;
+			for (const Shard& shard : m_shards) {
+				total += shard.value.load(std::memory_order_relaxed);
+			}
+			return total;
+		}
+
+		void Gauge::set(std::int64_t newValue)
+		{
+			add(newValue - value());
+		}
+
+		std::int64_t Gauge::value() const
+		{
+			std::int64_t total = 0;
+			for (const Shard& shard : m_shards) {
+				total += shard.value.load(std::memory_order_relaxed);
+			}
+			return total;
+		}
+
+		Histogram::Histogram(std::vector<double> upperBounds) :
+			m_upperBounds(std::move(upperBounds)), m_linesPerShard((m_upperBounds.size() + 2 + 7) / 8),
+			m_lines(std::make_unique<CacheLine[]>(m_linesPerShard * g_numMetricShards))
+		{
+			DOOBIUS_DASSERT(std::is_sorted(m_upperBounds.begin(), m_upperBounds.end()), "Histogram bucket bounds must be sorted");
+		}
+
+		void Histogram::observe(double value)
+		{
+			const std::size_t shardIdx = getMetricShardIdx();
+			const std::size_t bucketIdx = static_cast<std::size_t>(std::lower_bound(m_upperBounds.begin(), m_upperBounds.end(), value) - m_upperBounds.begin());
+			word(shardIdx, 1 + bucketIdx).fetch_add(1, std::memory_order_relaxed);
+
+			std::atomic<std::uint64_t>& sumBits = word(shardIdx, 0);
+			std::uint64_t oldBits = sumBits.load(std::memory_order_relaxed);
+			while (!sumBits.compare_exchange_weak(oldBits, std::bit_cast<std::uint64_t>(std::bit_cast<double>(oldBits) + value), std::memory_order_relaxed)) {
+			}
+		}
+
+		Histogram::Snapshot Histogram::snapshot() const
+		{
+			Snapshot snap;
+			snap.upperBounds = m_upperBounds;
+			snap.bucketCounts.assign(m_upperBounds.size() + 1, 0);
+			for (std::size_t shardIdx = 0; shardIdx < g_numMetricShards; ++shardIdx) {
+				snap.sum += std::bit_cast<double>(word(shardIdx, 0).load(std::memory_order_relaxed));
+				for (std::size_t b = 0; b < snap.bucketCounts.size(); ++b) {
+					snap.bucketCounts[b] += word(shardIdx, 1 + b).load(std::memory_order_relaxed);
+				}
+			}
+			for (std::uint64_t bucketCount : snap.bucketCounts) {
+				snap.count += bucketCount;
+			}
+			return snap;
+		}
+
+		MetricsRegistry::MetricsRegistry() : m_stopExporter{ false }
+		{
+			registerBuiltinMetrics();
+		}
+
+		MetricsRegistry::~MetricsRegistry()
+		{
+			stopExporter();
+		}
+
+		MetricsRegistry& MetricsRegistry::get()
+		{
+			static MetricsRegistry _metricsRegistry;
+			return _metricsRegistry;
+		}
+
+		void MetricsRegistry::registerBuiltinMetrics()
+		{
+			// DebuggingUtility sits below CommonUtility, so LogManager only keeps plain counts and they are pulled from here.
+			// Touching LogManager first also makes sure it outlives this registry's final export at exit.
+			Log::LogManager& logMng = DOOBIUS_LOG_MNG();
+			registerCallback("doobius_log_records_total", "Log records formatted by each sink", MetricType::COUNTER,
+				[&logMng]() { return static_cast<double>(logMng.getNumFileRecords()); }, { { "sink", "file" } });
+			registerCallback("doobius_log_records_total", "Log records formatted by each sink", MetricType::COUNTER,
+				[&logMng]() { return static_cast<double>(logMng.getNumConsoleRecords()); }, { { "sink", "console" } });
+			registerCallback("doobius_log_dropped_records_total", "Log records whose formatting threw", MetricType::COUNTER,
+				[&logMng]() { return static_cast<double>(logMng.getNumDroppedRecords()); });
+		}
+
+		MetricsRegistry::MetricSeries& MetricsRegistry::getSeries(const std::string& name, const std::string& help, MetricType type, const MetricLabels& labels)
+		{
+			DOOBIUS_FMT_DASSERT(isValidMetricName(name), "Invalid metric name %1%", name);
+			const std::string labelStr = renderLabels(labels);
+
+			auto [familyIt, inserted] = m_families.try_emplace(name);
+			MetricFamily& family = familyIt->second;
+			if (inserted) {
+				family.help = help;
+				family.type = type;
+			}
+			DOOBIUS_FMT_DASSERT(family.type == type, "Metric %1% was already registered with a different type", name);
+
+			for (const std::unique_ptr<MetricSeries>& series : family.series) {
+				if (series->labelStr == labelStr) {
+					return *series;
+				}
+			}
+			family.series.push_back(std::make_unique<MetricSeries>());
+			family.series.back()->labelStr = labelStr;
+			return *family.series.back();
+		}
+
+		Counter& MetricsRegistry::getCounter(const std::string& name, const std::string& help, const MetricLabels& labels)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			MetricSeries& series = getSeries(name, help, MetricType::COUNTER, labels);
+			if (!series.counter) {
+				series.counter = std::make_unique<Counter>();
+			}
+			return *series.counter;
+		}
+
+		Gauge& MetricsRegistry::getGauge(const std::string& name, const std::string& help, const MetricLabels& labels)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			MetricSeries& series = getSeries(name, help, MetricType::GAUGE, labels);
+			if (!series.gauge) {
+				series.gauge = std::make_unique<Gauge>();
+			}
+			return *series.gauge;
+		}
+
+		Histogram& MetricsRegistry::getHistogram(const std::string& name, const std::string& help, std::vector<double> upperBounds, const MetricLabels& labels)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			MetricSeries& series = getSeries(name, help, MetricType::HISTOGRAM, labels);
+			if (!series.histogram) {
+				series.histogram = std::make_unique<Histogram>(std::move(upperBounds));
+			}
+			return *series.histogram;
+		}
+
+		void MetricsRegistry::registerCallback(const std::string& name, const std::string& help, MetricType type, std::function<double()> fn, const MetricLabels& labels)
+		{
+			DOOBIUS_DASSERT(type != MetricType::HISTOGRAM, "Callback metrics can only be counters or gauges");
+			std::lock_guard<std::mutex> lock(m_mutex);
+			getSeries(name, help, type, labels).callback = std::move(fn);
+		}
+
+		std::string MetricsRegistry::renderPrometheus() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string out;
+			out.reserve(256 * m_families.size());
+			for (const auto& [name, family] : m_families) {
+				out += "# HELP ";
+				out += name;
+				out += ' ';
+				appendEscaped(out, family.help, false);
+				out += "\n# TYPE ";
+				out += name;
+				out += ' ';
+				out += metricTypeString(family.type);
+				out += '\n';
+
+				for (const std::unique_ptr<MetricSeries>& series : family.series) {
+					if (series->histogram) {
+						const Histogram::Snapshot snap = series->histogram->snapshot();
+						std::uint64_t cumulative = 0;
+						for (std::size_t b = 0; b < snap.bucketCounts.size(); ++b) {
+							cumulative += snap.bucketCounts[b];
+							std::string leLabel = "le=\"";
+							appendValue(leLabel, b < snap.upperBounds.size() ? snap.upperBounds[b] : INFINITY);
+							leLabel += '"';
+							appendSample(out, name, "_bucket", series->labelStr, leLabel, static_cast<double>(cumulative));
+						}
+						appendSample(out, name, "_sum", series->labelStr, {}, snap.sum);
+						appendSample(out, name, "_count", series->labelStr, {}, static_cast<double>(snap.count));
+					}
+					else if (series->counter) {
+						appendSample(out, name, "", series->labelStr, {}, static_cast<double>(series->counter->value()));
+					}
+					else if (series->gauge) {
+						appendSample(out, name, "", series->labelStr, {}, static_cast<double>(series->gauge->value()));
+					}
+					else if (series->callback) {
+						appendSample(out, name, "", series->labelStr, {}, series->callback());
+					}
+				}
+			}
+			return out;
+		}
+
+		bool MetricsRegistry::writePrometheusFile(const std::filesystem::path& path) const
+		{
+			const std::string text = renderPrometheus();
+			std::filesystem::path tmpPath = path;
+			tmpPath += ".tmp";
+			{
+				std::ofstream outFile(tmpPath, std::ios::binary | std::ios::trunc);
+				if (outFile.fail()) {
+					DOOBIUS_CLOG(warning) << "Couldn't open " << tmpPath.string() << " to write metrics";
+					return false;
+				}
+				outFile.write(text.data(), static_cast<std::streamsize>(text.size()));
+				if (outFile.fail()) {
+					DOOBIUS_CLOG(warning) << "Failed writing metrics to " << tmpPath.string();
+					return false;
+				}
+			}
+			std::error_code ec;
+			std::filesystem::rename(tmpPath, path, ec);
+			if (ec) {
+				DOOBIUS_CLOG(warning) << "Couldn't move metrics snapshot into " << path.string() << ": " << ec.message();
+				return false;
+			}
+			return true;
+		}
+
+		void MetricsRegistry::exporterLoop(std::filesystem::path path, std::chrono::milliseconds period)
+		{
+			std::unique_lock<std::mutex> lock(m_exporterMutex);
+			while (!m_stopExporter) {
+				lock.unlock();
+				writePrometheusFile(path);
+				lock.lock();
+				m_exporterCv.wait_for(lock, period, [this] { return m_stopExporter; });
+			}
+			lock.unlock();
+			writePrometheusFile(path);
+		}
+
+		void MetricsRegistry::startExporter(const std::filesystem::path& path, std::chrono::milliseconds period)
+		{
+			BOOST_LOG_NAMED_SCOPE("MetricsRegistry");
+			stopExporter();
+			{
+				std::lock_guard<std::mutex> lock(m_exporterMutex);
+				m_stopExporter = false;
+			}
+			m_exporter = std::thread(&MetricsRegistry::exporterLoop, this, path, std::max(period, std::chrono::milliseconds(1)));
+			DOOBIUS_CLOG(info) << "Exporting metrics to " << path.string() << " every " << period.count() << "ms";
+		}
+
+		void MetricsRegistry::stopExporter()
+		{
+			if (!m_exporter.joinable()) {
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_exporterMutex);
+				m_stopExporter = true;
+			}
+			m_exporterCv.notify_all();
+			m_exporter.join();
+		}
+	};
+};
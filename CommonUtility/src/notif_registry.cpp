@@ -8,31 +8,51 @@ namespace Doobius {
 			DOOBIUS_FMT_DASSERT(m_cbIdMap.left.find(cbId) != m_cbIdMap.left.end(), "Did not find callback %1% in notification registry %2%", cbId % m_nameOfNotifReg);
 
 			m_registrations.erase(ChannelSubscription(cbId, chlId));
-			const CbStr& cbName = m_cbIdMap.left.at(cbId);
-			const ChannelStr& chlName = m_chlIdMap.left.at(chlId);
+			const StringId cbName = m_cbIdMap.left.at(cbId);
+			const StringId chlName = m_chlIdMap.left.at(chlId);
 
 			DOOBIUS_CLOG(info) << cbName << " stopped listening to " << chlName << " in " << m_nameOfNotifReg;
 		}
 
+		void NotificationRegistry::initMetrics()
+		{
+			Perf::MetricsRegistry& metrics = Perf::MetricsRegistry::get();
+			const Perf::MetricLabels labels{ { "registry", m_nameOfNotifReg } };
+			m_updatesMetric = &metrics.getCounter("doobius_notification_updates_total", "updateChannel calls that reached at least one callback", labels);
+			m_missedUpdatesMetric = &metrics.getCounter("doobius_notification_missed_updates_total", "updateChannel calls on a missing or empty channel", labels);
+			m_callbacksInvokedMetric = &metrics.getCounter("doobius_notification_callbacks_invoked_total", "Callbacks run by updateChannel", labels);
+			m_callbacksMetric = &metrics.getGauge("doobius_notification_callbacks", "Callbacks registered", labels);
+			m_channelsMetric = &metrics.getGauge("doobius_notification_channels", "Channels registered", labels);
+		}
+
 		NotificationRegistry::NotificationRegistry() : m_cbIdCounter{ m_nullCbId }, m_chlIdCounter{ m_nullChlId }, m_nameOfNotifReg{ "UnknownNotifReg" }
 		{
+			initMetrics();
 			DOOBIUS_CLOG(info) << m_nameOfNotifReg << " notification registry was created";
 		}
 
 		NotificationRegistry::NotificationRegistry(const std::string& nameOfNotifReg) : m_cbIdCounter{ m_nullCbId }, m_chlIdCounter{ m_nullChlId }, m_nameOfNotifReg{ nameOfNotifReg }
 		{
+			initMetrics();
 			DOOBIUS_CLOG(info) << m_nameOfNotifReg << " notification registry was created";
 		}
 
-		void NotificationRegistry::createNotificationChannel(const ChannelStr& channelName)
+		NotificationRegistry::~NotificationRegistry()
+		{
+			m_callbacksMetric->sub(getNumCbsRegistered());
+			m_channelsMetric->sub(getNumChannelsRegistered());
+		}
+
+		void NotificationRegistry::createNotificationChannel(StringId channelName)
 		{
 			DOOBIUS_FMT_DASSERT(m_chlIdMap.right.find(channelName) == m_chlIdMap.right.end(), "Found channel %1% already registered in notification registry %2%", channelName % m_nameOfNotifReg);
 			m_chlIdMap.insert(ChannelIdMapping::value_type(++m_chlIdCounter, channelName));
+			m_channelsMetric->add(1);
 			DOOBIUS_CLOG(trace) << channelName << " <-> " << m_chlIdCounter << " : " << m_nameOfNotifReg;
 		}
 
 
-		NotificationRegistry::UpdateStatus NotificationRegistry::registerCallbackToChannel(const CbStr& cbName, const ChannelStr& chlName)
+		NotificationRegistry::UpdateStatus NotificationRegistry::registerCallbackToChannel(StringId cbName, StringId chlName)
 		{
 			if (m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find callback " << cbName << " in notification registry " << m_nameOfNotifReg;
@@ -51,7 +71,7 @@ namespace Doobius {
 			return UpdateStatus::UPDATE_OK;
 		}
 
-		NotificationRegistry::UpdateStatus NotificationRegistry::unsubCallbackFromChannel(const CbStr& cbName, const ChannelStr& chlName)
+		NotificationRegistry::UpdateStatus NotificationRegistry::unsubCallbackFromChannel(StringId cbName, StringId chlName)
 		{
 			if (m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find callback " << cbName << " in notification registry " << m_nameOfNotifReg;
@@ -71,7 +91,7 @@ namespace Doobius {
 			return UpdateStatus::UPDATE_OK;
 		}
 
-		NotificationRegistry::UpdateStatus NotificationRegistry::unsubCallbackFromAllChannels(const CbStr& cbName)
+		NotificationRegistry::UpdateStatus NotificationRegistry::unsubCallbackFromAllChannels(StringId cbName)
 		{
 			if (m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find callback " << cbName << " in notification registry " << m_nameOfNotifReg;
@@ -92,7 +112,7 @@ namespace Doobius {
 			return UpdateStatus::UPDATE_OK;
 		}
 
-		NotificationRegistry::UpdateStatus NotificationRegistry::unsubAllCallbacksFromChannel(const ChannelStr& chlName)
+		NotificationRegistry::UpdateStatus NotificationRegistry::unsubAllCallbacksFromChannel(StringId chlName)
 		{
 			if (m_chlIdMap.right.find(chlName) == m_chlIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find channel " << chlName << " in notification registry " << m_nameOfNotifReg;
@@ -113,16 +133,18 @@ namespace Doobius {
 			return UpdateStatus::UPDATE_OK;
 		}
 
-		void NotificationRegistry::destroyChannel(const ChannelStr& chlName)
+		void NotificationRegistry::destroyChannel(StringId chlName)
 		{
 			UpdateStatus unsubRes = unsubAllCallbacksFromChannel(chlName);
 			DOOBIUS_FMT_DASSERT(unsubRes == UpdateStatus::UPDATE_OK, "Did not find channel %1% in notification registry %2%", chlName % m_nameOfNotifReg);
-			m_chlIdMap.right.erase(chlName);
+			if (m_chlIdMap.right.erase(chlName) > 0) {
+				m_channelsMetric->sub(1);
+			}
 
 			DOOBIUS_CLOG(info) << "Channel " << chlName << " destroyed";
 		}
 
-		void NotificationRegistry::removeCallback(const CbStr& cbName)
+		void NotificationRegistry::removeCallback(StringId cbName)
 		{
 			UpdateStatus unsubRes = unsubCallbackFromAllChannels(cbName);
 			DOOBIUS_FMT_DASSERT(unsubRes == UpdateStatus::UPDATE_OK, "Did not find channel %1% in notification registry %2%", cbName % m_nameOfNotifReg);
@@ -130,11 +152,12 @@ namespace Doobius {
 			CbId cbId = m_cbIdMap.right.at(cbName);
 			DOOBIUS_FMT_VERIFY(m_callbackReg.erase(cbId), "Failed to remove callback %1% from callback registry in %2%", cbName % m_nameOfNotifReg);
 			m_cbIdMap.right.erase(cbName);
+			m_callbacksMetric->sub(1);
 
 			DOOBIUS_CLOG(info) << "Callback " << cbName << " destroyed";
 		}
 
-		int NotificationRegistry::getNumCbsListeningTo(const ChannelStr& chlName) const
+		int NotificationRegistry::getNumCbsListeningTo(StringId chlName) const
 		{
 			if (m_chlIdMap.right.find(chlName) == m_chlIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find channel " << chlName << " in notification registry " << m_nameOfNotifReg;
@@ -146,7 +169,7 @@ namespace Doobius {
 			return count;
 		}
 
-		int NotificationRegistry::getNumChannelsListenedBy(const CbStr& cbName) const
+		int NotificationRegistry::getNumChannelsListenedBy(StringId cbName) const
 		{
 			if (m_cbIdMap.right.find(cbName) == m_cbIdMap.right.end()) {
 				DOOBIUS_CLOG(warning) << "Did not find callback " << cbName << " in notification registry " << m_nameOfNotifReg;
@@ -0,0 +1,149 @@
+#include "doobius/common/payload_pool.h"
+#include "doobius/dbg/logging.h"
+
+#include <mutex>
+#include <new>
+
+namespace Doobius {
+	namespace Memory {
+		namespace {
+			using Detail::PayloadHeader;
+
+			constexpr std::size_t capacityOf(std::size_t sizeClass) {
+				return g_payloadMinPooledSize << sizeClass;
+			}
+
+			PayloadHeader* allocateBuffer(std::size_t capacity) {
+				void* memory = ::operator new(sizeof(PayloadHeader) + capacity, std::align_val_t{ alignof(PayloadHeader) });
+				return new (memory) PayloadHeader{};
+			}
+
+			void freeBuffer(PayloadHeader* header) {
+				header->~PayloadHeader();
+				::operator delete(header, std::align_val_t{ alignof(PayloadHeader) });
+			}
+
+			struct SizeClassPool {
+				std::mutex mutex;
+				PayloadHeader* freeList = nullptr;
+				std::uint64_t numFree = 0;
+				std::atomic<std::uint64_t> buffers{ 0 };
+				std::atomic<std::uint64_t> acquires{ 0 };
+				std::atomic<std::uint64_t> heapAllocations{ 0 };
+			};
+
+			struct PayloadPools {
+				std::array<SizeClassPool, g_payloadNumSizeClasses> sizeClasses;
+				std::atomic<std::uint64_t> oversizeAcquires{ 0 };
+				std::atomic<std::uint64_t> oversizeInUse{ 0 };
+
+				static PayloadPools& get() {
+					// Never destroyed: handles kept in statics can still be released during teardown
+					static PayloadPools* pools = new PayloadPools();
+					return *pools;
+				}
+			};
+		}
+
+		void Detail::releasePayload(PayloadHeader* header)
+		{
+			PayloadPools& pools = PayloadPools::get();
+			if (header->sizeClass == g_payloadOversizeClass) {
+				pools.oversizeInUse.fetch_sub(1, std::memory_order_relaxed);
+				freeBuffer(header);
+				return;
+			}
+			SizeClassPool& pool = pools.sizeClasses[header->sizeClass];
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			header->nextFree = pool.freeList;
+			pool.freeList = header;
+			++pool.numFree;
+		}
+
+		MutablePayload PayloadPool::acquire(std::size_t bytes)
+		{
+			PayloadPools& pools = PayloadPools::get();
+			PayloadHeader* header = nullptr;
+			std::size_t capacity;
+			if (bytes > g_payloadMaxPooledSize) {
+				capacity = bytes;
+				header = allocateBuffer(capacity);
+				header->sizeClass = g_payloadOversizeClass;
+				pools.oversizeAcquires.fetch_add(1, std::memory_order_relaxed);
+				pools.oversizeInUse.fetch_add(1, std::memory_order_relaxed);
+			}
+			else {
+				const std::size_t sizeClass = payloadSizeClassOf(bytes);
+				capacity = capacityOf(sizeClass);
+				SizeClassPool& pool = pools.sizeClasses[sizeClass];
+				pool.acquires.fetch_add(1, std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> lock(pool.mutex);
+					if (pool.freeList) {
+						header = pool.freeList;
+						pool.freeList = header->nextFree;
+						--pool.numFree;
+					}
+				}
+				if (!header) {
+					header = allocateBuffer(capacity);
+					header->sizeClass = static_cast<std::uint32_t>(sizeClass);
+					pool.buffers.fetch_add(1, std::memory_order_relaxed);
+					pool.heapAllocations.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			header->refCount.store(1, std::memory_order_relaxed);
+			header->size = bytes;
+			header->nextFree = nullptr;
+			return MutablePayload(header, capacity);
+		}
+
+		PayloadPoolStats PayloadPool::getStats()
+		{
+			PayloadPools& pools = PayloadPools::get();
+			PayloadPoolStats stats;
+			for (std::size_t sizeClass = 0; sizeClass < g_payloadNumSizeClasses; ++sizeClass) {
+				SizeClassPool& pool = pools.sizeClasses[sizeClass];
+				PayloadSizeClassStats& classStats = stats.sizeClasses[sizeClass];
+				classStats.capacity = capacityOf(sizeClass);
+				{
+					std::lock_guard<std::mutex> lock(pool.mutex);
+					classStats.free = pool.numFree;
+					classStats.buffers = pool.buffers.load(std::memory_order_relaxed);
+				}
+				classStats.acquires = pool.acquires.load(std::memory_order_relaxed);
+				classStats.heapAllocations = pool.heapAllocations.load(std::memory_order_relaxed);
+				stats.inUse += classStats.buffers - classStats.free;
+				stats.pooledBytes += classStats.buffers * classStats.capacity;
+			}
+			stats.oversizeAcquires = pools.oversizeAcquires.load(std::memory_order_relaxed);
+			stats.oversizeInUse = pools.oversizeInUse.load(std::memory_order_relaxed);
+			stats.inUse += stats.oversizeInUse;
+			return stats;
+		}
+
+		std::size_t PayloadPool::trim()
+		{
+			std::size_t freedBytes = 0;
+			for (std::size_t sizeClass = 0; sizeClass < g_payloadNumSizeClasses; ++sizeClass) {
+				SizeClassPool& pool = PayloadPools::get().sizeClasses[sizeClass];
+				PayloadHeader* freeList;
+				std::uint64_t numFree;
+				{
+					std::lock_guard<std::mutex> lock(pool.mutex);
+					freeList = std::exchange(pool.freeList, nullptr);
+					numFree = std::exchange(pool.numFree, 0);
+					pool.buffers.fetch_sub(numFree, std::memory_order_relaxed);
+				}
+				while (freeList) {
+					freeBuffer(std::exchange(freeList, freeList->nextFree));
+				}
+				freedBytes += numFree * capacityOf(sizeClass);
+			}
+			if (freedBytes > 0) {
+				DOOBIUS_CLOG(debug) << "Payload pools trimmed, " << freedBytes << " bytes freed";
+			}
+			return freedBytes;
+		}
+	};
+};
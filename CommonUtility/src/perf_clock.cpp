@@ -0,0 +1,100 @@
+#include "doobius/common/perf_clock.h"
+
+#if DOOBIUS_HAS_TSC && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+			bool detectInvariantTsc() {
+#if DOOBIUS_HAS_TSC
+				// CPUID leaf 0x80000007, EDX bit 8: TSC runs at a constant rate in all ACPI P-, C- and T-states
+				constexpr unsigned int powerMgmtLeaf = 0x80000007;
+				constexpr unsigned int invariantTscBit = 1u << 8;
+#if defined(_MSC_VER)
+				int regs[4];
+				__cpuid(regs, 0x80000000);
+				if (static_cast<unsigned int>(regs[0]) < powerMgmtLeaf) {
+					return false;
+				}
+				__cpuid(regs, static_cast<int>(powerMgmtLeaf));
+				return (static_cast<unsigned int>(regs[3]) & invariantTscBit) != 0;
+#else
+				unsigned int eax, ebx, ecx, edx;
+				if (__get_cpuid_max(0x80000000, nullptr) < powerMgmtLeaf) {
+					return false;
+				}
+				__get_cpuid(powerMgmtLeaf, &eax, &ebx, &ecx, &edx);
+				return (edx & invariantTscBit) != 0;
+#endif
+#else
+				return false;
+#endif
+			}
+
+			constexpr double steadyNsPerTick() {
+				using SteadyPeriod = std::chrono::steady_clock::period;
+				return 1e9 * SteadyPeriod::num / SteadyPeriod::den;
+			}
+		}
+
+		PerfClock::PerfClock() : m_source{ ClockSource::STEADY }, m_invariantTsc{ detectInvariantTsc() },
+			m_nsPerTick{ steadyNsPerTick() }, m_ticksPerNs{ 1.0 / steadyNsPerTick() }
+		{
+			if (m_invariantTsc) {
+				m_source = ClockSource::TSC;
+				calibrate(std::chrono::milliseconds(20));
+			}
+		}
+
+		PerfClock& PerfClock::get()
+		{
+			static PerfClock _perfClock;
+			return _perfClock;
+		}
+
+		void PerfClock::calibrate(std::chrono::milliseconds calibrationTime)
+		{
+#if DOOBIUS_HAS_TSC
+			if (m_source != ClockSource::TSC) {
+				return;
+			}
+
+			// Bracket each steady_clock read with TSC reads and take the midpoints, so the cost of the steady_clock
+			// call itself doesn't skew the rate
+			auto samplePair = [](std::uint64_t& tsc, std::chrono::steady_clock::time_point& steady) {
+				std::uint64_t before = readTscOrdered();
+				steady = std::chrono::steady_clock::now();
+				std::uint64_t after = readTscOrdered();
+				tsc = before + (after - before) / 2;
+			};
+
+			std::uint64_t tscStart, tscEnd;
+			std::chrono::steady_clock::time_point steadyStart, steadyEnd;
+			samplePair(tscStart, steadyStart);
+			do {
+				samplePair(tscEnd, steadyEnd);
+			} while (steadyEnd - steadyStart < calibrationTime);
+
+			const double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(steadyEnd - steadyStart).count());
+			m_ticksPerNs = static_cast<double>(tscEnd - tscStart) / elapsedNs;
+			m_nsPerTick = 1.0 / m_ticksPerNs;
+#endif
+		}
+
+		ClockSource PerfClock::setSource(ClockSource source)
+		{
+			if (source == ClockSource::TSC && m_invariantTsc) {
+				m_source = ClockSource::TSC;
+				calibrate(std::chrono::milliseconds(20));
+			}
+			else {
+				m_source = ClockSource::STEADY;
+				m_nsPerTick = steadyNsPerTick();
+				m_ticksPerNs = 1.0 / m_nsPerTick;
+			}
+			return m_source;
+		}
+	};
+};
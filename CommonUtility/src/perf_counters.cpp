@@ -0,0 +1,201 @@
+#include "doobius/common/perf_counters.h"
+#include "doobius/common/perf_clock.h"
+#include "doobius/dbg/logging.h"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+#if defined(__linux__)
+			struct PerfCounterDesc {
+				std::uint32_t type;
+				std::uint64_t config;
+			};
+
+			constexpr std::array<PerfCounterDesc, g_numPerfCounters> g_perfCounterDescs = { {
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+			} };
+
+			int openPerfCounter(const PerfCounterDesc& desc, int groupFd) {
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = desc.type;
+				attr.config = desc.config;
+				attr.disabled = groupFd == -1 ? 1 : 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+			}
+
+			std::string readParanoidLevel() {
+				std::ifstream paranoidFile("/proc/sys/kernel/perf_event_paranoid");
+				std::string level;
+				return (paranoidFile >> level) ? level : std::string("unknown");
+			}
+#endif
+		}
+
+		const char* perfCounterName(PerfCounter counter)
+		{
+			switch (counter) {
+			case PerfCounter::CYCLES: return "cycles";
+			case PerfCounter::INSTRUCTIONS: return "instructions";
+			case PerfCounter::L1D_MISSES: return "l1d_misses";
+			case PerfCounter::LLC_MISSES: return "llc_misses";
+			case PerfCounter::BRANCH_MISSES: return "branch_misses";
+			default: return "unknown";
+			}
+		}
+
+		double PerfCounterSample::getIpc() const
+		{
+			if (!deltas.has(PerfCounter::CYCLES) || !deltas.has(PerfCounter::INSTRUCTIONS) || deltas.get(PerfCounter::CYCLES) == 0) {
+				return 0.0;
+			}
+			return static_cast<double>(deltas.get(PerfCounter::INSTRUCTIONS)) / static_cast<double>(deltas.get(PerfCounter::CYCLES));
+		}
+
+		double PerfCounterSample::getMpki(PerfCounter missCounter) const
+		{
+			if (!deltas.has(missCounter) || !deltas.has(PerfCounter::INSTRUCTIONS) || deltas.get(PerfCounter::INSTRUCTIONS) == 0) {
+				return 0.0;
+			}
+			return 1e3 * static_cast<double>(deltas.get(missCounter)) / static_cast<double>(deltas.get(PerfCounter::INSTRUCTIONS));
+		}
+
+		std::string PerfCounterSample::toString() const
+		{
+			std::ostringstream oss;
+			oss << elapsedNs / 1e3 << "us";
+			if (deltas.availableMask == 0) {
+				return oss.str();
+			}
+			for (std::size_t i = 0; i < g_numPerfCounters; ++i) {
+				if (deltas.has(static_cast<PerfCounter>(i))) {
+					oss << ' ' << perfCounterName(static_cast<PerfCounter>(i)) << '=' << deltas.values[i];
+				}
+			}
+			if (deltas.has(PerfCounter::CYCLES) && deltas.has(PerfCounter::INSTRUCTIONS)) {
+				oss << " ipc=" << getIpc();
+			}
+			for (PerfCounter missCounter : { PerfCounter::L1D_MISSES, PerfCounter::LLC_MISSES, PerfCounter::BRANCH_MISSES }) {
+				if (deltas.has(missCounter) && deltas.has(PerfCounter::INSTRUCTIONS)) {
+					oss << ' ' << perfCounterName(missCounter) << "_pki=" << getMpki(missCounter);
+				}
+			}
+			return oss.str();
+		}
+
+		PerfCounterGroup::PerfCounterGroup() : m_leaderFd{ -1 }, m_availableMask{ 0 }, m_numOpen{ 0 }
+		{
+			m_fds.fill(-1);
+#if defined(__linux__)
+			int firstErrno = 0;
+			for (std::size_t i = 0; i < g_numPerfCounters; ++i) {
+				int fd = openPerfCounter(g_perfCounterDescs[i], m_leaderFd);
+				if (fd == -1) {
+					firstErrno = firstErrno ? firstErrno : errno;
+					continue;
+				}
+				if (m_leaderFd == -1) {
+					m_leaderFd = fd;
+				}
+				m_fds[i] = fd;
+				m_availableMask |= 1u << i;
+				++m_numOpen;
+			}
+
+			if (m_leaderFd != -1) {
+				ioctl(m_leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+				ioctl(m_leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			}
+			if (m_numOpen < g_numPerfCounters) {
+				DOOBIUS_CLOG(info) << "Opened " << m_numOpen << " of " << g_numPerfCounters << " hardware counters (" << std::strerror(firstErrno)
+					<< ", perf_event_paranoid=" << readParanoidLevel() << ")" << (m_numOpen ? "" : ", timing with wall clock only");
+			}
+#else
+			DOOBIUS_CLOG(info) << "Hardware counters are only read on Linux, timing with wall clock only";
+#endif
+		}
+
+		PerfCounterGroup::~PerfCounterGroup()
+		{
+#if defined(__linux__)
+			for (int fd : m_fds) {
+				if (fd != -1) {
+					close(fd);
+				}
+			}
+#endif
+		}
+
+		PerfCounterGroup& PerfCounterGroup::forCurrentThread()
+		{
+			thread_local PerfCounterGroup t_perfCounterGroup;
+			return t_perfCounterGroup;
+		}
+
+		PerfCounterValues PerfCounterGroup::read() const
+		{
+			PerfCounterValues counters;
+#if defined(__linux__)
+			if (m_leaderFd == -1) {
+				return counters;
+			}
+			// PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, then one value per counter in open order
+			std::array<std::uint64_t, 3 + g_numPerfCounters> buf{};
+			const ssize_t expected = static_cast<ssize_t>((3 + m_numOpen) * sizeof(std::uint64_t));
+			if (::read(m_leaderFd, buf.data(), sizeof(buf)) < expected || buf[0] != m_numOpen) {
+				return counters;
+			}
+			const double scale = buf[2] ? static_cast<double>(buf[1]) / static_cast<double>(buf[2]) : 1.0;
+			std::size_t valIdx = 3;
+			for (std::size_t i = 0; i < g_numPerfCounters; ++i) {
+				if (m_fds[i] != -1) {
+					counters.values[i] = static_cast<std::uint64_t>(static_cast<double>(buf[valIdx++]) * scale);
+				}
+			}
+			counters.availableMask = m_availableMask;
+#endif
+			return counters;
+		}
+
+		PerfCounterScope::PerfCounterScope() : m_group(PerfCounterGroup::forCurrentThread()), m_start(m_group.read()), m_startTicks(PerfClock::now())
+		{
+		}
+
+		PerfCounterSample PerfCounterScope::end() const
+		{
+			const std::uint64_t endTicks = PerfClock::nowOrdered();
+			const PerfCounterValues endValues = m_group.read();
+
+			PerfCounterSample sample;
+			sample.elapsedNs = PerfClock::get().ticksToNs(endTicks - m_startTicks);
+			sample.deltas.availableMask = m_start.availableMask & endValues.availableMask;
+			for (std::size_t i = 0; i < g_numPerfCounters; ++i) {
+				if (sample.deltas.has(static_cast<PerfCounter>(i))) {
+					// Multiplexing scale factors can differ between the two reads, never report a negative delta
+					sample.deltas.values[i] = endValues.values[i] > m_start.values[i] ? endValues.values[i] - m_start.values[i] : 0;
+				}
+			}
+			return sample;
+		}
+	};
+};
@@ -0,0 +1,179 @@
+#include "doobius/common/profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <fstream>
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+			thread_local ProfileEventRing* t_profileRing = nullptr;
+
+			std::size_t roundUpToPowerOfTwo(std::size_t val) {
+				std::size_t pow2 = 1;
+				while (pow2 < val) {
+					pow2 <<= 1;
+				}
+				return pow2;
+			}
+		}
+
+		void writeJsonEscaped(std::ostream& os, const char* str)
+		{
+			static constexpr char g_hexDigits[] = "0123456789abcdef";
+			for (const char* c = str; *c; ++c) {
+				const unsigned char ch = static_cast<unsigned char>(*c);
+				if (ch == '"' || ch == '\\') {
+					os << '\\' << *c;
+				}
+				else if (ch < 0x20) {
+					os << "\\u00" << g_hexDigits[ch >> 4] << g_hexDigits[ch & 0xF];
+				}
+				else {
+					os << *c;
+				}
+			}
+		}
+
+		ProfileEventRing::ProfileEventRing(std::size_t capacity, std::uint32_t _threadIdx) :
+			m_events(roundUpToPowerOfTwo(capacity)), m_mask{ roundUpToPowerOfTwo(capacity) - 1 }, m_writePos{ 0 }, m_readPos{ 0 },
+			m_droppedZones{ 0 }, m_openZones{ 0 }, threadIdx{ _threadIdx }
+		{
+		}
+
+		bool ProfileEventRing::tryBegin(const char* name, std::uint64_t ticks)
+		{
+			const std::uint64_t writePos = m_writePos.load(std::memory_order_relaxed);
+			const std::uint64_t freeSlots = m_events.size() - (writePos - m_readPos.load(std::memory_order_acquire));
+			// Keep one slot for the END of each zone already open, plus this zone's BEGIN and END
+			if (freeSlots < static_cast<std::uint64_t>(m_openZones) + 2) {
+				m_droppedZones.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			m_events[writePos & m_mask] = { name, ticks, ProfileEvent::Type::BEGIN };
+			m_writePos.store(writePos + 1, std::memory_order_release);
+			++m_openZones;
+			return true;
+		}
+
+		void ProfileEventRing::end(const char* name, std::uint64_t ticks)
+		{
+			const std::uint64_t writePos = m_writePos.load(std::memory_order_relaxed);
+			m_events[writePos & m_mask] = { name, ticks, ProfileEvent::Type::END };
+			m_writePos.store(writePos + 1, std::memory_order_release);
+			--m_openZones;
+		}
+
+		Profiler::Profiler() : m_ringCapacity{ g_defaultProfileRingCapacity }, m_startTicks{ nowTicks() }
+		{
+		}
+
+		Profiler& Profiler::get()
+		{
+			static Profiler _profiler;
+			return _profiler;
+		}
+
+		ProfileEventRing& Profiler::registerCurrentThread()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_rings.push_back(std::make_unique<ProfileEventRing>(m_ringCapacity, static_cast<std::uint32_t>(m_rings.size() + 1)));
+			t_profileRing = m_rings.back().get();
+			return *t_profileRing;
+		}
+
+		ProfileEventRing& Profiler::getThreadRing()
+		{
+			if (t_profileRing) {
+				return *t_profileRing;
+			}
+			return registerCurrentThread();
+		}
+
+		void Profiler::setCurrentThreadName(const std::string& name)
+		{
+			ProfileEventRing& ring = getThreadRing();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			ring.threadName = name;
+		}
+
+		void Profiler::setThreadRingCapacity(std::size_t capacity)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_ringCapacity = capacity;
+		}
+
+		std::size_t Profiler::collect()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::size_t numCollected = 0;
+			for (auto& ring : m_rings) {
+				numCollected += ring->drain([this, &ring](const ProfileEvent& event) {
+					m_collected.push_back({ event, ring->threadIdx });
+				});
+			}
+			return numCollected;
+		}
+
+		std::size_t Profiler::writeChromeTrace(const std::filesystem::path& tracePath)
+		{
+			BOOST_LOG_NAMED_SCOPE("ProfilerExport");
+			collect();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::ofstream traceFile(tracePath);
+			if (traceFile.fail()) {
+				DOOBIUS_CLOG(warning) << "Couldn't open " << tracePath.string() << " to write the profiler trace";
+				return 0;
+			}
+
+			traceFile << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool first = true;
+			for (const auto& ring : m_rings) {
+				if (ring->threadName.empty()) {
+					continue;
+				}
+				traceFile << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadIdx << ",\"args\":{\"name\":\"";
+				writeJsonEscaped(traceFile, ring->threadName.c_str());
+				traceFile << "\"}}";
+				first = false;
+			}
+
+			traceFile.precision(3);
+			traceFile << std::fixed;
+			for (const CollectedProfileEvent& collected : m_collected) {
+				const double tsUs = ticksToNs(collected.event.ticks - m_startTicks) / 1e3;
+				traceFile << (first ? "" : ",") << "\n{\"name\":\"";
+				writeJsonEscaped(traceFile, collected.event.name);
+				traceFile << "\",\"ph\":\"" << (collected.event.type == ProfileEvent::Type::BEGIN ? 'B' : 'E')
+					<< "\",\"pid\":1,\"tid\":" << collected.threadIdx << ",\"ts\":" << tsUs << '}';
+				first = false;
+			}
+			traceFile << "\n]}\n";
+
+			std::size_t numWritten = m_collected.size();
+			m_collected.clear();
+
+			std::uint64_t numDropped = 0;
+			for (const auto& ring : m_rings) {
+				numDropped += ring->getNumDroppedZones();
+			}
+			DOOBIUS_CLOG(info) << "Wrote " << numWritten << " profile events to " << tracePath.string() << " (" << numDropped << " zones dropped so far)";
+			return numWritten;
+		}
+
+		std::uint64_t Profiler::getNumDroppedZones() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::uint64_t numDropped = 0;
+			for (const auto& ring : m_rings) {
+				numDropped += ring->getNumDroppedZones();
+			}
+			return numDropped;
+		}
+
+		double Profiler::ticksToNs(std::uint64_t ticks)
+		{
+			return PerfClock::get().ticksToNs(ticks);
+		}
+	};
+};
@@ -0,0 +1,256 @@
+#include "doobius/common/sampling_profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#include <boost/stacktrace/frame.hpp>
+#include <boost/stacktrace/safe_dump_to.hpp>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <csignal>
+#include <sys/time.h>
+#endif
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+			thread_local SamplingProfiler::ThreadSampleBuffer* t_sampleBuffer = nullptr;
+			std::atomic<std::uint64_t> g_unregisteredSamples{ 0 };
+			std::atomic<std::size_t> g_samplingMaxDepth{ 64 };
+
+#if defined(__linux__)
+			struct sigaction g_prevSigprofAction;
+
+			// Async-signal-safe: only touches this thread's preallocated buffer and lock-free atomics
+			void onSigprof(int, siginfo_t*, void*) {
+				const int savedErrno = errno;
+				SamplingProfiler::ThreadSampleBuffer* buffer = t_sampleBuffer;
+				if (!buffer) {
+					g_unregisteredSamples.fetch_add(1, std::memory_order_relaxed);
+					errno = savedErrno;
+					return;
+				}
+
+				const std::size_t maxDepth = g_samplingMaxDepth.load(std::memory_order_relaxed);
+				const std::size_t used = buffer->used.load(std::memory_order_relaxed);
+				if (used + maxDepth + 1 > buffer->words.size()) {
+					buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+					errno = savedErrno;
+					return;
+				}
+
+				// Layout per sample: [depth][frame 0 (innermost)]...[frame depth - 1]. Skips this handler and the kernel's
+				// signal trampoline so frame 0 is the interrupted instruction.
+				void** sample = buffer->words.data() + used;
+				std::size_t depth = boost::stacktrace::safe_dump_to(2, sample + 1, maxDepth * sizeof(void*));
+				while (depth > 0 && sample[depth] == nullptr) {
+					--depth;
+				}
+				sample[0] = reinterpret_cast<void*>(depth);
+				buffer->used.store(used + depth + 1, std::memory_order_release);
+				buffer->numSamples.fetch_add(1, std::memory_order_relaxed);
+				errno = savedErrno;
+			}
+#endif
+
+			std::string frameName(void* addr, bool isReturnAddress) {
+				// Return addresses point after the call, step back into it so inlined call sites resolve correctly
+				void* lookupAddr = isReturnAddress ? static_cast<char*>(addr) - 1 : addr;
+				std::string name = boost::stacktrace::frame(lookupAddr).name();
+				if (name.empty()) {
+					std::ostringstream addrOss;
+					addrOss << "0x" << std::hex << reinterpret_cast<std::uintptr_t>(addr);
+					return addrOss.str();
+				}
+				// ';' separates frames in the collapsed format
+				std::replace(name.begin(), name.end(), ';', ':');
+				return name;
+			}
+		}
+
+		SamplingProfiler::ThreadSampleBuffer::ThreadSampleBuffer(std::size_t numWords, std::string _threadName) :
+			words(numWords, nullptr), used{ 0 }, numSamples{ 0 }, dropped{ 0 }, threadName(std::move(_threadName))
+		{
+		}
+
+		SamplingProfiler::SamplingProfiler() : m_running{ false }
+		{
+		}
+
+		SamplingProfiler::~SamplingProfiler()
+		{
+			stop();
+		}
+
+		SamplingProfiler& SamplingProfiler::get()
+		{
+			static SamplingProfiler _samplingProfiler;
+			return _samplingProfiler;
+		}
+
+		void SamplingProfiler::registerCurrentThread(const std::string& threadName)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (t_sampleBuffer) {
+				t_sampleBuffer->threadName = threadName;
+				return;
+			}
+			m_buffers.push_back(std::make_unique<ThreadSampleBuffer>(m_config.bufferWordsPerThread, threadName));
+			t_sampleBuffer = m_buffers.back().get();
+		}
+
+		bool SamplingProfiler::start()
+		{
+			return start(SamplingConfig{});
+		}
+
+		bool SamplingProfiler::start(const SamplingConfig& config)
+		{
+			BOOST_LOG_NAMED_SCOPE("SamplingProfiler");
+#if defined(__linux__)
+			if (m_running.load()) {
+				DOOBIUS_CLOG(warning) << "Sampling profiler is already running";
+				return true;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_config = config;
+				m_config.frequencyHz = std::max(1, m_config.frequencyHz);
+				m_config.maxDepth = std::clamp<std::size_t>(m_config.maxDepth, 1, 256);
+				g_samplingMaxDepth.store(m_config.maxDepth);
+			}
+			if (!t_sampleBuffer) {
+				registerCurrentThread("Main");
+			}
+
+			// The first unwind can lazily load and initialise unwind tables, keep that out of the signal handler
+			void* warmup[4];
+			boost::stacktrace::safe_dump_to(0, warmup, sizeof(warmup));
+
+			struct sigaction action {};
+			action.sa_sigaction = &onSigprof;
+			action.sa_flags = SA_SIGINFO | SA_RESTART;
+			sigemptyset(&action.sa_mask);
+			if (sigaction(SIGPROF, &action, &g_prevSigprofAction) != 0) {
+				DOOBIUS_CLOG(error) << "Couldn't install the SIGPROF handler (errno " << errno << ")";
+				return false;
+			}
+
+			// tv_usec must stay below a second, so 1Hz is { 1, 0 } rather than { 0, 1000000 }
+			const long periodUs = std::max(1L, 1000000L / m_config.frequencyHz);
+			itimerval timer{};
+			timer.it_interval.tv_sec = periodUs / 1000000;
+			timer.it_interval.tv_usec = periodUs % 1000000;
+			timer.it_value = timer.it_interval;
+			if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+				DOOBIUS_CLOG(error) << "Couldn't arm ITIMER_PROF (errno " << errno << ")";
+				sigaction(SIGPROF, &g_prevSigprofAction, nullptr);
+				return false;
+			}
+			m_running.store(true);
+			DOOBIUS_CLOG(info) << "Sampling profiler started at " << m_config.frequencyHz << "Hz";
+			return true;
+#else
+			DOOBIUS_CLOG(warning) << "The sampling profiler is only available on Linux";
+			return false;
+#endif
+		}
+
+		void SamplingProfiler::stop()
+		{
+#if defined(__linux__)
+			if (!m_running.exchange(false)) {
+				return;
+			}
+			itimerval timer{};
+			setitimer(ITIMER_PROF, &timer, nullptr);
+			sigaction(SIGPROF, &g_prevSigprofAction, nullptr);
+
+			SamplingStats stats = getStats();
+			DOOBIUS_CLOG(info) << "Sampling profiler stopped: " << stats.samples << " samples, " << stats.dropped << " dropped, "
+				<< stats.unregistered << " on unregistered threads";
+#endif
+		}
+
+		SamplingStats SamplingProfiler::getStats() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			SamplingStats stats;
+			for (const auto& buffer : m_buffers) {
+				stats.samples += buffer->numSamples.load(std::memory_order_relaxed);
+				stats.dropped += buffer->dropped.load(std::memory_order_relaxed);
+			}
+			stats.unregistered = g_unregisteredSamples.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+		std::size_t SamplingProfiler::writeCollapsedStacks(const std::filesystem::path& outPath) const
+		{
+			BOOST_LOG_NAMED_SCOPE("SamplingProfiler");
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			// Count identical raw stacks first so every distinct address is only symbolized once
+			std::map<std::pair<std::string, std::vector<void*>>, std::uint64_t> stackCounts;
+			for (const auto& buffer : m_buffers) {
+				const std::size_t used = buffer->used.load(std::memory_order_acquire);
+				std::size_t pos = 0;
+				while (pos < used) {
+					const std::size_t depth = reinterpret_cast<std::size_t>(buffer->words[pos]);
+					std::vector<void*> frames(buffer->words.begin() + pos + 1, buffer->words.begin() + pos + 1 + depth);
+					++stackCounts[{ buffer->threadName, std::move(frames) }];
+					pos += depth + 1;
+				}
+			}
+
+			std::unordered_map<void*, std::string> leafNames, callerNames;
+			auto cachedName = [](std::unordered_map<void*, std::string>& cache, void* addr, bool isReturnAddress) -> const std::string& {
+				auto it = cache.find(addr);
+				if (it == cache.end()) {
+					it = cache.emplace(addr, frameName(addr, isReturnAddress)).first;
+				}
+				return it->second;
+			};
+
+			// Different addresses inside the same functions collapse into the same line
+			std::map<std::string, std::uint64_t> lineCounts;
+			for (const auto& [stackKey, count] : stackCounts) {
+				const auto& [threadName, frames] = stackKey;
+				std::string line = threadName.empty() ? "thread" : threadName;
+				// Collapsed stacks go outermost first; frame 0 is the interrupted instruction, the rest are return addresses
+				for (std::size_t i = frames.size(); i-- > 0;) {
+					line += ';';
+					line += i == 0 ? cachedName(leafNames, frames[i], false) : cachedName(callerNames, frames[i], true);
+				}
+				lineCounts[line] += count;
+			}
+
+			std::ofstream outFile(outPath);
+			if (outFile.fail()) {
+				DOOBIUS_CLOG(warning) << "Couldn't open " << outPath.string() << " to write collapsed stacks";
+				return 0;
+			}
+			for (const auto& [line, count] : lineCounts) {
+				outFile << line << ' ' << count << '\n';
+			}
+
+			DOOBIUS_CLOG(info) << "Wrote " << lineCounts.size() << " distinct sampled stacks to " << outPath.string();
+			return lineCounts.size();
+		}
+
+		void SamplingProfiler::clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (const auto& buffer : m_buffers) {
+				buffer->used.store(0, std::memory_order_release);
+				buffer->numSamples.store(0, std::memory_order_relaxed);
+				buffer->dropped.store(0, std::memory_order_relaxed);
+			}
+			g_unregisteredSamples.store(0, std::memory_order_relaxed);
+		}
+	};
+};
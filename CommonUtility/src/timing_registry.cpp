@@ -0,0 +1,293 @@
+#include "doobius/common/timing_registry.h"
+#include "doobius/common/perf_clock.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace Doobius {
+	namespace Perf {
+		namespace {
+			constexpr std::uint64_t g_histHalfSubBuckets = std::uint64_t{ 1 } << (g_histSubBucketBits - 1);
+			constexpr std::uint64_t g_histMaxValue = (std::uint64_t{ 1 } << g_histMaxValueBits) - 1;
+
+			thread_local void* t_threadTimings = nullptr;
+		}
+
+		std::uint64_t histBucketLowerBound(std::size_t idx)
+		{
+			if (idx < (std::size_t{ 1 } << g_histSubBucketBits)) {
+				return idx;
+			}
+			const std::uint64_t shift = idx / g_histHalfSubBuckets - 1;
+			const std::uint64_t sub = idx % g_histHalfSubBuckets + g_histHalfSubBuckets;
+			return sub << shift;
+		}
+
+		std::uint64_t histBucketUpperBound(std::size_t idx)
+		{
+			if (idx + 1 >= g_histNumBuckets) {
+				return g_histMaxValue;
+			}
+			return histBucketLowerBound(idx + 1) - 1;
+		}
+
+		TimingHistogram::TimingHistogram() : m_buckets(g_histNumBuckets, 0), m_count{ 0 }, m_sumTicks{ 0 },
+			m_minTicks{ std::numeric_limits<std::uint64_t>::max() }, m_maxTicks{ 0 }
+		{
+		}
+
+		void TimingHistogram::record(std::uint64_t ticks)
+		{
+			++m_buckets[histBucketIndex(ticks)];
+			++m_count;
+			m_sumTicks += ticks;
+			m_minTicks = std::min(m_minTicks, ticks);
+			m_maxTicks = std::max(m_maxTicks, ticks);
+		}
+
+		void TimingHistogram::merge(const TimingHistogram& other)
+		{
+			for (std::size_t i = 0; i < g_histNumBuckets; ++i) {
+				m_buckets[i] += other.m_buckets[i];
+			}
+			m_count += other.m_count;
+			m_sumTicks += other.m_sumTicks;
+			m_minTicks = std::min(m_minTicks, other.m_minTicks);
+			m_maxTicks = std::max(m_maxTicks, other.m_maxTicks);
+		}
+
+		void TimingHistogram::subtract(const TimingHistogram& earlier)
+		{
+			std::size_t firstIdx = g_histNumBuckets, lastIdx = 0;
+			for (std::size_t i = 0; i < g_histNumBuckets; ++i) {
+				m_buckets[i] -= std::min(m_buckets[i], earlier.m_buckets[i]);
+				if (m_buckets[i]) {
+					firstIdx = std::min(firstIdx, i);
+					lastIdx = i;
+				}
+			}
+			m_count -= std::min(m_count, earlier.m_count);
+			m_sumTicks -= std::min(m_sumTicks, earlier.m_sumTicks);
+			if (firstIdx == g_histNumBuckets) {
+				m_minTicks = std::numeric_limits<std::uint64_t>::max();
+				m_maxTicks = 0;
+				return;
+			}
+			m_minTicks = std::max(m_minTicks, histBucketLowerBound(firstIdx));
+			m_maxTicks = std::min(m_maxTicks, histBucketUpperBound(lastIdx));
+		}
+
+		std::uint64_t TimingHistogram::valueAtQuantile(double q) const
+		{
+			if (m_count == 0) {
+				return 0;
+			}
+			const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(m_count) + 0.5));
+			if (rank >= m_count) {
+				return m_maxTicks;
+			}
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; i < g_histNumBuckets; ++i) {
+				seen += m_buckets[i];
+				if (seen >= rank) {
+					const std::uint64_t mid = histBucketLowerBound(i) + (histBucketUpperBound(i) - histBucketLowerBound(i)) / 2;
+					return std::clamp(mid, m_minTicks, m_maxTicks);
+				}
+			}
+			return m_maxTicks;
+		}
+
+		TimingStats TimingHistogram::getStats() const
+		{
+			TimingStats stats;
+			stats.count = m_count;
+			if (m_count == 0) {
+				return stats;
+			}
+			const PerfClock& clock = PerfClock::get();
+			stats.minNs = clock.ticksToNs(m_minTicks);
+			stats.meanNs = clock.ticksToNs(m_sumTicks) / static_cast<double>(m_count);
+			stats.p50Ns = clock.ticksToNs(valueAtQuantile(0.5));
+			stats.p90Ns = clock.ticksToNs(valueAtQuantile(0.9));
+			stats.p99Ns = clock.ticksToNs(valueAtQuantile(0.99));
+			stats.maxNs = clock.ticksToNs(m_maxTicks);
+			return stats;
+		}
+
+		ThreadTimingHistogram::ThreadTimingHistogram() : m_count{ 0 }, m_sumTicks{ 0 },
+			m_minTicks{ std::numeric_limits<std::uint64_t>::max() }, m_maxTicks{ 0 }
+		{
+			for (auto& bucket : m_buckets) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void ThreadTimingHistogram::mergeInto(TimingHistogram& hist) const
+		{
+			const std::uint64_t count = m_count.load(std::memory_order_acquire);
+			if (count == 0) {
+				return;
+			}
+			for (std::size_t i = 0; i < g_histNumBuckets; ++i) {
+				hist.m_buckets[i] += m_buckets[i].load(std::memory_order_relaxed);
+			}
+			hist.m_count += count;
+			hist.m_sumTicks += m_sumTicks.load(std::memory_order_relaxed);
+			hist.m_minTicks = std::min(hist.m_minTicks, m_minTicks.load(std::memory_order_relaxed));
+			hist.m_maxTicks = std::max(hist.m_maxTicks, m_maxTicks.load(std::memory_order_relaxed));
+		}
+
+		TimingRegistry::TimingRegistry() : m_lastSummaryTime{ std::chrono::steady_clock::now() }
+		{
+		}
+
+		TimingRegistry& TimingRegistry::get()
+		{
+			static TimingRegistry _timingRegistry;
+			return _timingRegistry;
+		}
+
+		TimerId TimingRegistry::getTimerId(StringId name)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto [it, inserted] = m_timerIds.try_emplace(name, static_cast<TimerId>(m_timerNames.size()));
+			if (inserted) {
+				m_timerNames.push_back(name.str());
+			}
+			return it->second;
+		}
+
+		std::string TimingRegistry::getTimerName(TimerId timerId) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return timerId < m_timerNames.size() ? m_timerNames[timerId] : std::string{};
+		}
+
+		TimingRegistry::ThreadTimings& TimingRegistry::getThreadTimings()
+		{
+			if (t_threadTimings) {
+				return *static_cast<ThreadTimings*>(t_threadTimings);
+			}
+			// Kept by the registry after the thread exits so its samples still show up in stats
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_threads.push_back(std::make_unique<ThreadTimings>());
+			t_threadTimings = m_threads.back().get();
+			return *m_threads.back();
+		}
+
+		ThreadTimingHistogram& TimingRegistry::growThreadHistograms(ThreadTimings& timings, TimerId timerId)
+		{
+			auto hist = std::make_unique<ThreadTimingHistogram>();
+			std::lock_guard<std::mutex> lock(timings.mutex);
+			if (timings.histograms.size() <= timerId) {
+				timings.histograms.resize(static_cast<std::size_t>(timerId) + 1);
+			}
+			timings.histograms[timerId] = std::move(hist);
+			return *timings.histograms[timerId];
+		}
+
+		void TimingRegistry::recordTicks(TimerId timerId, std::uint64_t ticks)
+		{
+			ThreadTimings& timings = getThreadTimings();
+			if (timerId < timings.histograms.size() && timings.histograms[timerId]) {
+				timings.histograms[timerId]->record(ticks);
+				return;
+			}
+			growThreadHistograms(timings, timerId).record(ticks);
+		}
+
+		std::vector<TimingHistogram> TimingRegistry::mergeAll() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<TimingHistogram> merged(m_timerNames.size());
+			for (const auto& timings : m_threads) {
+				std::lock_guard<std::mutex> threadLock(timings->mutex);
+				for (std::size_t id = 0; id < timings->histograms.size() && id < merged.size(); ++id) {
+					if (timings->histograms[id]) {
+						timings->histograms[id]->mergeInto(merged[id]);
+					}
+				}
+			}
+			return merged;
+		}
+
+		TimingHistogram TimingRegistry::getHistogram(TimerId timerId) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			TimingHistogram merged;
+			for (const auto& timings : m_threads) {
+				std::lock_guard<std::mutex> threadLock(timings->mutex);
+				if (timerId < timings->histograms.size() && timings->histograms[timerId]) {
+					timings->histograms[timerId]->mergeInto(merged);
+				}
+			}
+			return merged;
+		}
+
+		TimingStats TimingRegistry::getStats(TimerId timerId) const
+		{
+			return getHistogram(timerId).getStats();
+		}
+
+		boost::json::object TimingRegistry::getJsonSnapshot() const
+		{
+			std::vector<TimingHistogram> merged = mergeAll();
+			boost::json::object snapshot;
+			for (std::size_t id = 0; id < merged.size(); ++id) {
+				TimingStats stats = merged[id].getStats();
+				boost::json::object timerJson;
+				timerJson["count"] = stats.count;
+				timerJson["min_ns"] = stats.minNs;
+				timerJson["mean_ns"] = stats.meanNs;
+				timerJson["p50_ns"] = stats.p50Ns;
+				timerJson["p90_ns"] = stats.p90Ns;
+				timerJson["p99_ns"] = stats.p99Ns;
+				timerJson["max_ns"] = stats.maxNs;
+				snapshot[getTimerName(static_cast<TimerId>(id))] = std::move(timerJson);
+			}
+			return snapshot;
+		}
+
+		void TimingRegistry::logSummary()
+		{
+			BOOST_LOG_NAMED_SCOPE("Timing");
+			std::vector<TimingHistogram> merged = mergeAll();
+			std::vector<TimingHistogram> current = merged;
+			for (std::size_t id = 0; id < merged.size() && id < m_lastSummary.size(); ++id) {
+				merged[id].subtract(m_lastSummary[id]);
+			}
+			m_lastSummary = std::move(current);
+
+			auto toUs = [](double ns) { return ns / 1e3; };
+			std::ostringstream table;
+			table << std::fixed << std::setprecision(1);
+			table << "Timing summary (us)\n" << std::left << std::setw(32) << "timer" << std::right
+				<< std::setw(10) << "count" << std::setw(10) << "min" << std::setw(10) << "mean" << std::setw(10) << "p50"
+				<< std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max";
+			for (std::size_t id = 0; id < merged.size(); ++id) {
+				if (merged[id].getCount() == 0) {
+					continue;
+				}
+				TimingStats stats = merged[id].getStats();
+				table << '\n' << std::left << std::setw(32) << getTimerName(static_cast<TimerId>(id)) << std::right
+					<< std::setw(10) << stats.count << std::setw(10) << toUs(stats.minNs) << std::setw(10) << toUs(stats.meanNs)
+					<< std::setw(10) << toUs(stats.p50Ns) << std::setw(10) << toUs(stats.p90Ns) << std::setw(10) << toUs(stats.p99Ns)
+					<< std::setw(10) << toUs(stats.maxNs);
+			}
+			DOOBIUS_CLOG(info) << table.str();
+			m_lastSummaryTime = std::chrono::steady_clock::now();
+		}
+
+		bool TimingRegistry::logSummaryEvery(std::chrono::milliseconds period)
+		{
+			if (std::chrono::steady_clock::now() - m_lastSummaryTime < period) {
+				return false;
+			}
+			logSummary();
+			return true;
+		}
+	};
+};
@@ -0,0 +1,149 @@
+#include "doobius/common/virtual_memory.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Doobius {
+	namespace Memory {
+		namespace {
+			inline std::size_t roundUp(std::size_t value, std::size_t multiple) {
+				return (value + multiple - 1) / multiple * multiple;
+			}
+		}
+
+		std::size_t getPageSize()
+		{
+#if defined(_WIN32)
+			static const std::size_t pageSize = []() {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return static_cast<std::size_t>(info.dwPageSize);
+			}();
+#else
+			static const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+			return pageSize;
+		}
+
+		VirtualRegion::VirtualRegion() : m_base{ nullptr }, m_reserved{ 0 }, m_committed{ 0 }, m_hugePages{ false }
+		{
+		}
+
+		VirtualRegion::VirtualRegion(std::size_t reserveBytes, bool hugePages) : VirtualRegion()
+		{
+			const std::size_t granularity = hugePages ? g_hugePageSize : getPageSize();
+			const std::size_t size = roundUp(std::max<std::size_t>(reserveBytes, 1), granularity);
+#if defined(_WIN32)
+			// MEM_LARGE_PAGES needs SeLockMemoryPrivilege and can't be committed lazily, so stay on normal pages
+			m_base = static_cast<unsigned char*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+			m_hugePages = false;
+#else
+			// Over-reserve so the start can be moved up to a huge page boundary, then give back both ends
+			const std::size_t mapped = hugePages ? size + g_hugePageSize : size;
+			void* raw = mmap(nullptr, mapped, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (raw == MAP_FAILED) {
+				raw = nullptr;
+			}
+			else if (hugePages) {
+				const std::uintptr_t rawAddr = reinterpret_cast<std::uintptr_t>(raw);
+				const std::uintptr_t alignedAddr = roundUp(rawAddr, g_hugePageSize);
+				if (alignedAddr > rawAddr) {
+					munmap(raw, alignedAddr - rawAddr);
+				}
+				const std::size_t tail = rawAddr + mapped - (alignedAddr + size);
+				if (tail > 0) {
+					munmap(reinterpret_cast<void*>(alignedAddr + size), tail);
+				}
+				raw = reinterpret_cast<void*>(alignedAddr);
+			}
+			m_base = static_cast<unsigned char*>(raw);
+			m_hugePages = hugePages;
+#endif
+			if (!m_base) {
+				DOOBIUS_CLOG(error) << "Failed to reserve " << size << " bytes of address space";
+				m_hugePages = false;
+				return;
+			}
+			m_reserved = size;
+		}
+
+		VirtualRegion::~VirtualRegion()
+		{
+			release();
+		}
+
+		VirtualRegion::VirtualRegion(VirtualRegion&& other) noexcept : m_base{ std::exchange(other.m_base, nullptr) },
+			m_reserved{ std::exchange(other.m_reserved, 0) }, m_committed{ std::exchange(other.m_committed, 0) },
+			m_hugePages{ std::exchange(other.m_hugePages, false) }
+		{
+		}
+
+		VirtualRegion& VirtualRegion::operator=(VirtualRegion&& other) noexcept
+		{
+			if (this != &other) {
+				release();
+				m_base = std::exchange(other.m_base, nullptr);
+				m_reserved = std::exchange(other.m_reserved, 0);
+				m_committed = std::exchange(other.m_committed, 0);
+				m_hugePages = std::exchange(other.m_hugePages, false);
+			}
+			return *this;
+		}
+
+		void VirtualRegion::release()
+		{
+			if (!m_base) {
+				return;
+			}
+#if defined(_WIN32)
+			VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+			munmap(m_base, m_reserved);
+#endif
+			m_base = nullptr;
+			m_reserved = 0;
+			m_committed = 0;
+		}
+
+		bool VirtualRegion::commitUpTo(std::size_t bytes)
+		{
+			if (bytes <= m_committed) {
+				return true;
+			}
+			const std::size_t granularity = m_hugePages ? g_hugePageSize : getPageSize();
+			const std::size_t target = std::min(roundUp(bytes, granularity), m_reserved);
+			if (!m_base || bytes > m_reserved) {
+				return false;
+			}
+			unsigned char* start = m_base + m_committed;
+			const std::size_t length = target - m_committed;
+#if defined(_WIN32)
+			if (!VirtualAlloc(start, length, MEM_COMMIT, PAGE_READWRITE)) {
+				return false;
+			}
+#else
+			if (mprotect(start, length, PROT_READ | PROT_WRITE) != 0) {
+				return false;
+			}
+#if defined(MADV_HUGEPAGE)
+			if (m_hugePages) {
+				// Only a hint; the kernel falls back to normal pages when THP is off or no huge page is free
+				madvise(start, length, MADV_HUGEPAGE);
+			}
+#endif
+#endif
+			m_committed = target;
+			return true;
+		}
+	};
+};
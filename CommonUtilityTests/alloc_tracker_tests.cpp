@@ -0,0 +1,70 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/alloc_tracker.h"
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace DPerf = Doobius::Perf;
+
+BOOST_AUTO_TEST_CASE(AllocTrackerCountsThreadAllocations)
+{
+	if (!DPerf::AllocTracker::isEnabled()) {
+		BOOST_TEST_MESSAGE("Allocation tracking is not compiled into this configuration, skipping");
+		return;
+	}
+
+	// Kept outside the lambdas so the allocations escape and can't be optimised away
+	std::vector<std::unique_ptr<int>> kept;
+	kept.reserve(8);
+	BOOST_TEST(DPerf::countThreadAllocations([&]() {
+		kept.push_back(std::make_unique<int>(1));
+		kept.push_back(std::make_unique<int>(2));
+	}) == 2u);
+
+	// Pushing within reserved capacity must not touch the heap
+	std::vector<int> preallocated;
+	preallocated.reserve(64);
+	BOOST_TEST(DPerf::countThreadAllocations([&]() {
+		for (int i = 0; i < 64; ++i) {
+			preallocated.push_back(i);
+		}
+	}) == 0u);
+
+	const DPerf::AllocStats before = DPerf::AllocTracker::get().getThreadStats();
+	kept.clear();
+	BOOST_TEST(DPerf::AllocTracker::get().getThreadStats().frees - before.frees == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(AllocTrackerAttributesToInnermostScope)
+{
+	if (!DPerf::AllocTracker::isEnabled()) {
+		BOOST_TEST_MESSAGE("Allocation tracking is not compiled into this configuration, skipping");
+		return;
+	}
+
+	std::vector<std::unique_ptr<char[]>> kept;
+	kept.reserve(8);
+	{
+		DOOBIUS_ALLOC_SCOPE("AllocTestOuter");
+		kept.push_back(std::make_unique<char[]>(100));
+		{
+			DOOBIUS_ALLOC_SCOPE("AllocTestInner");
+			kept.push_back(std::make_unique<char[]>(1000));
+			kept.push_back(std::make_unique<char[]>(1000));
+		}
+	}
+
+	const std::vector<DPerf::AllocScopeStats> scopeStats = DPerf::AllocTracker::get().getScopeStats();
+	auto findScope = [&scopeStats](const std::string& name) {
+		return std::find_if(scopeStats.begin(), scopeStats.end(), [&name](const DPerf::AllocScopeStats& stats) { return stats.name == name; });
+	};
+	auto outer = findScope("AllocTestOuter");
+	auto inner = findScope("AllocTestInner");
+	BOOST_REQUIRE(outer != scopeStats.end());
+	BOOST_REQUIRE(inner != scopeStats.end());
+	BOOST_TEST(outer->allocs == 1u);
+	BOOST_TEST(outer->bytes == 100u);
+	BOOST_TEST(inner->allocs == 2u);
+	BOOST_TEST(inner->bytes == 2000u);
+}
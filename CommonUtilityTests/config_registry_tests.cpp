@@ -0,0 +1,150 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/dbg/config_registry.h"
+#include "doobius/dbg/logging.h"
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+namespace DConfig = Doobius::Config;
+
+namespace {
+	struct TestConfigSchema {
+		DConfig::ConfigSchema schema;
+		DConfig::ConfigKey<std::int64_t> workers = schema.add<std::int64_t>("workers", 4, DConfig::ConfigScope::GLOBAL, true);
+		DConfig::ConfigKey<double> gravity = schema.add<double>("gravity", -9.81);
+		DConfig::ConfigKey<bool> vsync = schema.add<bool>("vsync", false);
+		DConfig::ConfigKey<std::string> title = schema.add<std::string>("title", "Doobius");
+		DConfig::ConfigKey<std::string> buildTag = schema.add<std::string>("build_tag", "none", DConfig::ConfigScope::PER_BUILD);
+
+		TestConfigSchema(const char* name) : schema(name) {}
+	};
+
+	// Every test gets its own source file and cache directory, the registry itself is shared
+	struct ConfigFixture {
+		std::filesystem::path dir;
+
+		ConfigFixture(const char* name) : dir(std::filesystem::temp_directory_path() / "doobius_config_tests" / name) {
+			std::filesystem::remove_all(dir);
+			std::filesystem::create_directories(dir);
+			DConfig::ConfigRegistry::get().setCacheDir(dir / "cache");
+			DConfig::ConfigRegistry::get().clear();
+		}
+
+		~ConfigFixture() {
+			DConfig::ConfigRegistry::get().clear();
+			std::error_code ec;
+			std::filesystem::remove_all(dir, ec);
+		}
+
+		std::filesystem::path write(const std::string& contents) const {
+			const std::filesystem::path path = dir / "config.json";
+			std::ofstream(path, std::ios::trunc) << contents;
+			return path;
+		}
+	};
+}
+
+BOOST_AUTO_TEST_CASE(ConfigCompilesOnceThenLoadsFromCache)
+{
+	ConfigFixture fixture("Cache");
+	TestConfigSchema keys("tests_cache");
+	const std::filesystem::path path = fixture.write(R"({ "workers": 12, "gravity": 1.5, "vsync": true, "title": "Soak run",
+		"build_tag": { "dbg": "debug-tag", "rel-dev": "reldev-tag", "rel": "rel-tag" } })");
+	DConfig::ConfigRegistry& registry = DConfig::ConfigRegistry::get();
+	const std::uint64_t hitsBefore = registry.getNumCacheHits();
+	const std::uint64_t buildsBefore = registry.getNumCacheBuilds();
+
+	const DConfig::ConfigSection& compiled = registry.load(keys.schema, path);
+	BOOST_TEST((compiled.getOrigin() == DConfig::ConfigOrigin::JSON));
+	BOOST_TEST(compiled.getNumIssues() == 0);
+	BOOST_TEST(compiled.get(keys.workers) == 12);
+	BOOST_TEST(compiled.get(keys.gravity) == 1.5);
+	BOOST_TEST(compiled.get(keys.vsync));
+	BOOST_TEST(compiled.get(keys.title) == "Soak run");
+	const std::string expectedTag = Doobius::Log::getConfigString() == "dbg" ? "debug-tag" : Doobius::Log::getConfigString() == "rel" ? "rel-tag" : "reldev-tag";
+	BOOST_TEST(compiled.get(keys.buildTag) == expectedTag);
+	BOOST_TEST(&registry.load(keys.schema, path) == &compiled);
+	BOOST_TEST(registry.find("tests_cache") == &compiled);
+	BOOST_TEST(registry.getNumCacheBuilds() == buildsBefore + 1);
+
+	// A later launch maps the cache instead of parsing
+	registry.clear();
+	BOOST_TEST(registry.find("tests_cache") == nullptr);
+	const DConfig::ConfigSection& cached = registry.load(keys.schema, path);
+	BOOST_TEST((cached.getOrigin() == DConfig::ConfigOrigin::CACHE));
+	BOOST_TEST(cached.get(keys.workers) == 12);
+	BOOST_TEST(cached.get(keys.gravity) == 1.5);
+	BOOST_TEST(cached.get(keys.vsync));
+	BOOST_TEST(cached.get(keys.title) == "Soak run");
+	BOOST_TEST(cached.get(keys.buildTag) == expectedTag);
+	BOOST_TEST(registry.getNumCacheHits() == hitsBefore + 1);
+	BOOST_TEST(registry.getNumCacheBuilds() == buildsBefore + 1);
+}
+
+BOOST_AUTO_TEST_CASE(ConfigCacheRebuildsWhenSourceOrCacheChanges)
+{
+	ConfigFixture fixture("Rebuild");
+	TestConfigSchema keys("tests_rebuild");
+	DConfig::ConfigRegistry& registry = DConfig::ConfigRegistry::get();
+	std::filesystem::path path = fixture.write(R"({ "workers": 2 })");
+	BOOST_TEST(registry.load(keys.schema, path).get(keys.workers) == 2);
+
+	// Same length, different contents
+	registry.clear();
+	path = fixture.write(R"({ "workers": 3 })");
+	const DConfig::ConfigSection& edited = registry.load(keys.schema, path);
+	BOOST_TEST((edited.getOrigin() == DConfig::ConfigOrigin::JSON));
+	BOOST_TEST(edited.get(keys.workers) == 3);
+
+	// A truncated cache is never trusted
+	registry.clear();
+	std::filesystem::path cachePath;
+	for (const auto& entry : std::filesystem::directory_iterator(fixture.dir / "cache")) {
+		cachePath = entry.path();
+	}
+	BOOST_REQUIRE(!cachePath.empty());
+	std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) - 4);
+	const DConfig::ConfigSection& repaired = registry.load(keys.schema, path);
+	BOOST_TEST((repaired.getOrigin() == DConfig::ConfigOrigin::JSON));
+	BOOST_TEST(repaired.get(keys.workers) == 3);
+	BOOST_TEST(repaired.get(keys.title) == "Doobius");
+
+	// Neither is a cache built against a different schema
+	registry.clear();
+	TestConfigSchema otherKeys("tests_rebuild");
+	otherKeys.schema.add<std::int64_t>("extra", 1);
+	BOOST_TEST((registry.load(otherKeys.schema, path).getOrigin() == DConfig::ConfigOrigin::JSON));
+}
+
+BOOST_AUTO_TEST_CASE(ConfigValidationFallsBackToDefaults)
+{
+	ConfigFixture fixture("Validation");
+	TestConfigSchema keys("tests_validation");
+	DConfig::ConfigRegistry& registry = DConfig::ConfigRegistry::get();
+	// Missing required workers, wrong types for gravity and vsync, build_tag not per build, one unknown key
+	const std::filesystem::path path = fixture.write(R"({ "gravity": "down", "vsync": 1, "title": "ok", "build_tag": "flat", "typo": 3 })");
+
+	const DConfig::ConfigSection& section = registry.load(keys.schema, path);
+	BOOST_TEST(section.getNumIssues() == 5);
+	BOOST_TEST(section.get(keys.workers) == 4);
+	BOOST_TEST(section.get(keys.gravity) == -9.81);
+	BOOST_TEST(!section.get(keys.vsync));
+	BOOST_TEST(section.get(keys.title) == "ok");
+	BOOST_TEST(section.get(keys.buildTag) == "none");
+
+	// The issues are remembered by the cache so a cached launch still warns
+	registry.clear();
+	const DConfig::ConfigSection& cached = registry.load(keys.schema, path);
+	BOOST_TEST((cached.getOrigin() == DConfig::ConfigOrigin::CACHE));
+	BOOST_TEST(cached.getNumIssues() == 5);
+
+	registry.clear();
+	const DConfig::ConfigSection& broken = registry.load(keys.schema, fixture.write(R"({ "workers": )"));
+	BOOST_TEST(broken.getNumIssues() == 1);
+	BOOST_TEST(broken.get(keys.workers) == 4);
+
+	const DConfig::ConfigSection& missing = registry.load(keys.schema, fixture.dir / "does_not_exist.json");
+	BOOST_TEST((missing.getOrigin() == DConfig::ConfigOrigin::DEFAULTS));
+	BOOST_TEST(missing.getNumIssues() == 0);
+	BOOST_TEST(missing.get(keys.title) == "Doobius");
+}
@@ -0,0 +1,27 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/dbg/custom_assert.h"
+#include <boost/test/unit_test.hpp>
+
+namespace DDbg = Doobius::Dbg;
+
+static_assert(DDbg::fmtArgsExpected("Did not find channel %1% in notification registry %2%") == 2);
+static_assert(DDbg::fmtArgsExpected("%2% before %1%, %1% again") == 2);
+static_assert(DDbg::fmtArgsExpected("printf style %s and %5d") == 2);
+static_assert(DDbg::fmtArgsExpected("100%% literal, %|-8| %s") == 2);
+static_assert(DDbg::fmtArgsExpected("no placeholders") == 0);
+static_assert(decltype(DDbg::FmtArgCount<0>{} % 1 % "two" % 3.0)::value == 3);
+
+BOOST_AUTO_TEST_CASE(FmtVerifyOnlyFormatsOnFailure)
+{
+	int numExprEvals = 0;
+	int numArgEvals = 0;
+	auto expr = [&numExprEvals]() { ++numExprEvals; return true; };
+	auto arg = [&numArgEvals]() { ++numArgEvals; return std::string("unused"); };
+
+	for (int i = 0; i < 10; ++i) {
+		DOOBIUS_FMT_VERIFY(expr(), "Iteration %1% failed with %2%", i % arg());
+		DOOBIUS_FMT_ASSERT(i < 10, "Iteration %1% out of range", arg());
+	}
+	BOOST_TEST(numExprEvals == 10);
+	BOOST_TEST(numArgEvals == 0);
+}
@@ -0,0 +1,94 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/dbg/log_format.h"
+#include <boost/test/unit_test.hpp>
+
+#include <boost/log/attributes/constant.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <thread>
+
+namespace DLog = Doobius::Log;
+namespace pt = boost::posix_time;
+using RecordFormatter = void (*)(logging::record_view const&, logging::formatting_ostream&);
+
+namespace {
+	logging::record_view makeGoldenRecord(severity_level sev, const pt::ptime& ts, const std::string& msg, const char* tag, const char* chl) {
+		logging::attribute_set recAttrs;
+		recAttrs.insert("Severity", attrs::constant<severity_level>(sev));
+		recAttrs.insert("TimeStamp", attrs::constant<pt::ptime>(ts));
+		recAttrs.insert("File", attrs::constant<std::string>("golden_source.cpp"));
+		recAttrs.insert("Line", attrs::constant<std::uint_least32_t>(1234));
+		recAttrs.insert("LineID", attrs::constant<unsigned int>(987654));
+		if (tag)
+			recAttrs.insert("Tag", attrs::constant<std::string>(tag));
+		if (chl)
+			recAttrs.insert("Channel", attrs::constant<std::string>(chl));
+
+		logging::record rec = logging::core::get()->open_record(recAttrs);
+		BOOST_REQUIRE(rec);
+		{
+			logging::record_ostream recStrm(rec);
+			recStrm << msg;
+			recStrm.flush();
+		}
+		return rec.lock();
+	}
+
+	std::string formatWith(RecordFormatter formatter, logging::record_view const& rec) {
+		std::string out;
+		logging::formatting_ostream strm(out);
+		formatter(rec, strm);
+		strm.flush();
+		return out;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FastFormatterGoldenOutput)
+{
+	BOOST_LOG_NAMED_SCOPE("GoldenOuter");
+	BOOST_LOG_NAMED_SCOPE("GoldenInner");
+
+	const pt::ptime base(boost::gregorian::date(2024, boost::gregorian::Feb, 29), pt::hours(23) + pt::minutes(59) + pt::seconds(58));
+	const std::vector<pt::ptime> timestamps = {
+		base,
+		base + pt::microseconds(1),
+		base + pt::microseconds(120),
+		base + pt::microseconds(999999),
+		base + pt::seconds(1) + pt::microseconds(500000),
+		base + pt::seconds(2),							// rolls into the next day
+		base + pt::seconds(2) + pt::microseconds(42),
+		pt::ptime(boost::gregorian::date(1999, boost::gregorian::Jan, 1), pt::microseconds(7)),
+	};
+
+	for (const pt::ptime& ts : timestamps) {
+		for (severity_level sev : { severity_level::trace, severity_level::info, severity_level::warning, severity_level::fatal }) {
+			logging::record_view plain = makeGoldenRecord(sev, ts, "plain message", nullptr, nullptr);
+			logging::record_view tagged = makeGoldenRecord(sev, ts, "tagged message with\ttabs", "SomeTag", "SomeChannel");
+			logging::record_view empty = makeGoldenRecord(sev, ts, "", nullptr, nullptr);
+
+			for (logging::record_view const& rec : { plain, tagged, empty }) {
+				BOOST_TEST(formatWith(&DLog::fastFileLogRecordFormat, rec) == formatWith(&DLog::fileLogRecordFormat, rec));
+				BOOST_TEST(formatWith(&DLog::fastConsoleLogRecordFormat, rec) == formatWith(&DLog::consoleLogRecordFormat, rec));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FastFormatterGoldenOutputAcrossThreads)
+{
+	// The timestamp and thread id caches are per thread, so a second thread must not see the first one's entries
+	const pt::ptime ts(boost::gregorian::date(2030, boost::gregorian::Dec, 31), pt::hours(1) + pt::microseconds(3));
+	logging::record_view rec = makeGoldenRecord(severity_level::error, ts, "from main thread", "T", nullptr);
+	std::string mainFast = formatWith(&DLog::fastFileLogRecordFormat, rec);
+	std::string mainLegacy = formatWith(&DLog::fileLogRecordFormat, rec);
+
+	std::string otherFast, otherLegacy;
+	std::thread other([&]() {
+		otherFast = formatWith(&DLog::fastFileLogRecordFormat, rec);
+		otherLegacy = formatWith(&DLog::fileLogRecordFormat, rec);
+	});
+	other.join();
+
+	BOOST_TEST(mainFast == mainLegacy);
+	BOOST_TEST(otherFast == otherLegacy);
+}
@@ -0,0 +1,238 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/block_pool.h"
+#include "doobius/common/frame_arena.h"
+#include "doobius/common/alloc_tracker.h"
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace DMem = Doobius::Memory;
+
+BOOST_AUTO_TEST_CASE(VirtualRegionCommitsOnDemand)
+{
+	DMem::VirtualRegion region(std::size_t{ 64 } << 20, true);
+	BOOST_REQUIRE(region.isValid());
+	BOOST_TEST(region.getCommitted() == 0u);
+	if (region.usesHugePages()) {
+		BOOST_TEST(reinterpret_cast<std::uintptr_t>(region.getBase()) % DMem::g_hugePageSize == 0u);
+	}
+
+	BOOST_TEST(region.commitUpTo(100));
+	BOOST_TEST(region.getCommitted() >= 100u);
+	std::memset(region.getBase(), 0xAB, 100);
+	BOOST_TEST(region.commitUpTo(region.getReserved()));
+	region.getBase()[region.getReserved() - 1] = 1;
+	BOOST_TEST(!region.commitUpTo(region.getReserved() + 1));
+
+	DMem::VirtualRegion moved(std::move(region));
+	BOOST_TEST(!region.isValid());
+	BOOST_TEST(moved.getBase()[0] == 0xAB);
+}
+
+BOOST_AUTO_TEST_CASE(FrameArenaBumpsAndResets)
+{
+	DMem::FrameArena::FrameArenaConfig config;
+	config.reserveBytes = std::size_t{ 4 } << 20;
+	config.hugePages = false;
+	DMem::FrameArena arena(config);
+
+	void* first = arena.allocate(3, 1);
+	void* aligned = arena.allocate(64, 64);
+	BOOST_TEST(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0u);
+	BOOST_TEST(aligned > first);
+	double* doubles = arena.allocateArray<double>(100);
+	doubles[99] = 1.0;
+	BOOST_TEST(arena.getStats().used >= 64u + 100 * sizeof(double));
+
+	arena.reset();
+	BOOST_TEST(arena.getStats().used == 0u);
+	BOOST_TEST(arena.getStats().highWater >= 64u + 100 * sizeof(double));
+	// Same memory again after a reset
+	BOOST_TEST(arena.allocate(3, 1) == first);
+#if DOOBIUS_MEMORY_DEBUG
+	BOOST_TEST(reinterpret_cast<unsigned char*>(doubles)[0] == DMem::g_poisonFreed);
+#endif
+
+	// Past the reservation it keeps working from the heap until the next reset
+	void* big = arena.allocate(std::size_t{ 8 } << 20, 16);
+	BOOST_TEST(big != nullptr);
+	BOOST_TEST(arena.getStats().overflowAllocs == 1u);
+	std::memset(big, 0, std::size_t{ 8 } << 20);
+	arena.reset();
+}
+
+BOOST_AUTO_TEST_CASE(FrameArenaForThreadResetsOnAdvance)
+{
+	DMem::FrameArena& arena = DMem::FrameArena::forThread();
+	BOOST_TEST(&arena == &DMem::FrameArena::forThread());
+	void* first = arena.allocate(128);
+	arena.allocate(128);
+	BOOST_TEST(DMem::FrameArena::forThread().getStats().used >= 256u);
+
+	DMem::FrameArena::advanceFrame();
+	BOOST_TEST(DMem::FrameArena::forThread().getStats().used == 0u);
+	BOOST_TEST(DMem::FrameArena::forThread().allocate(128) == first);
+
+	// Other threads get their own arena
+	DMem::FrameArena* otherArena = nullptr;
+	std::thread other([&]() { otherArena = &DMem::FrameArena::forThread(); });
+	other.join();
+	BOOST_TEST(otherArena != &arena);
+}
+
+BOOST_AUTO_TEST_CASE(FrameArenaResourceBacksPmrContainers)
+{
+	DMem::FrameArena::advanceFrame();
+	std::pmr::vector<int> scratch(DMem::getFrameArenaResource());
+	for (int i = 0; i < 1000; ++i) {
+		scratch.push_back(i);
+	}
+	BOOST_TEST(scratch[999] == 999);
+	BOOST_TEST(DMem::FrameArena::forThread().getStats().used >= 1000 * sizeof(int));
+
+	// Nothing touches the general heap once the arena's pages are committed
+	if (Doobius::Perf::AllocTracker::isEnabled()) {
+		BOOST_TEST(Doobius::Perf::countThreadAllocations([]() {
+			std::pmr::vector<int> again(DMem::getFrameArenaResource());
+			again.resize(100);
+		}) == 0u);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(BlockPoolsReuseBlocks)
+{
+	static_assert(DMem::poolSizeClassOf(1) == 0);
+	static_assert(DMem::poolSizeClassOf(16) == 0);
+	static_assert(DMem::poolSizeClassOf(17) == 1);
+	static_assert(DMem::poolSizeClassOf(DMem::g_poolMaxBlockSize) == DMem::g_poolNumSizeClasses - 1);
+
+	std::set<void*> blocks;
+	for (int i = 0; i < 100; ++i) {
+		void* block = DMem::BlockPools::allocate(48);
+		BOOST_TEST(reinterpret_cast<std::uintptr_t>(block) % 64 == 0u);
+		blocks.insert(block);
+	}
+	BOOST_TEST(blocks.size() == 100u);
+	void* last = nullptr;
+	for (void* block : blocks) {
+		DMem::BlockPools::deallocate(block, 48);
+		last = block;
+	}
+	// Free list is LIFO, so the next block is the one freed last
+	BOOST_TEST(DMem::BlockPools::allocate(60) == last);
+	DMem::BlockPools::deallocate(last, 60);
+
+	// Too big for a pool, goes to the heap
+	void* big = DMem::BlockPools::allocate(DMem::g_poolMaxBlockSize + 1);
+	std::memset(big, 0, DMem::g_poolMaxBlockSize + 1);
+	DMem::BlockPools::deallocate(big, DMem::g_poolMaxBlockSize + 1);
+	BOOST_TEST(DMem::BlockPools::getStats().slabs >= 1u);
+}
+
+BOOST_AUTO_TEST_CASE(BlockPoolsHandleCrossThreadFrees)
+{
+	std::vector<void*> blocks;
+	std::thread producer([&]() {
+		for (int i = 0; i < 1000; ++i) {
+			blocks.push_back(DMem::BlockPools::allocate(32));
+			std::memset(blocks.back(), i & 0xFF, 32);
+		}
+	});
+	producer.join();
+	// The producer has exited, its blocks are freed here and join this thread's free list
+	for (void* block : blocks) {
+		DMem::BlockPools::deallocate(block, 32);
+	}
+	std::set<void*> freed(blocks.begin(), blocks.end());
+	void* reused = DMem::BlockPools::allocate(32);
+	BOOST_TEST(freed.count(reused) == 1u);
+	DMem::BlockPools::deallocate(reused, 32);
+}
+
+namespace {
+	// Counts what BlockPoolResource passes on to its upstream
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		int allocations = 0;
+		int deallocations = 0;
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+			++allocations;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+			++deallocations;
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+
+	struct alignas(64) AlignedElement {
+		unsigned char bytes[64];
+	};
+}
+
+BOOST_AUTO_TEST_CASE(BlockPoolResourceBacksPmrContainers)
+{
+	const DMem::BlockPoolStats before = DMem::BlockPools::getStats();
+	{
+		std::pmr::map<int, int> map(DMem::getBlockPoolResource());
+		for (int i = 0; i < 5000; ++i) {
+			map[i] = i * 2;
+		}
+		BOOST_TEST(map[4999] == 9998);
+	}
+
+	// Anything bigger than the largest block, or aligned past 64, goes to the upstream resource with its alignment
+	CountingResource upstream;
+	{
+		DMem::BlockPoolResource resource(&upstream);
+		std::pmr::vector<AlignedElement> aligned(100, AlignedElement{}, &resource);
+		BOOST_TEST(reinterpret_cast<std::uintptr_t>(aligned.data()) % alignof(AlignedElement) == 0u);
+		BOOST_TEST(upstream.allocations == 1);
+		std::pmr::vector<char> bytes(100000, 'x', &resource);
+		BOOST_TEST(bytes.back() == 'x');
+		BOOST_TEST(upstream.allocations == 2);
+		void* small = resource.allocate(32, 32);
+		BOOST_TEST(upstream.allocations == 2);
+		resource.deallocate(small, 32, 32);
+	}
+	BOOST_TEST(upstream.deallocations == 2);
+#if DOOBIUS_MEMORY_DEBUG
+	const DMem::BlockPoolStats after = DMem::BlockPools::getStats();
+	BOOST_TEST(after.outstanding == before.outstanding, boost::test_tools::per_element());
+#else
+	(void)before;
+#endif
+}
+
+#if DOOBIUS_MEMORY_DEBUG
+BOOST_AUTO_TEST_CASE(BlockPoolsPoisonAndReportLeaks)
+{
+	unsigned char* block = static_cast<unsigned char*>(DMem::BlockPools::allocate(128));
+	BOOST_TEST(block[100] == DMem::g_poisonAllocated);
+	DMem::BlockPools::deallocate(block, 128);
+	BOOST_TEST(block[100] == DMem::g_poisonFreed);
+
+	// A write after free is caught when the block is handed out again
+	const std::uint64_t violationsBefore = DMem::BlockPools::getStats().poisonViolations;
+	block[100] = 42;
+	void* again = DMem::BlockPools::allocate(128);
+	BOOST_TEST(again == block);
+	BOOST_TEST(DMem::BlockPools::getStats().poisonViolations == violationsBefore + 1);
+
+	const std::int64_t leaksBefore = DMem::BlockPools::reportLeaks();
+	void* leaked = DMem::BlockPools::allocate(1000);
+	BOOST_TEST(DMem::BlockPools::reportLeaks() == leaksBefore + 1);
+	DMem::BlockPools::deallocate(leaked, 1000);
+	DMem::BlockPools::deallocate(again, 128);
+	BOOST_TEST(DMem::BlockPools::reportLeaks() == leaksBefore - 1);
+}
+#endif
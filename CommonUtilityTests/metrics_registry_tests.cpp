@@ -0,0 +1,163 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/metrics_registry.h"
+#include "doobius/common/notif_registry.h"
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace DPerf = Doobius::Perf;
+
+namespace {
+	std::string readFile(const std::filesystem::path& path) {
+		std::ifstream inFile(path);
+		std::ostringstream contents;
+		contents << inFile.rdbuf();
+		return contents.str();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MetricsCounterFromManyThreads)
+{
+	DPerf::Counter& counter = DPerf::MetricsRegistry::get().getCounter("test_many_thread_increments_total", "Test counter");
+	BOOST_TEST(&counter == &DPerf::MetricsRegistry::get().getCounter("test_many_thread_increments_total", "Test counter"));
+
+	constexpr int numThreads = 8;
+	constexpr int incrementsPerThread = 100000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; ++t) {
+		threads.emplace_back([&counter]() {
+			for (int i = 0; i < incrementsPerThread; ++i) {
+				counter.inc();
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	BOOST_TEST(counter.value() == static_cast<std::uint64_t>(numThreads) * incrementsPerThread);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsGaugeAndLabels)
+{
+	DPerf::MetricsRegistry& metrics = DPerf::MetricsRegistry::get();
+	DPerf::Gauge& gaugeA = metrics.getGauge("test_queue_depth", "Test gauge", { { "queue", "a" } });
+	DPerf::Gauge& gaugeB = metrics.getGauge("test_queue_depth", "Test gauge", { { "queue", "b\"quoted\"" } });
+	BOOST_TEST(&gaugeA != &gaugeB);
+
+	gaugeA.add(5);
+	gaugeA.sub(2);
+	std::thread([&gaugeA]() { gaugeA.add(10); }).join();
+	BOOST_TEST(gaugeA.value() == 13);
+	gaugeA.set(-4);
+	BOOST_TEST(gaugeA.value() == -4);
+	gaugeB.set(7);
+
+	const std::string text = metrics.renderPrometheus();
+	BOOST_TEST(text.find("# HELP test_queue_depth Test gauge\n# TYPE test_queue_depth gauge\n") != std::string::npos);
+	BOOST_TEST(text.find("test_queue_depth{queue=\"a\"} -4\n") != std::string::npos);
+	BOOST_TEST(text.find("test_queue_depth{queue=\"b\\\"quoted\\\"\"} 7\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsHistogramBuckets)
+{
+	DPerf::Histogram& hist = DPerf::MetricsRegistry::get().getHistogram("test_latency_ms", "Test histogram", { 1.0, 5.0, 10.0 });
+	for (double value : { 0.5, 1.0, 3.0, 7.5, 20.0, 20.0 }) {
+		hist.observe(value);
+	}
+	const DPerf::Histogram::Snapshot snap = hist.snapshot();
+	BOOST_TEST(snap.count == 6u);
+	BOOST_TEST(snap.sum == 52.0);
+	BOOST_TEST(snap.bucketCounts == std::vector<std::uint64_t>({ 2, 1, 1, 2 }), boost::test_tools::per_element());
+
+	const std::string text = DPerf::MetricsRegistry::get().renderPrometheus();
+	BOOST_TEST(text.find("# TYPE test_latency_ms histogram\n"
+		"test_latency_ms_bucket{le=\"1\"} 2\n"
+		"test_latency_ms_bucket{le=\"5\"} 3\n"
+		"test_latency_ms_bucket{le=\"10\"} 4\n"
+		"test_latency_ms_bucket{le=\"+Inf\"} 6\n"
+		"test_latency_ms_sum 52\n"
+		"test_latency_ms_count 6\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsCallbacksAndBuiltins)
+{
+	DPerf::MetricsRegistry& metrics = DPerf::MetricsRegistry::get();
+	double sampled = 0.25;
+	metrics.registerCallback("test_sampled_ratio", "Test callback", DPerf::MetricType::GAUGE, [&sampled]() { return sampled; });
+	BOOST_TEST(metrics.renderPrometheus().find("test_sampled_ratio 0.25\n") != std::string::npos);
+	sampled = 3.0;
+	BOOST_TEST(metrics.renderPrometheus().find("test_sampled_ratio 3\n") != std::string::npos);
+	metrics.registerCallback("test_sampled_ratio", "Test callback", DPerf::MetricType::GAUGE, []() { return 0.0; });
+
+	const std::string text = metrics.renderPrometheus();
+	BOOST_TEST(text.find("# TYPE doobius_log_records_total counter\n") != std::string::npos);
+	BOOST_TEST(text.find("doobius_log_records_total{sink=\"file\"} ") != std::string::npos);
+	BOOST_TEST(text.find("doobius_log_dropped_records_total ") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsNotificationRegistry)
+{
+	using Doobius::Notification::NotificationRegistry;
+	DPerf::MetricsRegistry& metrics = DPerf::MetricsRegistry::get();
+	const DPerf::MetricLabels labels{ { "registry", "MetricsTestReg" } };
+
+	NotificationRegistry notifReg("MetricsTestReg");
+	notifReg.createNotificationChannel("Tick");
+	notifReg.createNotificationChannel("Unused");
+	int received = 0;
+	notifReg.registerCallback<int>([&received](const int& val) { received += val; }, "first");
+	notifReg.registerCallback<int>([&received](const int& val) { received += val; }, "second");
+	notifReg.registerCallbackToChannel("first", "Tick");
+	notifReg.registerCallbackToChannel("second", "Tick");
+
+	notifReg.updateChannel("Tick", 1);
+	notifReg.updateChannel("Tick", 2);
+	notifReg.updateChannel("Unused", 3);
+	BOOST_TEST(received == 6);
+
+	BOOST_TEST(metrics.getCounter("doobius_notification_updates_total", "", labels).value() == 2u);
+	BOOST_TEST(metrics.getCounter("doobius_notification_callbacks_invoked_total", "", labels).value() == 4u);
+	BOOST_TEST(metrics.getCounter("doobius_notification_missed_updates_total", "", labels).value() == 1u);
+	BOOST_TEST(metrics.getGauge("doobius_notification_callbacks", "", labels).value() == 2);
+	BOOST_TEST(metrics.getGauge("doobius_notification_channels", "", labels).value() == 2);
+
+	notifReg.removeCallback("second");
+	notifReg.destroyChannel("Unused");
+	BOOST_TEST(metrics.getGauge("doobius_notification_callbacks", "", labels).value() == 1);
+	BOOST_TEST(metrics.getGauge("doobius_notification_channels", "", labels).value() == 1);
+
+	// Registries sharing a name add up, and a destroyed one takes its share back out
+	{
+		NotificationRegistry sameName("MetricsTestReg");
+		sameName.createNotificationChannel("Other");
+		sameName.registerCallback<int>([](const int&) {}, "third");
+		BOOST_TEST(metrics.getGauge("doobius_notification_callbacks", "", labels).value() == 2);
+		BOOST_TEST(metrics.getGauge("doobius_notification_channels", "", labels).value() == 2);
+		notifReg.createNotificationChannel("Late");
+		BOOST_TEST(metrics.getGauge("doobius_notification_channels", "", labels).value() == 3);
+	}
+	BOOST_TEST(metrics.getGauge("doobius_notification_callbacks", "", labels).value() == 1);
+	BOOST_TEST(metrics.getGauge("doobius_notification_channels", "", labels).value() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsExporterWritesFile)
+{
+	DPerf::MetricsRegistry& metrics = DPerf::MetricsRegistry::get();
+	DPerf::Counter& counter = metrics.getCounter("test_exported_total", "Test exported counter");
+	counter.inc(41);
+
+	const std::filesystem::path outPath = std::filesystem::temp_directory_path() / "doobius_metrics_test.prom";
+	std::filesystem::remove(outPath);
+	BOOST_TEST(metrics.writePrometheusFile(outPath));
+	BOOST_TEST(readFile(outPath).find("test_exported_total 41\n") != std::string::npos);
+
+	metrics.startExporter(outPath, std::chrono::milliseconds(10));
+	counter.inc();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	metrics.stopExporter();
+	BOOST_TEST(readFile(outPath).find("test_exported_total 42\n") != std::string::npos);
+	BOOST_TEST(!std::filesystem::exists(std::filesystem::path(outPath).concat(".tmp")));
+	std::filesystem::remove(outPath);
+}
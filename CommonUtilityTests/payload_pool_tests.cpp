@@ -0,0 +1,147 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/payload_pool.h"
+#include "doobius/common/notif_registry.h"
+#include "doobius/common/alloc_tracker.h"
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace DMem = Doobius::Memory;
+namespace DNotif = Doobius::Notification;
+
+namespace {
+	std::uint64_t heapAllocationsOf(const DMem::PayloadPoolStats& stats) {
+		std::uint64_t total = 0;
+		for (const DMem::PayloadSizeClassStats& sizeClass : stats.sizeClasses) {
+			total += sizeClass.heapAllocations;
+		}
+		return total;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PayloadHandlesShareOneBuffer)
+{
+	static_assert(DMem::payloadSizeClassOf(1) == 0);
+	static_assert(DMem::payloadSizeClassOf(DMem::g_payloadMinPooledSize) == 0);
+	static_assert(DMem::payloadSizeClassOf(DMem::g_payloadMinPooledSize + 1) == 1);
+	static_assert(DMem::payloadSizeClassOf(DMem::g_payloadMaxPooledSize) == DMem::g_payloadNumSizeClasses - 1);
+
+	const DMem::PayloadPoolStats before = DMem::PayloadPool::getStats();
+	DMem::MutablePayload mutablePayload = DMem::PayloadPool::acquire(10000);
+	BOOST_TEST(mutablePayload.size() == 10000u);
+	BOOST_TEST(mutablePayload.capacity() == 16384u);
+	BOOST_TEST(reinterpret_cast<std::uintptr_t>(mutablePayload.data()) % 64 == 0u);
+	std::span<std::uint32_t> words = mutablePayload.view<std::uint32_t>();
+	BOOST_TEST(words.size() == 2500u);
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		words[i] = static_cast<std::uint32_t>(i);
+	}
+	const std::byte* bytes = mutablePayload.data();
+
+	DMem::PayloadHandle handle = std::move(mutablePayload).publish();
+	BOOST_TEST(handle.data() == bytes);
+	BOOST_TEST(handle.useCount() == 1u);
+	DMem::PayloadHandle kept = handle;
+	BOOST_TEST(handle.useCount() == 2u);
+	handle.reset();
+	BOOST_TEST(!handle);
+	BOOST_TEST(kept.useCount() == 1u);
+	BOOST_TEST(kept.view<std::uint32_t>()[2499] == 2499u);
+	BOOST_TEST(DMem::PayloadPool::getStats().inUse == before.inUse + 1);
+
+	// The last reference puts the buffer back and the next acquire of that class gets it
+	kept.reset();
+	BOOST_TEST(DMem::PayloadPool::getStats().inUse == before.inUse);
+	DMem::MutablePayload again = DMem::PayloadPool::acquire(16384);
+	BOOST_TEST(again.data() == bytes);
+	BOOST_TEST(again.size() == 16384u);
+	again.resize(8);
+	BOOST_TEST(std::move(again).publish().size() == 8u);
+
+	// Oversize payloads skip the pools but are still counted
+	{
+		DMem::PayloadHandle big = DMem::PayloadPool::acquire(DMem::g_payloadMaxPooledSize + 1).publish();
+		BOOST_TEST(big.size() == DMem::g_payloadMaxPooledSize + 1);
+		BOOST_TEST(DMem::PayloadPool::getStats().oversizeInUse == before.oversizeInUse + 1);
+	}
+	const DMem::PayloadPoolStats after = DMem::PayloadPool::getStats();
+	BOOST_TEST(after.oversizeAcquires == before.oversizeAcquires + 1);
+	BOOST_TEST(after.oversizeInUse == before.oversizeInUse);
+	BOOST_TEST(after.sizeClasses[2].acquires == before.sizeClasses[2].acquires + 2);
+}
+
+BOOST_AUTO_TEST_CASE(PayloadSubscribersKeepHandlesPastTheCallback)
+{
+	DNotif::NotificationRegistry registry("PayloadTests");
+	std::vector<DMem::PayloadHandle> kept;
+	kept.reserve(8);
+	std::uint64_t checksum = 0;
+	registry.createNotificationChannel("mesh_deltas");
+	registry.registerCallback<DMem::PayloadHandle>([&kept](const DMem::PayloadHandle& payload) { kept.push_back(payload); }, "keeper");
+	registry.registerCallback<DMem::PayloadHandle>([&checksum](const DMem::PayloadHandle& payload) { checksum += payload.view<std::uint64_t>()[0]; }, "reader");
+	registry.registerCallbackToChannel("keeper", "mesh_deltas");
+	registry.registerCallbackToChannel("reader", "mesh_deltas");
+
+	const std::byte* firstBytes = nullptr;
+	for (std::uint64_t frame = 1; frame <= 4; ++frame) {
+		DMem::MutablePayload delta = DMem::PayloadPool::acquire(64 << 10);
+		delta.view<std::uint64_t>()[0] = frame;
+		if (!firstBytes) {
+			firstBytes = delta.data();
+		}
+		// The publisher's handle goes away right after the dispatch, the keeper's copy doesn't
+		BOOST_TEST((registry.updateChannel("mesh_deltas", std::move(delta).publish()) == DNotif::NotificationRegistry::UpdateStatus::UPDATE_OK));
+	}
+	BOOST_TEST(checksum == 10u);
+	BOOST_CHECK_THROW(registry.updateChannel("mesh_deltas", 5), boost::bad_any_cast);
+	BOOST_REQUIRE(kept.size() == 4u);
+	BOOST_TEST(kept[0].data() == firstBytes);
+	for (std::uint64_t frame = 1; frame <= 4; ++frame) {
+		BOOST_TEST(kept[frame - 1].useCount() == 1u);
+		BOOST_TEST(kept[frame - 1].view<std::uint64_t>()[0] == frame);
+	}
+
+	// A subscriber on another thread can drop the last reference
+	const std::uint64_t inUse = DMem::PayloadPool::getStats().inUse;
+	std::thread releaser([moved = std::move(kept)]() mutable { moved.clear(); });
+	releaser.join();
+	BOOST_TEST(DMem::PayloadPool::getStats().inUse == inUse - 4);
+}
+
+BOOST_AUTO_TEST_CASE(PayloadSteadyStateDoesNotTouchTheHeap)
+{
+	constexpr std::size_t g_retained = 3;
+	std::vector<DMem::PayloadHandle> retained(g_retained);
+
+	// Each frame publishes a snapshot that a subscriber keeps for g_retained frames
+	auto runFrame = [&retained](std::uint64_t frame) {
+		DMem::MutablePayload snapshot = DMem::PayloadPool::acquire(256 << 10);
+		std::memset(snapshot.data(), static_cast<int>(frame & 0xFF), snapshot.size());
+		DMem::PayloadHandle handle = std::move(snapshot).publish();
+		DMem::PayloadHandle subscriberCopy = handle;
+		retained[frame % g_retained] = std::move(subscriberCopy);
+	};
+	for (std::uint64_t frame = 0; frame < g_retained + 1; ++frame) {
+		runFrame(frame);
+	}
+
+	const DMem::PayloadPoolStats warm = DMem::PayloadPool::getStats();
+	const std::uint64_t heapAllocs = Doobius::Perf::countThreadAllocations([&runFrame]() {
+		for (std::uint64_t frame = 0; frame < 1000; ++frame) {
+			runFrame(frame);
+		}
+	});
+	if (Doobius::Perf::AllocTracker::isEnabled()) {
+		BOOST_TEST(heapAllocs == 0u);
+	}
+	const DMem::PayloadPoolStats steady = DMem::PayloadPool::getStats();
+	BOOST_TEST(heapAllocationsOf(steady) == heapAllocationsOf(warm));
+	BOOST_TEST(steady.sizeClasses[6].acquires == warm.sizeClasses[6].acquires + 1000);
+	BOOST_TEST(steady.inUse == warm.inUse);
+
+	retained.clear();
+	BOOST_TEST(DMem::PayloadPool::trim() >= (g_retained + 1) * (256u << 10));
+	BOOST_TEST(DMem::PayloadPool::getStats().sizeClasses[6].free == 0u);
+}
@@ -0,0 +1,53 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/perf_clock.h"
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <thread>
+
+namespace DPerf = Doobius::Perf;
+
+namespace {
+	// Relative error of PerfClock against steady_clock over one sleep of the given length
+	double measureClockError(std::chrono::milliseconds interval) {
+		const auto steadyStart = std::chrono::steady_clock::now();
+		const std::uint64_t ticksStart = DPerf::PerfClock::nowOrdered();
+		std::this_thread::sleep_for(interval);
+		const std::uint64_t ticksEnd = DPerf::PerfClock::nowOrdered();
+		const auto steadyEnd = std::chrono::steady_clock::now();
+
+		const double steadyNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(steadyEnd - steadyStart).count());
+		const double perfNs = DPerf::PerfClock::get().ticksToNs(ticksEnd - ticksStart);
+		return std::abs(perfNs - steadyNs) / steadyNs;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PerfClockCalibration)
+{
+	DPerf::PerfClock& clock = DPerf::PerfClock::get();
+	BOOST_TEST_MESSAGE("Perf clock source " << (clock.getSource() == DPerf::ClockSource::TSC ? "TSC" : "steady_clock")
+		<< ", " << clock.getTicksPerNs() << " ticks/ns");
+	if (!clock.hasInvariantTsc()) {
+		BOOST_TEST((clock.getSource() == DPerf::ClockSource::STEADY));
+	}
+
+	// Best of a few runs so a descheduled sleep doesn't fail the test
+	double bestError = 1.0;
+	for (int i = 0; i < 5 && bestError > 0.005; ++i) {
+		bestError = std::min(bestError, measureClockError(std::chrono::milliseconds(100)));
+	}
+	BOOST_TEST(bestError < 0.005);
+
+	BOOST_TEST(clock.ticksToNs(clock.nsToTicks(1e6)) == 1e6, boost::test_tools::tolerance(1e-6));
+}
+
+BOOST_AUTO_TEST_CASE(PerfClockSteadyFallback)
+{
+	DPerf::PerfClock& clock = DPerf::PerfClock::get();
+	const DPerf::ClockSource original = clock.getSource();
+
+	BOOST_TEST((clock.setSource(DPerf::ClockSource::STEADY) == DPerf::ClockSource::STEADY));
+	BOOST_TEST(measureClockError(std::chrono::milliseconds(20)) < 0.005);
+
+	BOOST_TEST((clock.setSource(original) == original));
+}
@@ -0,0 +1,56 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/code_timer.h"
+#include "doobius/common/perf_counters.h"
+#include <boost/test/unit_test.hpp>
+
+#include <numeric>
+#include <thread>
+
+namespace DPerf = Doobius::Perf;
+
+BOOST_AUTO_TEST_CASE(PerfCounterScopeMeasures)
+{
+	std::vector<std::uint64_t> data(1 << 16);
+	std::iota(data.begin(), data.end(), 0);
+
+	DPerf::PerfCounterScope scope;
+	volatile std::uint64_t sum = std::accumulate(data.begin(), data.end(), std::uint64_t{ 0 });
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	DPerf::PerfCounterSample sample = scope.end();
+	BOOST_TEST_MESSAGE("PerfCounterScope: " << sample.toString());
+
+	// Wall time is always there, counters only where the kernel lets us open them
+	BOOST_TEST(sample.elapsedNs >= 2e6);
+	const DPerf::PerfCounterGroup& group = DPerf::PerfCounterGroup::forCurrentThread();
+	BOOST_TEST(sample.deltas.availableMask == group.getAvailableMask());
+	if (sample.deltas.has(DPerf::PerfCounter::INSTRUCTIONS)) {
+		BOOST_TEST(sample.deltas.get(DPerf::PerfCounter::INSTRUCTIONS) > data.size());
+	}
+	if (!group.isAvailable()) {
+		BOOST_TEST(sample.getIpc() == 0.0);
+		BOOST_TEST(sample.toString().find("ipc") == std::string::npos);
+	}
+	static_cast<void>(sum);
+}
+
+BOOST_AUTO_TEST_CASE(PerfCounterRates)
+{
+	DPerf::PerfCounterSample sample;
+	sample.deltas.values = { 2000, 3000, 30, 3, 6 };
+	sample.deltas.availableMask = (1u << DPerf::g_numPerfCounters) - 1;
+	BOOST_TEST(sample.getIpc() == 1.5);
+	BOOST_TEST(sample.getMpki(DPerf::PerfCounter::L1D_MISSES) == 10.0);
+	BOOST_TEST(sample.getMpki(DPerf::PerfCounter::BRANCH_MISSES) == 2.0);
+
+	// Without instructions none of the rates can be derived
+	sample.deltas.availableMask &= ~(1u << static_cast<std::size_t>(DPerf::PerfCounter::INSTRUCTIONS));
+	BOOST_TEST(sample.getIpc() == 0.0);
+	BOOST_TEST(sample.getMpki(DPerf::PerfCounter::LLC_MISSES) == 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(CodeTimerCountersMode)
+{
+	DPerf::CodeTimer timer("CodeTimerCountersMode", DPerf::CodeTimerMode::COUNTERS);
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	BOOST_TEST(timer.end() >= 1000);
+}
@@ -0,0 +1,44 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/profiler.h"
+#include <boost/test/unit_test.hpp>
+
+namespace DPerf = Doobius::Perf;
+
+namespace {
+	void profileRecursive(DPerf::ProfileEventRing& ring, int depth) {
+		if (!ring.tryBegin("zone", DPerf::Profiler::nowTicks())) {
+			return;
+		}
+		if (depth > 0) {
+			profileRecursive(ring, depth - 1);
+		}
+		ring.end("zone", DPerf::Profiler::nowTicks());
+	}
+}
+
+// A full ring must drop whole zones so every BEGIN that made it in still gets its END
+BOOST_AUTO_TEST_CASE(ProfileRingDropsWholeZones)
+{
+	DPerf::ProfileEventRing ring(8, 1);
+	profileRecursive(ring, 9);
+
+	int depth = 0, numBegins = 0;
+	std::size_t numEvents = ring.drain([&](const DPerf::ProfileEvent& event) {
+		if (event.type == DPerf::ProfileEvent::Type::BEGIN) {
+			++depth;
+			++numBegins;
+		}
+		else {
+			--depth;
+		}
+		BOOST_TEST(depth >= 0);
+	});
+	BOOST_TEST(depth == 0);
+	BOOST_TEST(numEvents == 8u);
+	BOOST_TEST(numBegins == 4);
+	BOOST_TEST(ring.getNumDroppedZones() == 1u);
+
+	// Drained space is reusable
+	profileRecursive(ring, 1);
+	BOOST_TEST(ring.drain([](const DPerf::ProfileEvent&) {}) == 4u);
+}
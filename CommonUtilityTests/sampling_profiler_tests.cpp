@@ -0,0 +1,115 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/sampling_profiler.h"
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace DPerf = Doobius::Perf;
+
+#if defined(_MSC_VER)
+#define SAMPLING_TEST_NOINLINE __declspec(noinline)
+#else
+#define SAMPLING_TEST_NOINLINE __attribute__((noinline))
+#endif
+
+// Out of line with external linkage so it shows up by name even when symbols only come from the dynamic symbol table
+SAMPLING_TEST_NOINLINE std::uint64_t samplingBusyLoop(std::chrono::milliseconds duration) {
+	std::uint64_t acc = 0x9E3779B97F4A7C15ull;
+	const auto endTime = std::chrono::steady_clock::now() + duration;
+	while (std::chrono::steady_clock::now() < endTime) {
+		for (int i = 0; i < 10000; ++i) {
+			acc = acc * 6364136223846793005ull + 1442695040888963407ull;
+		}
+	}
+	return acc;
+}
+
+BOOST_AUTO_TEST_CASE(SamplingProfilerCollapsedStacks)
+{
+	DPerf::SamplingProfiler& profiler = DPerf::SamplingProfiler::get();
+	profiler.clear();
+	DPerf::SamplingProfiler::SamplingConfig config;
+	config.frequencyHz = 1000;
+	if (!profiler.start(config)) {
+		BOOST_TEST_MESSAGE("Sampling profiler isn't supported here, skipping");
+		return;
+	}
+	BOOST_TEST(profiler.isRunning());
+	volatile std::uint64_t sink = samplingBusyLoop(std::chrono::milliseconds(300));
+	profiler.stop();
+	BOOST_TEST(!profiler.isRunning());
+	static_cast<void>(sink);
+
+	// 300ms of CPU at 1kHz, leave plenty of slack for coarse kernel timers and loaded machines
+	const DPerf::SamplingStats stats = profiler.getStats();
+	BOOST_TEST(stats.samples >= 20u);
+	BOOST_TEST(stats.dropped == 0u);
+
+	const std::filesystem::path outPath = std::filesystem::temp_directory_path() / "doobius_sampling_test.folded";
+	BOOST_TEST(profiler.writeCollapsedStacks(outPath) > 0u);
+
+	std::ifstream inFile(outPath);
+	std::string line;
+	std::uint64_t totalCount = 0;
+	bool sawBusyLoop = false;
+	while (std::getline(inFile, line)) {
+		const std::size_t countPos = line.rfind(' ');
+		BOOST_REQUIRE(countPos != std::string::npos);
+		totalCount += std::stoull(line.substr(countPos + 1));
+		sawBusyLoop = sawBusyLoop || line.find("samplingBusyLoop") != std::string::npos;
+	}
+	BOOST_TEST(totalCount == stats.samples);
+	BOOST_TEST(sawBusyLoop);
+	std::filesystem::remove(outPath);
+}
+
+BOOST_AUTO_TEST_CASE(SamplingProfilerLowFrequency)
+{
+#if defined(__linux__)
+	DPerf::SamplingProfiler& profiler = DPerf::SamplingProfiler::get();
+	// 0 is clamped to 1Hz, a one-second period the timer has to be given in whole seconds
+	for (int frequencyHz : { 0, 1, 3 }) {
+		DPerf::SamplingProfiler::SamplingConfig config;
+		config.frequencyHz = frequencyHz;
+		BOOST_TEST(profiler.start(config), "start at " << frequencyHz << "Hz");
+		BOOST_TEST(profiler.isRunning());
+		profiler.stop();
+	}
+	profiler.clear();
+#else
+	BOOST_TEST_MESSAGE("Sampling profiler isn't supported here, skipping");
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(SamplingProfilerBufferFull)
+{
+	DPerf::SamplingProfiler& profiler = DPerf::SamplingProfiler::get();
+	profiler.clear();
+	std::uint64_t samples = 0;
+	std::uint64_t dropped = 0;
+	std::thread worker([&]() {
+		// A fresh thread gets a buffer sized from the current config, this one only has room for a single sample
+		DPerf::SamplingProfiler::SamplingConfig config;
+		config.frequencyHz = 1000;
+		config.bufferWordsPerThread = config.maxDepth + 1;
+		if (!profiler.start(config)) {
+			return;
+		}
+		profiler.registerCurrentThread("Worker");
+		volatile std::uint64_t sink = samplingBusyLoop(std::chrono::milliseconds(200));
+		profiler.stop();
+		static_cast<void>(sink);
+		const DPerf::SamplingStats stats = profiler.getStats();
+		samples = stats.samples;
+		dropped = stats.dropped;
+	});
+	worker.join();
+	if (samples + dropped == 0) {
+		BOOST_TEST_MESSAGE("Sampling profiler isn't supported here, skipping");
+		return;
+	}
+	BOOST_TEST(samples == 1u);
+	BOOST_TEST(dropped > 0u);
+}
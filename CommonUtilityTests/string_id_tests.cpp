@@ -0,0 +1,122 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/dbg/string_id.h"
+#include "doobius/dbg/log_format.h"
+#include "doobius/common/notif_registry.h"
+#include "doobius/common/timing_registry.h"
+#include <boost/test/unit_test.hpp>
+
+#include <boost/log/attributes/constant.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Doobius::Literals;
+
+namespace {
+	// A literal that is never interned at runtime, only through its _sid registration
+	constexpr Doobius::StringId g_compileTimeId = "tests/compile-time-only"_sid;
+}
+
+BOOST_AUTO_TEST_CASE(StringIdLiteralsMatchRuntimeInterning)
+{
+	static_assert("input/keyboard"_sid == "input/keyboard"_sid);
+	static_assert("input/keyboard"_sid != "input/mouse"_sid);
+	static_assert(g_compileTimeId.getValue() == Doobius::hashStringId("tests/compile-time-only"));
+
+	const std::string runtimeName = std::string("input/") + "keyboard";
+	BOOST_TEST(Doobius::internString(runtimeName) == "input/keyboard"_sid);
+	BOOST_TEST(("input/keyboard"_sid).view() == "input/keyboard");
+	// Registered before main, so it prints even though nothing interned it at runtime
+	BOOST_TEST(g_compileTimeId.view() == "tests/compile-time-only");
+	BOOST_TEST(std::string(g_compileTimeId.c_str()) == "tests/compile-time-only");
+
+	switch (Doobius::internString("input/mouse").getValue()) {
+	case ("input/mouse"_sid).getValue():
+		break;
+	default:
+		BOOST_FAIL("Literal ids must work as case labels");
+	}
+
+	BOOST_TEST(Doobius::StringId().isNull());
+	BOOST_TEST(Doobius::StringId().view().empty());
+	BOOST_TEST(std::string(Doobius::StringId().c_str()).empty());
+	std::ostringstream oss;
+	oss << "input/keyboard"_sid << "|" << Doobius::internString("");
+	BOOST_TEST(oss.str() == "input/keyboard|");
+}
+
+BOOST_AUTO_TEST_CASE(StringInterningIsThreadSafe)
+{
+	const std::size_t before = Doobius::StringInterner::get().getNumStrings();
+	std::vector<std::vector<Doobius::StringId>> ids(4);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < ids.size(); ++t) {
+		threads.emplace_back([&ids, t]() {
+			// Every thread interns the same names so they race on insertion
+			for (int i = 0; i < 2000; ++i) {
+				ids[t].push_back(Doobius::internString("tests/concurrent/" + std::to_string(i)));
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	for (std::size_t t = 1; t < ids.size(); ++t) {
+		BOOST_TEST(ids[t] == ids[0]);
+	}
+	BOOST_TEST(Doobius::StringInterner::get().getNumStrings() == before + 2000);
+	BOOST_TEST(ids[0][1234].view() == "tests/concurrent/1234");
+
+	// Bigger than a block share, stored on its own
+	const std::string longName(10000, 'x');
+	BOOST_TEST(Doobius::internString(longName).view() == longName);
+}
+
+BOOST_AUTO_TEST_CASE(NotificationRegistryAcceptsStringIds)
+{
+	Doobius::Notification::NotificationRegistry registry("StringIdReg");
+	registry.createNotificationChannel("tests/channel"_sid);
+	int received = 0;
+	registry.registerCallback<int>([&](const int& value) { received += value; }, "tests/callback"_sid);
+	BOOST_TEST((registry.registerCallbackToChannel("tests/callback"_sid, "tests/channel"_sid) == Doobius::Notification::NotificationRegistry::UpdateStatus::UPDATE_OK));
+
+	// Ids and strings name the same channel
+	BOOST_TEST(registry.getNumCbsListeningTo("tests/channel") == 1);
+	registry.updateChannel("tests/channel"_sid, 2);
+	registry.updateChannel(std::string("tests/channel"), 3);
+	BOOST_TEST(received == 5);
+
+	registry.removeCallback("tests/callback");
+	BOOST_TEST(registry.getNumCbsListeningTo("tests/channel"_sid) == 0);
+	registry.destroyChannel("tests/channel"_sid);
+	BOOST_TEST(registry.getNumChannelsRegistered() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TimingRegistryAcceptsStringIds)
+{
+	Doobius::Perf::TimingRegistry& registry = Doobius::Perf::TimingRegistry::get();
+	const Doobius::Perf::TimerId timerId = registry.getTimerId("tests/timer"_sid);
+	BOOST_TEST(registry.getTimerId("tests/timer") == timerId);
+	BOOST_TEST(registry.getTimerName(timerId) == "tests/timer");
+}
+
+BOOST_AUTO_TEST_CASE(LogFormattersResolveInternedTags)
+{
+	logging::attribute_set recAttrs;
+	recAttrs.insert("Severity", attrs::constant<severity_level>(severity_level::info));
+	recAttrs.insert("Tag", attrs::constant<Doobius::StringId>("tests/log-tag"_sid));
+	logging::record rec = logging::core::get()->open_record(recAttrs);
+	BOOST_REQUIRE(rec);
+	const logging::record_view view = rec.lock();
+
+	std::string fast, reference;
+	logging::formatting_ostream fastStrm(fast), referenceStrm(reference);
+	Doobius::Log::fastConsoleLogRecordFormat(view, fastStrm);
+	Doobius::Log::consoleLogRecordFormat(view, referenceStrm);
+	fastStrm.flush();
+	referenceStrm.flush();
+	BOOST_TEST(fast.find(":tests/log-tag:") != std::string::npos);
+	BOOST_TEST(fast == reference);
+}
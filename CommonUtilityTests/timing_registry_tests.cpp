@@ -0,0 +1,85 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/code_timer.h"
+#include "doobius/common/timing_registry.h"
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+namespace DPerf = Doobius::Perf;
+
+BOOST_AUTO_TEST_CASE(HistogramBucketLayout)
+{
+	std::size_t prevIdx = 0;
+	for (std::uint64_t val : { 0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456789ull, (1ull << 44) - 1 }) {
+		const std::size_t idx = DPerf::histBucketIndex(val);
+		BOOST_TEST(idx < DPerf::g_histNumBuckets);
+		BOOST_TEST(idx >= prevIdx);
+		BOOST_TEST(DPerf::histBucketLowerBound(idx) <= val);
+		BOOST_TEST(DPerf::histBucketUpperBound(idx) >= val);
+		// Bucket width stays within ~3.2% of the values it holds
+		BOOST_TEST(DPerf::histBucketUpperBound(idx) - DPerf::histBucketLowerBound(idx) <= val / 31);
+		prevIdx = idx;
+	}
+	BOOST_TEST(DPerf::histBucketIndex(~0ull) == DPerf::g_histNumBuckets - 1);
+}
+
+BOOST_AUTO_TEST_CASE(HistogramQuantiles)
+{
+	DPerf::TimingHistogram hist;
+	for (std::uint64_t val = 1; val <= 100000; ++val) {
+		hist.record(val);
+	}
+	BOOST_TEST(hist.getCount() == 100000u);
+	BOOST_TEST(hist.valueAtQuantile(0.0) == 1u);
+	BOOST_TEST(static_cast<double>(hist.valueAtQuantile(0.5)) == 50000.0, boost::test_tools::tolerance(0.02));
+	BOOST_TEST(static_cast<double>(hist.valueAtQuantile(0.99)) == 99000.0, boost::test_tools::tolerance(0.02));
+	BOOST_TEST(hist.valueAtQuantile(1.0) == 100000u);
+
+	// Subtracting an earlier snapshot leaves only the newer samples
+	DPerf::TimingHistogram later = hist;
+	for (int i = 0; i < 10; ++i) {
+		later.record(5000000);
+	}
+	later.subtract(hist);
+	BOOST_TEST(later.getCount() == 10u);
+	BOOST_TEST(static_cast<double>(later.valueAtQuantile(0.5)) == 5000000.0, boost::test_tools::tolerance(0.02));
+}
+
+BOOST_AUTO_TEST_CASE(TimingRegistryMergesThreads)
+{
+	DPerf::TimingRegistry& registry = DPerf::TimingRegistry::get();
+	const DPerf::TimerId timerId = registry.getTimerId("TimingRegistryMergesThreads");
+	BOOST_TEST(registry.getTimerId("TimingRegistryMergesThreads") == timerId);
+	BOOST_TEST(registry.getTimerName(timerId) == "TimingRegistryMergesThreads");
+
+	std::vector<std::thread> threads;
+	for (std::uint64_t t = 1; t <= 4; ++t) {
+		threads.emplace_back([&registry, timerId, t]() {
+			for (int i = 0; i < 1000; ++i) {
+				registry.recordTicks(timerId, t * 1000);
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const DPerf::TimingHistogram hist = registry.getHistogram(timerId);
+	BOOST_TEST(hist.getCount() == 4000u);
+	BOOST_TEST(hist.valueAtQuantile(0.0) == 1000u);
+	BOOST_TEST(hist.valueAtQuantile(1.0) == 4000u);
+	BOOST_TEST(static_cast<double>(hist.valueAtQuantile(0.5)) == 2000.0, boost::test_tools::tolerance(0.02));
+}
+
+BOOST_AUTO_TEST_CASE(CodeTimerAggregateMode)
+{
+	DPerf::TimingRegistry& registry = DPerf::TimingRegistry::get();
+	for (int i = 0; i < 10; ++i) {
+		DPerf::CodeTimer timer("CodeTimerAggregateMode", DPerf::CodeTimerMode::AGGREGATE);
+		timer.end();
+	}
+	const DPerf::TimerId timerId = registry.getTimerId("CodeTimerAggregateMode");
+	DPerf::CodeTimer(timerId).end();
+
+	BOOST_TEST(registry.getStats(timerId).count == 11u);
+}
@@ -0,0 +1,114 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/common/triple_buffer.h"
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace DNotif = Doobius::Notification;
+
+namespace {
+	// Big enough that a torn read would show up as a mix of two sequence numbers
+	struct Snapshot {
+		std::uint64_t sequence = 0;
+		std::array<std::uint64_t, 32> payload{};
+	};
+
+	class SnapshotWatcher : public DNotif::IDirectNotifiee<DNotif::SnapshotNotice> {
+	public:
+		std::atomic<std::uint64_t> latestSequence{ 0 };
+		int numNotices = 0;
+
+		SnapshotWatcher() : DNotif::DirectNotifieeCommon("SnapshotWatcher") {}
+
+		void onNotify(const DNotif::SnapshotNotice& notice, Doobius::StringId) override {
+			++numNotices;
+			latestSequence.store(notice.sequence, std::memory_order_release);
+		}
+	};
+}
+
+BOOST_AUTO_TEST_CASE(TripleBufferHandsOverLatestSnapshot)
+{
+	DNotif::TripleBuffer<int> buffer(-1);
+	BOOST_TEST(!buffer.update());
+	BOOST_TEST(buffer.front() == -1);
+	BOOST_TEST(buffer.getFrontSequence() == 0);
+
+	buffer.backBuffer() = 1;
+	BOOST_TEST(buffer.publish() == 1);
+	BOOST_TEST(buffer.hasNewSnapshot());
+	BOOST_TEST(buffer.read() == 1);
+	BOOST_TEST(!buffer.hasNewSnapshot());
+
+	// Snapshots the consumer never picked up are skipped, not queued
+	buffer.publish(2);
+	buffer.publish(3);
+	BOOST_TEST(buffer.publish(4) == 4);
+	BOOST_TEST(buffer.update());
+	BOOST_TEST(buffer.front() == 4);
+	BOOST_TEST(buffer.getFrontSequence() == 4);
+	BOOST_TEST(!buffer.update());
+	BOOST_TEST(buffer.front() == 4);
+}
+
+BOOST_AUTO_TEST_CASE(TripleBufferReadsNeverTear)
+{
+	constexpr std::uint64_t numSnapshots = 200000;
+	DNotif::TripleBuffer<Snapshot> buffer;
+
+	std::thread producer([&buffer]() {
+		for (std::uint64_t seq = 1; seq <= numSnapshots; ++seq) {
+			Snapshot& back = buffer.backBuffer();
+			back.sequence = seq;
+			back.payload.fill(seq);
+			buffer.publish();
+		}
+	});
+
+	std::uint64_t lastSeen = 0, numTorn = 0, numBackwards = 0, numUpdates = 0;
+	while (lastSeen < numSnapshots) {
+		if (!buffer.update()) {
+			continue;
+		}
+		++numUpdates;
+		const Snapshot& snapshot = buffer.front();
+		for (std::uint64_t value : snapshot.payload) {
+			numTorn += value != snapshot.sequence ? 1 : 0;
+		}
+		numBackwards += snapshot.sequence <= lastSeen ? 1 : 0;
+		BOOST_TEST(buffer.getFrontSequence() == snapshot.sequence);
+		lastSeen = snapshot.sequence;
+	}
+	producer.join();
+
+	BOOST_TEST(numTorn == 0);
+	BOOST_TEST(numBackwards == 0);
+	BOOST_TEST(numUpdates > 0);
+	BOOST_TEST(buffer.getNumPublished() == numSnapshots);
+}
+
+BOOST_AUTO_TEST_CASE(TripleBufferNotifierSignalsObservers)
+{
+	DNotif::TripleBufferNotifier<SnapshotWatcher, Snapshot> notifier("tests/snapshots");
+	SnapshotWatcher first, second;
+	notifier.addNotifiee(&first);
+	notifier.addNotifiee(&second);
+
+	Snapshot snapshot;
+	snapshot.sequence = 7;
+	BOOST_TEST(notifier.publish(snapshot) == 1);
+	BOOST_TEST(first.numNotices == 1);
+	BOOST_TEST(second.latestSequence.load() == 1);
+
+	notifier.removeNotifiee(&second);
+	notifier.backBuffer().sequence = 8;
+	notifier.publish();
+	BOOST_TEST(first.numNotices == 2);
+	BOOST_TEST(second.numNotices == 1);
+
+	// The notice only says something arrived, the consumer reads the newest one
+	BOOST_TEST(notifier.getBuffer().read().sequence == 8);
+	BOOST_TEST(notifier.getBuffer().getFrontSequence() == first.latestSequence.load());
+}
@@ -0,0 +1,410 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "doobius/common/notif_registry.h"
+
+namespace Doobius {
+	using ComponentTypeId = std::uint32_t;
+	constexpr std::size_t g_maxComponentTypes = 128;
+	// Each archetype stores its entities in chunks of this many bytes, component arrays side by side in each
+	constexpr std::size_t g_ecsChunkBytes = std::size_t{ 16 } << 10;
+	constexpr std::uint32_t g_invalidArchetype = UINT32_MAX;
+
+	/**
+	 * \brief Slot index plus the generation of that slot when the entity was created. Destroying an entity bumps
+	 * the slot's generation, so stale ids stop resolving instead of aliasing whatever reuses the slot.
+	 */
+	struct EntityId {
+		std::uint32_t index = UINT32_MAX;
+		std::uint32_t generation = 0;
+
+		inline bool isNull() const { return index == UINT32_MAX; }
+		inline bool operator==(const EntityId& rhs) const { return index == rhs.index && generation == rhs.generation; }
+		inline bool operator!=(const EntityId& rhs) const { return !(*this == rhs); }
+	};
+
+	inline std::ostream& operator<<(std::ostream& os, const EntityId& entity) {
+		return os << "Entity(" << entity.index << "v" << entity.generation << ")";
+	}
+
+	struct ComponentInfo {
+		std::string name;
+		std::size_t size;
+		std::size_t alignment;
+		bool trivial;
+		void (*moveConstruct)(void* dst, void* src);
+		void (*destruct)(void* p);
+	};
+
+	// Process-wide list of component types, ids are handed out the first time a type is used
+	class ComponentRegistry {
+	private:
+		ComponentRegistry() = default;
+
+		mutable std::mutex m_mutex;
+		std::vector<std::unique_ptr<ComponentInfo>> m_infos;
+	public:
+		ComponentRegistry(const ComponentRegistry&) = delete;
+		ComponentRegistry& operator=(const ComponentRegistry&) = delete;
+
+		static ComponentRegistry& get();
+
+		ComponentTypeId registerType(ComponentInfo info);
+		// The returned reference stays valid forever
+		const ComponentInfo& getInfo(ComponentTypeId typeId) const;
+	};
+
+	template<typename C>
+	inline ComponentTypeId registeredComponentTypeId() {
+		static_assert(std::is_nothrow_move_constructible_v<C>, "Components are moved between chunks and must be nothrow move constructible");
+		static const ComponentTypeId typeId = ComponentRegistry::get().registerType({ typeid(C).name(), sizeof(C), alignof(C),
+			std::is_trivially_copyable_v<C>,
+			[](void* dst, void* src) { new (dst) C(std::move(*static_cast<C*>(src))); },
+			[](void* p) { static_cast<C*>(p)->~C(); } });
+		return typeId;
+	}
+
+	// const T and T share an id, so queries and getComponent can ask for read-only access
+	template<typename T>
+	inline ComponentTypeId componentTypeId() {
+		return registeredComponentTypeId<std::remove_cv_t<std::remove_reference_t<T>>>();
+	}
+
+	using ComponentMask = std::bitset<g_maxComponentTypes>;
+
+	// Published on the world's added/removed channels. typeName points into the ComponentRegistry and never dangles.
+	struct ComponentEvent {
+		EntityId entity;
+		ComponentTypeId typeId;
+		const char* typeName;
+	};
+
+	class World;
+
+	/**
+	 * \brief Every entity with exactly the same set of component types. Entities are packed into fixed-size chunks;
+	 * within a chunk each component type has its own contiguous array (structure of arrays), so iterating one
+	 * component touches only that component's memory. Removal swaps the last entity into the hole.
+	 */
+	class Archetype {
+	private:
+		struct Chunk {
+			std::byte* data;
+		};
+
+		std::vector<ComponentTypeId> m_types;		// Sorted
+		ComponentMask m_mask;
+		std::vector<const ComponentInfo*> m_infos;
+		// Byte offset of each column inside a chunk; the EntityId array sits at offset 0
+		std::vector<std::size_t> m_columnOffsets;
+		std::size_t m_chunkCapacity;
+		std::size_t m_chunkBytes;
+		std::vector<Chunk> m_chunks;
+		std::size_t m_size;
+		// Archetype reached by adding or removing one type, filled in as transitions happen
+		std::unordered_map<ComponentTypeId, std::uint32_t> m_addEdges;
+		std::unordered_map<ComponentTypeId, std::uint32_t> m_removeEdges;
+
+		friend class World;
+	public:
+		Archetype(std::vector<ComponentTypeId> types);
+		~Archetype();
+
+		Archetype(const Archetype&) = delete;
+		Archetype& operator=(const Archetype&) = delete;
+
+		// Column index of typeId, or -1 when this archetype doesn't have it
+		int getColumn(ComponentTypeId typeId) const;
+
+		inline std::byte* columnData(std::size_t chunkIdx, std::size_t column) const {
+			return m_chunks[chunkIdx].data + m_columnOffsets[column];
+		}
+		inline void* componentAt(std::size_t row, std::size_t column) const {
+			return columnData(row / m_chunkCapacity, column) + (row % m_chunkCapacity) * m_infos[column]->size;
+		}
+		inline EntityId* entitiesOf(std::size_t chunkIdx) const {
+			return reinterpret_cast<EntityId*>(m_chunks[chunkIdx].data);
+		}
+		// Entities stored in chunk chunkIdx; every chunk but the last is full
+		inline std::size_t chunkSize(std::size_t chunkIdx) const {
+			return std::min(m_chunkCapacity, m_size - chunkIdx * m_chunkCapacity);
+		}
+
+		inline const std::vector<ComponentTypeId>& getTypes() const { return m_types; }
+		inline const ComponentMask& getMask() const { return m_mask; }
+		inline std::size_t size() const { return m_size; }
+		inline std::size_t getNumChunks() const { return (m_size + m_chunkCapacity - 1) / m_chunkCapacity; }
+		inline std::size_t getChunkCapacity() const { return m_chunkCapacity; }
+	};
+
+	/**
+	 * \brief Records structural changes (create, destroy, add, remove) to apply to a world later, so they can be
+	 * made while iterating a query or from a job. Component values are moved into the buffer's own pages, which
+	 * are kept for reuse after playback. Entities created through a buffer get their id immediately but only
+	 * become alive on playback.
+	 *
+	 * One buffer per thread; the buffer itself isn't synchronized.
+	 */
+	class CommandBuffer {
+	private:
+		enum class Op : std::uint8_t {
+			CREATE,
+			DESTROY,
+			ADD,
+			REMOVE
+		};
+
+		struct Command {
+			Op op;
+			EntityId entity;
+			ComponentTypeId typeId;
+			void* payload;
+		};
+
+		static constexpr std::size_t g_pageBytes = 4096;
+
+		World& m_world;
+		std::vector<Command> m_commands;
+		std::vector<std::unique_ptr<std::byte[]>> m_pages;
+		std::vector<std::unique_ptr<std::byte[]>> m_largePayloads;
+		std::size_t m_pageIdx;
+		std::size_t m_pageUsed;
+
+		void* allocPayload(std::size_t size, std::size_t alignment);
+		void destroyPayloads();
+	public:
+		explicit CommandBuffer(World& world);
+		~CommandBuffer();
+
+		CommandBuffer(const CommandBuffer&) = delete;
+		CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+		EntityId createEntity();
+		void destroyEntity(EntityId entity);
+
+		template<typename T>
+		void addComponent(EntityId entity, T&& component) {
+			using C = std::remove_cv_t<std::remove_reference_t<T>>;
+			static_assert(alignof(C) <= alignof(std::max_align_t), "Over-aligned components can't be deferred");
+			void* payload = allocPayload(sizeof(C), alignof(C));
+			new (payload) C(std::forward<T>(component));
+			m_commands.push_back({ Op::ADD, entity, componentTypeId<C>(), payload });
+		}
+
+		template<typename T>
+		void removeComponent(EntityId entity) {
+			m_commands.push_back({ Op::REMOVE, entity, componentTypeId<T>(), nullptr });
+		}
+
+		// Applies every command in recording order and empties the buffer. Commands on dead entities are skipped.
+		void playback();
+
+		inline std::size_t getNumCommands() const { return m_commands.size(); }
+		inline bool isEmpty() const { return m_commands.empty(); }
+	};
+
+	class QueryCacheBase {
+	public:
+		virtual ~QueryCacheBase() = default;
+	};
+
+	/**
+	 * \brief Matching archetypes and their column indices for one query signature. New archetypes are checked
+	 * incrementally the next time the query runs, so a query costs nothing extra once the world stops growing.
+	 */
+	template<typename... Ts>
+	class QueryCache : public QueryCacheBase {
+	public:
+		struct Match {
+			Archetype* archetype;
+			std::array<int, sizeof...(Ts)> columns;
+		};
+
+		ComponentMask mask;
+		std::vector<Match> matches;
+		std::size_t numArchetypesSeen = 0;
+
+		QueryCache() {
+			(mask.set(componentTypeId<Ts>()), ...);
+		}
+	};
+
+	/**
+	 * \brief Entities and their components. Structural changes (create, destroy, add, remove) move entities between
+	 * archetypes and must not happen while a query over this world is running; record them in a CommandBuffer
+	 * instead. Component pointers are invalidated by any structural change to the entity or its archetype.
+	 *
+	 * With an event registry, every component added or removed is published as a ComponentEvent on
+	 * "<name>ComponentAdded" / "<name>ComponentRemoved", so listeners on the existing notification system see ECS
+	 * changes without knowing about archetypes. Removals are published while the component can still be read, additions
+	 * once it is in place; listeners must not make structural changes themselves. Channels with no listeners cost one
+	 * lookup per change.
+	 */
+	class World {
+	private:
+		struct EntityRecord {
+			std::uint32_t archetype;	// g_invalidArchetype once dead
+			std::uint32_t generation;
+			std::size_t row;
+		};
+
+		// Only touched by structural changes; reserving an id never reads it, so buffers can reserve during a query
+		std::vector<EntityRecord> m_records;
+		// Destroyed slots, each with the generation its next entity gets
+		std::vector<EntityId> m_freeSlots;
+		std::uint32_t m_numSlots;
+		std::mutex m_slotMutex;
+		std::size_t m_numAlive;
+
+		std::vector<std::unique_ptr<Archetype>> m_archetypes;
+		std::map<std::vector<ComponentTypeId>, std::uint32_t> m_archetypeIds;
+		std::unordered_map<std::type_index, std::unique_ptr<QueryCacheBase>> m_queries;
+
+		Notification::NotificationRegistry* m_eventRegistry;
+		StringId m_addedChannel;
+		StringId m_removedChannel;
+
+		std::uint32_t getOrCreateArchetype(std::vector<ComponentTypeId> types);
+		std::uint32_t archetypeWith(std::uint32_t archetypeIdx, ComponentTypeId typeId);
+		std::uint32_t archetypeWithout(std::uint32_t archetypeIdx, ComponentTypeId typeId);
+		// Moves the entity to dst, carrying over every component both archetypes share. Returns the new row.
+		std::size_t moveEntity(EntityId entity, std::uint32_t dstIdx);
+		std::size_t pushRow(Archetype& archetype, EntityId entity);
+		// Destroys the row's components and swaps the last entity into it
+		void removeRow(Archetype& archetype, std::size_t row);
+		void publish(StringId channel, EntityId entity, ComponentTypeId typeId);
+		void* addComponentRaw(EntityId entity, ComponentTypeId typeId, void* src);
+		bool removeComponentRaw(EntityId entity, ComponentTypeId typeId);
+		void makeAlive(EntityId entity);
+
+		template<typename... Ts>
+		QueryCache<Ts...>& getQuery() {
+			std::unique_ptr<QueryCacheBase>& slot = m_queries[std::type_index(typeid(QueryCache<Ts...>))];
+			if (!slot) {
+				slot = std::make_unique<QueryCache<Ts...>>();
+			}
+			QueryCache<Ts...>& query = static_cast<QueryCache<Ts...>&>(*slot);
+			for (; query.numArchetypesSeen < m_archetypes.size(); ++query.numArchetypesSeen) {
+				Archetype& archetype = *m_archetypes[query.numArchetypesSeen];
+				if ((archetype.getMask() & query.mask) == query.mask) {
+					query.matches.push_back({ &archetype, { archetype.getColumn(componentTypeId<Ts>())... } });
+				}
+			}
+			return query;
+		}
+
+		template<typename... Ts, typename Fn, std::size_t... Is>
+		static void runChunk(const typename QueryCache<Ts...>::Match& match, std::size_t chunkIdx, Fn& fn, std::index_sequence<Is...>) {
+			fn(match.archetype->chunkSize(chunkIdx), match.archetype->entitiesOf(chunkIdx),
+				reinterpret_cast<std::remove_reference_t<Ts>*>(match.archetype->columnData(chunkIdx, match.columns[Is]))...);
+		}
+
+		friend class CommandBuffer;
+	public:
+		// eventRegistry may be null; name prefixes the event channel names so several worlds can share a registry
+		explicit World(Notification::NotificationRegistry* eventRegistry = nullptr, const std::string& name = "Ecs");
+		~World();
+
+		World(const World&) = delete;
+		World& operator=(const World&) = delete;
+
+		// Thread-safe, also while a query runs. The entity isn't alive until a command buffer's playback creates it.
+		EntityId reserveEntity();
+
+		EntityId createEntity();
+
+		template<typename... Ts>
+		EntityId createEntity(Ts&&... components) {
+			EntityId entity = createEntity();
+			(addComponent(entity, std::forward<Ts>(components)), ...);
+			return entity;
+		}
+
+		void destroyEntity(EntityId entity);
+		bool isAlive(EntityId entity) const;
+
+		// Replaces the value if the entity already has a T. Returns the stored component, or nullptr for a dead entity.
+		template<typename T>
+		std::remove_cv_t<std::remove_reference_t<T>>* addComponent(EntityId entity, T&& component) {
+			using C = std::remove_cv_t<std::remove_reference_t<T>>;
+			C value(std::forward<T>(component));
+			return static_cast<C*>(addComponentRaw(entity, componentTypeId<C>(), &value));
+		}
+
+		// Returns false if the entity is dead or had no T
+		template<typename T>
+		bool removeComponent(EntityId entity) {
+			return removeComponentRaw(entity, componentTypeId<T>());
+		}
+
+		template<typename T>
+		T* getComponent(EntityId entity) const {
+			if (!isAlive(entity)) {
+				return nullptr;
+			}
+			const EntityRecord& record = m_records[entity.index];
+			const Archetype& archetype = *m_archetypes[record.archetype];
+			const int column = archetype.getColumn(componentTypeId<T>());
+			return column < 0 ? nullptr : static_cast<T*>(archetype.componentAt(record.row, static_cast<std::size_t>(column)));
+		}
+
+		template<typename T>
+		bool hasComponent(EntityId entity) const {
+			return getComponent<T>(entity) != nullptr;
+		}
+
+		/**
+		 * \brief Calls fn(count, entities, T0*, T1*, ...) once per chunk holding every one of Ts, each pointer
+		 * addressing count contiguous components. Prefer this in hot loops; forEach is a thin wrapper over it.
+		 */
+		template<typename... Ts, typename Fn>
+		void forEachChunk(Fn&& fn) {
+			QueryCache<Ts...>& query = getQuery<Ts...>();
+			for (const typename QueryCache<Ts...>::Match& match : query.matches) {
+				const std::size_t numChunks = match.archetype->getNumChunks();
+				for (std::size_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx) {
+					runChunk<Ts...>(match, chunkIdx, fn, std::index_sequence_for<Ts...>{});
+				}
+			}
+		}
+
+		// Calls fn(entity, T0&, T1&, ...) for every entity holding every one of Ts. Use const Ts for read-only access.
+		template<typename... Ts, typename Fn>
+		void forEach(Fn&& fn) {
+			forEachChunk<Ts...>([&fn](std::size_t count, const EntityId* entities, std::remove_reference_t<Ts>*... columns) {
+				for (std::size_t i = 0; i < count; ++i) {
+					fn(entities[i], columns[i]...);
+				}
+			});
+		}
+
+		// Number of entities a query over Ts would visit
+		template<typename... Ts>
+		std::size_t count() {
+			std::size_t total = 0;
+			for (const typename QueryCache<Ts...>::Match& match : getQuery<Ts...>().matches) {
+				total += match.archetype->size();
+			}
+			return total;
+		}
+
+		inline std::size_t getNumAlive() const { return m_numAlive; }
+		inline std::size_t getNumArchetypes() const { return m_archetypes.size(); }
+	};
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "doobius/dbg/string_id.h"
+
+namespace Doobius {
+	class FrameProfiler;
+
+	enum class LoopPhase {
+		PRE_UPDATE,
+		FIXED_UPDATE,		// Runs zero or more times per frame, always with fixedDeltaSec
+		UPDATE,
+		POST_UPDATE,
+		NUM_PHASES
+	};
+
+	const char* loopPhaseName(LoopPhase phase);
+
+	struct FrameTime {
+		std::uint64_t frameIdx = 0;
+		// Wall time since the previous frame started, after clamping
+		double deltaSec = 0.0;
+		double fixedDeltaSec = 0.0;
+		// Fixed steps run so far, including this one inside FIXED_UPDATE
+		std::uint64_t fixedStepIdx = 0;
+		// How far into the next fixed step the frame is, in [0, 1). Use it to interpolate between simulation states.
+		double alpha = 0.0;
+		double totalSec = 0.0;
+	};
+
+	struct LoopStats {
+		std::uint64_t numFrames = 0;
+		std::uint64_t numFixedSteps = 0;
+		// Frames that had more time to catch up on than maxAccumulatedSec or maxFixedStepsPerFrame allow
+		std::uint64_t numClampedFrames = 0;
+		double targetIntervalMs = 0.0;
+		// Frame-start to frame-start interval over the recorded history
+		double meanIntervalMs = 0.0;
+		double stdDevIntervalMs = 0.0;
+		double minIntervalMs = 0.0;
+		double p50IntervalMs = 0.0;
+		double p99IntervalMs = 0.0;
+		double maxIntervalMs = 0.0;
+		// Mean and worst absolute distance from targetIntervalMs, 0 when unpaced
+		double meanAbsJitterMs = 0.0;
+		double maxAbsJitterMs = 0.0;
+	};
+
+	/**
+	 * \brief Main loop with a fixed simulation timestep and a variable-rate update. Each frame runs PRE_UPDATE, as many
+	 * FIXED_UPDATE steps as the accumulated time covers, UPDATE and POST_UPDATE, then paces itself to the target rate:
+	 * it sleeps while the remaining time is comfortably longer than a sleep is expected to take and spins the rest.
+	 * The expected sleep length is learned while running, so a coarse OS timer just means more spinning.
+	 *
+	 * Hooks run on the loop thread in registration order within their phase. Register them before run() or from a hook;
+	 * a hook registered during a frame first runs on the next one.
+	 */
+	class EngineLoop {
+	public:
+		struct EngineLoopConfig {
+			double fixedTimestepSec = 1.0 / 60.0;
+			double targetFrameRateHz = 60.0;		// 0 runs unpaced
+			double maxAccumulatedSec = 0.25;		// Longer stalls are dropped instead of simulated
+			std::uint32_t maxFixedStepsPerFrame = 8;
+			std::uint64_t maxFrames = 0;			// 0 runs until requestStop()
+			std::size_t intervalHistorySize = 1 << 16;
+		};
+
+		using HookFn = std::function<void(const FrameTime&)>;
+		using HookId = std::uint64_t;
+	private:
+		struct Hook {
+			HookId id;
+			// Interned: FrameScope and the alloc tracker keep the name pointer past the hook's lifetime
+			StringId name;
+			HookFn fn;
+			bool removed;
+		};
+
+		using Clock = std::chrono::steady_clock;
+
+		FrameProfiler* m_profiler;
+		EngineLoopConfig m_config;
+		std::array<std::vector<Hook>, static_cast<std::size_t>(LoopPhase::NUM_PHASES)> m_hooks;
+		// Hooks registered from inside a frame start with the next one, so no phase's hook list grows while it runs
+		std::vector<std::pair<LoopPhase, Hook>> m_pendingHooks;
+		HookId m_nextHookId;
+		bool m_hooksRemoved;
+		bool m_inTick;
+
+		std::atomic<bool> m_stopRequested;
+		bool m_running;
+		// Integer ns so a run of identical deltas always produces the same number of fixed steps
+		std::int64_t m_accumulatorNs;
+		FrameTime m_frameTime;
+		std::uint64_t m_numClampedFrames;
+
+		// Ring of frame-start intervals in ns for the exit report
+		std::vector<std::int64_t> m_intervalsNs;
+		std::size_t m_intervalPos;
+		std::uint64_t m_numIntervals;
+
+		// Running estimate of how long a 1ms sleep really takes (Welford mean and variance, ns)
+		double m_sleepMeanNs;
+		double m_sleepM2Ns;
+		std::uint64_t m_numSleeps;
+
+		void runPhase(LoopPhase phase);
+		void applyHookChanges();
+		void recordInterval(std::int64_t intervalNs);
+		void paceUntil(Clock::time_point deadline);
+	public:
+		// profiler may be null; when set each tick is a profiler frame with a scope per phase and per hook
+		explicit EngineLoop(FrameProfiler* profiler = nullptr);
+
+		EngineLoop(const EngineLoop&) = delete;
+		EngineLoop& operator=(const EngineLoop&) = delete;
+
+		// Resets timing state and stats, keeps hooks. Not safe to call while running.
+		void configure(const EngineLoopConfig& config);
+
+		HookId registerHook(LoopPhase phase, std::string name, HookFn fn);
+		// The hook stops being called straight away but is only freed at the start of the next frame
+		void unregisterHook(HookId id);
+
+		/**
+		 * \brief Runs one frame as if frameDeltaSec had passed since the last one, without pacing. run() calls this
+		 * with the measured wall time; call it directly to drive the loop from a test or a replay.
+		 */
+		void tick(double frameDeltaSec);
+
+		// Runs frames until maxFrames is reached or requestStop() is called. Returns the number of frames run.
+		std::uint64_t run();
+
+		// Safe to call from any thread and from a signal handler; the current frame still finishes
+		inline void requestStop() { m_stopRequested.store(true, std::memory_order_relaxed); }
+		inline bool isRunning() const { return m_running; }
+
+		inline const EngineLoopConfig& getConfig() const { return m_config; }
+		inline const FrameTime& getFrameTime() const { return m_frameTime; }
+		LoopStats getStats() const;
+	};
+}
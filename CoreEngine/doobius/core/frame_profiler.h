@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "doobius/common/alloc_tracker.h"
+#include "doobius/common/perf_clock.h"
+
+#define DOOBIUS_FRAME_SCOPE_CONCAT_IMPL(A, B) A##B
+#define DOOBIUS_FRAME_SCOPE_CONCAT(A, B) DOOBIUS_FRAME_SCOPE_CONCAT_IMPL(A, B)
+
+/**
+ * Times the enclosing scope as part of the current frame's breakdown in Root's frame profiler. NAME must outlive the
+ * frame (a string literal or a static string), only the pointer is stored.
+ */
+#define DOOBIUS_FRAME_SCOPE(NAME) Doobius::FrameScope DOOBIUS_FRAME_SCOPE_CONCAT(_doobiusFrameScope, __LINE__)(DOOBIUS_ROOT().frameProfiler, NAME)
+
+namespace Doobius {
+	struct FrameScopeRecord {
+		const char* name;
+		std::uint64_t startTicks;
+		std::uint64_t endTicks;
+		std::uint32_t depth;
+		std::uint32_t threadIdx;
+	};
+
+	struct FrameTimeStats {
+		std::size_t numFrames = 0;
+		double minMs = 0;
+		double meanMs = 0;
+		double p50Ms = 0;
+		double p99Ms = 0;
+		double maxMs = 0;
+		std::size_t numOverBudget = 0;
+		// Heap allocations from any thread during the frame, always 0 without allocation tracking
+		double meanAllocs = 0;
+		std::uint64_t maxAllocs = 0;
+	};
+
+	/**
+	 * \brief Tracks frame times between beginFrame/endFrame in a fixed-size ring and keeps the named scopes recorded
+	 * during the current frame. A frame that ends over budget has its scope breakdown written to a spike file (Chrome
+	 * trace JSON); any other frame just has its scope buffer reset.
+	 *
+	 * beginFrame/endFrame belong to one thread, scopes can be recorded from any but should close within the frame
+	 * they were opened in. A scope still being written when the frame ends is left out of the spike file and counted
+	 * as unfinished.
+	 */
+	class FrameProfiler {
+	public:
+		struct FrameProfilerConfig {
+			double frameBudgetMs = 16.6;
+			std::size_t historySize = 256;
+			std::size_t maxScopesPerFrame = 4096;
+			std::filesystem::path spikeDir;		// Spike files are skipped while this is empty
+			std::size_t maxSpikeFiles = 32;		// Later spikes are still counted but not written
+		};
+	private:
+		FrameProfilerConfig m_config;
+		std::uint64_t m_budgetTicks;
+
+		std::vector<std::uint64_t> m_frameTicks;
+		std::vector<std::uint64_t> m_frameAllocs;
+		std::uint64_t m_frameStartAllocs;
+		std::size_t m_frameHistoryPos;
+		std::uint64_t m_frameIdx;
+		std::uint64_t m_frameStartTicks;
+		bool m_inFrame;
+
+		struct ScopeSlot {
+			FrameScopeRecord record;
+			// Stored with release once record is written; endFrame only reads records it sees set with acquire
+			std::atomic<bool> ready{ false };
+		};
+		std::unique_ptr<ScopeSlot[]> m_scopes;
+		std::size_t m_maxScopes;
+		std::atomic<std::size_t> m_numScopes;
+
+		std::uint64_t m_numSpikes;
+		std::size_t m_numSpikeFilesWritten;
+		std::filesystem::path m_lastSpikePath;
+
+		void writeSpikeFile(std::uint64_t frameTicks, std::uint64_t frameAllocs, std::size_t numScopes);
+	public:
+		FrameProfiler();
+
+		// Resets history and spike counts. Not safe to call mid-frame.
+		void configure(const FrameProfilerConfig& config);
+
+		void beginFrame();
+		// Returns the frame time in ms
+		double endFrame();
+
+		inline void recordScope(const char* name, std::uint64_t startTicks, std::uint64_t endTicks, std::uint32_t depth, std::uint32_t threadIdx) {
+			// acquire pairs with beginFrame's release, so the slot's ready flag is already cleared
+			const std::size_t slot = m_numScopes.fetch_add(1, std::memory_order_acquire);
+			if (slot < m_maxScopes) {
+				m_scopes[slot].record = { name, startTicks, endTicks, depth, threadIdx };
+				m_scopes[slot].ready.store(true, std::memory_order_release);
+			}
+		}
+
+		FrameTimeStats getFrameTimeStats() const;
+
+		inline const FrameProfilerConfig& getConfig() const { return m_config; }
+		inline std::uint64_t getFrameIdx() const { return m_frameIdx; }
+		inline std::uint64_t getNumSpikes() const { return m_numSpikes; }
+		inline const std::filesystem::path& getLastSpikePath() const { return m_lastSpikePath; }
+	};
+
+	/**
+	 * \brief RAII scope recorded into a FrameProfiler when it closes. Use through DOOBIUS_FRAME_SCOPE.
+	 */
+	class FrameScope {
+	private:
+		FrameProfiler& m_profiler;
+		const char* m_name;
+		std::uint64_t m_startTicks;
+		std::uint32_t m_depth;
+
+		static std::uint32_t& threadDepth();
+		static std::uint32_t threadIdx();
+	public:
+		FrameScope(FrameProfiler& profiler, const char* name) : m_profiler(profiler), m_name(name), m_depth(threadDepth()++)
+		{
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+			Perf::AllocTracker::pushScope(m_name);
+#endif
+			m_startTicks = Perf::PerfClock::now();
+		}
+
+		~FrameScope()
+		{
+			const std::uint64_t endTicks = Perf::PerfClock::now();
+			--threadDepth();
+			m_profiler.recordScope(m_name, m_startTicks, endTicks, m_depth, threadIdx());
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+			Perf::AllocTracker::popScope();
+#endif
+		}
+
+		FrameScope(const FrameScope&) = delete;
+		FrameScope& operator=(const FrameScope&) = delete;
+	};
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Doobius {
+	class JobSystem;
+
+	// Callables handed to the job system are stored inline in the job and must fit in this many bytes
+	constexpr std::size_t g_jobPayloadSize = 88;
+
+	/**
+	 * \brief Counts jobs that haven't finished yet. Pass it to JobSystem::run for every job of a fork and
+	 * JobSystem::wait on it to join. Must outlive every job it counts.
+	 */
+	class JobCounter {
+	private:
+		std::atomic<std::int32_t> m_pending;
+
+		friend class JobSystem;
+	public:
+		JobCounter() : m_pending{ 0 } {}
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		inline bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+		inline std::int32_t getNumPending() const { return m_pending.load(std::memory_order_relaxed); }
+	};
+
+	struct alignas(64) Job {
+		using InvokeFn = void (*)(Job&);
+
+		InvokeFn invoke;
+		JobCounter* counter;
+		std::atomic<bool> inUse;
+		bool heapAllocated;
+		alignas(std::max_align_t) unsigned char payload[g_jobPayloadSize];
+	};
+
+	/**
+	 * \brief Bounded Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+	 * The owning worker pushes and pops at the bottom, every other thread steals from the top.
+	 */
+	class JobDeque {
+	private:
+		std::unique_ptr<std::atomic<Job*>[]> m_buffer;
+		std::int64_t m_mask;
+		alignas(64) std::atomic<std::int64_t> m_top;
+		alignas(64) std::atomic<std::int64_t> m_bottom;
+	public:
+		// capacity is rounded up to a power of two
+		explicit JobDeque(std::size_t capacity);
+
+		// Owner only. Returns false when the deque is full.
+		bool push(Job* job);
+		// Owner only
+		Job* pop();
+		// Any thread. Returns nullptr when empty or when it lost a race for the last job.
+		Job* steal();
+
+		inline std::int64_t sizeApprox() const {
+			return m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct JobSystemStats {
+		std::uint64_t executed = 0;
+		std::uint64_t stolen = 0;
+		// Jobs run straight away by the submitter because its deque was full
+		std::uint64_t runInline = 0;
+		// Jobs that didn't find a free pool slot (or came from a non-worker thread) and were heap allocated
+		std::uint64_t heapAllocated = 0;
+	};
+
+	/**
+	 * \brief Work-stealing job scheduler. The thread that calls start() becomes worker 0 and only runs jobs while it
+	 * waits on a counter; the other workers are background threads that sleep when there is nothing to steal.
+	 * Jobs submitted from a worker go on that worker's deque, jobs from any other thread go through a locked queue.
+	 *
+	 * Jobs are fixed-size slots taken from a per-worker pool, so submitting allocates nothing unless the pool is
+	 * exhausted. Waiting never blocks a worker: it keeps running other jobs until the counter reaches zero.
+	 */
+	class JobSystem {
+	public:
+		struct JobSystemConfig {
+			std::int32_t numWorkers = -1;			// Background threads. -1 uses hardware_concurrency() - 1
+			std::size_t dequeCapacity = 4096;
+			std::size_t jobPoolSize = 4096;			// Per worker
+		};
+	private:
+		struct alignas(64) Worker {
+			JobDeque deque;
+			std::unique_ptr<Job[]> jobPool;
+			std::size_t jobPoolSize;
+			std::size_t nextJobSlot;
+			std::atomic<std::uint64_t> executed;
+			std::atomic<std::uint64_t> stolen;
+			std::atomic<std::uint64_t> runInline;
+			std::atomic<std::uint64_t> heapAllocated;
+			std::uint32_t stealSeed;
+
+			Worker(std::size_t dequeCapacity, std::size_t poolSize);
+		};
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_injectMutex;
+		std::deque<Job*> m_injectQueue;
+		std::atomic<std::size_t> m_injectSize;
+		// Work done by threads that aren't workers, e.g. a non-worker waiting on a counter
+		std::atomic<std::uint64_t> m_externalExecuted;
+		std::atomic<std::uint64_t> m_externalHeapAllocated;
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_sleepCv;
+		std::atomic<std::int64_t> m_numQueued;
+		std::atomic<std::int32_t> m_numSleeping;
+		std::atomic<bool> m_stop;
+		bool m_running;
+
+		Job* allocJob();
+		void submit(Job* job);
+		Job* findJob(std::int32_t workerIdx);
+		void execute(Job* job);
+		void wakeOne();
+		void workerLoop(std::uint32_t workerIdx);
+
+		template<typename F>
+		static void invokeJob(Job& job) {
+			F* fn = std::launder(reinterpret_cast<F*>(job.payload));
+			(*fn)();
+			fn->~F();
+		}
+
+		template<typename F>
+		void splitRange(std::size_t begin, std::size_t end, std::size_t grainSize, F& fn, JobCounter& counter) {
+			// Hand the upper half of the range to a job and keep halving the lower half, so thieves always take the
+			// largest piece left
+			while (end - begin > grainSize) {
+				const std::size_t mid = begin + (end - begin) / 2;
+				run([this, mid, end, grainSize, &fn, &counter]() { splitRange(mid, end, grainSize, fn, counter); }, &counter);
+				end = mid;
+			}
+			fn(begin, end);
+		}
+	public:
+		JobSystem();
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+		JobSystem& operator=(JobSystem&&) = delete;
+
+		// The calling thread becomes worker 0
+		void start(const JobSystemConfig& config);
+		// Runs whatever is still queued, then joins the background threads
+		void stop();
+
+		/**
+		 * \brief Queues fn() and increments counter, if given, until it has run. fn must be no bigger than
+		 * g_jobPayloadSize; capture large state by reference. Runs fn immediately if the job system isn't started.
+		 */
+		template<typename F>
+		void run(F&& fn, JobCounter* counter = nullptr) {
+			using FnType = std::decay_t<F>;
+			static_assert(sizeof(FnType) <= g_jobPayloadSize, "Job callable is too large, capture by reference instead");
+			static_assert(alignof(FnType) <= alignof(std::max_align_t), "Job callable is over-aligned");
+			if (!m_running) {
+				fn();
+				return;
+			}
+			if (counter) {
+				counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+			}
+			Job* job = allocJob();
+			new (job->payload) FnType(std::forward<F>(fn));
+			job->invoke = &invokeJob<FnType>;
+			job->counter = counter;
+			submit(job);
+		}
+
+		// Runs other jobs on the calling thread until counter reaches zero
+		void wait(const JobCounter& counter);
+
+		/**
+		 * \brief Calls fn(rangeBegin, rangeEnd) over [begin, end) in pieces of at most grainSize elements, spread over
+		 * every worker, and returns once all of them have run.
+		 */
+		template<typename F>
+		void parallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, F&& fn) {
+			if (begin >= end) {
+				return;
+			}
+			JobCounter counter;
+			splitRange(begin, end, grainSize ? grainSize : 1, fn, counter);
+			wait(counter);
+		}
+
+		inline bool isRunning() const { return m_running; }
+		// Worker index of the calling thread, or -1 when it isn't one of this system's workers
+		std::int32_t getWorkerIdx() const;
+		// Workers including the thread that started the system
+		inline std::uint32_t getNumThreads() const { return static_cast<std::uint32_t>(m_workers.size()); }
+		JobSystemStats getStats() const;
+	};
+}
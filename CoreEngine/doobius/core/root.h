@@ -1,6 +1,11 @@
 #pragma once
 #include "doobius/dbg/custom_assert.h"
 #include "doobius/common/notif_registry.h"
+#include "doobius/core/ecs.h"
+#include "doobius/core/engine_loop.h"
+#include "doobius/core/frame_profiler.h"
+#include "doobius/core/job_system.h"
+#include "doobius/core/subsystem_registry.h"
 
 #define DOOBIUS_ROOT() Doobius::Root::get()
 
@@ -14,9 +19,21 @@ namespace Doobius {
 		bool m_setup;
 	public:
 		struct DoobiusRootConfig {
+			FrameProfiler::FrameProfilerConfig frameProfilerConfig;
+			JobSystem::JobSystemConfig jobSystemConfig;
+			EngineLoop::EngineLoopConfig engineLoopConfig;
 		};
 
 		NotificationRegistry rootNotifReg;
+		FrameProfiler frameProfiler;
+		// Started by init() on the calling thread, which becomes worker 0
+		JobSystem jobSystem;
+		// Every frame it runs is also a frameProfiler frame
+		EngineLoop engineLoop;
+		// Register subsystems before init(), which starts them on the job system in dependency order
+		SubsystemRegistry subsystems;
+		// Publishes component add/remove events on rootNotifReg's EcsComponentAdded / EcsComponentRemoved channels
+		World world;
 
 		Root(const Root&) = delete;
 		Root(Root&&) = delete;
@@ -24,6 +41,12 @@ namespace Doobius {
 		Root& operator=(Root&&) = delete;
 
 		void init(const DoobiusRootConfig& rootConfig);
+		// Shuts subsystems down in reverse dependency order, then stops the job system. Runs from ~Root if not called.
+		void shutdown();
+
+		inline void beginFrame() { frameProfiler.beginFrame(); }
+		// Returns the frame time in ms
+		inline double endFrame() { return frameProfiler.endFrame(); }
 		static Root& get();
 	};
 }
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Doobius {
+	class JobCounter;
+	class JobSystem;
+
+	struct SubsystemDesc {
+		std::string name;
+		// Names of subsystems that must finish init before this one starts and shut down only after it
+		std::vector<std::string> dependencies;
+		// Return false to fail startup; subsystems depending on this one are then skipped
+		std::function<bool()> init;
+		std::function<void()> shutdown;
+	};
+
+	struct SubsystemTiming {
+		std::string name;
+		double startMs = 0;			// Relative to the start of the phase
+		double durationMs = 0;
+		// Longest chain of init times ending with this subsystem, i.e. the earliest it could have finished
+		double criticalPathMs = 0;
+		std::uint32_t threadIdx = 0;	// Job system worker that ran it, 0 for the thread that called initAll
+		bool ok = false;
+		bool skipped = false;			// Never ran because a dependency failed
+	};
+
+	struct StartupProfile {
+		std::vector<SubsystemTiming> init;		// In start order
+		std::vector<SubsystemTiming> shutdown;	// In shutdown order
+		double initWallMs = 0;
+		// What init would have taken one subsystem at a time
+		double initSerialMs = 0;
+		double initCriticalPathMs = 0;
+		double shutdownWallMs = 0;
+	};
+
+	/**
+	 * \brief Subsystems registered with their dependencies, initialized as a DAG: every subsystem whose dependencies
+	 * are done is queued on the job system, so independent ones start in parallel. Shutdown runs on the calling thread
+	 * in the reverse of the order init actually finished in, which is always a valid reverse topological order.
+	 *
+	 * Registration is only allowed before initAll.
+	 */
+	class SubsystemRegistry {
+	private:
+		struct Node {
+			SubsystemDesc desc;
+			std::vector<std::size_t> dependencyIdxs;
+			std::vector<std::size_t> dependentIdxs;
+			std::atomic<std::int32_t> remainingDeps;
+			std::atomic<bool> skipped;		// A dependency failed or was skipped
+			SubsystemTiming timing;
+		};
+
+		std::vector<std::unique_ptr<Node>> m_nodes;
+		// Indices of initialized subsystems in the order they finished
+		std::vector<std::size_t> m_initOrder;
+		std::atomic<std::size_t> m_numInitFinished;
+		bool m_initialized;
+		StartupProfile m_profile;
+
+		void runInit(JobSystem& jobs, JobCounter& counter, std::size_t nodeIdx, std::int64_t phaseStartNs);
+	public:
+		SubsystemRegistry();
+
+		SubsystemRegistry(const SubsystemRegistry&) = delete;
+		SubsystemRegistry& operator=(const SubsystemRegistry&) = delete;
+
+		// Returns false (and logs) for an empty or duplicate name, or when called after initAll
+		bool registerSubsystem(SubsystemDesc desc);
+
+		/**
+		 * \brief Topological order of the registered subsystems, ties broken by registration order. Returns false with
+		 * an explanation in error if a dependency is missing or there is a cycle, naming every subsystem on it.
+		 */
+		bool resolveOrder(std::vector<std::string>& order, std::string& error) const;
+
+		// Runs every init, in parallel where the DAG allows. Returns false if the graph is invalid or any init failed.
+		bool initAll(JobSystem& jobs);
+		// Shuts down every subsystem whose init succeeded. Safe to call more than once.
+		void shutdownAll();
+
+		inline bool isInitialized() const { return m_initialized; }
+		inline const StartupProfile& getStartupProfile() const { return m_profile; }
+		void logStartupProfile() const;
+	};
+}
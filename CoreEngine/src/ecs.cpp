@@ -0,0 +1,385 @@
+#include "doobius/core/ecs.h"
+#include "doobius/dbg/custom_assert.h"
+#include "doobius/dbg/logging.h"
+
+#include <cstring>
+
+namespace Doobius {
+	namespace {
+		constexpr std::size_t g_chunkAlignment = 64;
+
+		inline std::size_t alignUp(std::size_t value, std::size_t alignment) {
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		inline void moveComponent(const ComponentInfo& info, void* dst, void* src) {
+			if (info.trivial) {
+				std::memcpy(dst, src, info.size);
+			}
+			else {
+				info.moveConstruct(dst, src);
+			}
+		}
+
+		inline void destroyComponent(const ComponentInfo& info, void* p) {
+			if (!info.trivial) {
+				info.destruct(p);
+			}
+		}
+	}
+
+	ComponentRegistry& ComponentRegistry::get()
+	{
+		static ComponentRegistry registry;
+		return registry;
+	}
+
+	ComponentTypeId ComponentRegistry::registerType(ComponentInfo info)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		DOOBIUS_FMT_ASSERT(m_infos.size() < g_maxComponentTypes, "Registering component %1% would go past the %2% component type limit", info.name % g_maxComponentTypes);
+		m_infos.push_back(std::make_unique<ComponentInfo>(std::move(info)));
+		return static_cast<ComponentTypeId>(m_infos.size() - 1);
+	}
+
+	const ComponentInfo& ComponentRegistry::getInfo(ComponentTypeId typeId) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return *m_infos.at(typeId);
+	}
+
+	Archetype::Archetype(std::vector<ComponentTypeId> types) : m_types(std::move(types)), m_chunkCapacity{ 0 }, m_chunkBytes{ g_ecsChunkBytes }, m_size{ 0 }
+	{
+		std::size_t bytesPerEntity = sizeof(EntityId);
+		for (ComponentTypeId typeId : m_types) {
+			m_mask.set(typeId);
+			m_infos.push_back(&ComponentRegistry::get().getInfo(typeId));
+			bytesPerEntity += m_infos.back()->size;
+		}
+
+		// Start from the unpadded estimate and back off until the aligned columns fit. Components too big for one
+		// chunk still get one entity per chunk.
+		m_chunkCapacity = std::max<std::size_t>(1, m_chunkBytes / bytesPerEntity);
+		m_columnOffsets.resize(m_types.size());
+		for (;;) {
+			std::size_t offset = sizeof(EntityId) * m_chunkCapacity;
+			for (std::size_t column = 0; column < m_types.size(); ++column) {
+				offset = alignUp(offset, std::max(m_infos[column]->alignment, alignof(EntityId)));
+				m_columnOffsets[column] = offset;
+				offset += m_infos[column]->size * m_chunkCapacity;
+			}
+			if (offset <= m_chunkBytes) {
+				break;
+			}
+			if (m_chunkCapacity == 1) {
+				m_chunkBytes = alignUp(offset, g_chunkAlignment);
+				break;
+			}
+			--m_chunkCapacity;
+		}
+	}
+
+	Archetype::~Archetype()
+	{
+		for (std::size_t row = 0; row < m_size; ++row) {
+			for (std::size_t column = 0; column < m_types.size(); ++column) {
+				destroyComponent(*m_infos[column], componentAt(row, column));
+			}
+		}
+		for (Chunk& chunk : m_chunks) {
+			::operator delete(chunk.data, std::align_val_t{ g_chunkAlignment });
+		}
+	}
+
+	int Archetype::getColumn(ComponentTypeId typeId) const
+	{
+		// Archetypes rarely have more than a handful of types, a linear scan beats anything cleverer here
+		for (std::size_t column = 0; column < m_types.size(); ++column) {
+			if (m_types[column] == typeId) {
+				return static_cast<int>(column);
+			}
+		}
+		return -1;
+	}
+
+	CommandBuffer::CommandBuffer(World& world) : m_world(world), m_pageIdx{ 0 }, m_pageUsed{ 0 }
+	{
+	}
+
+	CommandBuffer::~CommandBuffer()
+	{
+		destroyPayloads();
+	}
+
+	void* CommandBuffer::allocPayload(std::size_t size, std::size_t alignment)
+	{
+		if (size > g_pageBytes) {
+			m_largePayloads.push_back(std::make_unique<std::byte[]>(size));
+			return m_largePayloads.back().get();
+		}
+		m_pageUsed = alignUp(m_pageUsed, alignment);
+		if (m_pageIdx >= m_pages.size() || m_pageUsed + size > g_pageBytes) {
+			if (m_pageIdx < m_pages.size()) {
+				++m_pageIdx;
+			}
+			if (m_pageIdx == m_pages.size()) {
+				m_pages.push_back(std::make_unique<std::byte[]>(g_pageBytes));
+			}
+			m_pageUsed = 0;
+		}
+		void* payload = m_pages[m_pageIdx].get() + m_pageUsed;
+		m_pageUsed += size;
+		return payload;
+	}
+
+	void CommandBuffer::destroyPayloads()
+	{
+		for (const Command& command : m_commands) {
+			if (command.op == Op::ADD) {
+				destroyComponent(ComponentRegistry::get().getInfo(command.typeId), command.payload);
+			}
+		}
+		m_commands.clear();
+		m_largePayloads.clear();
+		m_pageIdx = 0;
+		m_pageUsed = 0;
+	}
+
+	EntityId CommandBuffer::createEntity()
+	{
+		EntityId entity = m_world.reserveEntity();
+		m_commands.push_back({ Op::CREATE, entity, 0, nullptr });
+		return entity;
+	}
+
+	void CommandBuffer::destroyEntity(EntityId entity)
+	{
+		m_commands.push_back({ Op::DESTROY, entity, 0, nullptr });
+	}
+
+	void CommandBuffer::playback()
+	{
+		for (const Command& command : m_commands) {
+			switch (command.op) {
+			case Op::CREATE:
+				m_world.makeAlive(command.entity);
+				break;
+			case Op::DESTROY:
+				m_world.destroyEntity(command.entity);
+				break;
+			case Op::ADD:
+				m_world.addComponentRaw(command.entity, command.typeId, command.payload);
+				break;
+			case Op::REMOVE:
+				m_world.removeComponentRaw(command.entity, command.typeId);
+				break;
+			}
+		}
+		// The payloads were moved from, but still need destroying
+		destroyPayloads();
+	}
+
+	World::World(Notification::NotificationRegistry* eventRegistry, const std::string& name) :
+		m_numSlots{ 0 }, m_numAlive{ 0 }, m_eventRegistry{ eventRegistry }, m_addedChannel{ internString(name + "ComponentAdded") }, m_removedChannel{ internString(name + "ComponentRemoved") }
+	{
+		// Archetype 0 holds entities without components
+		getOrCreateArchetype({});
+		if (m_eventRegistry) {
+			m_eventRegistry->createNotificationChannel(m_addedChannel);
+			m_eventRegistry->createNotificationChannel(m_removedChannel);
+		}
+	}
+
+	World::~World() = default;
+
+	std::uint32_t World::getOrCreateArchetype(std::vector<ComponentTypeId> types)
+	{
+		std::map<std::vector<ComponentTypeId>, std::uint32_t>::iterator it = m_archetypeIds.find(types);
+		if (it != m_archetypeIds.end()) {
+			return it->second;
+		}
+		const std::uint32_t archetypeIdx = static_cast<std::uint32_t>(m_archetypes.size());
+		m_archetypes.push_back(std::make_unique<Archetype>(types));
+		m_archetypeIds.emplace(std::move(types), archetypeIdx);
+		return archetypeIdx;
+	}
+
+	std::uint32_t World::archetypeWith(std::uint32_t archetypeIdx, ComponentTypeId typeId)
+	{
+		std::unordered_map<ComponentTypeId, std::uint32_t>::iterator edge = m_archetypes[archetypeIdx]->m_addEdges.find(typeId);
+		if (edge != m_archetypes[archetypeIdx]->m_addEdges.end()) {
+			return edge->second;
+		}
+		std::vector<ComponentTypeId> types = m_archetypes[archetypeIdx]->getTypes();
+		types.insert(std::upper_bound(types.begin(), types.end(), typeId), typeId);
+		const std::uint32_t dstIdx = getOrCreateArchetype(std::move(types));
+		m_archetypes[archetypeIdx]->m_addEdges.emplace(typeId, dstIdx);
+		m_archetypes[dstIdx]->m_removeEdges.emplace(typeId, archetypeIdx);
+		return dstIdx;
+	}
+
+	std::uint32_t World::archetypeWithout(std::uint32_t archetypeIdx, ComponentTypeId typeId)
+	{
+		std::unordered_map<ComponentTypeId, std::uint32_t>::iterator edge = m_archetypes[archetypeIdx]->m_removeEdges.find(typeId);
+		if (edge != m_archetypes[archetypeIdx]->m_removeEdges.end()) {
+			return edge->second;
+		}
+		std::vector<ComponentTypeId> types = m_archetypes[archetypeIdx]->getTypes();
+		types.erase(std::find(types.begin(), types.end(), typeId));
+		const std::uint32_t dstIdx = getOrCreateArchetype(std::move(types));
+		m_archetypes[archetypeIdx]->m_removeEdges.emplace(typeId, dstIdx);
+		m_archetypes[dstIdx]->m_addEdges.emplace(typeId, archetypeIdx);
+		return dstIdx;
+	}
+
+	std::size_t World::pushRow(Archetype& archetype, EntityId entity)
+	{
+		const std::size_t row = archetype.m_size;
+		const std::size_t chunkIdx = row / archetype.m_chunkCapacity;
+		// Chunks are kept when an archetype shrinks, so only growing past every chunk allocates
+		if (chunkIdx == archetype.m_chunks.size()) {
+			archetype.m_chunks.push_back({ static_cast<std::byte*>(::operator new(archetype.m_chunkBytes, std::align_val_t{ g_chunkAlignment })) });
+		}
+		archetype.entitiesOf(chunkIdx)[row % archetype.m_chunkCapacity] = entity;
+		++archetype.m_size;
+		return row;
+	}
+
+	void World::removeRow(Archetype& archetype, std::size_t row)
+	{
+		const std::size_t last = archetype.m_size - 1;
+		for (std::size_t column = 0; column < archetype.m_types.size(); ++column) {
+			const ComponentInfo& info = *archetype.m_infos[column];
+			void* component = archetype.componentAt(row, column);
+			destroyComponent(info, component);
+			if (row != last) {
+				void* lastComponent = archetype.componentAt(last, column);
+				moveComponent(info, component, lastComponent);
+				destroyComponent(info, lastComponent);
+			}
+		}
+		if (row != last) {
+			const EntityId moved = archetype.entitiesOf(last / archetype.m_chunkCapacity)[last % archetype.m_chunkCapacity];
+			archetype.entitiesOf(row / archetype.m_chunkCapacity)[row % archetype.m_chunkCapacity] = moved;
+			m_records[moved.index].row = row;
+		}
+		--archetype.m_size;
+	}
+
+	std::size_t World::moveEntity(EntityId entity, std::uint32_t dstIdx)
+	{
+		EntityRecord& record = m_records[entity.index];
+		Archetype& src = *m_archetypes[record.archetype];
+		Archetype& dst = *m_archetypes[dstIdx];
+		const std::size_t srcRow = record.row;
+		const std::size_t dstRow = pushRow(dst, entity);
+		for (std::size_t column = 0; column < dst.m_types.size(); ++column) {
+			const int srcColumn = src.getColumn(dst.m_types[column]);
+			if (srcColumn >= 0) {
+				moveComponent(*dst.m_infos[column], dst.componentAt(dstRow, column), src.componentAt(srcRow, static_cast<std::size_t>(srcColumn)));
+			}
+		}
+		// Destroys the moved-from components along with any the destination doesn't have
+		removeRow(src, srcRow);
+		record.archetype = dstIdx;
+		record.row = dstRow;
+		return dstRow;
+	}
+
+	void World::publish(StringId channel, EntityId entity, ComponentTypeId typeId)
+	{
+		if (!m_eventRegistry || m_eventRegistry->getNumCbsListeningTo(channel) == 0) {
+			return;
+		}
+		m_eventRegistry->updateChannel(channel, ComponentEvent{ entity, typeId, ComponentRegistry::get().getInfo(typeId).name.c_str() });
+	}
+
+	EntityId World::reserveEntity()
+	{
+		std::lock_guard<std::mutex> lock(m_slotMutex);
+		if (!m_freeSlots.empty()) {
+			const EntityId entity = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			return entity;
+		}
+		return { m_numSlots++, 0 };
+	}
+
+	void World::makeAlive(EntityId entity)
+	{
+		if (entity.index >= m_records.size()) {
+			m_records.resize(entity.index + 1, { g_invalidArchetype, 0, 0 });
+		}
+		EntityRecord& record = m_records[entity.index];
+		DOOBIUS_DASSERT(record.archetype == g_invalidArchetype, "Entity slot was handed out twice");
+		record.generation = entity.generation;
+		record.archetype = 0;
+		record.row = pushRow(*m_archetypes[0], entity);
+		++m_numAlive;
+	}
+
+	EntityId World::createEntity()
+	{
+		const EntityId entity = reserveEntity();
+		makeAlive(entity);
+		return entity;
+	}
+
+	void World::destroyEntity(EntityId entity)
+	{
+		if (!isAlive(entity)) {
+			return;
+		}
+		EntityRecord& record = m_records[entity.index];
+		Archetype& archetype = *m_archetypes[record.archetype];
+		for (ComponentTypeId typeId : archetype.getTypes()) {
+			publish(m_removedChannel, entity, typeId);
+		}
+		removeRow(archetype, record.row);
+		record.archetype = g_invalidArchetype;
+		--m_numAlive;
+
+		std::lock_guard<std::mutex> lock(m_slotMutex);
+		m_freeSlots.push_back({ entity.index, entity.generation + 1 });
+	}
+
+	bool World::isAlive(EntityId entity) const
+	{
+		return entity.index < m_records.size() && m_records[entity.index].generation == entity.generation
+			&& m_records[entity.index].archetype != g_invalidArchetype;
+	}
+
+	void* World::addComponentRaw(EntityId entity, ComponentTypeId typeId, void* src)
+	{
+		if (!isAlive(entity)) {
+			return nullptr;
+		}
+		EntityRecord& record = m_records[entity.index];
+		const ComponentInfo& info = ComponentRegistry::get().getInfo(typeId);
+		const int column = m_archetypes[record.archetype]->getColumn(typeId);
+		if (column >= 0) {
+			void* existing = m_archetypes[record.archetype]->componentAt(record.row, static_cast<std::size_t>(column));
+			destroyComponent(info, existing);
+			moveComponent(info, existing, src);
+			return existing;
+		}
+
+		const std::uint32_t dstIdx = archetypeWith(record.archetype, typeId);
+		const std::size_t row = moveEntity(entity, dstIdx);
+		Archetype& dst = *m_archetypes[dstIdx];
+		void* component = dst.componentAt(row, static_cast<std::size_t>(dst.getColumn(typeId)));
+		moveComponent(info, component, src);
+		publish(m_addedChannel, entity, typeId);
+		return component;
+	}
+
+	bool World::removeComponentRaw(EntityId entity, ComponentTypeId typeId)
+	{
+		if (!isAlive(entity) || m_archetypes[m_records[entity.index].archetype]->getColumn(typeId) < 0) {
+			return false;
+		}
+		publish(m_removedChannel, entity, typeId);
+		moveEntity(entity, archetypeWithout(m_records[entity.index].archetype, typeId));
+		return true;
+	}
+}
@@ -0,0 +1,301 @@
+#include "doobius/core/engine_loop.h"
+#include "doobius/core/frame_profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace Doobius {
+	namespace {
+		// requestStop() is called from signal handlers
+		static_assert(std::atomic<bool>::is_always_lock_free, "EngineLoop's stop flag must be lock free");
+
+		constexpr std::chrono::milliseconds g_paceSleepStep{ 1 };
+
+		inline std::int64_t secToNs(double sec) {
+			return static_cast<std::int64_t>(std::llround(sec * 1e9));
+		}
+	}
+
+	const char* loopPhaseName(LoopPhase phase)
+	{
+		switch (phase) {
+		case LoopPhase::PRE_UPDATE:
+			return "PreUpdate";
+		case LoopPhase::FIXED_UPDATE:
+			return "FixedUpdate";
+		case LoopPhase::UPDATE:
+			return "Update";
+		case LoopPhase::POST_UPDATE:
+			return "PostUpdate";
+		default:
+			return "Unknown";
+		}
+	}
+
+	EngineLoop::EngineLoop(FrameProfiler* profiler) : m_profiler(profiler), m_nextHookId{ 1 }, m_hooksRemoved{ false }, m_inTick{ false }, m_stopRequested{ false },
+		m_running{ false }, m_accumulatorNs{ 0 }, m_numClampedFrames{ 0 }, m_intervalPos{ 0 }, m_numIntervals{ 0 }, m_sleepMeanNs{ 0 },
+		m_sleepM2Ns{ 0 }, m_numSleeps{ 0 }
+	{
+		configure(EngineLoopConfig{});
+	}
+
+	void EngineLoop::configure(const EngineLoopConfig& config)
+	{
+		m_config = config;
+		m_config.fixedTimestepSec = std::max(m_config.fixedTimestepSec, 1e-6);
+		m_accumulatorNs = 0;
+		m_frameTime = FrameTime{};
+		m_frameTime.fixedDeltaSec = m_config.fixedTimestepSec;
+		m_numClampedFrames = 0;
+		m_intervalsNs.assign(std::max<std::size_t>(1, m_config.intervalHistorySize), 0);
+		m_intervalPos = 0;
+		m_numIntervals = 0;
+		// Assume sleeps are accurate until measured otherwise
+		m_sleepMeanNs = static_cast<double>(std::chrono::nanoseconds(g_paceSleepStep).count());
+		m_sleepM2Ns = 0;
+		m_numSleeps = 0;
+	}
+
+	EngineLoop::HookId EngineLoop::registerHook(LoopPhase phase, std::string name, HookFn fn)
+	{
+		const HookId id = m_nextHookId++;
+		Hook hook{ id, internString(name), std::move(fn), false };
+		if (m_inTick) {
+			m_pendingHooks.emplace_back(phase, std::move(hook));
+		}
+		else {
+			m_hooks[static_cast<std::size_t>(phase)].push_back(std::move(hook));
+		}
+		return id;
+	}
+
+	void EngineLoop::unregisterHook(HookId id)
+	{
+		for (std::pair<LoopPhase, Hook>& pending : m_pendingHooks) {
+			if (pending.second.id == id) {
+				pending.second.removed = true;
+				m_hooksRemoved = true;
+				return;
+			}
+		}
+		for (std::vector<Hook>& phaseHooks : m_hooks) {
+			for (Hook& hook : phaseHooks) {
+				if (hook.id == id) {
+					hook.removed = true;
+					m_hooksRemoved = true;
+					return;
+				}
+			}
+		}
+	}
+
+	void EngineLoop::applyHookChanges()
+	{
+		for (std::pair<LoopPhase, Hook>& pending : m_pendingHooks) {
+			m_hooks[static_cast<std::size_t>(pending.first)].push_back(std::move(pending.second));
+		}
+		m_pendingHooks.clear();
+		for (std::vector<Hook>& phaseHooks : m_hooks) {
+			phaseHooks.erase(std::remove_if(phaseHooks.begin(), phaseHooks.end(), [](const Hook& hook) { return hook.removed; }), phaseHooks.end());
+		}
+		m_hooksRemoved = false;
+	}
+
+	void EngineLoop::runPhase(LoopPhase phase)
+	{
+		std::vector<Hook>& phaseHooks = m_hooks[static_cast<std::size_t>(phase)];
+		if (!m_profiler) {
+			for (Hook& hook : phaseHooks) {
+				if (!hook.removed) {
+					hook.fn(m_frameTime);
+				}
+			}
+			return;
+		}
+
+		FrameScope phaseScope(*m_profiler, loopPhaseName(phase));
+		for (Hook& hook : phaseHooks) {
+			if (!hook.removed) {
+				// The interner never frees, so the name outlives the hook as FrameScope and the alloc tracker require
+				FrameScope hookScope(*m_profiler, hook.name.c_str());
+				hook.fn(m_frameTime);
+			}
+		}
+	}
+
+	void EngineLoop::tick(double frameDeltaSec)
+	{
+		if (m_hooksRemoved || !m_pendingHooks.empty()) {
+			applyHookChanges();
+		}
+		m_inTick = true;
+		if (m_profiler) {
+			m_profiler->beginFrame();
+		}
+
+		bool clamped = false;
+		frameDeltaSec = std::max(frameDeltaSec, 0.0);
+		if (frameDeltaSec > m_config.maxAccumulatedSec) {
+			frameDeltaSec = m_config.maxAccumulatedSec;
+			clamped = true;
+		}
+		m_frameTime.deltaSec = frameDeltaSec;
+		m_frameTime.fixedDeltaSec = m_config.fixedTimestepSec;
+		m_frameTime.totalSec += frameDeltaSec;
+
+		runPhase(LoopPhase::PRE_UPDATE);
+
+		const std::int64_t fixedNs = secToNs(m_config.fixedTimestepSec);
+		m_accumulatorNs += secToNs(frameDeltaSec);
+		for (std::uint32_t step = 0; step < m_config.maxFixedStepsPerFrame && m_accumulatorNs >= fixedNs; ++step) {
+			m_accumulatorNs -= fixedNs;
+			runPhase(LoopPhase::FIXED_UPDATE);
+			++m_frameTime.fixedStepIdx;
+		}
+		if (m_accumulatorNs >= fixedNs) {
+			// Too far behind to catch up this frame, drop whole steps rather than spiral
+			m_accumulatorNs %= fixedNs;
+			clamped = true;
+		}
+		m_frameTime.alpha = static_cast<double>(m_accumulatorNs) / static_cast<double>(fixedNs);
+
+		runPhase(LoopPhase::UPDATE);
+		runPhase(LoopPhase::POST_UPDATE);
+
+		if (m_profiler) {
+			m_profiler->endFrame();
+		}
+		m_inTick = false;
+		m_numClampedFrames += clamped ? 1 : 0;
+		++m_frameTime.frameIdx;
+	}
+
+	void EngineLoop::recordInterval(std::int64_t intervalNs)
+	{
+		m_intervalsNs[m_intervalPos] = intervalNs;
+		m_intervalPos = (m_intervalPos + 1) % m_intervalsNs.size();
+		++m_numIntervals;
+	}
+
+	void EngineLoop::paceUntil(Clock::time_point deadline)
+	{
+		for (;;) {
+			const std::int64_t remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+			if (remainingNs <= 0) {
+				return;
+			}
+			// Only sleep when even a pessimistic sleep (mean + 1 stddev) still wakes up before the deadline
+			const double sleepEstimateNs = m_sleepMeanNs + (m_numSleeps > 1 ? std::sqrt(m_sleepM2Ns / static_cast<double>(m_numSleeps - 1)) : 0.0);
+			if (static_cast<double>(remainingNs) <= sleepEstimateNs) {
+				break;
+			}
+			const Clock::time_point sleepStart = Clock::now();
+			std::this_thread::sleep_for(g_paceSleepStep);
+			const double sleptNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sleepStart).count());
+			++m_numSleeps;
+			const double delta = sleptNs - m_sleepMeanNs;
+			m_sleepMeanNs += delta / static_cast<double>(m_numSleeps);
+			m_sleepM2Ns += delta * (sleptNs - m_sleepMeanNs);
+		}
+		while (Clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::uint64_t EngineLoop::run()
+	{
+		BOOST_LOG_NAMED_SCOPE("EngineLoop");
+		if (m_running) {
+			DOOBIUS_CLOG(warning) << "EngineLoop::run called while the loop is already running";
+			return 0;
+		}
+		m_running = true;
+
+		const bool paced = m_config.targetFrameRateHz > 0.0;
+		const Clock::duration targetInterval = paced
+			? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_config.targetFrameRateHz))
+			: Clock::duration::zero();
+		DOOBIUS_CLOG(info) << "Engine loop starting, fixed step " << m_config.fixedTimestepSec * 1e3 << "ms, target "
+			<< (paced ? std::to_string(m_config.targetFrameRateHz) + "Hz" : std::string("unpaced"));
+
+		std::uint64_t framesRun = 0;
+		Clock::time_point prevFrameStart = Clock::now();
+		Clock::time_point deadline = prevFrameStart;
+		// The first frame behaves as if exactly one interval had passed
+		double frameDeltaSec = paced ? std::chrono::duration<double>(targetInterval).count() : m_config.fixedTimestepSec;
+		for (;;) {
+			tick(frameDeltaSec);
+			++framesRun;
+			if ((m_config.maxFrames && framesRun >= m_config.maxFrames) || m_stopRequested.load(std::memory_order_relaxed)) {
+				break;
+			}
+
+			if (paced) {
+				deadline += targetInterval;
+				const Clock::time_point now = Clock::now();
+				if (deadline < now) {
+					// Missed the slot entirely; start a new cadence instead of running frames back to back to catch up
+					deadline = now;
+				}
+				paceUntil(deadline);
+			}
+
+			const Clock::time_point frameStart = Clock::now();
+			const std::int64_t intervalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(frameStart - prevFrameStart).count();
+			recordInterval(intervalNs);
+			frameDeltaSec = static_cast<double>(intervalNs) / 1e9;
+			prevFrameStart = frameStart;
+		}
+
+		m_stopRequested.store(false, std::memory_order_relaxed);
+		m_running = false;
+		DOOBIUS_CLOG(info) << "Engine loop stopped after " << framesRun << " frames";
+		return framesRun;
+	}
+
+	LoopStats EngineLoop::getStats() const
+	{
+		LoopStats stats;
+		stats.numFrames = m_frameTime.frameIdx;
+		stats.numFixedSteps = m_frameTime.fixedStepIdx;
+		stats.numClampedFrames = m_numClampedFrames;
+		stats.targetIntervalMs = m_config.targetFrameRateHz > 0.0 ? 1e3 / m_config.targetFrameRateHz : 0.0;
+
+		const std::size_t numIntervals = static_cast<std::size_t>(std::min<std::uint64_t>(m_numIntervals, m_intervalsNs.size()));
+		if (numIntervals == 0) {
+			return stats;
+		}
+		std::vector<std::int64_t> intervals(m_intervalsNs.begin(), m_intervalsNs.begin() + numIntervals);
+		std::sort(intervals.begin(), intervals.end());
+
+		auto toMs = [](double ns) { return ns / 1e6; };
+		double sumNs = 0.0;
+		for (std::int64_t ns : intervals) {
+			sumNs += static_cast<double>(ns);
+		}
+		const double meanNs = sumNs / static_cast<double>(numIntervals);
+		double sqDevNs = 0.0;
+		double sumAbsJitterNs = 0.0;
+		double maxAbsJitterNs = 0.0;
+		const double targetNs = stats.targetIntervalMs * 1e6;
+		for (std::int64_t ns : intervals) {
+			sqDevNs += (static_cast<double>(ns) - meanNs) * (static_cast<double>(ns) - meanNs);
+			if (targetNs > 0.0) {
+				const double jitterNs = std::abs(static_cast<double>(ns) - targetNs);
+				sumAbsJitterNs += jitterNs;
+				maxAbsJitterNs = std::max(maxAbsJitterNs, jitterNs);
+			}
+		}
+		stats.meanIntervalMs = toMs(meanNs);
+		stats.stdDevIntervalMs = toMs(std::sqrt(sqDevNs / static_cast<double>(numIntervals)));
+		stats.minIntervalMs = toMs(static_cast<double>(intervals.front()));
+		stats.p50IntervalMs = toMs(static_cast<double>(intervals[(numIntervals - 1) / 2]));
+		stats.p99IntervalMs = toMs(static_cast<double>(intervals[(numIntervals - 1) * 99 / 100]));
+		stats.maxIntervalMs = toMs(static_cast<double>(intervals.back()));
+		stats.meanAbsJitterMs = toMs(sumAbsJitterNs / static_cast<double>(numIntervals));
+		stats.maxAbsJitterMs = toMs(maxAbsJitterNs);
+		return stats;
+	}
+}
@@ -0,0 +1,177 @@
+#include "doobius/core/frame_profiler.h"
+#include "doobius/common/profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Doobius {
+	namespace {
+		std::atomic<std::uint32_t> g_nextFrameThreadIdx{ 1 };
+	}
+
+	std::uint32_t& FrameScope::threadDepth()
+	{
+		thread_local std::uint32_t t_depth = 0;
+		return t_depth;
+	}
+
+	std::uint32_t FrameScope::threadIdx()
+	{
+		thread_local std::uint32_t t_threadIdx = g_nextFrameThreadIdx.fetch_add(1, std::memory_order_relaxed);
+		return t_threadIdx;
+	}
+
+	FrameProfiler::FrameProfiler() : m_budgetTicks{ 0 }, m_frameStartAllocs{ 0 }, m_frameHistoryPos{ 0 }, m_frameIdx{ 0 }, m_frameStartTicks{ 0 },
+		m_inFrame{ false }, m_maxScopes{ 0 }, m_numScopes{ 0 }, m_numSpikes{ 0 }, m_numSpikeFilesWritten{ 0 }
+	{
+		configure(FrameProfilerConfig{});
+	}
+
+	void FrameProfiler::configure(const FrameProfilerConfig& config)
+	{
+		m_config = config;
+		m_budgetTicks = Perf::PerfClock::get().nsToTicks(m_config.frameBudgetMs * 1e6);
+		m_frameTicks.assign(std::max<std::size_t>(1, m_config.historySize), 0);
+		m_frameAllocs.assign(m_frameTicks.size(), 0);
+		m_frameHistoryPos = 0;
+		m_frameIdx = 0;
+		m_maxScopes = m_config.maxScopesPerFrame;
+		m_scopes = std::make_unique<ScopeSlot[]>(m_maxScopes);
+		m_numScopes.store(0, std::memory_order_relaxed);
+		m_numSpikes = 0;
+		m_numSpikeFilesWritten = 0;
+		m_lastSpikePath.clear();
+		m_inFrame = false;
+	}
+
+	void FrameProfiler::beginFrame()
+	{
+		if (m_inFrame) {
+			DOOBIUS_CLOG(warning) << "beginFrame called twice without endFrame, restarting frame " << m_frameIdx;
+		}
+		const std::size_t numUsed = std::min(m_numScopes.load(std::memory_order_relaxed), m_maxScopes);
+		for (std::size_t i = 0; i < numUsed; ++i) {
+			m_scopes[i].ready.store(false, std::memory_order_relaxed);
+		}
+		m_numScopes.store(0, std::memory_order_release);
+		m_inFrame = true;
+		m_frameStartAllocs = Perf::AllocTracker::get().getGlobalStats().allocs;
+		m_frameStartTicks = Perf::PerfClock::now();
+	}
+
+	double FrameProfiler::endFrame()
+	{
+		const std::uint64_t frameTicks = Perf::PerfClock::nowOrdered() - m_frameStartTicks;
+		if (!m_inFrame) {
+			DOOBIUS_CLOG(warning) << "endFrame called without beginFrame";
+			return 0.0;
+		}
+		m_inFrame = false;
+
+		const std::uint64_t frameAllocs = Perf::AllocTracker::get().getGlobalStats().allocs - m_frameStartAllocs;
+		m_frameTicks[m_frameHistoryPos] = frameTicks;
+		m_frameAllocs[m_frameHistoryPos] = frameAllocs;
+		m_frameHistoryPos = (m_frameHistoryPos + 1) % m_frameTicks.size();
+		++m_frameIdx;
+
+		if (frameTicks > m_budgetTicks) {
+			++m_numSpikes;
+			const std::size_t numScopes = m_numScopes.load(std::memory_order_relaxed);
+			if (!m_config.spikeDir.empty() && m_numSpikeFilesWritten < m_config.maxSpikeFiles) {
+				writeSpikeFile(frameTicks, frameAllocs, numScopes);
+			}
+		}
+		return Perf::PerfClock::get().ticksToNs(frameTicks) / 1e6;
+	}
+
+	void FrameProfiler::writeSpikeFile(std::uint64_t frameTicks, std::uint64_t frameAllocs, std::size_t numScopes)
+	{
+		BOOST_LOG_NAMED_SCOPE("FrameProfiler");
+		const Perf::PerfClock& clock = Perf::PerfClock::get();
+		const std::uint64_t frameIdx = m_frameIdx - 1;
+		const double frameMs = clock.ticksToNs(frameTicks) / 1e6;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_config.spikeDir, ec);
+		std::filesystem::path spikePath = m_config.spikeDir / ("spike_frame" + std::to_string(frameIdx) + ".json");
+		std::ofstream spikeFile(spikePath);
+		if (spikeFile.fail()) {
+			DOOBIUS_CLOG(warning) << "Frame " << frameIdx << " took " << frameMs << "ms but " << spikePath.string() << " couldn't be opened";
+			return;
+		}
+
+		const std::size_t numKept = std::min(numScopes, m_maxScopes);
+		std::vector<FrameScopeRecord> scopes;
+		scopes.reserve(numKept);
+		for (std::size_t i = 0; i < numKept; ++i) {
+			if (m_scopes[i].ready.load(std::memory_order_acquire)) {
+				scopes.push_back(m_scopes[i].record);
+			}
+		}
+		std::sort(scopes.begin(), scopes.end(), [](const FrameScopeRecord& lhs, const FrameScopeRecord& rhs) {
+			return lhs.startTicks < rhs.startTicks || (lhs.startTicks == rhs.startTicks && lhs.depth < rhs.depth);
+		});
+
+		// Chrome trace "X" (complete) events, so the breakdown opens in the same viewer as the profiler's traces
+		spikeFile.precision(3);
+		spikeFile << std::fixed;
+		spikeFile << "{\"frame\":" << frameIdx << ",\"frame_ms\":" << frameMs << ",\"budget_ms\":" << m_config.frameBudgetMs
+			<< ",\"allocs\":" << frameAllocs << ",\"num_scopes\":" << numScopes << ",\"dropped_scopes\":" << (numScopes - numKept)
+			<< ",\"unfinished_scopes\":" << (numKept - scopes.size())
+			<< ",\n\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0.000,\"dur\":"
+			<< frameMs * 1e3 << '}';
+		for (const FrameScopeRecord& scope : scopes) {
+			// Scopes from other threads may have started before beginFrame
+			const double startUs = (static_cast<double>(scope.startTicks) - static_cast<double>(m_frameStartTicks)) * clock.ticksToNs(1) / 1e3;
+			spikeFile << ",\n{\"name\":\"";
+			Perf::writeJsonEscaped(spikeFile, scope.name);
+			spikeFile << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << scope.threadIdx << ",\"ts\":" << startUs
+				<< ",\"dur\":" << clock.ticksToNs(scope.endTicks - scope.startTicks) / 1e3 << ",\"args\":{\"depth\":" << scope.depth << "}}";
+		}
+		spikeFile << "\n]}\n";
+
+		++m_numSpikeFilesWritten;
+		m_lastSpikePath = spikePath;
+		DOOBIUS_CLOG(warning) << "Frame " << frameIdx << " took " << frameMs << "ms (budget " << m_config.frameBudgetMs
+			<< "ms), scope breakdown saved to " << spikePath.string();
+	}
+
+	FrameTimeStats FrameProfiler::getFrameTimeStats() const
+	{
+		FrameTimeStats stats;
+		stats.numFrames = static_cast<std::size_t>(std::min<std::uint64_t>(m_frameIdx, m_frameTicks.size()));
+		if (stats.numFrames == 0) {
+			return stats;
+		}
+
+		std::vector<std::uint64_t> frames;
+		if (m_frameIdx < m_frameTicks.size()) {
+			frames.assign(m_frameTicks.begin(), m_frameTicks.begin() + stats.numFrames);
+		}
+		else {
+			frames = m_frameTicks;
+		}
+		std::sort(frames.begin(), frames.end());
+
+		const Perf::PerfClock& clock = Perf::PerfClock::get();
+		auto toMs = [&clock](std::uint64_t ticks) { return clock.ticksToNs(ticks) / 1e6; };
+		std::uint64_t sumTicks = 0;
+		for (std::uint64_t ticks : frames) {
+			sumTicks += ticks;
+			stats.numOverBudget += ticks > m_budgetTicks ? 1 : 0;
+		}
+		std::uint64_t sumAllocs = 0;
+		for (std::size_t i = 0; i < stats.numFrames; ++i) {
+			sumAllocs += m_frameAllocs[i];
+			stats.maxAllocs = std::max(stats.maxAllocs, m_frameAllocs[i]);
+		}
+		stats.meanAllocs = static_cast<double>(sumAllocs) / static_cast<double>(stats.numFrames);
+		stats.minMs = toMs(frames.front());
+		stats.meanMs = toMs(sumTicks) / static_cast<double>(frames.size());
+		stats.p50Ms = toMs(frames[(frames.size() - 1) / 2]);
+		stats.p99Ms = toMs(frames[(frames.size() - 1) * 99 / 100]);
+		stats.maxMs = toMs(frames.back());
+		return stats;
+	}
+}
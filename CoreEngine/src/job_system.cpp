@@ -0,0 +1,337 @@
+#include "doobius/core/job_system.h"
+#include "doobius/common/profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <bit>
+#include <string>
+
+namespace Doobius {
+	namespace {
+		thread_local const JobSystem* t_jobSystem = nullptr;
+		thread_local std::int32_t t_workerIdx = -1;
+		thread_local std::uint32_t t_externalStealSeed = 0x9E3779B9u;
+
+		constexpr std::size_t g_maxJobPoolProbes = 32;
+		constexpr int g_idleSpins = 64;
+
+		inline std::uint32_t xorshift(std::uint32_t& state) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	}
+
+	JobDeque::JobDeque(std::size_t capacity) :
+		m_buffer(std::make_unique<std::atomic<Job*>[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))),
+		m_mask(static_cast<std::int64_t>(std::bit_ceil(std::max<std::size_t>(capacity, 2))) - 1), m_top{ 0 }, m_bottom{ 0 }
+	{
+	}
+
+	bool JobDeque::push(Job* job)
+	{
+		const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+		const std::int64_t t = m_top.load(std::memory_order_acquire);
+		if (b - t > m_mask) {
+			return false;
+		}
+		m_buffer[b & m_mask].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* JobDeque::pop()
+	{
+		const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::int64_t t = m_top.load(std::memory_order_relaxed);
+		if (t > b) {
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = m_buffer[b & m_mask].load(std::memory_order_relaxed);
+		if (t == b) {
+			// Last job, race any thief for it
+			if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* JobDeque::steal()
+	{
+		std::int64_t t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return nullptr;
+		}
+		Job* job = m_buffer[t & m_mask].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return job;
+	}
+
+	JobSystem::Worker::Worker(std::size_t dequeCapacity, std::size_t poolSize) :
+		deque(dequeCapacity), jobPool(std::make_unique<Job[]>(poolSize)), jobPoolSize(poolSize), nextJobSlot{ 0 },
+		executed{ 0 }, stolen{ 0 }, runInline{ 0 }, heapAllocated{ 0 }, stealSeed{ 0x9E3779B9u }
+	{
+	}
+
+	JobSystem::JobSystem() : m_injectSize{ 0 }, m_externalExecuted{ 0 }, m_externalHeapAllocated{ 0 }, m_numQueued{ 0 },
+		m_numSleeping{ 0 }, m_stop{ false }, m_running{ false }
+	{
+	}
+
+	JobSystem::~JobSystem()
+	{
+		stop();
+	}
+
+	void JobSystem::start(const JobSystemConfig& config)
+	{
+		BOOST_LOG_NAMED_SCOPE("JobSystem");
+		if (m_running) {
+			DOOBIUS_CLOG(warning) << "Job system has already been started";
+			return;
+		}
+
+		const std::uint32_t numWorkers = config.numWorkers >= 0 ? static_cast<std::uint32_t>(config.numWorkers)
+			: std::max(1u, std::thread::hardware_concurrency()) - 1;
+		const std::size_t poolSize = std::max<std::size_t>(config.jobPoolSize, 1);
+		m_workers.clear();
+		for (std::uint32_t i = 0; i <= numWorkers; ++i) {
+			m_workers.push_back(std::make_unique<Worker>(config.dequeCapacity, poolSize));
+			m_workers.back()->stealSeed += i * 0x85EBCA6Bu;
+		}
+
+		t_jobSystem = this;
+		t_workerIdx = 0;
+		m_stop.store(false);
+		m_running = true;
+		for (std::uint32_t i = 1; i <= numWorkers; ++i) {
+			m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+		DOOBIUS_CLOG(info) << "Job system started with " << numWorkers << " background workers";
+	}
+
+	void JobSystem::stop()
+	{
+		if (!m_running) {
+			return;
+		}
+		m_stop.store(true, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_sleepCv.notify_all();
+		}
+		for (std::thread& thread : m_threads) {
+			thread.join();
+		}
+		m_threads.clear();
+
+		// Anything the workers left behind runs here
+		const std::int32_t workerIdx = getWorkerIdx();
+		while (Job* job = findJob(workerIdx)) {
+			execute(job);
+		}
+
+		if (t_jobSystem == this) {
+			t_jobSystem = nullptr;
+			t_workerIdx = -1;
+		}
+		// Workers are kept until the next start() so their stats can still be read
+		m_running = false;
+	}
+
+	std::int32_t JobSystem::getWorkerIdx() const
+	{
+		return t_jobSystem == this ? t_workerIdx : -1;
+	}
+
+	Job* JobSystem::allocJob()
+	{
+		const std::int32_t workerIdx = getWorkerIdx();
+		if (workerIdx >= 0) {
+			Worker& worker = *m_workers[workerIdx];
+			// Slots free up roughly in the order they were handed out, so the next one is nearly always available
+			for (std::size_t probe = 0; probe < std::min(g_maxJobPoolProbes, worker.jobPoolSize); ++probe) {
+				Job& job = worker.jobPool[worker.nextJobSlot];
+				worker.nextJobSlot = worker.nextJobSlot + 1 == worker.jobPoolSize ? 0 : worker.nextJobSlot + 1;
+				if (!job.inUse.load(std::memory_order_acquire)) {
+					job.inUse.store(true, std::memory_order_relaxed);
+					job.heapAllocated = false;
+					return &job;
+				}
+			}
+			worker.heapAllocated.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			m_externalHeapAllocated.fetch_add(1, std::memory_order_relaxed);
+		}
+		Job* job = new Job();
+		job->heapAllocated = true;
+		return job;
+	}
+
+	void JobSystem::submit(Job* job)
+	{
+		const std::int32_t workerIdx = getWorkerIdx();
+		if (workerIdx >= 0) {
+			m_numQueued.fetch_add(1, std::memory_order_seq_cst);
+			if (!m_workers[workerIdx]->deque.push(job)) {
+				m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+				m_workers[workerIdx]->runInline.fetch_add(1, std::memory_order_relaxed);
+				execute(job);
+				return;
+			}
+		}
+		else {
+			std::lock_guard<std::mutex> lock(m_injectMutex);
+			m_numQueued.fetch_add(1, std::memory_order_seq_cst);
+			m_injectQueue.push_back(job);
+			m_injectSize.store(m_injectQueue.size(), std::memory_order_release);
+		}
+		wakeOne();
+	}
+
+	void JobSystem::wakeOne()
+	{
+		// A sleeper registers itself under m_sleepMutex before re-checking m_numQueued, so either it sees the new job
+		// or this sees it and the notify can't slip in before its wait
+		if (m_numSleeping.load(std::memory_order_seq_cst) > 0) {
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_sleepCv.notify_one();
+		}
+	}
+
+	Job* JobSystem::findJob(std::int32_t workerIdx)
+	{
+		Job* job = nullptr;
+		if (workerIdx >= 0) {
+			job = m_workers[workerIdx]->deque.pop();
+		}
+		if (!job && m_injectSize.load(std::memory_order_acquire) > 0) {
+			std::lock_guard<std::mutex> lock(m_injectMutex);
+			if (!m_injectQueue.empty()) {
+				job = m_injectQueue.front();
+				m_injectQueue.pop_front();
+				m_injectSize.store(m_injectQueue.size(), std::memory_order_release);
+			}
+		}
+		if (!job) {
+			const std::size_t numWorkers = m_workers.size();
+			std::uint32_t& seed = workerIdx >= 0 ? m_workers[workerIdx]->stealSeed : t_externalStealSeed;
+			const std::size_t firstVictim = xorshift(seed) % numWorkers;
+			for (std::size_t i = 0; i < numWorkers && !job; ++i) {
+				const std::size_t victim = (firstVictim + i) % numWorkers;
+				if (static_cast<std::int32_t>(victim) != workerIdx) {
+					job = m_workers[victim]->deque.steal();
+				}
+			}
+			if (job && workerIdx >= 0) {
+				m_workers[workerIdx]->stolen.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		if (job) {
+			m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	void JobSystem::execute(Job* job)
+	{
+		job->invoke(*job);
+		// The slot can be reused as soon as inUse drops, so read everything needed from it first
+		JobCounter* counter = job->counter;
+		if (job->heapAllocated) {
+			delete job;
+		}
+		else {
+			job->inUse.store(false, std::memory_order_release);
+		}
+		if (counter) {
+			counter->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+
+		const std::int32_t workerIdx = getWorkerIdx();
+		if (workerIdx >= 0) {
+			m_workers[workerIdx]->executed.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			m_externalExecuted.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void JobSystem::wait(const JobCounter& counter)
+	{
+		const std::int32_t workerIdx = getWorkerIdx();
+		while (!counter.isDone()) {
+			if (Job* job = findJob(workerIdx)) {
+				execute(job);
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::workerLoop(std::uint32_t workerIdx)
+	{
+		t_jobSystem = this;
+		t_workerIdx = static_cast<std::int32_t>(workerIdx);
+		DOOBIUS_PROFILE_THREAD_NAME("JobWorker" + std::to_string(workerIdx));
+		BOOST_LOG_NAMED_SCOPE("JobWorker");
+
+		for (;;) {
+			if (Job* job = findJob(t_workerIdx)) {
+				execute(job);
+				continue;
+			}
+			if (m_stop.load(std::memory_order_acquire)) {
+				break;
+			}
+
+			bool workAppeared = false;
+			for (int spin = 0; spin < g_idleSpins && !workAppeared; ++spin) {
+				workAppeared = m_numQueued.load(std::memory_order_relaxed) > 0;
+				if (!workAppeared) {
+					std::this_thread::yield();
+				}
+			}
+			if (workAppeared) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_numSleeping.fetch_add(1, std::memory_order_seq_cst);
+			m_sleepCv.wait(lock, [this] {
+				return m_stop.load(std::memory_order_acquire) || m_numQueued.load(std::memory_order_seq_cst) > 0;
+			});
+			m_numSleeping.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		t_jobSystem = nullptr;
+		t_workerIdx = -1;
+	}
+
+	JobSystemStats JobSystem::getStats() const
+	{
+		JobSystemStats stats;
+		stats.executed = m_externalExecuted.load(std::memory_order_relaxed);
+		stats.heapAllocated = m_externalHeapAllocated.load(std::memory_order_relaxed);
+		for (const std::unique_ptr<Worker>& worker : m_workers) {
+			stats.executed += worker->executed.load(std::memory_order_relaxed);
+			stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+			stats.runInline += worker->runInline.load(std::memory_order_relaxed);
+			stats.heapAllocated += worker->heapAllocated.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
+}
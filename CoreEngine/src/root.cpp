@@ -1,28 +1,48 @@
 #include "doobius/core/root.h"
+#include "doobius/common/frame_arena.h"
+#include "doobius/common/profiler.h"
 
 namespace Doobius {
-	Root::Root() : m_setup{ false }, rootNotifReg{ "RootNotifReg" } {
+	Root::Root() : m_setup{ false }, rootNotifReg{ "RootNotifReg" }, engineLoop{ &frameProfiler }, world{ &rootNotifReg } {
 		BOOST_LOG_NAMED_SCOPE("RootInit");
+		// First hook of every tick, so frame arena memory lives exactly one engine loop frame
+		engineLoop.registerHook(LoopPhase::PRE_UPDATE, "FrameArenaAdvance", [](const FrameTime&) { Memory::FrameArena::advanceFrame(); });
 		DOOBIUS_CLOG(info) << "Doobius root startup complete";
 	}
 
 	Root::~Root()
 	{
 		BOOST_LOG_NAMED_SCOPE("RootEnd");
+		shutdown();
 		DOOBIUS_CLOG(info) << "Doobius root shutdown complete";
 	}
 
 	void Root::init(const DoobiusRootConfig& rootConfig)
 	{
 		BOOST_LOG_NAMED_SCOPE("RootInit");
+		DOOBIUS_PROFILE_SCOPE("Root::init");
 		if (m_setup) {
 			DOOBIUS_CLOG(warning) << "Root has already been initialized before";
 			return;
 		}
 
+		frameProfiler.configure(rootConfig.frameProfilerConfig);
+		jobSystem.start(rootConfig.jobSystemConfig);
+		engineLoop.configure(rootConfig.engineLoopConfig);
+		if (!subsystems.initAll(jobSystem)) {
+			DOOBIUS_CLOG(error) << "Not every subsystem initialized, see the startup profile above";
+		}
 		m_setup = true;
 	}
 
+	void Root::shutdown()
+	{
+		BOOST_LOG_NAMED_SCOPE("RootEnd");
+		DOOBIUS_PROFILE_SCOPE("Root::shutdown");
+		subsystems.shutdownAll();
+		jobSystem.stop();
+	}
+
 	Root& Root::get() {
 		static Root _root;
 		return _root;
@@ -0,0 +1,272 @@
+#include "doobius/core/subsystem_registry.h"
+#include "doobius/core/job_system.h"
+#include "doobius/common/profiler.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <queue>
+#include <unordered_map>
+
+namespace Doobius {
+	namespace {
+		inline std::int64_t nowNs() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		inline double nsToMs(std::int64_t ns) {
+			return static_cast<double>(ns) / 1e6;
+		}
+	}
+
+	SubsystemRegistry::SubsystemRegistry() : m_numInitFinished{ 0 }, m_initialized{ false }
+	{
+	}
+
+	bool SubsystemRegistry::registerSubsystem(SubsystemDesc desc)
+	{
+		BOOST_LOG_NAMED_SCOPE("SubsystemRegistry");
+		if (m_initialized) {
+			DOOBIUS_CLOG(error) << "Subsystem " << desc.name << " registered after initAll, ignoring it";
+			return false;
+		}
+		if (desc.name.empty()) {
+			DOOBIUS_CLOG(error) << "Subsystems need a name";
+			return false;
+		}
+		for (const std::unique_ptr<Node>& node : m_nodes) {
+			if (node->desc.name == desc.name) {
+				DOOBIUS_CLOG(error) << "Subsystem " << desc.name << " is already registered";
+				return false;
+			}
+		}
+		std::unique_ptr<Node> node = std::make_unique<Node>();
+		node->desc = std::move(desc);
+		m_nodes.push_back(std::move(node));
+		return true;
+	}
+
+	bool SubsystemRegistry::resolveOrder(std::vector<std::string>& order, std::string& error) const
+	{
+		order.clear();
+		std::unordered_map<std::string, std::size_t> nameToIdx;
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			nameToIdx.emplace(m_nodes[i]->desc.name, i);
+		}
+
+		std::vector<std::vector<std::size_t>> dependents(m_nodes.size());
+		std::vector<std::vector<std::size_t>> dependencies(m_nodes.size());
+		std::vector<std::size_t> inDegree(m_nodes.size(), 0);
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			for (const std::string& depName : m_nodes[i]->desc.dependencies) {
+				auto dep = nameToIdx.find(depName);
+				if (dep == nameToIdx.end()) {
+					error = "Subsystem " + m_nodes[i]->desc.name + " depends on unknown subsystem " + depName;
+					return false;
+				}
+				dependents[dep->second].push_back(i);
+				dependencies[i].push_back(dep->second);
+				++inDegree[i];
+			}
+		}
+
+		// Kahn's algorithm, lowest registration index first so the order is stable
+		std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<std::size_t>> ready;
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			if (inDegree[i] == 0) {
+				ready.push(i);
+			}
+		}
+		while (!ready.empty()) {
+			const std::size_t idx = ready.top();
+			ready.pop();
+			order.push_back(m_nodes[idx]->desc.name);
+			for (std::size_t dependent : dependents[idx]) {
+				if (--inDegree[dependent] == 0) {
+					ready.push(dependent);
+				}
+			}
+		}
+		if (order.size() == m_nodes.size()) {
+			return true;
+		}
+
+		// Every node left has an unresolved dependency that is also left, so following those must loop
+		std::size_t idx = 0;
+		while (inDegree[idx] == 0) {
+			++idx;
+		}
+		std::vector<std::size_t> visitOrder(m_nodes.size(), SIZE_MAX);
+		std::vector<std::size_t> path;
+		while (visitOrder[idx] == SIZE_MAX) {
+			visitOrder[idx] = path.size();
+			path.push_back(idx);
+			idx = *std::find_if(dependencies[idx].begin(), dependencies[idx].end(), [&](std::size_t dep) { return inDegree[dep] > 0; });
+		}
+		error = "Subsystem dependency cycle: ";
+		for (std::size_t i = visitOrder[idx]; i < path.size(); ++i) {
+			error += m_nodes[path[i]]->desc.name + " -> ";
+		}
+		error += m_nodes[idx]->desc.name;
+		order.clear();
+		return false;
+	}
+
+	void SubsystemRegistry::runInit(JobSystem& jobs, JobCounter& counter, std::size_t nodeIdx, std::int64_t phaseStartNs)
+	{
+		Node& node = *m_nodes[nodeIdx];
+		const std::int64_t startNs = nowNs();
+		bool ok = false;
+		node.timing.skipped = node.skipped.load(std::memory_order_acquire);
+		if (node.timing.skipped) {
+			DOOBIUS_CLOG(warning) << "Skipping init of subsystem " << node.desc.name << ", a dependency failed";
+		}
+		else {
+			DOOBIUS_PROFILE_SCOPE(node.desc.name.c_str());
+			try {
+				ok = node.desc.init ? node.desc.init() : true;
+			}
+			catch (const std::exception& e) {
+				DOOBIUS_CLOG(error) << "Subsystem " << node.desc.name << " threw during init: " << e.what();
+			}
+			if (!ok) {
+				DOOBIUS_CLOG(error) << "Subsystem " << node.desc.name << " failed to initialize";
+			}
+		}
+		const std::int64_t endNs = nowNs();
+
+		node.timing.name = node.desc.name;
+		node.timing.startMs = nsToMs(startNs - phaseStartNs);
+		node.timing.durationMs = nsToMs(endNs - startNs);
+		node.timing.threadIdx = static_cast<std::uint32_t>(std::max(jobs.getWorkerIdx(), 0));
+		node.timing.ok = ok;
+		// Dependencies published their timing before releasing this node, see the fetch_sub below
+		double longestDepPathMs = 0.0;
+		for (std::size_t depIdx : node.dependencyIdxs) {
+			longestDepPathMs = std::max(longestDepPathMs, m_nodes[depIdx]->timing.criticalPathMs);
+		}
+		node.timing.criticalPathMs = longestDepPathMs + node.timing.durationMs;
+
+		if (ok) {
+			m_initOrder[m_numInitFinished.fetch_add(1, std::memory_order_relaxed)] = nodeIdx;
+		}
+		for (std::size_t dependentIdx : node.dependentIdxs) {
+			Node& dependent = *m_nodes[dependentIdx];
+			if (!ok) {
+				dependent.skipped.store(true, std::memory_order_relaxed);
+			}
+			if (dependent.remainingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				jobs.run([this, &jobs, &counter, dependentIdx, phaseStartNs]() { runInit(jobs, counter, dependentIdx, phaseStartNs); }, &counter);
+			}
+		}
+	}
+
+	bool SubsystemRegistry::initAll(JobSystem& jobs)
+	{
+		BOOST_LOG_NAMED_SCOPE("SubsystemRegistry");
+		DOOBIUS_PROFILE_SCOPE("SubsystemRegistry::initAll");
+		if (m_initialized) {
+			DOOBIUS_CLOG(warning) << "Subsystems have already been initialized";
+			return true;
+		}
+
+		std::vector<std::string> order;
+		std::string error;
+		if (!resolveOrder(order, error)) {
+			DOOBIUS_CLOG(error) << error;
+			return false;
+		}
+
+		std::unordered_map<std::string, std::size_t> nameToIdx;
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			nameToIdx.emplace(m_nodes[i]->desc.name, i);
+			m_nodes[i]->dependencyIdxs.clear();
+			m_nodes[i]->dependentIdxs.clear();
+			m_nodes[i]->timing = SubsystemTiming{};
+		}
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			for (const std::string& depName : m_nodes[i]->desc.dependencies) {
+				const std::size_t depIdx = nameToIdx.at(depName);
+				m_nodes[i]->dependencyIdxs.push_back(depIdx);
+				m_nodes[depIdx]->dependentIdxs.push_back(i);
+			}
+			m_nodes[i]->remainingDeps.store(static_cast<std::int32_t>(m_nodes[i]->dependencyIdxs.size()), std::memory_order_relaxed);
+			m_nodes[i]->skipped.store(false, std::memory_order_relaxed);
+		}
+		m_initOrder.assign(m_nodes.size(), 0);
+		m_numInitFinished.store(0, std::memory_order_relaxed);
+
+		const std::int64_t phaseStartNs = nowNs();
+		JobCounter counter;
+		for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+			if (m_nodes[i]->dependencyIdxs.empty()) {
+				jobs.run([this, &jobs, &counter, i, phaseStartNs]() { runInit(jobs, counter, i, phaseStartNs); }, &counter);
+			}
+		}
+		jobs.wait(counter);
+		const std::int64_t phaseEndNs = nowNs();
+
+		m_initOrder.resize(m_numInitFinished.load(std::memory_order_relaxed));
+		m_initialized = true;
+
+		m_profile = StartupProfile{};
+		m_profile.initWallMs = nsToMs(phaseEndNs - phaseStartNs);
+		for (const std::unique_ptr<Node>& node : m_nodes) {
+			m_profile.init.push_back(node->timing);
+			m_profile.initSerialMs += node->timing.durationMs;
+			m_profile.initCriticalPathMs = std::max(m_profile.initCriticalPathMs, node->timing.criticalPathMs);
+		}
+		std::stable_sort(m_profile.init.begin(), m_profile.init.end(), [](const SubsystemTiming& a, const SubsystemTiming& b) {
+			return a.startMs < b.startMs;
+		});
+		logStartupProfile();
+		return m_initOrder.size() == m_nodes.size();
+	}
+
+	void SubsystemRegistry::shutdownAll()
+	{
+		BOOST_LOG_NAMED_SCOPE("SubsystemRegistry");
+		DOOBIUS_PROFILE_SCOPE("SubsystemRegistry::shutdownAll");
+		if (!m_initialized) {
+			return;
+		}
+
+		m_profile.shutdown.clear();
+		const std::int64_t phaseStartNs = nowNs();
+		for (auto it = m_initOrder.rbegin(); it != m_initOrder.rend(); ++it) {
+			Node& node = *m_nodes[*it];
+			SubsystemTiming timing;
+			timing.name = node.desc.name;
+			const std::int64_t startNs = nowNs();
+			if (node.desc.shutdown) {
+				DOOBIUS_PROFILE_SCOPE(node.desc.name.c_str());
+				node.desc.shutdown();
+			}
+			const std::int64_t endNs = nowNs();
+			timing.startMs = nsToMs(startNs - phaseStartNs);
+			timing.durationMs = nsToMs(endNs - startNs);
+			timing.ok = true;
+			m_profile.shutdown.push_back(timing);
+		}
+		m_profile.shutdownWallMs = nsToMs(nowNs() - phaseStartNs);
+		m_initOrder.clear();
+		m_initialized = false;
+		DOOBIUS_CLOG(info) << "Shut down " << m_profile.shutdown.size() << " subsystems in " << m_profile.shutdownWallMs << "ms";
+	}
+
+	void SubsystemRegistry::logStartupProfile() const
+	{
+		BOOST_LOG_NAMED_SCOPE("SubsystemRegistry");
+		DOOBIUS_CLOG(info) << "Subsystem startup: " << m_profile.init.size() << " subsystems, wall " << m_profile.initWallMs << "ms, serial "
+			<< m_profile.initSerialMs << "ms, critical path " << m_profile.initCriticalPathMs << "ms";
+		for (const SubsystemTiming& timing : m_profile.init) {
+			DOOBIUS_CLOG(info) << std::fixed << std::setprecision(3) << "  " << std::left << std::setw(24) << timing.name
+				<< " start " << std::right << std::setw(9) << timing.startMs << "ms  took " << std::setw(9) << timing.durationMs
+				<< "ms  path " << std::setw(9) << timing.criticalPathMs << "ms  worker " << timing.threadIdx
+				<< (timing.skipped ? "  SKIPPED" : (timing.ok ? "" : "  FAILED"));
+		}
+	}
+}
@@ -0,0 +1,236 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/core/ecs.h"
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Position {
+		float x, y;
+	};
+
+	struct Velocity {
+		float dx, dy;
+	};
+
+	struct Tag {};
+
+	// Counts live instances so tests can see every component was destroyed exactly once
+	struct Tracked {
+		static int s_alive;
+		std::unique_ptr<int> value;
+
+		explicit Tracked(int v) : value(std::make_unique<int>(v)) { ++s_alive; }
+		Tracked(Tracked&& rhs) noexcept : value(std::move(rhs.value)) { ++s_alive; }
+		Tracked& operator=(Tracked&&) = delete;
+		~Tracked() { --s_alive; }
+	};
+	int Tracked::s_alive = 0;
+}
+
+BOOST_AUTO_TEST_CASE(EcsEntityIdsAreGenerational)
+{
+	Doobius::World world;
+	const Doobius::EntityId first = world.createEntity();
+	BOOST_TEST(world.isAlive(first));
+	world.destroyEntity(first);
+	BOOST_TEST(!world.isAlive(first));
+
+	// Same slot, newer generation; the stale id must not see the new entity
+	const Doobius::EntityId second = world.createEntity(Position{ 1, 2 });
+	BOOST_TEST(second.index == first.index);
+	BOOST_TEST(second.generation == first.generation + 1);
+	BOOST_TEST(!world.isAlive(first));
+	BOOST_TEST(world.getComponent<Position>(first) == nullptr);
+	BOOST_TEST(world.getComponent<Position>(second)->y == 2.0f);
+	BOOST_TEST(world.getNumAlive() == 1u);
+	BOOST_TEST(!world.isAlive(Doobius::EntityId{}));
+}
+
+BOOST_AUTO_TEST_CASE(EcsComponentsMoveBetweenArchetypes)
+{
+	Doobius::World world;
+	const Doobius::EntityId a = world.createEntity(Position{ 1, 1 }, Velocity{ 2, 2 });
+	const Doobius::EntityId b = world.createEntity(Position{ 3, 3 });
+	BOOST_TEST(world.hasComponent<Velocity>(a));
+	BOOST_TEST(!world.hasComponent<Velocity>(b));
+
+	world.addComponent(b, Velocity{ 4, 4 });
+	BOOST_TEST(world.getComponent<Position>(b)->x == 3.0f);
+	BOOST_TEST(world.getComponent<Velocity>(b)->dx == 4.0f);
+	// Adding a type the entity has replaces the value and keeps the archetype
+	const std::size_t numArchetypes = world.getNumArchetypes();
+	world.addComponent(b, Velocity{ 5, 5 });
+	BOOST_TEST(world.getComponent<Velocity>(b)->dx == 5.0f);
+	BOOST_TEST(world.getNumArchetypes() == numArchetypes);
+
+	BOOST_TEST(world.removeComponent<Position>(a));
+	BOOST_TEST(!world.removeComponent<Position>(a));
+	BOOST_TEST(!world.hasComponent<Position>(a));
+	BOOST_TEST(world.getComponent<Velocity>(a)->dy == 2.0f);
+	BOOST_TEST(world.getComponent<const Velocity>(a)->dy == 2.0f);
+
+	world.addComponent(a, Tag{});
+	BOOST_TEST(world.hasComponent<Tag>(a));
+	world.destroyEntity(a);
+	BOOST_TEST(world.getComponent<Velocity>(a) == nullptr);
+	BOOST_TEST(world.getComponent<Position>(b)->x == 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(EcsSwapRemoveKeepsOtherEntitiesValid)
+{
+	Doobius::World world;
+	std::vector<Doobius::EntityId> entities;
+	// Enough to span several chunks
+	for (int i = 0; i < 5000; ++i) {
+		entities.push_back(world.createEntity(Position{ static_cast<float>(i), 0 }));
+	}
+	for (int i = 0; i < 5000; i += 3) {
+		world.destroyEntity(entities[i]);
+	}
+	for (int i = 0; i < 5000; ++i) {
+		if (i % 3 == 0) {
+			BOOST_TEST(!world.isAlive(entities[i]));
+		}
+		else {
+			BOOST_TEST(world.getComponent<Position>(entities[i])->x == static_cast<float>(i));
+		}
+	}
+	BOOST_TEST(world.count<Position>() == world.getNumAlive());
+}
+
+BOOST_AUTO_TEST_CASE(EcsQueriesVisitContiguousChunks)
+{
+	Doobius::World world;
+	for (int i = 0; i < 3000; ++i) {
+		world.createEntity(Position{ 0, 0 }, Velocity{ 1, static_cast<float>(i) });
+	}
+	for (int i = 0; i < 100; ++i) {
+		world.createEntity(Position{ 0, 0 });
+		world.createEntity(Position{ 0, 0 }, Velocity{ 1, 0 }, Tag{});
+	}
+
+	std::size_t visited = 0;
+	world.forEachChunk<Position, const Velocity>([&](std::size_t count, const Doobius::EntityId* entities, Position* positions, const Velocity* velocities) {
+		BOOST_TEST(entities != nullptr);
+		for (std::size_t i = 0; i < count; ++i) {
+			positions[i].x += velocities[i].dx;
+		}
+		visited += count;
+	});
+	BOOST_TEST(visited == 3100u);
+
+	float sum = 0;
+	world.forEach<const Position>([&](Doobius::EntityId, const Position& position) { sum += position.x; });
+	BOOST_TEST(sum == 3100.0f);
+
+	// The cached query picks up archetypes created after it first ran
+	const Doobius::EntityId late = world.createEntity(Velocity{ 1, 0 }, Position{ 0, 0 }, Tracked{ 1 });
+	BOOST_TEST((world.count<Position, Velocity>() == 3101u));
+	world.destroyEntity(late);
+	BOOST_TEST((world.count<Position, Velocity>() == 3100u));
+}
+
+BOOST_AUTO_TEST_CASE(EcsCommandBuffersDeferStructuralChanges)
+{
+	Doobius::World world;
+	for (int i = 0; i < 10; ++i) {
+		world.createEntity(Position{ static_cast<float>(i), 0 });
+	}
+
+	Doobius::CommandBuffer commands(world);
+	std::vector<Doobius::EntityId> spawned;
+	world.forEach<Position>([&](Doobius::EntityId entity, Position& position) {
+		if (static_cast<int>(position.x) % 2 == 0) {
+			commands.destroyEntity(entity);
+		}
+		else {
+			commands.addComponent(entity, Velocity{ 1, 1 });
+			const Doobius::EntityId child = commands.createEntity();
+			commands.addComponent(child, Tracked{ static_cast<int>(position.x) });
+			spawned.push_back(child);
+		}
+	});
+	// Nothing changed while iterating
+	BOOST_TEST(world.getNumAlive() == 10u);
+	BOOST_TEST(!world.isAlive(spawned[0]));
+	BOOST_TEST(commands.getNumCommands() == 20u);
+
+	commands.playback();
+	BOOST_TEST(commands.isEmpty());
+	BOOST_TEST(world.getNumAlive() == 10u);
+	BOOST_TEST((world.count<Position, Velocity>() == 5u));
+	std::set<int> values;
+	world.forEach<Tracked>([&](Doobius::EntityId, Tracked& tracked) { values.insert(*tracked.value); });
+	BOOST_TEST((values == std::set<int>{ 1, 3, 5, 7, 9 }));
+	BOOST_TEST(Tracked::s_alive == 5);
+
+	// Commands on an entity destroyed earlier in the same buffer are skipped, and unplayed payloads are destroyed
+	commands.destroyEntity(spawned[0]);
+	commands.addComponent(spawned[0], Tracked{ 100 });
+	commands.playback();
+	BOOST_TEST(Tracked::s_alive == 4);
+	{
+		Doobius::CommandBuffer dropped(world);
+		dropped.addComponent(spawned[1], Tracked{ 200 });
+		BOOST_TEST(Tracked::s_alive == 5);
+	}
+	BOOST_TEST(Tracked::s_alive == 4);
+}
+
+BOOST_AUTO_TEST_CASE(EcsComponentLifetimesAreBalanced)
+{
+	{
+		Doobius::World world;
+		std::vector<Doobius::EntityId> entities;
+		for (int i = 0; i < 100; ++i) {
+			entities.push_back(world.createEntity(Tracked{ i }));
+		}
+		for (int i = 0; i < 100; i += 2) {
+			world.addComponent(entities[i], Position{ 0, 0 });
+		}
+		for (int i = 0; i < 100; i += 4) {
+			world.removeComponent<Tracked>(entities[i]);
+		}
+		BOOST_TEST(Tracked::s_alive == 75);
+		BOOST_TEST(*world.getComponent<Tracked>(entities[2])->value == 2);
+		BOOST_TEST(*world.getComponent<Tracked>(entities[99])->value == 99);
+	}
+	// The world destroys what its archetypes still hold
+	BOOST_TEST(Tracked::s_alive == 0);
+}
+
+BOOST_AUTO_TEST_CASE(EcsPublishesComponentEvents)
+{
+	Doobius::Notification::NotificationRegistry registry("EcsTestReg");
+	Doobius::World world(&registry, "Test");
+
+	std::vector<std::string> added;
+	int removed = 0;
+	registry.registerCallback<Doobius::ComponentEvent>([&](const Doobius::ComponentEvent& event) {
+		added.push_back(event.typeName);
+		BOOST_TEST(world.isAlive(event.entity));
+	}, "OnAdded");
+	registry.registerCallback<Doobius::ComponentEvent>([&](const Doobius::ComponentEvent& event) {
+		++removed;
+		// Still readable while the removal is being published
+		BOOST_TEST(world.getComponent<Position>(event.entity) != nullptr);
+	}, "OnRemoved");
+	registry.registerCallbackToChannel("OnAdded", "TestComponentAdded");
+	registry.registerCallbackToChannel("OnRemoved", "TestComponentRemoved");
+
+	const Doobius::EntityId entity = world.createEntity(Position{ 0, 0 });
+	world.addComponent(entity, Velocity{ 0, 0 });
+	BOOST_TEST(added.size() == 2u);
+	BOOST_TEST(added[0].find("Position") != std::string::npos);
+	BOOST_TEST(added[1].find("Velocity") != std::string::npos);
+	world.addComponent(entity, Velocity{ 1, 1 });
+	BOOST_TEST(added.size() == 2u);
+
+	world.removeComponent<Velocity>(entity);
+	world.destroyEntity(entity);
+	BOOST_TEST(removed == 2);
+}
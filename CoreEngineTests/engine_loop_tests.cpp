@@ -0,0 +1,209 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/core/engine_loop.h"
+#include "doobius/core/frame_profiler.h"
+#include "doobius/common/alloc_tracker.h"
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	Doobius::EngineLoop::EngineLoopConfig makeConfig(double fixedTimestepSec) {
+		Doobius::EngineLoop::EngineLoopConfig config;
+		config.fixedTimestepSec = fixedTimestepSec;
+		config.targetFrameRateHz = 0.0;
+		return config;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopRunsFixedStepsFromAccumulatedTime)
+{
+	Doobius::EngineLoop loop;
+	loop.configure(makeConfig(0.010));
+
+	int fixedSteps = 0;
+	int updates = 0;
+	loop.registerHook(Doobius::LoopPhase::FIXED_UPDATE, "Count", [&](const Doobius::FrameTime& time) {
+		BOOST_TEST(time.fixedDeltaSec == 0.010);
+		++fixedSteps;
+	});
+	loop.registerHook(Doobius::LoopPhase::UPDATE, "Count", [&](const Doobius::FrameTime&) { ++updates; });
+
+	// 25ms: two steps with half a step left over
+	loop.tick(0.025);
+	BOOST_TEST(fixedSteps == 2);
+	BOOST_TEST(loop.getFrameTime().alpha == 0.5, boost::test_tools::tolerance(1e-9));
+	// The leftover 5ms plus 5ms makes one more
+	loop.tick(0.005);
+	BOOST_TEST(fixedSteps == 3);
+	BOOST_TEST(loop.getFrameTime().alpha == 0.0, boost::test_tools::tolerance(1e-9));
+	// Less than a step: update still runs, the simulation doesn't
+	loop.tick(0.001);
+	BOOST_TEST(fixedSteps == 3);
+	BOOST_TEST(updates == 3);
+
+	// A thousand identical deltas must not drift
+	for (int i = 0; i < 1000; ++i) {
+		loop.tick(0.010);
+	}
+	BOOST_TEST(fixedSteps == 1003);
+	BOOST_TEST(loop.getStats().numFrames == 1003u);
+	BOOST_TEST(loop.getStats().numClampedFrames == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopClampsLongStalls)
+{
+	Doobius::EngineLoop loop;
+	Doobius::EngineLoop::EngineLoopConfig config = makeConfig(0.010);
+	config.maxAccumulatedSec = 0.1;
+	config.maxFixedStepsPerFrame = 4;
+	loop.configure(config);
+
+	int fixedSteps = 0;
+	loop.registerHook(Doobius::LoopPhase::FIXED_UPDATE, "Count", [&](const Doobius::FrameTime&) { ++fixedSteps; });
+
+	// A 5s hitch is clamped to 100ms, then capped at 4 steps with the rest dropped
+	loop.tick(5.0);
+	BOOST_TEST(fixedSteps == 4);
+	BOOST_TEST(loop.getFrameTime().deltaSec == 0.1);
+	BOOST_TEST(loop.getFrameTime().alpha < 1.0);
+	BOOST_TEST(loop.getStats().numClampedFrames == 1u);
+
+	// Back to normal afterwards, no backlog carried over
+	loop.tick(0.010);
+	BOOST_TEST(fixedSteps == 5);
+	BOOST_TEST(loop.getStats().numClampedFrames == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopRunsPhasesInOrder)
+{
+	Doobius::FrameProfiler profiler;
+	Doobius::EngineLoop loop(&profiler);
+	loop.configure(makeConfig(0.010));
+
+	std::vector<std::string> calls;
+	loop.registerHook(Doobius::LoopPhase::POST_UPDATE, "Post", [&](const Doobius::FrameTime&) { calls.push_back("post"); });
+	loop.registerHook(Doobius::LoopPhase::UPDATE, "UpdateA", [&](const Doobius::FrameTime&) { calls.push_back("updateA"); });
+	const Doobius::EngineLoop::HookId updateB = loop.registerHook(Doobius::LoopPhase::UPDATE, "UpdateB", [&](const Doobius::FrameTime&) {
+		calls.push_back("updateB");
+	});
+	loop.registerHook(Doobius::LoopPhase::FIXED_UPDATE, "Fixed", [&](const Doobius::FrameTime&) { calls.push_back("fixed"); });
+	loop.registerHook(Doobius::LoopPhase::PRE_UPDATE, "Pre", [&](const Doobius::FrameTime& time) {
+		calls.push_back("pre");
+		if (time.frameIdx == 0) {
+			// Registered mid-frame, so it first runs next frame
+			loop.registerHook(Doobius::LoopPhase::UPDATE, "Late", [&](const Doobius::FrameTime&) { calls.push_back("late"); });
+		}
+	});
+
+	loop.tick(0.010);
+	BOOST_TEST(calls == (std::vector<std::string>{ "pre", "fixed", "updateA", "updateB", "post" }), boost::test_tools::per_element());
+	BOOST_TEST(profiler.getFrameIdx() == 1u);
+
+	calls.clear();
+	loop.unregisterHook(updateB);
+	loop.tick(0.0);
+	BOOST_TEST(calls == (std::vector<std::string>{ "pre", "updateA", "late", "post" }), boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopHookNamesOutliveTheirHooks)
+{
+	const std::filesystem::path spikeDir = std::filesystem::path(DOOBIUS_TEST_EXE_DIR) / "EngineLoopHookSpikes";
+	std::filesystem::remove_all(spikeDir);
+	Doobius::FrameProfiler profiler;
+	Doobius::FrameProfiler::FrameProfilerConfig profilerConfig;
+	profilerConfig.frameBudgetMs = 0.0;
+	profilerConfig.spikeDir = spikeDir;
+	profilerConfig.maxSpikeFiles = 8;
+	profiler.configure(profilerConfig);
+	Doobius::EngineLoop loop(&profiler);
+	loop.configure(makeConfig(0.010));
+
+	// Short names fit the small-string buffer and would move with the hook vector, long ones would be freed with it.
+	// Allocations escape into kept so each hook's alloc scope records at least one.
+	std::vector<std::unique_ptr<int>> kept;
+	auto registerAllocating = [&loop, &kept](const std::string& name) {
+		return loop.registerHook(Doobius::LoopPhase::UPDATE, name, [&kept](const Doobius::FrameTime&) {
+			kept.push_back(std::make_unique<int>(1));
+		});
+	};
+	std::vector<Doobius::EngineLoop::HookId> ephemeral;
+	ephemeral.push_back(registerAllocating("Hk"));
+	ephemeral.push_back(registerAllocating("EphemeralHookWithANameTooLongForTheSmallStringBuffer"));
+	loop.tick(0.010);
+
+	for (Doobius::EngineLoop::HookId id : ephemeral) {
+		loop.unregisterHook(id);
+	}
+	for (int i = 0; i < 64; ++i) {
+		registerAllocating("Replacement" + std::to_string(i));
+	}
+	loop.tick(0.010);
+	loop.tick(0.010);
+
+	std::ifstream firstSpike(spikeDir / "spike_frame0.json");
+	std::ostringstream firstContents;
+	firstContents << firstSpike.rdbuf();
+	BOOST_TEST(firstContents.str().find("\"name\":\"EphemeralHookWithANameTooLongForTheSmallStringBuffer\"") != std::string::npos);
+	std::ifstream lastSpike(spikeDir / "spike_frame2.json");
+	std::ostringstream lastContents;
+	lastContents << lastSpike.rdbuf();
+	BOOST_TEST(lastContents.str().find("\"name\":\"Replacement63\"") != std::string::npos);
+	BOOST_TEST(lastContents.str().find("\"name\":\"Hk\"") == std::string::npos);
+
+	// The alloc tracker still prints the names of hooks that are long gone
+	if (Doobius::Perf::AllocTracker::isEnabled()) {
+		const std::vector<Doobius::Perf::AllocScopeStats> scopes = Doobius::Perf::AllocTracker::get().getScopeStats();
+		for (const char* expected : { "Hk", "EphemeralHookWithANameTooLongForTheSmallStringBuffer", "Replacement0" }) {
+			BOOST_TEST(std::any_of(scopes.begin(), scopes.end(), [expected](const Doobius::Perf::AllocScopeStats& scope) {
+				return scope.name == expected && scope.allocs > 0;
+			}), expected);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopPacesToTargetRate)
+{
+	Doobius::EngineLoop loop;
+	Doobius::EngineLoop::EngineLoopConfig config = makeConfig(0.005);
+	config.targetFrameRateHz = 200.0;
+	config.maxFrames = 40;
+	loop.configure(config);
+
+	int fixedSteps = 0;
+	loop.registerHook(Doobius::LoopPhase::FIXED_UPDATE, "Count", [&](const Doobius::FrameTime&) { ++fixedSteps; });
+	BOOST_TEST(loop.run() == 40u);
+	BOOST_TEST(!loop.isRunning());
+
+	const Doobius::LoopStats stats = loop.getStats();
+	BOOST_TEST(stats.numFrames == 40u);
+	BOOST_TEST(stats.targetIntervalMs == 5.0, boost::test_tools::tolerance(1e-9));
+	// Loose bounds, CI machines are noisy; the point is that pacing holds the rate instead of free-running
+	BOOST_TEST(stats.meanIntervalMs > 4.0);
+	BOOST_TEST(stats.meanIntervalMs < 10.0);
+	BOOST_TEST(stats.minIntervalMs > 0.0);
+	BOOST_TEST(fixedSteps > 20);
+}
+
+BOOST_AUTO_TEST_CASE(EngineLoopStopsOnRequest)
+{
+	Doobius::EngineLoop loop;
+	loop.configure(makeConfig(0.010));
+	loop.registerHook(Doobius::LoopPhase::UPDATE, "Stopper", [&](const Doobius::FrameTime& time) {
+		if (time.frameIdx == 9) {
+			loop.requestStop();
+		}
+	});
+	BOOST_TEST(loop.run() == 10u);
+	// The request is consumed, a later run starts fresh
+	loop.registerHook(Doobius::LoopPhase::UPDATE, "Stopper2", [&](const Doobius::FrameTime& time) {
+		if (time.frameIdx == 14) {
+			loop.requestStop();
+		}
+	});
+	BOOST_TEST(loop.run() == 5u);
+}
@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE CoreEngineTests
+#define BOOST_ALL_DYN_LINK
+#include "doobius/core/root.h"
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+struct LoggingFixture {
+	LoggingFixture() {
+		BOOST_LOG_NAMED_SCOPE("CoreEngineLogFixture");
+		std::filesystem::path testDir = "CoreEngineTestLogs";
+		std::filesystem::path testDirFull = DOOBIUS_TEST_EXE_DIR / testDir;
+		DOOBIUS_LOG_MNG().initLogging(testDirFull);
+	}
+	~LoggingFixture() = default;
+};
+
+BOOST_TEST_GLOBAL_FIXTURE(LoggingFixture);
+
+namespace {
+	std::string readFile(const std::filesystem::path& path) {
+		std::ifstream file(path);
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	void runFrame(Doobius::FrameProfiler& profiler, bool slow) {
+		profiler.beginFrame();
+		{
+			Doobius::FrameScope update(profiler, "Update");
+			{
+				Doobius::FrameScope physics(profiler, "Physics");
+			}
+			if (slow) {
+				Doobius::FrameScope slowScope(profiler, "SyntheticStall");
+				std::this_thread::sleep_for(std::chrono::milliseconds(15));
+			}
+		}
+		profiler.endFrame();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FrameProfilerCapturesSpikes)
+{
+	const std::filesystem::path spikeDir = std::filesystem::path(DOOBIUS_TEST_EXE_DIR) / "CoreEngineTestSpikes";
+	std::filesystem::remove_all(spikeDir);
+
+	Doobius::FrameProfiler profiler;
+	Doobius::FrameProfiler::FrameProfilerConfig config;
+	config.frameBudgetMs = 5.0;
+	config.historySize = 16;
+	config.spikeDir = spikeDir;
+	config.maxSpikeFiles = 2;
+	profiler.configure(config);
+
+	// Frames 3, 7 and 11 are slow; only the first two get spike files
+	for (int i = 0; i < 20; ++i) {
+		runFrame(profiler, i % 4 == 3 && i < 12);
+	}
+
+	BOOST_TEST(profiler.getFrameIdx() == 20u);
+	BOOST_TEST(profiler.getNumSpikes() == 3u);
+	BOOST_TEST(std::filesystem::exists(spikeDir / "spike_frame3.json"));
+	BOOST_TEST(std::filesystem::exists(spikeDir / "spike_frame7.json"));
+	BOOST_TEST(!std::filesystem::exists(spikeDir / "spike_frame11.json"));
+	BOOST_TEST(profiler.getLastSpikePath() == spikeDir / "spike_frame7.json");
+
+	const std::string spike = readFile(spikeDir / "spike_frame3.json");
+	BOOST_TEST(spike.find("\"frame\":3,") != std::string::npos);
+	BOOST_TEST(spike.find("\"name\":\"Update\"") != std::string::npos);
+	BOOST_TEST(spike.find("\"name\":\"Physics\"") != std::string::npos);
+	BOOST_TEST(spike.find("\"name\":\"SyntheticStall\"") != std::string::npos);
+	BOOST_TEST(spike.find("\"dropped_scopes\":0") != std::string::npos);
+
+	// Only the last 16 frames are kept, which still includes the slow frames 7 and 11
+	Doobius::FrameTimeStats stats = profiler.getFrameTimeStats();
+	BOOST_TEST(stats.numFrames == 16u);
+	BOOST_TEST(stats.numOverBudget == 2u);
+	BOOST_TEST(stats.maxMs >= 15.0);
+	BOOST_TEST(stats.p50Ms < 5.0);
+}
+
+BOOST_AUTO_TEST_CASE(FrameProfilerDropsExcessScopes)
+{
+	const std::filesystem::path spikeDir = std::filesystem::path(DOOBIUS_TEST_EXE_DIR) / "CoreEngineTestSpikesDropped";
+	std::filesystem::remove_all(spikeDir);
+
+	Doobius::FrameProfiler profiler;
+	Doobius::FrameProfiler::FrameProfilerConfig config;
+	config.frameBudgetMs = 0.0;
+	config.maxScopesPerFrame = 4;
+	config.spikeDir = spikeDir;
+	profiler.configure(config);
+
+	profiler.beginFrame();
+	for (int i = 0; i < 10; ++i) {
+		Doobius::FrameScope scope(profiler, "Repeated");
+	}
+	profiler.endFrame();
+
+	BOOST_TEST(profiler.getNumSpikes() == 1u);
+	BOOST_TEST(readFile(spikeDir / "spike_frame0.json").find("\"dropped_scopes\":6") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(FrameProfilerRecordsScopesFromWorkers)
+{
+	const std::filesystem::path spikeDir = std::filesystem::path(DOOBIUS_TEST_EXE_DIR) / "CoreEngineTestSpikesWorkers";
+	std::filesystem::remove_all(spikeDir);
+
+	Doobius::FrameProfiler profiler;
+	Doobius::FrameProfiler::FrameProfilerConfig config;
+	config.frameBudgetMs = 0.0;
+	config.spikeDir = spikeDir;
+	profiler.configure(config);
+
+	for (int frame = 0; frame < 2; ++frame) {
+		profiler.beginFrame();
+		std::vector<std::thread> workers;
+		for (int w = 0; w < 4; ++w) {
+			workers.emplace_back([&profiler]() {
+				for (int i = 0; i < 50; ++i) {
+					Doobius::FrameScope scope(profiler, "WorkerJob");
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		profiler.endFrame();
+	}
+
+	const std::string spike = readFile(spikeDir / "spike_frame1.json");
+	BOOST_TEST(spike.find("\"num_scopes\":200,") != std::string::npos);
+	BOOST_TEST(spike.find("\"unfinished_scopes\":0") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(RootOwnsFrameProfiler)
+{
+	Doobius::Root::DoobiusRootConfig rootConfig{};
+	rootConfig.frameProfilerConfig.frameBudgetMs = 1000.0;
+	DOOBIUS_ROOT().init(rootConfig);
+
+	DOOBIUS_ROOT().beginFrame();
+	{
+		DOOBIUS_FRAME_SCOPE("RootFrameScope");
+	}
+	DOOBIUS_ROOT().endFrame();
+
+	BOOST_TEST(DOOBIUS_ROOT().frameProfiler.getFrameIdx() == 1u);
+	BOOST_TEST(DOOBIUS_ROOT().frameProfiler.getNumSpikes() == 0u);
+}
@@ -0,0 +1,141 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/core/job_system.h"
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+	Doobius::JobSystem::JobSystemConfig makeConfig(std::int32_t numWorkers) {
+		Doobius::JobSystem::JobSystemConfig config;
+		config.numWorkers = numWorkers;
+		config.dequeCapacity = 256;
+		config.jobPoolSize = 256;
+		return config;
+	}
+
+	std::uint64_t fib(Doobius::JobSystem& jobs, std::uint32_t n) {
+		if (n < 2) {
+			return n;
+		}
+		std::uint64_t left = 0;
+		Doobius::JobCounter counter;
+		jobs.run([&]() { left = fib(jobs, n - 1); }, &counter);
+		const std::uint64_t right = fib(jobs, n - 2);
+		jobs.wait(counter);
+		return left + right;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemParallelForCoversRange)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeConfig(3));
+	BOOST_TEST(jobs.getNumThreads() == 4u);
+
+	std::vector<std::uint32_t> hits(100000, 0);
+	jobs.parallelFor(0, hits.size(), 64, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			++hits[i];
+		}
+	});
+	BOOST_TEST(std::all_of(hits.begin(), hits.end(), [](std::uint32_t hit) { return hit == 1; }));
+
+	// Empty and single-element ranges
+	std::atomic<int> calls{ 0 };
+	jobs.parallelFor(5, 5, 1, [&](std::size_t, std::size_t) { ++calls; });
+	BOOST_TEST(calls.load() == 0);
+	jobs.parallelFor(7, 8, 0, [&](std::size_t begin, std::size_t end) { calls += static_cast<int>(end - begin); });
+	BOOST_TEST(calls.load() == 1);
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemNestedForkJoin)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeConfig(3));
+	// Deep recursion with a wait inside every job; more jobs than the pool holds, so heap fallback gets exercised too
+	BOOST_TEST(fib(jobs, 20) == 6765u);
+
+	const Doobius::JobSystemStats stats = jobs.getStats();
+	BOOST_TEST(stats.executed + stats.runInline > 0u);
+	jobs.stop();
+	// Stats survive stop() so they can be read after a run
+	BOOST_TEST(jobs.getStats().executed == stats.executed);
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemCountersGateDependencies)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeConfig(2));
+
+	// Stage B reads everything stage A wrote, so it may only start once A's counter is done
+	std::vector<int> stageA(512, 0);
+	std::vector<int> stageB(512, 0);
+	Doobius::JobCounter stageACounter;
+	for (std::size_t i = 0; i < stageA.size(); ++i) {
+		jobs.run([&stageA, i]() { stageA[i] = static_cast<int>(i); }, &stageACounter);
+	}
+	jobs.wait(stageACounter);
+	BOOST_TEST(stageACounter.getNumPending() == 0);
+
+	Doobius::JobCounter stageBCounter;
+	for (std::size_t i = 0; i < stageB.size(); ++i) {
+		jobs.run([&stageA, &stageB, i]() { stageB[i] = stageA[stageA.size() - 1 - i] * 2; }, &stageBCounter);
+	}
+	jobs.wait(stageBCounter);
+	for (std::size_t i = 0; i < stageB.size(); ++i) {
+		BOOST_TEST(stageB[i] == static_cast<int>(stageA.size() - 1 - i) * 2);
+	}
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemAcceptsJobsFromOtherThreads)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeConfig(2));
+
+	std::atomic<std::uint64_t> sum{ 0 };
+	std::thread external([&]() {
+		Doobius::JobCounter counter;
+		for (std::uint64_t i = 1; i <= 1000; ++i) {
+			jobs.run([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }, &counter);
+		}
+		jobs.wait(counter);
+	});
+	external.join();
+	BOOST_TEST(sum.load() == 500500u);
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemRunsInlineWhenStopped)
+{
+	Doobius::JobSystem jobs;
+	BOOST_TEST(!jobs.isRunning());
+	int value = 0;
+	Doobius::JobCounter counter;
+	jobs.run([&]() { value = 42; }, &counter);
+	BOOST_TEST(value == 42);
+	BOOST_TEST(counter.isDone());
+
+	// A system with no background workers still works, everything runs on the caller while it waits
+	jobs.start(makeConfig(0));
+	std::atomic<int> total{ 0 };
+	jobs.parallelFor(0, 1000, 10, [&](std::size_t begin, std::size_t end) { total += static_cast<int>(end - begin); });
+	BOOST_TEST(total.load() == 1000);
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(JobSystemStopDrainsQueuedJobs)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeConfig(1));
+	std::atomic<int> ran{ 0 };
+	for (int i = 0; i < 200; ++i) {
+		jobs.run([&]() { ++ran; });
+	}
+	jobs.stop();
+	BOOST_TEST(ran.load() == 200);
+}
@@ -0,0 +1,192 @@
+#define BOOST_ALL_DYN_LINK
+#include "doobius/core/subsystem_registry.h"
+#include "doobius/core/job_system.h"
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Records init and shutdown calls from any thread
+	struct CallLog {
+		std::mutex mutex;
+		std::vector<std::string> inits;
+		std::vector<std::string> shutdowns;
+
+		void addInit(const std::string& name) {
+			std::lock_guard<std::mutex> lock(mutex);
+			inits.push_back(name);
+		}
+
+		bool hasInit(const std::string& name) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return std::find(inits.begin(), inits.end(), name) != inits.end();
+		}
+	};
+
+	std::size_t indexOf(const std::vector<std::string>& names, const std::string& name) {
+		return static_cast<std::size_t>(std::find(names.begin(), names.end(), name) - names.begin());
+	}
+
+	Doobius::SubsystemDesc makeSubsystem(CallLog& log, const std::string& name, std::vector<std::string> dependencies) {
+		return { name, dependencies, [&log, name, dependencies]() {
+			// Every dependency must already be up when init starts
+			for (const std::string& dep : dependencies) {
+				BOOST_TEST(log.hasInit(dep));
+			}
+			log.addInit(name);
+			return true;
+		}, [&log, name]() { log.shutdowns.push_back(name); } };
+	}
+
+	Doobius::JobSystem::JobSystemConfig makeJobConfig(std::int32_t numWorkers) {
+		Doobius::JobSystem::JobSystemConfig config;
+		config.numWorkers = numWorkers;
+		config.dequeCapacity = 64;
+		config.jobPoolSize = 64;
+		return config;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SubsystemsInitInDependencyOrder)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeJobConfig(3));
+	CallLog log;
+	Doobius::SubsystemRegistry registry;
+	// Diamond plus a tail: Renderer and Audio need Platform, Game needs both, Tools needs Game
+	BOOST_TEST(registry.registerSubsystem(makeSubsystem(log, "Tools", { "Game" })));
+	BOOST_TEST(registry.registerSubsystem(makeSubsystem(log, "Game", { "Renderer", "Audio" })));
+	BOOST_TEST(registry.registerSubsystem(makeSubsystem(log, "Renderer", { "Platform" })));
+	BOOST_TEST(registry.registerSubsystem(makeSubsystem(log, "Audio", { "Platform" })));
+	BOOST_TEST(registry.registerSubsystem(makeSubsystem(log, "Platform", {})));
+	BOOST_TEST(!registry.registerSubsystem(makeSubsystem(log, "Audio", {})));
+
+	std::vector<std::string> order;
+	std::string error;
+	BOOST_TEST(registry.resolveOrder(order, error));
+	BOOST_TEST(order == (std::vector<std::string>{ "Platform", "Renderer", "Audio", "Game", "Tools" }), boost::test_tools::per_element());
+
+	BOOST_TEST(registry.initAll(jobs));
+	BOOST_TEST(registry.isInitialized());
+	BOOST_TEST(log.inits.size() == 5u);
+	BOOST_TEST(registry.getStartupProfile().init.size() == 5u);
+	BOOST_TEST(!registry.registerSubsystem(makeSubsystem(log, "Late", {})));
+
+	registry.shutdownAll();
+	BOOST_TEST(log.shutdowns.size() == 5u);
+	// Exact reverse of the init order, so everything shuts down before what it depends on
+	BOOST_TEST(std::equal(log.inits.rbegin(), log.inits.rend(), log.shutdowns.begin(), log.shutdowns.end()));
+	BOOST_TEST(indexOf(log.shutdowns, "Game") < indexOf(log.shutdowns, "Audio"));
+	BOOST_TEST(indexOf(log.shutdowns, "Audio") < indexOf(log.shutdowns, "Platform"));
+	BOOST_TEST(registry.getStartupProfile().shutdown.size() == 5u);
+
+	// Second shutdown is a no-op
+	registry.shutdownAll();
+	BOOST_TEST(log.shutdowns.size() == 5u);
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(SubsystemCyclesAreRejected)
+{
+	Doobius::JobSystem jobs;
+	CallLog log;
+	Doobius::SubsystemRegistry registry;
+	registry.registerSubsystem(makeSubsystem(log, "Standalone", {}));
+	registry.registerSubsystem(makeSubsystem(log, "A", { "C" }));
+	registry.registerSubsystem(makeSubsystem(log, "B", { "A" }));
+	registry.registerSubsystem(makeSubsystem(log, "C", { "B" }));
+	registry.registerSubsystem(makeSubsystem(log, "DependsOnCycle", { "C" }));
+
+	std::vector<std::string> order;
+	std::string error;
+	BOOST_TEST(!registry.resolveOrder(order, error));
+	BOOST_TEST(order.empty());
+	BOOST_TEST_MESSAGE(error);
+	BOOST_TEST(error.find("cycle") != std::string::npos);
+	for (const char* name : { "A", "B", "C" }) {
+		BOOST_TEST(error.find(std::string(name) + " -> ") != std::string::npos);
+	}
+	BOOST_TEST(error.find("DependsOnCycle") == std::string::npos);
+
+	// Nothing starts when the graph is invalid, not even the subsystems outside the cycle
+	BOOST_TEST(!registry.initAll(jobs));
+	BOOST_TEST(log.inits.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SubsystemSelfAndMissingDependencies)
+{
+	CallLog log;
+	std::vector<std::string> order;
+	std::string error;
+
+	Doobius::SubsystemRegistry selfRegistry;
+	selfRegistry.registerSubsystem(makeSubsystem(log, "Ouroboros", { "Ouroboros" }));
+	BOOST_TEST(!selfRegistry.resolveOrder(order, error));
+	BOOST_TEST(error.find("Ouroboros -> Ouroboros") != std::string::npos);
+
+	Doobius::SubsystemRegistry missingRegistry;
+	missingRegistry.registerSubsystem(makeSubsystem(log, "Physics", { "Math" }));
+	BOOST_TEST(!missingRegistry.resolveOrder(order, error));
+	BOOST_TEST(error.find("unknown subsystem Math") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(SubsystemFailureSkipsDependents)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeJobConfig(1));
+	CallLog log;
+	Doobius::SubsystemRegistry registry;
+	registry.registerSubsystem(makeSubsystem(log, "Platform", {}));
+	registry.registerSubsystem({ "Gpu", { "Platform" }, []() { return false; }, []() {} });
+	registry.registerSubsystem(makeSubsystem(log, "Renderer", { "Gpu" }));
+	registry.registerSubsystem(makeSubsystem(log, "Ui", { "Renderer" }));
+	registry.registerSubsystem(makeSubsystem(log, "Audio", { "Platform" }));
+
+	BOOST_TEST(!registry.initAll(jobs));
+	BOOST_TEST(log.hasInit("Platform"));
+	BOOST_TEST(log.hasInit("Audio"));
+	BOOST_TEST(!log.hasInit("Renderer"));
+	BOOST_TEST(!log.hasInit("Ui"));
+
+	std::size_t numSkipped = 0;
+	for (const Doobius::SubsystemTiming& timing : registry.getStartupProfile().init) {
+		numSkipped += timing.skipped ? 1 : 0;
+	}
+	BOOST_TEST(numSkipped == 2u);
+
+	// Only what came up gets shut down
+	registry.shutdownAll();
+	BOOST_TEST(log.shutdowns.size() == 2u);
+	BOOST_TEST(log.shutdowns.back() == "Platform");
+	jobs.stop();
+}
+
+BOOST_AUTO_TEST_CASE(IndependentSubsystemsInitInParallel)
+{
+	Doobius::JobSystem jobs;
+	jobs.start(makeJobConfig(3));
+	Doobius::SubsystemRegistry registry;
+	// Four independent 40ms inits; blocking rather than spinning so they overlap even on a single core
+	for (int i = 0; i < 4; ++i) {
+		registry.registerSubsystem({ "Slow" + std::to_string(i), {}, []() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(40));
+			return true;
+		}, nullptr });
+	}
+	registry.registerSubsystem({ "After", { "Slow0", "Slow1", "Slow2", "Slow3" }, nullptr, nullptr });
+
+	BOOST_TEST(registry.initAll(jobs));
+	const Doobius::StartupProfile& profile = registry.getStartupProfile();
+	BOOST_TEST(profile.initSerialMs >= 160.0);
+	BOOST_TEST(profile.initWallMs < profile.initSerialMs * 0.75);
+	BOOST_TEST(profile.initCriticalPathMs >= 40.0);
+	BOOST_TEST(profile.initCriticalPathMs < 100.0);
+	BOOST_TEST(profile.init.back().name == "After");
+	registry.shutdownAll();
+	jobs.stop();
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "doobius/dbg/custom_assert.h"
+
+namespace Doobius {
+	namespace Config {
+		enum class ConfigType : std::uint8_t {
+			BOOL,
+			INT,
+			DOUBLE,
+			STRING
+		};
+
+		// PER_BUILD values are written as { "dbg": ..., "rel-dev": ..., "rel": ... } and the current build's entry is used
+		enum class ConfigScope : std::uint8_t {
+			GLOBAL,
+			PER_BUILD
+		};
+
+		template<typename T>
+		struct ConfigTypeOf;
+		template<> struct ConfigTypeOf<bool> { static constexpr ConfigType value = ConfigType::BOOL; };
+		template<> struct ConfigTypeOf<std::int64_t> { static constexpr ConfigType value = ConfigType::INT; };
+		template<> struct ConfigTypeOf<double> { static constexpr ConfigType value = ConfigType::DOUBLE; };
+		template<> struct ConfigTypeOf<std::string> { static constexpr ConfigType value = ConfigType::STRING; };
+
+		// Strings are read straight out of the cache, everything else by value
+		template<typename T>
+		using ConfigValueType = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>;
+
+		// Typed handle to one field of a ConfigSchema, returned by ConfigSchema::add
+		template<typename T>
+		class ConfigKey {
+		private:
+			std::uint32_t m_index;
+
+			explicit ConfigKey(std::uint32_t index) : m_index(index) {}
+			friend class ConfigSchema;
+		public:
+			inline std::uint32_t getIndex() const { return m_index; }
+		};
+
+		struct ConfigField {
+			std::string key;
+			ConfigType type;
+			ConfigScope scope;
+			// Missing required fields are reported, missing optional ones silently take the default
+			bool required;
+			// Same encoding as a cache slot; for strings the default lives in defaultString
+			std::uint64_t defaultBits;
+			std::string defaultString;
+		};
+
+		/**
+		 * \brief The fields a module reads from its config file, declared once next to the code that uses them:
+		 *
+		 *     Config::ConfigSchema schema{ "log_config" };
+		 *     const Config::ConfigKey<std::int64_t> rotationSize = schema.add<std::int64_t>("rotation_size", 10);
+		 *
+		 * JSON is validated against the schema when it's compiled into a cache, so reads never fail.
+		 */
+		class ConfigSchema {
+		private:
+			std::string m_name;
+			std::vector<ConfigField> m_fields;
+			// 0 until hash() is first called, reset by add()
+			mutable std::uint64_t m_hash;
+		public:
+			explicit ConfigSchema(std::string name) : m_name(std::move(name)), m_hash(0) {}
+
+			ConfigSchema(const ConfigSchema&) = delete;
+			ConfigSchema& operator=(const ConfigSchema&) = delete;
+
+			template<typename T>
+			ConfigKey<T> add(std::string key, T defaultValue, ConfigScope scope = ConfigScope::GLOBAL, bool required = false) {
+				ConfigField field{ std::move(key), ConfigTypeOf<T>::value, scope, required, 0, {} };
+				if constexpr (std::is_same_v<T, std::string>) {
+					field.defaultString = std::move(defaultValue);
+				}
+				else if constexpr (std::is_same_v<T, bool>) {
+					field.defaultBits = defaultValue ? 1 : 0;
+				}
+				else {
+					std::memcpy(&field.defaultBits, &defaultValue, sizeof(field.defaultBits));
+				}
+				m_fields.push_back(std::move(field));
+				m_hash = 0;
+				return ConfigKey<T>(static_cast<std::uint32_t>(m_fields.size() - 1));
+			}
+
+			inline const std::string& getName() const { return m_name; }
+			inline const std::vector<ConfigField>& getFields() const { return m_fields; }
+
+			// Covers names, types, scopes and defaults (defaults are baked into the cache) plus the build configuration
+			std::uint64_t hash() const;
+		};
+
+		enum class ConfigOrigin {
+			DEFAULTS,	// No source file, every field has its default
+			JSON,		// Parsed and validated this launch, cache (re)written
+			CACHE		// Memory-mapped from a cache whose source hash matched
+		};
+
+		/**
+		 * \brief One loaded config file. Each field is an 8-byte slot; strings point into a pool that follows the
+		 * slots. When it came from the cache, that's the mapped file itself and nothing was copied.
+		 */
+		class ConfigSection {
+		private:
+			const ConfigSchema* m_schema;
+			// Keeps the mapped file or the compiled buffer alive
+			std::shared_ptr<const void> m_storage;
+			const std::uint64_t* m_slots;
+			const char* m_strings;
+			ConfigOrigin m_origin;
+			std::uint32_t m_numIssues;
+		public:
+			ConfigSection(const ConfigSchema* schema, std::shared_ptr<const void> storage, const std::uint64_t* slots, const char* strings,
+				ConfigOrigin origin, std::uint32_t numIssues)
+				: m_schema(schema), m_storage(std::move(storage)), m_slots(slots), m_strings(strings), m_origin(origin), m_numIssues(numIssues)
+			{
+			}
+
+			template<typename T>
+			ConfigValueType<T> get(ConfigKey<T> key) const {
+				DOOBIUS_DASSERT(key.getIndex() < m_schema->getFields().size(), "ConfigKey belongs to a different schema");
+				const std::uint64_t slot = m_slots[key.getIndex()];
+				if constexpr (std::is_same_v<T, std::string>) {
+					return std::string_view(m_strings + (slot >> 32), static_cast<std::size_t>(slot & 0xFFFFFFFFull));
+				}
+				else if constexpr (std::is_same_v<T, bool>) {
+					return slot != 0;
+				}
+				else {
+					T value;
+					std::memcpy(&value, &slot, sizeof(value));
+					return value;
+				}
+			}
+
+			inline const ConfigSchema& getSchema() const { return *m_schema; }
+			inline ConfigOrigin getOrigin() const { return m_origin; }
+			// Validation problems found when the JSON was compiled, kept in the cache so later launches still see them
+			inline std::uint32_t getNumIssues() const { return m_numIssues; }
+		};
+
+		/**
+		 * \brief Loads config files through their schemas. The first launch after a config file changes parses and
+		 * validates the JSON and writes a compact binary cache (keyed on a hash of the file's contents, the schema and
+		 * the build configuration) to the cache directory; later launches only hash the file and map the cache.
+		 * Caches use native endianness and are per machine, delete the directory to force a rebuild.
+		 */
+		class ConfigRegistry {
+		private:
+			ConfigRegistry();
+
+			mutable std::mutex m_mutex;
+			std::filesystem::path m_cacheDir;
+			std::map<std::pair<std::string, std::filesystem::path>, std::unique_ptr<ConfigSection>> m_sections;
+			std::map<std::string, const ConfigSection*, std::less<>> m_latestByName;
+			std::uint64_t m_numCacheHits;
+			std::uint64_t m_numCacheBuilds;
+		public:
+			static ConfigRegistry& get();
+
+			ConfigRegistry(const ConfigRegistry&) = delete;
+			ConfigRegistry& operator=(const ConfigRegistry&) = delete;
+
+			// Defaults to DoobiusConfigCache in the system temp directory
+			void setCacheDir(const std::filesystem::path& cacheDir);
+			std::filesystem::path getCacheDir() const;
+
+			/**
+			 * \brief Loads jsonPath through schema, or returns the section already loaded from that file. The schema must
+			 * outlive the registry's use of the section. Never throws on bad input: problems are logged, the affected
+			 * fields take their defaults and the section's issue count goes up.
+			 */
+			const ConfigSection& load(const ConfigSchema& schema, const std::filesystem::path& jsonPath);
+
+			// The section most recently returned by load() for this schema name, nullptr if there is none
+			const ConfigSection* find(std::string_view schemaName) const;
+
+			/**
+			 * \brief Drops every loaded section so the next load() goes back to disk. Meant for benchmarks and tests;
+			 * references to the old sections dangle afterwards.
+			 */
+			void clear();
+
+			std::uint64_t getNumCacheHits() const;
+			std::uint64_t getNumCacheBuilds() const;
+		};
+	}
+}
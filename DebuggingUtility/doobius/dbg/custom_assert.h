@@ -3,17 +3,37 @@
 #include <boost/assert.hpp>
 #include <boost/static_assert.hpp>
 #include <boost/format.hpp>
+#include <boost/config.hpp>
+#include <boost/current_function.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
 #include "doobius/dbg/logging.h"
 
 // Always-active assert. Always resolves to BOOST_ASSERT_MSG
 #define DOOBIUS_ASSERT(EXPR, _MSG) BOOST_ASSERT_MSG(EXPR, _MSG);
 
-// Always-active boost formatted assert. Always resolves to BOOST_ASSERT_MSG
-#define DOOBIUS_FMT_ASSERT(EXPR, _FMT, _ARG)            \
-    do {                                                \
-        boost::format sfmt(_FMT);                       \
-        sfmt % _ARG;                                    \
-        BOOST_ASSERT_MSG((EXPR), sfmt.str().c_str());   \
+/**
+ * Fails to compile when _FMT (which must be a string literal) expects a different number of arguments than _ARG
+ * supplies. _ARG is only looked at in an unevaluated context, so this costs nothing at runtime.
+ */
+#define DOOBIUS_FMT_CHECK(_FMT, _ARG)                                                                   \
+    static_assert(Doobius::Dbg::fmtArgsExpected(_FMT) == decltype(Doobius::Dbg::FmtArgCount<0>{} % _ARG)::value, \
+        "Format string placeholders don't match the number of arguments passed")
+
+// Always-active boost formatted assert. The message is only formatted once EXPR has failed.
+#define DOOBIUS_FMT_ASSERT(EXPR, _FMT, _ARG)                                    \
+    do {                                                                        \
+        DOOBIUS_FMT_CHECK(_FMT, _ARG);                                          \
+        if (BOOST_UNLIKELY(!(EXPR))) {                                          \
+            Doobius::Dbg::fmtAssertFailed(#EXPR, [&]() {                        \
+                boost::format sfmt(_FMT);                                       \
+                sfmt % _ARG;                                                    \
+                return sfmt.str();                                              \
+            }, BOOST_CURRENT_FUNCTION, __FILE__, __LINE__);                     \
+        }                                                                       \
     } while (0)
 
 #if defined(_DEBUG)
@@ -34,11 +54,70 @@
 // Always-active verification. Resolves to BOOST_ASSERT_MSG always.
 #define DOOBIUS_VERIFY(EXPR, _MSG) BOOST_VERIFY_MSG(EXPR, _MSG);
 
-// Always-active boost formatted verification. Resolves to BOOST_ASSERT_MSG always.
-#define DOOBIUS_FMT_VERIFY(EXPR, _FMT, _ARG)            \
-    do {                                                \
-        boost::format sfmt(_FMT);                       \
-        sfmt % _ARG;                                    \
-        BOOST_VERIFY_MSG((EXPR), sfmt.str().c_str());   \
-    } while (0)
+// Always-active boost formatted verification. EXPR is evaluated exactly once, the message only on failure.
+#define DOOBIUS_FMT_VERIFY(EXPR, _FMT, _ARG) DOOBIUS_FMT_ASSERT(EXPR, _FMT, _ARG)
+
+#if defined(_MSC_VER)
+#define DOOBIUS_COLD_NOINLINE __declspec(noinline)
+#else
+#define DOOBIUS_COLD_NOINLINE __attribute__((cold, noinline))
+#endif
+
+namespace Doobius {
+	namespace Dbg {
+		/**
+		 * \brief Number of arguments a boost::format string consumes: the highest N in a %N% placeholder, or one per
+		 * printf-style directive if there are none. "%%" is a literal percent sign.
+		 */
+		constexpr int fmtArgsExpected(std::string_view fmt) {
+			int maxPositional = 0;
+			int numDirectives = 0;
+			for (std::size_t i = 0; i < fmt.size(); ++i) {
+				if (fmt[i] != '%') {
+					continue;
+				}
+				if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+					++i;
+					continue;
+				}
+				std::size_t j = i + 1;
+				int argIdx = 0;
+				while (j < fmt.size() && fmt[j] >= '0' && fmt[j] <= '9') {
+					argIdx = argIdx * 10 + (fmt[j] - '0');
+					++j;
+				}
+				if (j > i + 1 && j < fmt.size() && fmt[j] == '%') {
+					maxPositional = argIdx > maxPositional ? argIdx : maxPositional;
+					i = j;
+					continue;
+				}
+				++numDirectives;
+				if (i + 1 < fmt.size() && fmt[i + 1] == '|') {
+					const std::size_t closing = fmt.find('|', i + 2);
+					i = closing == std::string_view::npos ? fmt.size() : closing;
+				}
+			}
+			return maxPositional > 0 ? maxPositional : numDirectives;
+		}
+
+		// Counts the operands of an "a % b % c" argument chain in an unevaluated context. Never defined.
+		template<int N>
+		struct FmtArgCount {
+			static constexpr int value = N;
+		};
+
+		template<int N, typename T>
+		FmtArgCount<N + 1> operator%(FmtArgCount<N>, const T&);
 
+		/**
+		 * \brief Failure path of DOOBIUS_FMT_ASSERT/VERIFY. Kept out of line and cold so the passing path is a single
+		 * test and branch, with the boost::format construction living in msgFn.
+		 */
+		template<typename MsgFn>
+		[[noreturn]] DOOBIUS_COLD_NOINLINE void fmtAssertFailed(const char* expr, MsgFn&& msgFn, const char* function, const char* file, long line) {
+			const std::string msg = msgFn();
+			boost::assertion_failed_msg(expr, msg.c_str(), function, file, line);
+			std::abort();
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "doobius/dbg/logging.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/log/utility/formatting_ostream.hpp>
+
+namespace Doobius {
+	namespace Log {
+		BOOST_LOG_ATTRIBUTE_KEYWORD(line_id, "LineID", unsigned int)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(line, "Line", std::uint_least32_t)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", severity_level)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(tag_attr, "Tag", std::string)
+		// DOOBIUS_CLOG_TAG with an interned tag, resolved only when the record is formatted
+		BOOST_LOG_ATTRIBUTE_KEYWORD(tag_id_attr, "Tag", Doobius::StringId)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(channel, "Channel", std::string)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(file, "File", std::string)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(scope, "Scope", attrs::named_scope::value_type)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(timeline, "Timeline", attrs::timer::value_type)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
+		BOOST_LOG_ATTRIBUTE_KEYWORD(thread_id, "ThreadID", boost::log::attributes::current_thread_id::value_type)
+
+		// Reference formatters that stream every attribute through formatting_ostream. Not installed on any sink anymore,
+		// kept so the fast formatters below have something to be checked against.
+		void consoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm);
+		void fileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm);
+
+		/**
+		 * \brief Byte-for-byte the same output as the reference formatters, but each record is assembled in a reusable
+		 * per-thread buffer (integers through std::to_chars, the date/second part of the timestamp cached so only the
+		 * sub-second digits are redone) and handed to the stream in one write.
+		 */
+		void fastConsoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm);
+		void fastFileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm);
+	}
+}
@@ -1,11 +1,11 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <source_location>
 #include <filesystem>
 
 #include <boost/log/expressions.hpp>
 #include <boost/log/attributes.hpp>
-#include <boost/stacktrace/stacktrace.hpp>
 
 #include <boost/log/trivial.hpp>
 #include <boost/log/sources/severity_channel_logger.hpp>
@@ -14,6 +14,9 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/utility/manipulators/add_value.hpp>
 
+#include "doobius/dbg/stacktrace.h"
+#include "doobius/dbg/string_id.h"
+
 namespace logging = boost::log;
 namespace src = boost::log::sources;
 namespace expr = boost::log::expressions;
@@ -45,6 +48,9 @@ using severity_level = logging::trivial::severity_level;
 	<< logging::add_value("Line", std::source_location::current().line()) \
 	<< logging::add_value("File", std::filesystem::path(std::source_location::current().file_name()).filename().string())
 
+/**
+ * TAG is a std::string or a StringId; "input/keyboard"_sid avoids building a string for every record
+ */
 #define DOOBIUS_CLOG_TAG(SEV, TAG) \
 	DOOBIUS_CLOG(SEV) \
 	<< logging::add_value("Tag", TAG)
@@ -58,14 +64,21 @@ using severity_level = logging::trivial::severity_level;
 	DOOBIUS_LOG(LOGGER, SEV) \
 	<< logging::add_value("Tag", TAG)
 
+/**
+ * Only raw return addresses and a module/offset table go into the record. Symbols for each distinct stack are
+ * written later by the StacktraceSymbolizer thread, tagged with the same hash.
+ */
 #define DOOBIUS_CLOG_STACKTRACE(SEV) \
 	{ \
 		BOOST_LOG_NAMED_SCOPE("Stacktrace"); \
-		DOOBIUS_CLOG(SEV) << boost::stacktrace::basic_stacktrace(); \
+		DOOBIUS_CLOG(SEV) << Doobius::Log::captureAndSubmitStacktrace(severity_level::SEV); \
 	}
 
 namespace Doobius {
 	namespace Log {
+		// "dbg", "rel-dev" or "rel", the key of the current build's values in config files
+		const std::string& getConfigString();
+
 		class LogManager {
 		private:
 			LogManager();
@@ -86,10 +99,26 @@ namespace Doobius {
 
 			void initLogging(const std::filesystem::path& logDir);
 
+			// Same as above but reads the given config file instead of the solution-level log_config.json
+			void initLogging(const std::filesystem::path& logDir, const std::filesystem::path& logConfigPath);
+
+			/**
+			 * \brief Flushes and removes every sink and resets the settings read from the config so initLogging() can be
+			 * called again. Meant for benchmarks and tests that need to compare sink setups in one process.
+			 */
+			void shutdownLogging();
+
 			// TODO: Implement createSubsystemLogger
 			ModuleLogger createSubsystemLogger(const std::string& subsystemName) const;
 
 			inline const std::filesystem::path& getLogDir() const { return m_fullLogDir; }
+
+			// Records formatted by each sink since startup. Read by the metrics registry in CommonUtility.
+			std::uint64_t getNumFileRecords() const;
+			std::uint64_t getNumConsoleRecords() const;
+			// Records whose formatting threw. Debug builds rethrow to the logging call site, other builds write the line
+			// with a failure marker; the first failure is also reported on stderr.
+			std::uint64_t getNumDroppedRecords() const;
 		};
 	}
 }
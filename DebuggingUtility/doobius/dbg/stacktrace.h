@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <filesystem>
+#include <ostream>
+#include <deque>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <boost/log/trivial.hpp>
+
+namespace Doobius {
+	namespace Log {
+		constexpr std::size_t g_maxStacktraceDepth = 64;
+
+		/**
+		 * \brief Raw return addresses of a call stack. Capturing one only walks the stack; nothing is symbolized until
+		 * the StacktraceSymbolizer gets to it (or until an offline pass maps the log file back to symbols).
+		 *
+		 */
+		class RawStacktrace {
+		private:
+			std::array<void*, g_maxStacktraceDepth> m_frames;
+			std::size_t m_size;
+			std::size_t m_hash;
+		public:
+			RawStacktrace();
+
+			/**
+			 * \brief Captures the calling thread's stack, skipping \p skip frames above the caller.
+			 */
+			static RawStacktrace capture(std::size_t skip = 0);
+
+			inline std::size_t size() const { return m_size; }
+			inline std::size_t hash() const { return m_hash; }
+			inline void* const* frames() const { return m_frames.data(); }
+
+			// Symbolizes every frame. Slow, keep off the hot path.
+			std::string symbolize() const;
+
+			bool operator==(const RawStacktrace& rhs) const;
+		};
+
+		/**
+		 * \brief Writes the module table and module-relative offsets of each frame. This is what ends up in the log file
+		 * and what symbolizeLogFile() parses back.
+		 */
+		std::ostream& operator<<(std::ostream& os, const RawStacktrace& trace);
+
+		/**
+		 * \brief Background symbolizer for captured stacks. Each distinct stack (by hash) is symbolized exactly once on the
+		 * worker thread and written to the log tagged with its hash, so the raw record and its symbols can be paired up.
+		 *
+		 */
+		class StacktraceSymbolizer {
+		private:
+			StacktraceSymbolizer();
+			~StacktraceSymbolizer();
+
+			struct PendingStack {
+				RawStacktrace trace;
+				boost::log::trivial::severity_level sev;
+			};
+
+			void workerLoop();
+			// Waiting is pointless on the worker itself (it would wait on its own in-flight stack) and once stopping
+			bool canWaitLocked() const;
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_cv;
+			std::condition_variable m_drainedCv;
+			std::unordered_set<std::size_t> m_seenHashes;
+			std::deque<PendingStack> m_pending;
+			std::size_t m_inFlight;
+			bool m_stop;
+			std::thread m_worker;
+		public:
+			StacktraceSymbolizer(const StacktraceSymbolizer&) = delete;
+			StacktraceSymbolizer& operator=(const StacktraceSymbolizer&) = delete;
+			StacktraceSymbolizer(StacktraceSymbolizer&&) = delete;
+			StacktraceSymbolizer& operator=(StacktraceSymbolizer&&) = delete;
+
+			static StacktraceSymbolizer& get();
+
+			// Queues the stack for symbolization if its hash hasn't been seen before and the symbolizer isn't shutting
+			// down. Returns true if it was queued.
+			bool submit(const RawStacktrace& trace, boost::log::trivial::severity_level sev);
+
+			// Blocks until everything queued so far has been symbolized and logged. Returns false straight away when
+			// called from the symbolizer's own thread or after shutdown started, true once drained.
+			bool flush();
+			// Same as flush() but gives up after timeout, for paths that must go on to abort regardless
+			bool flushFor(std::chrono::milliseconds timeout);
+
+			std::size_t getNumUniqueStacks() const;
+		};
+
+		// Captures the stack and hands it to the symbolizer. Used by DOOBIUS_CLOG_STACKTRACE.
+		RawStacktrace captureAndSubmitStacktrace(boost::log::trivial::severity_level sev);
+
+		/**
+		 * \brief Offline pass over a log file: every raw stacktrace frame whose module is also loaded in this process
+		 * is replaced by its symbol. Frames from modules that aren't loaded are left as-is.
+		 *
+		 * \return Number of frames that were symbolized
+		 */
+		std::size_t symbolizeLogFile(const std::filesystem::path& inLog, const std::filesystem::path& outLog);
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace Doobius {
+	// 64-bit FNV-1a, usable at compile time
+	constexpr std::uint64_t hashStringId(std::string_view str) {
+		std::uint64_t hash = 14695981039346656037ull;
+		for (char c : str) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/**
+	 * \brief An interned name: the 64-bit hash of the string, so comparing and hashing ids is integer work. Every id
+	 * handed out by internString() or the _sid literal has its string stored in the StringInterner, so it can be turned
+	 * back into text for printing.
+	 */
+	class StringId {
+	private:
+		std::uint64_t m_value;
+
+		constexpr explicit StringId(std::uint64_t value) : m_value(value) {}
+
+		friend class StringInterner;
+		template<std::size_t N>
+		friend struct StringIdLiteral;
+	public:
+		constexpr StringId() : m_value(0) {}
+
+		inline constexpr std::uint64_t getValue() const { return m_value; }
+		inline constexpr bool isNull() const { return m_value == 0; }
+
+		// The interned text; "" for the null id
+		std::string_view view() const;
+		// Null terminated, lives as long as the process
+		const char* c_str() const;
+		inline std::string str() const { return std::string(view()); }
+
+		inline constexpr bool operator==(const StringId& rhs) const { return m_value == rhs.m_value; }
+		inline constexpr bool operator!=(const StringId& rhs) const { return m_value != rhs.m_value; }
+		inline constexpr bool operator<(const StringId& rhs) const { return m_value < rhs.m_value; }
+	};
+
+	std::ostream& operator<<(std::ostream& os, StringId id);
+
+	/**
+	 * \brief Process-wide string table behind StringId. Interning a string already in the table takes a shared lock on
+	 * one of several shards; new strings are copied once into that shard's arena and never freed, so views returned
+	 * by lookup stay valid forever.
+	 */
+	class StringInterner {
+	private:
+		StringInterner() = default;
+	public:
+		StringInterner(const StringInterner&) = delete;
+		StringInterner& operator=(const StringInterner&) = delete;
+
+		static StringInterner& get();
+
+		// A different string already interned under the same hash is logged as an error and fails a debug assert;
+		// release builds go on sharing the id
+		StringId intern(std::string_view str);
+		// The interned text for id, or "" if nothing was interned under it
+		std::string_view lookup(StringId id) const;
+		std::size_t getNumStrings() const;
+		std::size_t getArenaBytes() const;
+	};
+
+	inline StringId internString(std::string_view str) {
+		return StringInterner::get().intern(str);
+	}
+
+	// Literal type for "..."_sid: the characters as a template argument, so each distinct literal gets its own
+	// registration below
+	template<std::size_t N>
+	struct StringIdLiteral {
+		char chars[N];
+
+		constexpr StringIdLiteral(const char(&str)[N]) {
+			for (std::size_t i = 0; i < N; ++i) {
+				chars[i] = str[i];
+			}
+		}
+
+		inline constexpr std::string_view view() const { return std::string_view(chars, N - 1); }
+		inline constexpr StringId toId() const { return StringId(hashStringId(view())); }
+	};
+
+	// Interns each literal during static initialization, so ids made at compile time can still be printed
+	template<StringIdLiteral Literal>
+	struct StringIdRegistration {
+		static inline const StringId id = internString(Literal.view());
+	};
+
+	inline namespace Literals {
+		/**
+		 * \brief "input/keyboard"_sid is hashed at compile time and is a constant expression, e.g. a case label. The
+		 * literal's text is interned before main() runs.
+		 */
+		template<StringIdLiteral Literal>
+		constexpr StringId operator""_sid() {
+			(void)StringIdRegistration<Literal>::id;
+			return Literal.toId();
+		}
+	}
+}
+
+template<>
+struct std::hash<Doobius::StringId> {
+	// Already a hash
+	inline std::size_t operator()(Doobius::StringId id) const noexcept { return static_cast<std::size_t>(id.getValue()); }
+};
@@ -0,0 +1,424 @@
+#include "doobius/dbg/config_registry.h"
+#include "doobius/dbg/logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/json.hpp>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace json = boost::json;
+
+namespace Doobius {
+	namespace Config {
+		namespace {
+			// "DCFG"
+			constexpr std::uint32_t g_cacheMagic = 0x47464344;
+			// Bump when the layout below changes
+			constexpr std::uint32_t g_cacheVersion = 1;
+
+			// Followed by numFields 8-byte slots and then stringBytes of string data
+			struct CacheHeader {
+				std::uint32_t magic;
+				std::uint32_t version;
+				std::uint64_t schemaHash;
+				std::uint64_t sourceHash;
+				std::uint32_t numFields;
+				std::uint32_t numIssues;
+				std::uint32_t stringBytes;
+				std::uint32_t reserved;
+			};
+			static_assert(sizeof(CacheHeader) % sizeof(std::uint64_t) == 0, "Slots after the header must stay 8-byte aligned");
+			constexpr std::size_t g_headerWords = sizeof(CacheHeader) / sizeof(std::uint64_t);
+
+			// Read-only view of a whole file, nullptr from open() if it doesn't exist or can't be mapped
+			class MappedFile {
+			private:
+				const char* m_data = nullptr;
+				std::size_t m_size = 0;
+#if defined(_WIN32)
+				HANDLE m_file = INVALID_HANDLE_VALUE;
+				HANDLE m_mapping = nullptr;
+#endif
+			public:
+				MappedFile() = default;
+				MappedFile(const MappedFile&) = delete;
+				MappedFile& operator=(const MappedFile&) = delete;
+
+				~MappedFile() {
+#if defined(_WIN32)
+					if (m_data) {
+						UnmapViewOfFile(m_data);
+					}
+					if (m_mapping) {
+						CloseHandle(m_mapping);
+					}
+					if (m_file != INVALID_HANDLE_VALUE) {
+						CloseHandle(m_file);
+					}
+#else
+					if (m_data) {
+						munmap(const_cast<char*>(m_data), m_size);
+					}
+#endif
+				}
+
+				static std::shared_ptr<MappedFile> open(const std::filesystem::path& path) {
+					std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>();
+#if defined(_WIN32)
+					mapped->m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+					if (mapped->m_file == INVALID_HANDLE_VALUE) {
+						return nullptr;
+					}
+					LARGE_INTEGER fileSize;
+					if (!GetFileSizeEx(mapped->m_file, &fileSize)) {
+						return nullptr;
+					}
+					mapped->m_size = static_cast<std::size_t>(fileSize.QuadPart);
+					if (mapped->m_size == 0) {
+						return mapped;
+					}
+					mapped->m_mapping = CreateFileMappingW(mapped->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+					if (!mapped->m_mapping) {
+						return nullptr;
+					}
+					mapped->m_data = static_cast<const char*>(MapViewOfFile(mapped->m_mapping, FILE_MAP_READ, 0, 0, 0));
+					return mapped->m_data ? mapped : nullptr;
+#else
+					const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+					if (fd < 0) {
+						return nullptr;
+					}
+					struct stat fileStat;
+					if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+						::close(fd);
+						return nullptr;
+					}
+					mapped->m_size = static_cast<std::size_t>(fileStat.st_size);
+					if (mapped->m_size > 0) {
+						void* data = mmap(nullptr, mapped->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+						if (data != MAP_FAILED) {
+							mapped->m_data = static_cast<const char*>(data);
+						}
+					}
+					// The mapping keeps the file alive on its own
+					::close(fd);
+					return mapped->m_data || mapped->m_size == 0 ? mapped : nullptr;
+#endif
+				}
+
+				inline const char* data() const { return m_data; }
+				inline std::size_t size() const { return m_size; }
+				inline std::string_view view() const { return std::string_view(m_data, m_size); }
+			};
+
+			const char* getTypeName(ConfigType type) {
+				switch (type) {
+				case ConfigType::BOOL:   return "bool";
+				case ConfigType::INT:    return "integer";
+				case ConfigType::DOUBLE: return "number";
+				case ConfigType::STRING: return "string";
+				}
+				return "?";
+			}
+
+			/**
+			 * Validates root against the schema and lays the result out exactly as the cache file: header, slots, strings.
+			 * root is null when there is no source file, which gives every field its default without reporting anything.
+			 * ioNumIssues comes in holding issues found before compiling (a parse error) and goes out with the total.
+			 */
+			std::shared_ptr<std::vector<std::uint64_t>> compileSection(const ConfigSchema& schema, const json::value* root,
+				std::uint64_t schemaHash, std::uint64_t sourceHash, std::uint32_t& ioNumIssues)
+			{
+				const std::vector<ConfigField>& fields = schema.getFields();
+				std::vector<std::uint64_t> slots(fields.size());
+				std::string strings;
+				std::uint32_t numIssues = ioNumIssues;
+				auto reportIssue = [&schema, &numIssues](const std::string& msg) {
+					++numIssues;
+					DOOBIUS_CLOG(warning) << "Config " << schema.getName() << ": " << msg;
+				};
+
+				const json::object* rootObj = root && root->is_object() ? &root->as_object() : nullptr;
+				if (root && !rootObj) {
+					reportIssue("top level isn't an object. Using defaults.");
+				}
+
+				for (std::size_t i = 0; i < fields.size(); ++i) {
+					const ConfigField& field = fields[i];
+					const json::value* val = rootObj ? rootObj->if_contains(field.key) : nullptr;
+					if (!val) {
+						if (rootObj && field.required) {
+							reportIssue("missing required field " + field.key + ". Using default.");
+						}
+					}
+					else if (field.scope == ConfigScope::PER_BUILD) {
+						if (!val->is_object()) {
+							reportIssue(field.key + " should hold one value per build configuration. Using default.");
+							val = nullptr;
+						}
+						else if (!(val = val->as_object().if_contains(Log::getConfigString()))) {
+							reportIssue("Couldn't find " + field.key + " for config=" + Log::getConfigString() + ". Using default.");
+						}
+					}
+
+					std::uint64_t bits = field.defaultBits;
+					std::string_view str = field.defaultString;
+					bool typeMatches = true;
+					if (val) {
+						switch (field.type) {
+						case ConfigType::BOOL:
+							typeMatches = val->is_bool();
+							bits = typeMatches ? (val->as_bool() ? 1 : 0) : bits;
+							break;
+						case ConfigType::INT:
+							typeMatches = val->is_int64() || (val->is_uint64() && val->as_uint64() <= static_cast<std::uint64_t>(INT64_MAX));
+							if (typeMatches) {
+								const std::int64_t intVal = val->is_int64() ? val->as_int64() : static_cast<std::int64_t>(val->as_uint64());
+								std::memcpy(&bits, &intVal, sizeof(bits));
+							}
+							break;
+						case ConfigType::DOUBLE:
+							typeMatches = val->is_number();
+							if (typeMatches) {
+								const double doubleVal = val->to_number<double>();
+								std::memcpy(&bits, &doubleVal, sizeof(bits));
+							}
+							break;
+						case ConfigType::STRING:
+							typeMatches = val->is_string();
+							str = typeMatches ? std::string_view(val->as_string()) : str;
+							break;
+						}
+						if (!typeMatches) {
+							reportIssue(field.key + " should be a " + getTypeName(field.type) + ". Using default.");
+						}
+					}
+					if (field.type == ConfigType::STRING) {
+						bits = (static_cast<std::uint64_t>(strings.size()) << 32) | static_cast<std::uint64_t>(str.size());
+						strings.append(str);
+					}
+					slots[i] = bits;
+				}
+
+				if (rootObj) {
+					for (const json::key_value_pair& entry : *rootObj) {
+						const bool known = std::any_of(fields.begin(), fields.end(), [&entry](const ConfigField& field) { return field.key == entry.key(); });
+						if (!known) {
+							reportIssue("unknown field " + std::string(entry.key()) + " is ignored.");
+						}
+					}
+				}
+
+				const std::size_t stringWords = (strings.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+				auto blob = std::make_shared<std::vector<std::uint64_t>>(g_headerWords + slots.size() + stringWords, 0);
+				const CacheHeader header{ g_cacheMagic, g_cacheVersion, schemaHash, sourceHash, static_cast<std::uint32_t>(slots.size()),
+					numIssues, static_cast<std::uint32_t>(strings.size()), 0 };
+				std::memcpy(blob->data(), &header, sizeof(header));
+				std::memcpy(blob->data() + g_headerWords, slots.data(), slots.size() * sizeof(std::uint64_t));
+				std::memcpy(blob->data() + g_headerWords + slots.size(), strings.data(), strings.size());
+				ioNumIssues = numIssues;
+				return blob;
+			}
+
+			std::size_t getBlobBytes(const std::vector<std::uint64_t>& blob) {
+				CacheHeader header;
+				std::memcpy(&header, blob.data(), sizeof(header));
+				return sizeof(CacheHeader) + header.numFields * sizeof(std::uint64_t) + header.stringBytes;
+			}
+
+			// A cache is only used if it was built from the same bytes, schema and build config, and is intact
+			bool isCacheValid(const MappedFile& cache, const ConfigSchema& schema, std::uint64_t schemaHash, std::uint64_t sourceHash) {
+				if (cache.size() < sizeof(CacheHeader)) {
+					return false;
+				}
+				CacheHeader header;
+				std::memcpy(&header, cache.data(), sizeof(header));
+				if (header.magic != g_cacheMagic || header.version != g_cacheVersion || header.schemaHash != schemaHash
+					|| header.sourceHash != sourceHash || header.numFields != schema.getFields().size()
+					|| cache.size() != sizeof(CacheHeader) + header.numFields * sizeof(std::uint64_t) + header.stringBytes) {
+					return false;
+				}
+				const std::uint64_t* slots = reinterpret_cast<const std::uint64_t*>(cache.data() + sizeof(CacheHeader));
+				for (std::size_t i = 0; i < schema.getFields().size(); ++i) {
+					if (schema.getFields()[i].type == ConfigType::STRING && (slots[i] >> 32) + (slots[i] & 0xFFFFFFFFull) > header.stringBytes) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// Written next to the cache and renamed over it, so a concurrent launch never maps half a file
+			void writeCache(const std::filesystem::path& cachePath, const std::vector<std::uint64_t>& blob) {
+				std::error_code ec;
+				std::filesystem::create_directories(cachePath.parent_path(), ec);
+				std::filesystem::path tmpPath = cachePath;
+				tmpPath += ".tmp";
+				{
+					std::ofstream cacheFile(tmpPath, std::ios::binary | std::ios::trunc);
+					cacheFile.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(getBlobBytes(blob)));
+					if (cacheFile.fail()) {
+						DOOBIUS_CLOG(warning) << "Couldn't write config cache " << tmpPath.string();
+						return;
+					}
+				}
+				std::filesystem::rename(tmpPath, cachePath, ec);
+				if (ec) {
+					DOOBIUS_CLOG(warning) << "Couldn't replace config cache " << cachePath.string() << ": " << ec.message();
+					std::filesystem::remove(tmpPath, ec);
+				}
+			}
+		}
+
+		std::uint64_t ConfigSchema::hash() const
+		{
+			if (m_hash != 0) {
+				return m_hash;
+			}
+			std::string desc = m_name;
+			desc += '\0';
+			desc += Log::getConfigString();
+			for (const ConfigField& field : m_fields) {
+				desc += '\0';
+				desc += field.key;
+				const std::uint8_t flags[3] = { static_cast<std::uint8_t>(field.type), static_cast<std::uint8_t>(field.scope), static_cast<std::uint8_t>(field.required) };
+				desc.append(reinterpret_cast<const char*>(flags), sizeof(flags));
+				desc.append(reinterpret_cast<const char*>(&field.defaultBits), sizeof(field.defaultBits));
+				desc += field.defaultString;
+			}
+			m_hash = hashStringId(desc);
+			return m_hash;
+		}
+
+		ConfigRegistry::ConfigRegistry() : m_numCacheHits{ 0 }, m_numCacheBuilds{ 0 }
+		{
+			std::error_code ec;
+			m_cacheDir = std::filesystem::temp_directory_path(ec) / "DoobiusConfigCache";
+		}
+
+		ConfigRegistry& ConfigRegistry::get()
+		{
+			static ConfigRegistry _registry;
+			return _registry;
+		}
+
+		void ConfigRegistry::setCacheDir(const std::filesystem::path& cacheDir)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cacheDir = cacheDir;
+		}
+
+		std::filesystem::path ConfigRegistry::getCacheDir() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_cacheDir;
+		}
+
+		const ConfigSection& ConfigRegistry::load(const ConfigSchema& schema, const std::filesystem::path& jsonPath)
+		{
+			BOOST_LOG_NAMED_SCOPE("ConfigLoad");
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::error_code pathEc;
+			const std::filesystem::path sourcePath = std::filesystem::absolute(jsonPath, pathEc).lexically_normal();
+			auto loadedIt = m_sections.find(std::make_pair(schema.getName(), sourcePath));
+			if (loadedIt != m_sections.end()) {
+				m_latestByName[schema.getName()] = loadedIt->second.get();
+				return *loadedIt->second;
+			}
+
+			auto makeSection = [&schema](std::shared_ptr<const void> storage, const char* base, ConfigOrigin origin, std::uint32_t numIssues) {
+				const std::uint64_t* slots = reinterpret_cast<const std::uint64_t*>(base + sizeof(CacheHeader));
+				const char* strings = reinterpret_cast<const char*>(slots + schema.getFields().size());
+				return std::make_unique<ConfigSection>(&schema, std::move(storage), slots, strings, origin, numIssues);
+			};
+
+			const std::uint64_t schemaHash = schema.hash();
+			std::unique_ptr<ConfigSection> section;
+			std::uint32_t numIssues = 0;
+			std::shared_ptr<MappedFile> source = MappedFile::open(jsonPath);
+			if (!source) {
+				DOOBIUS_CLOG(warning) << "Couldn't find/open " << jsonPath.string() << ". Using defaults for " << schema.getName();
+				std::shared_ptr<std::vector<std::uint64_t>> blob = compileSection(schema, nullptr, schemaHash, 0, numIssues);
+				const char* base = reinterpret_cast<const char*>(blob->data());
+				section = makeSection(std::move(blob), base, ConfigOrigin::DEFAULTS, numIssues);
+			}
+			else {
+				const std::uint64_t sourceHash = hashStringId(source->view());
+				// The path is part of the name so tests and tools loading another file through the same schema don't evict the real cache
+				std::ostringstream cacheName;
+				cacheName << schema.getName() << '.' << Log::getConfigString() << '.' << std::hex << (hashStringId(sourcePath.generic_string()) & 0xFFFFFFFFull) << ".cfgcache";
+				const std::filesystem::path cachePath = m_cacheDir / cacheName.str();
+				std::shared_ptr<MappedFile> cache = MappedFile::open(cachePath);
+				if (cache && isCacheValid(*cache, schema, schemaHash, sourceHash)) {
+					CacheHeader header;
+					std::memcpy(&header, cache->data(), sizeof(header));
+					if (header.numIssues > 0) {
+						DOOBIUS_CLOG(warning) << "Config " << schema.getName() << " had " << header.numIssues << " issue(s) when " << jsonPath.string()
+							<< " was compiled. Fix them and the cache is rebuilt on the next launch.";
+					}
+					const char* base = cache->data();
+					section = makeSection(std::move(cache), base, ConfigOrigin::CACHE, header.numIssues);
+					++m_numCacheHits;
+				}
+				else {
+					// Unmapped before it's replaced, Windows won't rename over a mapped file
+					cache.reset();
+					DOOBIUS_CLOG(info) << "Compiling " << jsonPath.string() << " into " << cachePath.string();
+					boost::system::error_code parseEc;
+					json::value root = json::parse(source->view(), parseEc);
+					if (parseEc) {
+						DOOBIUS_CLOG(warning) << "Config " << schema.getName() << ": couldn't parse " << jsonPath.string() << " (" << parseEc.message() << "). Using defaults.";
+						++numIssues;
+					}
+					std::shared_ptr<std::vector<std::uint64_t>> blob = compileSection(schema, parseEc ? nullptr : &root, schemaHash, sourceHash, numIssues);
+					writeCache(cachePath, *blob);
+					const char* base = reinterpret_cast<const char*>(blob->data());
+					section = makeSection(std::move(blob), base, ConfigOrigin::JSON, numIssues);
+					++m_numCacheBuilds;
+				}
+			}
+
+			const ConfigSection& loaded = *section;
+			m_latestByName[schema.getName()] = section.get();
+			m_sections.emplace(std::make_pair(schema.getName(), sourcePath), std::move(section));
+			return loaded;
+		}
+
+		const ConfigSection* ConfigRegistry::find(std::string_view schemaName) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_latestByName.find(schemaName);
+			return it == m_latestByName.end() ? nullptr : it->second;
+		}
+
+		void ConfigRegistry::clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_latestByName.clear();
+			m_sections.clear();
+		}
+
+		std::uint64_t ConfigRegistry::getNumCacheHits() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_numCacheHits;
+		}
+
+		std::uint64_t ConfigRegistry::getNumCacheBuilds() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_numCacheBuilds;
+		}
+	}
+}
@@ -1,6 +1,13 @@
 #pragma once
 #include "doobius/dbg/custom_assert.h"
 
+#include <chrono>
+
+namespace {
+	// How long a failed assert waits for its stacktrace to be symbolized before aborting anyway
+	constexpr std::chrono::milliseconds g_assertSymbolizeTimeout{ 2000 };
+}
+
 namespace boost
 {
 #if defined(BOOST_ASSERT_HANDLER_IS_NORETURN)
@@ -18,6 +25,8 @@ namespace boost
 
 		DOOBIUS_CLOG(error) << assertOss.str();
 		DOOBIUS_CLOG_STACKTRACE(error);
+		// About to go down, so symbolize now instead of leaving it to the worker, but never hang the abort on it
+		Doobius::Log::StacktraceSymbolizer::get().flushFor(g_assertSymbolizeTimeout);
 #if defined(_DEBUG)
 		__debugbreak();
 #endif // defined(_DEBUG)
@@ -38,6 +47,8 @@ namespace boost
 
 		DOOBIUS_CLOG(error) << assertOss.str();
 		DOOBIUS_CLOG_STACKTRACE(error);
+		// About to go down, so symbolize now instead of leaving it to the worker, but never hang the abort on it
+		Doobius::Log::StacktraceSymbolizer::get().flushFor(g_assertSymbolizeTimeout);
 #if defined(_DEBUG)
 		__debugbreak();
 #endif // defined(_DEBUG)
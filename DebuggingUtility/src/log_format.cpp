@@ -0,0 +1,272 @@
+#include "doobius/dbg/log_format.h"
+#include <charconv>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/log/support/date_time.hpp>
+
+namespace Doobius {
+	namespace Log {
+		class Terminal {
+		public:
+			static constexpr const char* reset() { return "\033[0m"; }
+			static constexpr const char* red() { return "\033[31m"; }
+			static constexpr const char* yellow() { return "\033[33m"; }
+			static constexpr const char* blue() { return "\033[34m"; }
+			static constexpr const char* white() { return "\033[37m"; }
+		};
+
+		const char* getSeverityColor(severity_level sev) {
+			switch (sev) {
+			case severity_level::trace:
+			case severity_level::debug:
+			case severity_level::info:
+				return Terminal::white();
+			case severity_level::warning:
+				return Terminal::yellow();
+			case severity_level::error:
+			case severity_level::fatal:
+				return Terminal::red();
+			default:
+				return Terminal::reset();
+			}
+		}
+
+		void consoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
+		{
+			strm << getSeverityColor(*rec[severity]);
+			strm << "<" << rec[severity] << "> ";
+
+			strm << "[" << rec[file] << ":" << rec[line] << "]";
+			strm << "[" << rec[thread_id] << "] ";
+
+			strm << "|";
+			if (auto channelPtr = rec[channel])
+				strm << *channelPtr;
+			strm << ":";
+			if (auto scopePtr = rec[scope])
+				strm << *scopePtr;
+			strm << ":";
+			if (auto tagPtr = rec[tag_attr])
+				strm << *tagPtr;
+			else if (auto tagIdPtr = rec[tag_id_attr])
+				strm << *tagIdPtr;
+			strm << ":";
+			if (auto timelinePtr = rec[timeline])
+				strm << *timelinePtr;
+			strm << "| ";
+
+			strm << "\t";
+			strm << rec[expr::smessage];
+			strm << Terminal::reset();
+		}
+
+		void fileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
+		{
+			strm << "<" << rec[severity] << "> ";
+			strm << "[" << rec[line_id] << "]";
+
+			strm << "[" << rec[file] << ":" << rec[line] << "]";
+			strm << "[" << rec[thread_id] << "]";
+			auto ts = rec[timestamp];
+			strm << "[" << boost::posix_time::to_simple_string(*ts) << "] ";
+
+			strm << "|";
+			if (auto channelPtr = rec[channel])
+				strm << *channelPtr;
+			strm << ":";
+			if (auto scopePtr = rec[scope])
+				strm << *scopePtr;
+			strm << ":";
+			if (auto tagPtr = rec[tag_attr])
+				strm << *tagPtr;
+			else if (auto tagIdPtr = rec[tag_id_attr])
+				strm << *tagIdPtr;
+			strm << ":";
+			if (auto timelinePtr = rec[timeline])
+				strm << *timelinePtr;
+			strm << "| ";
+
+			strm << "\t";
+			strm << rec[expr::smessage];
+		}
+
+		namespace {
+			using ThreadIdNative = boost::log::aux::thread::native_type;
+
+			struct RecordFormatCache {
+				std::string buffer;
+
+				// Everything up to and including the whole seconds of the last timestamp seen on this thread
+				long long cachedSecondKey = -1;
+				std::string cachedSecondStr;
+
+				// Thread ids only change when a different thread's record comes through
+				ThreadIdNative cachedTid = 0;
+				bool cachedTidValid = false;
+				char cachedTidStr[2 + sizeof(ThreadIdNative) * 2];
+			};
+
+			thread_local RecordFormatCache t_formatCache;
+
+			inline void appendUInt(std::string& buf, std::uint64_t val) {
+				char digits[24];
+				std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), val);
+				buf.append(digits, res.ptr);
+			}
+
+			void appendSeverity(std::string& buf, severity_level sev) {
+				if (const char* sevStr = logging::trivial::to_string<char>(sev)) {
+					buf += sevStr;
+				}
+				else {
+					char digits[12];
+					std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), static_cast<int>(sev));
+					buf.append(digits, res.ptr);
+				}
+			}
+
+			// Same layout Boost.Log uses for thread::id: "0x" followed by zero-padded lowercase hex of the native id
+			void appendThreadId(RecordFormatCache& cache, const attrs::current_thread_id::value_type& tid) {
+				ThreadIdNative nativeId = tid.native_id();
+				if (!cache.cachedTidValid || cache.cachedTid != nativeId) {
+					static constexpr char hexDigits[] = "0123456789abcdef";
+					constexpr std::size_t numDigits = sizeof(ThreadIdNative) * 2;
+					cache.cachedTidStr[0] = '0';
+					cache.cachedTidStr[1] = 'x';
+					for (std::size_t i = 0; i < numDigits; ++i) {
+						cache.cachedTidStr[2 + i] = hexDigits[(nativeId >> ((numDigits - 1 - i) * 4)) & 0xF];
+					}
+					cache.cachedTid = nativeId;
+					cache.cachedTidValid = true;
+				}
+				cache.buffer.append(cache.cachedTidStr, sizeof(cache.cachedTidStr));
+			}
+
+			// Mirrors to_simple_string(ptime): "YYYY-Mon-DD HH:MM:SS" plus ".ffffff" only when the fraction is non-zero
+			void appendTimestamp(RecordFormatCache& cache, const boost::posix_time::ptime& ts) {
+				if (ts.is_special()) {
+					cache.buffer += boost::posix_time::to_simple_string(ts);
+					return;
+				}
+
+				const boost::posix_time::time_duration tod = ts.time_of_day();
+				const long long secondKey = static_cast<long long>(ts.date().day_number()) * 86400 + tod.total_seconds();
+				if (secondKey != cache.cachedSecondKey) {
+					boost::posix_time::ptime wholeSecond(ts.date(), boost::posix_time::seconds(tod.total_seconds()));
+					cache.cachedSecondStr = boost::posix_time::to_simple_string(wholeSecond);
+					cache.cachedSecondKey = secondKey;
+				}
+				cache.buffer += cache.cachedSecondStr;
+
+				const auto fracSec = tod.fractional_seconds();
+				if (fracSec != 0) {
+					const std::size_t numFracDigits = static_cast<std::size_t>(boost::posix_time::time_duration::num_fractional_digits());
+					char digits[24];
+					std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), static_cast<std::uint64_t>(fracSec));
+					const std::size_t len = static_cast<std::size_t>(res.ptr - digits);
+					cache.buffer += '.';
+					if (len < numFracDigits) {
+						cache.buffer.append(numFracDigits - len, '0');
+					}
+					cache.buffer.append(digits, len);
+				}
+			}
+
+			// The "|channel:scope:tag:timeline| \tmessage" tail shared by both sinks
+			void appendAttributesAndMessage(std::string& buf, logging::record_view const& rec) {
+				buf += '|';
+				if (auto channelPtr = rec[channel])
+					buf += *channelPtr;
+				buf += ':';
+				if (auto scopePtr = rec[scope]) {
+					bool first = true;
+					for (const auto& scopeEntry : *scopePtr) {
+						if (!first)
+							buf += "->";
+						buf.append(scopeEntry.scope_name.c_str(), scopeEntry.scope_name.size());
+						first = false;
+					}
+				}
+				buf += ':';
+				if (auto tagPtr = rec[tag_attr])
+					buf += *tagPtr;
+				else if (auto tagIdPtr = rec[tag_id_attr])
+					buf += tagIdPtr->view();
+				buf += ':';
+				if (auto timelinePtr = rec[timeline]) {
+					// Timeline is rare enough that going through a stream here doesn't matter
+					std::ostringstream timelineOss;
+					timelineOss << *timelinePtr;
+					buf += timelineOss.str();
+				}
+				buf += "| ";
+
+				buf += '\t';
+				if (auto msgPtr = rec[expr::smessage])
+					buf += *msgPtr;
+			}
+		}
+
+		void fastConsoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
+		{
+			RecordFormatCache& cache = t_formatCache;
+			std::string& buf = cache.buffer;
+			buf.clear();
+
+			auto sevRef = rec[severity];
+			buf += getSeverityColor(*sevRef);
+			buf += '<';
+			if (sevRef)
+				appendSeverity(buf, *sevRef);
+			buf += "> ";
+
+			buf += '[';
+			if (auto filePtr = rec[file])
+				buf += *filePtr;
+			buf += ':';
+			if (auto linePtr = rec[line])
+				appendUInt(buf, *linePtr);
+			buf += "][";
+			if (auto tidPtr = rec[thread_id])
+				appendThreadId(cache, *tidPtr);
+			buf += "] ";
+
+			appendAttributesAndMessage(buf, rec);
+			buf += Terminal::reset();
+
+			strm.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+		}
+
+		void fastFileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
+		{
+			RecordFormatCache& cache = t_formatCache;
+			std::string& buf = cache.buffer;
+			buf.clear();
+
+			buf += '<';
+			if (auto sevPtr = rec[severity])
+				appendSeverity(buf, *sevPtr);
+			buf += "> [";
+			if (auto lineIdPtr = rec[line_id])
+				appendUInt(buf, *lineIdPtr);
+			buf += "][";
+			if (auto filePtr = rec[file])
+				buf += *filePtr;
+			buf += ':';
+			if (auto linePtr = rec[line])
+				appendUInt(buf, *linePtr);
+			buf += "][";
+			if (auto tidPtr = rec[thread_id])
+				appendThreadId(cache, *tidPtr);
+			buf += "][";
+			if (auto tsPtr = rec[timestamp])
+				appendTimestamp(cache, *tsPtr);
+			buf += "] ";
+
+			appendAttributesAndMessage(buf, rec);
+
+			strm.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+		}
+	}
+}
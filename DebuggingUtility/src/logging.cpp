@@ -1,52 +1,18 @@
 #include "doobius/dbg/logging.h"
-#include <fstream>
+#include "doobius/dbg/log_format.h"
+#include "doobius/dbg/config_registry.h"
+#include <atomic>
+#include <cstdio>
+#include <exception>
 
 #include <boost/core/null_deleter.hpp>
 #include <boost/log/sinks/text_ostream_backend.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/log/support/date_time.hpp>
 #include <boost/log/utility/setup/file.hpp>
-#include <boost/json.hpp>
-namespace json = boost::json;
-
-BOOST_LOG_ATTRIBUTE_KEYWORD(line_id, "LineID", unsigned int)
-BOOST_LOG_ATTRIBUTE_KEYWORD(line, "Line", std::uint_least32_t)
-BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", severity_level)
-BOOST_LOG_ATTRIBUTE_KEYWORD(tag_attr, "Tag", std::string)
-BOOST_LOG_ATTRIBUTE_KEYWORD(channel, "Channel", std::string)
-BOOST_LOG_ATTRIBUTE_KEYWORD(file, "File", std::string)
-BOOST_LOG_ATTRIBUTE_KEYWORD(scope, "Scope", attrs::named_scope::value_type)
-BOOST_LOG_ATTRIBUTE_KEYWORD(timeline, "Timeline", attrs::timer::value_type)
-BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
-BOOST_LOG_ATTRIBUTE_KEYWORD(thread_id, "ThreadID", boost::log::attributes::current_thread_id::value_type)
 
 namespace Doobius {
 	namespace Log {
-		class Terminal {
-		public:
-			static constexpr const char* reset() { return "\033[0m"; }
-			static constexpr const char* red() { return "\033[31m"; }
-			static constexpr const char* yellow() { return "\033[33m"; }
-			static constexpr const char* blue() { return "\033[34m"; }
-			static constexpr const char* white() { return "\033[37m"; }
-		};
-
-		const char* getSeverityColor(severity_level sev) {
-			switch (sev) {
-			case severity_level::trace:
-			case severity_level::debug:
-			case severity_level::info:
-				return Terminal::white();
-			case severity_level::warning:
-				return Terminal::yellow();
-			case severity_level::error:
-			case severity_level::fatal:
-				return Terminal::red();
-			default:
-				return Terminal::reset();
-			}
-		}
-
 		const std::string& getConfigString() {
 #if defined(Debug_CONFIG)
 			static const std::string configStr = "dbg";
@@ -61,12 +27,65 @@ namespace Doobius {
 			return configStr;
 		}
 
-		static struct LogFileSetting {
+		struct LogFileSetting {
 			severity_level minSeverity = severity_level::trace;
 			severity_level minConsoleLogSeverity = severity_level::info;
 			std::string logFilePrefix = "default-dbg";
 			__int64 rotationSizeInMb = 10;
-		} logFileSetting;
+			bool consoleSinkEnabled = true;
+		};
+		static LogFileSetting logFileSetting;
+
+		static std::atomic<std::uint64_t> numFileRecords{ 0 };
+		static std::atomic<std::uint64_t> numConsoleRecords{ 0 };
+		static std::atomic<std::uint64_t> numDroppedRecords{ 0 };
+
+		/**
+		 * \brief Called from the catch block when formatting a record threw. Counts the record as dropped and reports
+		 * the first one on stderr, since the sinks may be what's broken. Debug builds rethrow so the failure surfaces
+		 * at the logging call; other builds mark the line and carry on.
+		 */
+		void onRecordFormatFailed(const char* sinkName, [[maybe_unused]] logging::formatting_ostream& strm) {
+			numDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+			static std::atomic<bool> reported{ false };
+			std::string what = "unknown exception";
+			try {
+				throw;
+			}
+			catch (const std::exception& e) {
+				what = e.what();
+			}
+			catch (...) {
+			}
+			if (!reported.exchange(true, std::memory_order_relaxed)) {
+				std::fprintf(stderr, "Doobius logging: formatting a %s record failed (%s), further failures are only counted\n", sinkName, what.c_str());
+			}
+#if defined(_DEBUG)
+			throw;
+#else
+			strm << " <record formatting failed: " << what << '>';
+#endif
+		}
+
+		void countingConsoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm) {
+			numConsoleRecords.fetch_add(1, std::memory_order_relaxed);
+			try {
+				fastConsoleLogRecordFormat(rec, strm);
+			}
+			catch (...) {
+				onRecordFormatFailed("console", strm);
+			}
+		}
+
+		void countingFileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm) {
+			numFileRecords.fetch_add(1, std::memory_order_relaxed);
+			try {
+				fastFileLogRecordFormat(rec, strm);
+			}
+			catch (...) {
+				onRecordFormatFailed("file", strm);
+			}
+		}
 
 
 		severity_level parseSev(const std::string_view& sevStr) {
@@ -120,103 +139,39 @@ namespace Doobius {
 			return buildConfigStr;
 		}
 
-		void readSettingsFromJson(json::value const& logConfigJson) {
-			BOOST_LOG_NAMED_SCOPE("SettingsParse");
-			BOOST_LOG_TRIVIAL(info) << "Now reading configuration present in the config file...";
-			json::object const& root = logConfigJson.as_object();
-
-			// Minimum Log Severity
-			json::object const& minSev = root.at("min_severity").as_object();
-			if (auto minSevPtr = minSev.if_contains(getConfigString())) {
-				logFileSetting.minSeverity = parseSev(minSevPtr->as_string());
-			}
-			else {
-				BOOST_LOG_TRIVIAL(warning) << "Couldn't find min_severity for config=" << getConfigString() << ". Using default.";
-			}
-
-			// Minimum Log Severity for Console Logging
-			json::object const& cMinSev = root.at("console_min_severity").as_object();
-			if (auto cMinSevPtr = cMinSev.if_contains(getConfigString())) {
-				logFileSetting.minConsoleLogSeverity = parseSev(cMinSevPtr->as_string());
-			}
-			else {
-				BOOST_LOG_TRIVIAL(warning) << "Couldn't find console_min_severity for config=" << getConfigString() << ". Using default.";
-			}
-
-			// Log File Prefix for the log file into which records are stored
-			json::object const& logFilePrefix = root.at("log_file_prefix").as_object();
-			if (auto lfpPtr = logFilePrefix.if_contains(getConfigString())) {
-				logFileSetting.logFilePrefix = lfpPtr->as_string();
-			}
-			else {
-				BOOST_LOG_TRIVIAL(warning) << "Couldn't find log_file_prefix for config=" << getConfigString() << ". Using default.";
-			}
-
-			// Rotation Size (MB) of the log file
-			json::object const& rotationSize = root.at("rotation_size").as_object();
-			if (auto rotSizePtr = rotationSize.if_contains(getConfigString())) {
-				logFileSetting.rotationSizeInMb = rotSizePtr->as_int64();
-			}
-			else {
-				BOOST_LOG_TRIVIAL(warning) << "Couldn't find rotation_size for config=" << getConfigString() << ". Using default.";
-			}
+		// Required fields hold one value per build configuration, defaults match LogFileSetting's
+		struct LogConfigSchema {
+			Config::ConfigSchema schema{ "log_config" };
+			Config::ConfigKey<std::string> minSeverity = schema.add<std::string>("min_severity", "trace", Config::ConfigScope::PER_BUILD, true);
+			Config::ConfigKey<std::string> consoleMinSeverity = schema.add<std::string>("console_min_severity", "info", Config::ConfigScope::PER_BUILD, true);
+			Config::ConfigKey<std::string> logFilePrefix = schema.add<std::string>("log_file_prefix", "default-dbg", Config::ConfigScope::PER_BUILD, true);
+			// In MB
+			Config::ConfigKey<std::int64_t> rotationSize = schema.add<std::int64_t>("rotation_size", 10, Config::ConfigScope::PER_BUILD, true);
+			Config::ConfigKey<bool> consoleSinkEnabled = schema.add<bool>("console_sink_enabled", true, Config::ConfigScope::PER_BUILD);
+		};
 
-			BOOST_LOG_TRIVIAL(info) << "Done parsing config file";
+		const LogConfigSchema& getLogConfigSchema() {
+			static const LogConfigSchema _logConfigSchema;
+			return _logConfigSchema;
 		}
 
-		void consoleLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
-		{
-			strm << getSeverityColor(*rec[severity]);
-			strm << "<" << rec[severity] << "> ";
-
-			strm << "[" << rec[file] << ":" << rec[line] << "]";
-			strm << "[" << rec[thread_id] << "] ";
-
-			strm << "|";
-			if (auto channelPtr = rec[channel])
-				strm << *channelPtr;
-			strm << ":";
-			if (auto scopePtr = rec[scope])
-				strm << *scopePtr;
-			strm << ":";
-			if (auto tagPtr = rec[tag_attr])
-				strm << *tagPtr;
-			strm << ":";
-			if (auto timelinePtr = rec[timeline])
-				strm << *timelinePtr;
-			strm << "| ";
-
-			strm << "\t";
-			strm << rec[expr::smessage];
-			strm << Terminal::reset();
+		void readSettingsFromConfig(const Config::ConfigSection& logConfig) {
+			BOOST_LOG_NAMED_SCOPE("SettingsParse");
+			BOOST_LOG_TRIVIAL(info) << "Now reading configuration present in the config file...";
+			const LogConfigSchema& keys = getLogConfigSchema();
+			logFileSetting.minSeverity = parseSev(logConfig.get(keys.minSeverity));
+			logFileSetting.minConsoleLogSeverity = parseSev(logConfig.get(keys.consoleMinSeverity));
+			logFileSetting.logFilePrefix = logConfig.get(keys.logFilePrefix);
+			logFileSetting.rotationSizeInMb = logConfig.get(keys.rotationSize);
+			logFileSetting.consoleSinkEnabled = logConfig.get(keys.consoleSinkEnabled);
+			BOOST_LOG_TRIVIAL(info) << "Done parsing config file";
 		}
 
-		void fileLogRecordFormat(logging::record_view const& rec, logging::formatting_ostream& strm)
+		void setupGlobalAttributes()
 		{
-			strm << "<" << rec[severity] << "> ";
-			strm << "[" << rec[line_id] << "]";
-
-			strm << "[" << rec[file] << ":" << rec[line] << "]";
-			strm << "[" << rec[thread_id] << "]";
-			auto ts = rec[timestamp];
-			strm << "[" << boost::posix_time::to_simple_string(*ts) << "] ";
-
-			strm << "|";
-			if (auto channelPtr = rec[channel])
-				strm << *channelPtr;
-			strm << ":";
-			if (auto scopePtr = rec[scope])
-				strm << *scopePtr;
-			strm << ":";
-			if (auto tagPtr = rec[tag_attr])
-				strm << *tagPtr;
-			strm << ":";
-			if (auto timelinePtr = rec[timeline])
-				strm << *timelinePtr;
-			strm << "| ";
-
-			strm << "\t";
-			strm << rec[expr::smessage];
+			boost::shared_ptr< logging::core > core = logging::core::get();
+			core->add_global_attribute("Scope", attrs::named_scope());
+			logging::add_common_attributes();
 		}
 
 		void setupConsoleSink()
@@ -228,14 +183,11 @@ namespace Doobius {
 			typedef sinks::synchronous_sink< text_stream > sink_t;
 
 			boost::shared_ptr< logging::core > core = logging::core::get();
-			core->add_global_attribute("Scope", attrs::named_scope());
-			logging::add_common_attributes();
-
 			boost::shared_ptr< sink_t > clSink = boost::make_shared< sink_t >();
 			clSink->locked_backend()->add_stream(boost::shared_ptr< std::ostream >(&std::clog, boost::null_deleter()));
 
 			clSink->set_filter(severity >= logFileSetting.minConsoleLogSeverity);
-			clSink->set_formatter(&consoleLogRecordFormat);
+			clSink->set_formatter(&countingConsoleLogRecordFormat);
 
 			BOOST_LOG_TRIVIAL(info) << "Switching to new console logger";
 			core->add_sink(clSink);
@@ -263,7 +215,7 @@ namespace Doobius {
 				keywords::file_name = logFilePath,
 				keywords::rotation_size = logFileSetting.rotationSizeInMb * 1024 * 1024,
 				keywords::time_based_rotation = sinks::file::rotation_at_time_point(0, 0, 0),
-				keywords::format = &fileLogRecordFormat,
+				keywords::format = &countingFileLogRecordFormat,
 				keywords::filter = severity >= logFileSetting.minSeverity
 			);
 			DOOBIUS_CLOG(info) << "Finished setting up file sink";
@@ -277,6 +229,11 @@ namespace Doobius {
 		}
 
 		void LogManager::initLogging(const std::filesystem::path& logDir)
+		{
+			initLogging(logDir, PATH_TO_CONFIGS_DIR / m_nameOfLogConfigFile);
+		}
+
+		void LogManager::initLogging(const std::filesystem::path& logDir, const std::filesystem::path& logConfigPath)
 		{
 			BOOST_LOG_NAMED_SCOPE("InitLogging");
 			if (m_setup) {
@@ -284,28 +241,47 @@ namespace Doobius {
 				return;
 			}
 
-			std::filesystem::path logConfigPath = PATH_TO_CONFIGS_DIR / m_nameOfLogConfigFile;
-
-			std::ifstream logConfigStream(logConfigPath);
-			if (logConfigStream.fail()) {
-				BOOST_LOG_TRIVIAL(warning) << "Couldn't find/open " << logConfigPath.string() << ". Reverting to default log configuration";
-			}
-			else {
-				BOOST_LOG_TRIVIAL(info) << "Found " << logConfigPath.string() << ".";
-
-				std::ostringstream tempFileContents;
-				tempFileContents << logConfigStream.rdbuf();
-
-				json::value logConfigJson = json::parse(tempFileContents.str());
-				readSettingsFromJson(logConfigJson);
-			}
+			// Missing files, parse errors and missing fields are reported by the registry and fall back to defaults
+			readSettingsFromConfig(Config::ConfigRegistry::get().load(getLogConfigSchema().schema, logConfigPath));
 			// At this point, logFileSetting is valid and up-to-date
-			setupConsoleSink();
+			setupGlobalAttributes();
+			if (logFileSetting.consoleSinkEnabled) {
+				setupConsoleSink();
+			}
 			DOOBIUS_CLOG(info) << getBuildEnvironmentString();
 			setupFileSink(logDir);
 
 			m_fullLogDir = logDir;
 			m_setup = true;
 		}
+
+		void LogManager::shutdownLogging()
+		{
+			if (!m_setup) {
+				return;
+			}
+			boost::shared_ptr< logging::core > core = logging::core::get();
+			core->flush();
+			core->remove_all_sinks();
+
+			logFileSetting = LogFileSetting{};
+			m_fullLogDir.clear();
+			m_setup = false;
+		}
+
+		std::uint64_t LogManager::getNumFileRecords() const
+		{
+			return numFileRecords.load(std::memory_order_relaxed);
+		}
+
+		std::uint64_t LogManager::getNumConsoleRecords() const
+		{
+			return numConsoleRecords.load(std::memory_order_relaxed);
+		}
+
+		std::uint64_t LogManager::getNumDroppedRecords() const
+		{
+			return numDroppedRecords.load(std::memory_order_relaxed);
+		}
 	}
 }
\ No newline at end of file
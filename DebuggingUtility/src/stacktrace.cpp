@@ -0,0 +1,303 @@
+#include "doobius/dbg/stacktrace.h"
+#include "doobius/dbg/logging.h"
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+
+#include <boost/stacktrace/safe_dump_to.hpp>
+#include <boost/stacktrace/frame.hpp>
+#include <boost/container_hash/hash.hpp>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+namespace Doobius {
+	namespace Log {
+		namespace {
+			struct ModuleInfo {
+				std::string path;
+				std::uintptr_t base = 0;
+			};
+
+			// Resolves which loaded module an address belongs to. This is a loader lookup, not symbolization, so it's cheap.
+			bool resolveModule(const void* addr, ModuleInfo& outInfo) {
+#if defined(_WIN32)
+				HMODULE hMod = nullptr;
+				if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCSTR>(addr), &hMod)) {
+					return false;
+				}
+				char modPath[MAX_PATH];
+				DWORD len = GetModuleFileNameA(hMod, modPath, MAX_PATH);
+				outInfo.path.assign(modPath, len);
+				outInfo.base = reinterpret_cast<std::uintptr_t>(hMod);
+				return true;
+#else
+				Dl_info info;
+				if (dladdr(addr, &info) == 0 || info.dli_fname == nullptr) {
+					return false;
+				}
+				outInfo.path = info.dli_fname;
+				outInfo.base = reinterpret_cast<std::uintptr_t>(info.dli_fbase);
+				return true;
+#endif
+			}
+
+			// Finds the load address of a module with the same file name in this process, 0 if it isn't loaded
+			std::uintptr_t findLoadedModuleBase(const std::string& modulePath) {
+				const std::string wantedName = std::filesystem::path(modulePath).filename().string();
+#if defined(_WIN32)
+				return reinterpret_cast<std::uintptr_t>(GetModuleHandleA(wantedName.c_str()));
+#else
+				struct SearchState {
+					const std::string* wantedName;
+					std::uintptr_t base;
+				} state{ &wantedName, 0 };
+
+				dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) -> int {
+					SearchState* st = static_cast<SearchState*>(data);
+					std::filesystem::path modPath = (info->dlpi_name && info->dlpi_name[0]) ? std::filesystem::path(info->dlpi_name) : std::filesystem::read_symlink("/proc/self/exe");
+					if (modPath.filename().string() == *st->wantedName) {
+						st->base = static_cast<std::uintptr_t>(info->dlpi_addr);
+						return 1;
+					}
+					return 0;
+				}, &state);
+				return state.base;
+#endif
+			}
+		}
+
+		RawStacktrace::RawStacktrace() : m_frames{}, m_size{ 0 }, m_hash{ 0 } {}
+
+		RawStacktrace RawStacktrace::capture(std::size_t skip)
+		{
+			RawStacktrace trace;
+			// safe_dump_to() null-terminates, so one slot is always spent on the terminator
+			std::size_t stored = boost::stacktrace::safe_dump_to(skip + 1, trace.m_frames.data(), sizeof(trace.m_frames));
+			while (stored > 0 && trace.m_frames[stored - 1] == nullptr) {
+				--stored;
+			}
+			trace.m_size = stored;
+			trace.m_hash = boost::hash_range(trace.m_frames.begin(), trace.m_frames.begin() + stored);
+			return trace;
+		}
+
+		std::string RawStacktrace::symbolize() const
+		{
+			std::ostringstream symOss;
+			for (std::size_t i = 0; i < m_size; ++i) {
+				symOss << "\n\t#" << i << ' ' << boost::stacktrace::frame(m_frames[i]);
+			}
+			return symOss.str();
+		}
+
+		bool RawStacktrace::operator==(const RawStacktrace& rhs) const
+		{
+			return m_hash == rhs.m_hash && m_size == rhs.m_size && std::equal(m_frames.begin(), m_frames.begin() + m_size, rhs.m_frames.begin());
+		}
+
+		std::ostream& operator<<(std::ostream& os, const RawStacktrace& trace)
+		{
+			std::vector<ModuleInfo> modules;
+			std::ostringstream frameOss;
+			for (std::size_t i = 0; i < trace.size(); ++i) {
+				ModuleInfo info;
+				if (!resolveModule(trace.frames()[i], info)) {
+					frameOss << "\n\t#" << i << " ?+0x" << std::hex << reinterpret_cast<std::uintptr_t>(trace.frames()[i]) << std::dec;
+					continue;
+				}
+
+				std::size_t modIdx = 0;
+				while (modIdx < modules.size() && modules[modIdx].base != info.base) {
+					++modIdx;
+				}
+				if (modIdx == modules.size()) {
+					modules.push_back(std::move(info));
+				}
+				std::uintptr_t offset = reinterpret_cast<std::uintptr_t>(trace.frames()[i]) - modules[modIdx].base;
+				frameOss << "\n\t#" << i << " m" << modIdx << "+0x" << std::hex << offset << std::dec;
+			}
+
+			os << "[stacktrace 0x" << std::hex << trace.hash() << std::dec << "] " << trace.size() << " frames";
+			for (std::size_t i = 0; i < modules.size(); ++i) {
+				os << "\n\tmodule " << i << ' ' << modules[i].path;
+			}
+			return os << frameOss.str();
+		}
+
+		StacktraceSymbolizer::StacktraceSymbolizer() : m_inFlight{ 0 }, m_stop{ false }
+		{
+			m_worker = std::thread(&StacktraceSymbolizer::workerLoop, this);
+		}
+
+		StacktraceSymbolizer::~StacktraceSymbolizer()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cv.notify_one();
+			m_drainedCv.notify_all();
+			if (m_worker.joinable()) {
+				m_worker.join();
+			}
+		}
+
+		StacktraceSymbolizer& StacktraceSymbolizer::get()
+		{
+			static StacktraceSymbolizer _symbolizer;
+			return _symbolizer;
+		}
+
+		bool StacktraceSymbolizer::submit(const RawStacktrace& trace, boost::log::trivial::severity_level sev)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				// The worker may already be gone, nothing would ever drain the queue
+				if (m_stop || !m_seenHashes.insert(trace.hash()).second) {
+					return false;
+				}
+				m_pending.push_back({ trace, sev });
+			}
+			m_cv.notify_one();
+			return true;
+		}
+
+		bool StacktraceSymbolizer::canWaitLocked() const
+		{
+			return !m_stop && std::this_thread::get_id() != m_worker.get_id();
+		}
+
+		bool StacktraceSymbolizer::flush()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!canWaitLocked()) {
+				return false;
+			}
+			m_drainedCv.wait(lock, [this] { return m_stop || (m_pending.empty() && m_inFlight == 0); });
+			return m_pending.empty() && m_inFlight == 0;
+		}
+
+		bool StacktraceSymbolizer::flushFor(std::chrono::milliseconds timeout)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!canWaitLocked()) {
+				return false;
+			}
+			return m_drainedCv.wait_for(lock, timeout, [this] { return m_stop || (m_pending.empty() && m_inFlight == 0); })
+				&& m_pending.empty() && m_inFlight == 0;
+		}
+
+		std::size_t StacktraceSymbolizer::getNumUniqueStacks() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_seenHashes.size();
+		}
+
+		void StacktraceSymbolizer::workerLoop()
+		{
+			BOOST_LOG_NAMED_SCOPE("Symbolizer");
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true) {
+				m_cv.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+				// Drain whatever is left even when stopping so nothing captured goes unsymbolized
+				if (m_pending.empty()) {
+					break;
+				}
+
+				PendingStack pending = m_pending.front();
+				m_pending.pop_front();
+				++m_inFlight;
+				lock.unlock();
+
+				std::string symbols = pending.trace.symbolize();
+				BOOST_LOG_SEV(logging::trivial::logger::get(), pending.sev)
+					<< logging::add_value("Tag", "Symbolized"_sid)
+					<< "[stacktrace 0x" << std::hex << pending.trace.hash() << std::dec << "] symbols:" << symbols;
+
+				lock.lock();
+				--m_inFlight;
+				if (m_pending.empty()) {
+					m_drainedCv.notify_all();
+				}
+			}
+			m_drainedCv.notify_all();
+		}
+
+		RawStacktrace captureAndSubmitStacktrace(boost::log::trivial::severity_level sev)
+		{
+			RawStacktrace trace = RawStacktrace::capture(1);
+			StacktraceSymbolizer::get().submit(trace, sev);
+			return trace;
+		}
+
+		std::size_t symbolizeLogFile(const std::filesystem::path& inLog, const std::filesystem::path& outLog)
+		{
+			BOOST_LOG_NAMED_SCOPE("SymbolizeLogFile");
+			std::ifstream inStream(inLog);
+			if (inStream.fail()) {
+				DOOBIUS_CLOG(warning) << "Couldn't open " << inLog.string() << " for symbolization";
+				return 0;
+			}
+			std::ofstream outStream(outLog);
+
+			std::unordered_map<std::size_t, std::uintptr_t> moduleBases;
+			std::size_t numSymbolized = 0;
+			std::string line;
+			while (std::getline(inStream, line)) {
+				std::size_t firstChar = line.find_first_not_of('\t');
+				std::string_view body = firstChar == std::string::npos ? std::string_view{} : std::string_view(line).substr(firstChar);
+
+				if (body.starts_with("module ")) {
+					std::istringstream modIss{ std::string(body.substr(7)) };
+					std::size_t modIdx = 0;
+					std::string modPath;
+					modIss >> modIdx;
+					std::getline(modIss >> std::ws, modPath);
+					moduleBases[modIdx] = findLoadedModuleBase(modPath);
+				}
+				else if (body.starts_with('#')) {
+					std::size_t modPos = body.find(" m");
+					std::size_t offPos = body.find("+0x");
+					std::size_t modIdx = 0;
+					std::uintptr_t offset = 0;
+					// Malformed frame lines are copied through like frames from unknown modules
+					bool parsed = modPos != std::string_view::npos && offPos != std::string_view::npos && modPos < offPos;
+					if (parsed) {
+						std::string_view modDigits = body.substr(modPos + 2, offPos - modPos - 2);
+						std::string_view offDigits = body.substr(offPos + 3);
+						auto modResult = std::from_chars(modDigits.data(), modDigits.data() + modDigits.size(), modIdx);
+						auto offResult = std::from_chars(offDigits.data(), offDigits.data() + offDigits.size(), offset, 16);
+						parsed = modResult.ec == std::errc{} && modResult.ptr == modDigits.data() + modDigits.size() && offResult.ec == std::errc{};
+					}
+					if (parsed) {
+						auto baseIt = moduleBases.find(modIdx);
+						if (baseIt != moduleBases.end() && baseIt->second != 0) {
+							boost::stacktrace::frame symFrame(reinterpret_cast<void*>(baseIt->second + offset));
+							outStream << line.substr(0, firstChar) << body.substr(0, modPos) << ' ' << symFrame << '\n';
+							++numSymbolized;
+							continue;
+						}
+					}
+				}
+				else if (line.find("[stacktrace 0x") != std::string::npos) {
+					// Module indices are per record
+					moduleBases.clear();
+				}
+				outStream << line << '\n';
+			}
+
+			DOOBIUS_CLOG(info) << "Symbolized " << numSymbolized << " frame(s) from " << inLog.string() << " into " << outLog.string();
+			return numSymbolized;
+		}
+	}
+}
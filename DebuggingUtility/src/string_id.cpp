@@ -0,0 +1,157 @@
+#include "doobius/dbg/string_id.h"
+#include "doobius/dbg/logging.h"
+#include "doobius/dbg/custom_assert.h"
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Doobius {
+	namespace {
+		constexpr std::size_t g_numInternShards = 16;
+		constexpr std::size_t g_internBlockSize = std::size_t{ 16 } << 10;
+
+		struct InternShard {
+			mutable std::shared_mutex mutex;
+			std::unordered_map<std::uint64_t, std::string_view> strings;
+			std::vector<std::unique_ptr<char[]>> blocks;
+			std::vector<std::unique_ptr<char[]>> bigStrings;
+			std::size_t blockUsed = g_internBlockSize;
+			std::size_t arenaBytes = 0;
+
+			// Copies str (plus a terminating null) into the arena; caller holds the lock exclusively
+			std::string_view store(std::string_view str) {
+				const std::size_t bytes = str.size() + 1;
+				char* dst;
+				if (bytes > g_internBlockSize / 4) {
+					// Big strings get their own allocation so they don't waste the rest of the current block
+					bigStrings.push_back(std::make_unique<char[]>(bytes));
+					dst = bigStrings.back().get();
+					arenaBytes += bytes;
+				}
+				else {
+					if (blockUsed + bytes > g_internBlockSize) {
+						blocks.push_back(std::make_unique<char[]>(g_internBlockSize));
+						blockUsed = 0;
+						arenaBytes += g_internBlockSize;
+					}
+					dst = blocks.back().get() + blockUsed;
+					blockUsed += bytes;
+				}
+				std::memcpy(dst, str.data(), str.size());
+				dst[str.size()] = '\0';
+				return std::string_view(dst, str.size());
+			}
+		};
+
+		struct InternTable {
+			std::array<InternShard, g_numInternShards> shards;
+
+			static InternTable& get() {
+				// Never destroyed: log formatters resolve ids while statics are being torn down
+				static InternTable* table = new InternTable();
+				return *table;
+			}
+
+			inline InternShard& shardFor(std::uint64_t hash) {
+				return shards[hash % g_numInternShards];
+			}
+		};
+	}
+
+	std::string_view StringId::view() const
+	{
+		return StringInterner::get().lookup(*this);
+	}
+
+	const char* StringId::c_str() const
+	{
+		// Every stored view is followed by its null terminator
+		const std::string_view str = view();
+		return str.data() ? str.data() : "";
+	}
+
+	std::ostream& operator<<(std::ostream& os, StringId id)
+	{
+		const std::string_view str = id.view();
+		// Never interned (or interned from a different process): the hash is all there is to print
+		if (str.empty() && !id.isNull() && id.getValue() != hashStringId("")) {
+			return os << "#" << std::hex << id.getValue() << std::dec;
+		}
+		return os << str;
+	}
+
+	StringInterner& StringInterner::get()
+	{
+		static StringInterner interner;
+		return interner;
+	}
+
+	StringId StringInterner::intern(std::string_view str)
+	{
+		const std::uint64_t hash = hashStringId(str);
+		InternShard& shard = InternTable::get().shardFor(hash);
+		// Stored views point into the shard's arena, which never moves or frees, so they outlive the locks
+		std::string_view existing;
+		bool found = false;
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			std::unordered_map<std::uint64_t, std::string_view>::const_iterator it = shard.strings.find(hash);
+			if (it != shard.strings.end()) {
+				existing = it->second;
+				found = true;
+			}
+		}
+		if (!found) {
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+			// Another thread may have interned it between the two locks
+			std::unordered_map<std::uint64_t, std::string_view>::const_iterator it = shard.strings.find(hash);
+			if (it == shard.strings.end()) {
+				shard.strings.emplace(hash, shard.store(str));
+				return StringId(hash);
+			}
+			existing = it->second;
+		}
+		// Reported with no lock held: formatting the log record looks StringId tags up in these same shards
+		if (existing != str) {
+			DOOBIUS_CLOG(error) << "String id collision between \"" << existing << "\" and \"" << str << "\", both map to 0x" << std::hex << hash;
+			DOOBIUS_FMT_DASSERT(existing == str, "String id collision between \"%1%\" and \"%2%\"", existing % str);
+		}
+		return StringId(hash);
+	}
+
+	std::string_view StringInterner::lookup(StringId id) const
+	{
+		if (id.isNull()) {
+			return {};
+		}
+		const InternShard& shard = InternTable::get().shardFor(id.getValue());
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		std::unordered_map<std::uint64_t, std::string_view>::const_iterator it = shard.strings.find(id.getValue());
+		return it != shard.strings.end() ? it->second : std::string_view{};
+	}
+
+	std::size_t StringInterner::getNumStrings() const
+	{
+		std::size_t total = 0;
+		for (const InternShard& shard : InternTable::get().shards) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			total += shard.strings.size();
+		}
+		return total;
+	}
+
+	std::size_t StringInterner::getArenaBytes() const
+	{
+		std::size_t total = 0;
+		for (const InternShard& shard : InternTable::get().shards) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			total += shard.arenaBytes;
+		}
+		return total;
+	}
+}
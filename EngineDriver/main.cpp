@@ -1,12 +1,134 @@
 #include "doobius/core/root.h"
+#include "doobius/dbg/config_registry.h"
 #include "doobius/common/code_timer.h"
+#include "doobius/common/profiler.h"
+#include "doobius/common/alloc_tracker.h"
+#include "doobius/common/sampling_profiler.h"
+#include "doobius/common/metrics_registry.h"
+#include "doobius/common/block_pool.h"
+#include "soak.h"
+
+#include <csignal>
+#include <cstdlib>
+
+namespace {
+	Doobius::EngineLoop* g_signalLoop = nullptr;
+
+	void onStopSignal(int) {
+		if (g_signalLoop) {
+			g_signalLoop->requestStop();
+		}
+	}
+}
 
 int main(int argc, char* argv[]) {
 	// TODO: Do I need to pass $(TargetPath) here instead?
+	DOOBIUS_PROFILE_THREAD_NAME("Main");
 	std::filesystem::path logDir = std::filesystem::absolute(argv[0]).parent_path() / "EngineDriverLogs";
-	DOOBIUS_LOG_MNG().initLogging(logDir);
-	Doobius::Perf::CodeTimer mainFunc("mainFunc");
+	// Compiled config caches go next to the exe like the logs instead of the shared temp directory
+	Doobius::Config::ConfigRegistry::get().setCacheDir(std::filesystem::absolute(argv[0]).parent_path() / "ConfigCache");
+	{
+		DOOBIUS_PROFILE_SCOPE("initLogging");
+		DOOBIUS_LOG_MNG().initLogging(logDir);
+	}
+
+	// Offline mode: EngineDriver --symbolize <in.log> <out.log> maps raw stacktraces in a log back to symbols
+	if (argc >= 4 && std::string_view(argv[1]) == "--symbolize") {
+		Doobius::Log::symbolizeLogFile(argv[2], argv[3]);
+		return 0;
+	}
+
+	// --sample-profile <out.folded> [--sample-hz <N>] samples the whole run and writes collapsed stacks on exit
+	// --frames <N> [--frame-hz <N>] runs the engine loop headless for N frames after startup, 0 runs until SIGINT/SIGTERM
+	// --soak <seconds> [--soak-json <path>] [--soak-log-rate <records/s>] runs the synthetic soak workloads after startup
+	// instead of the engine loop and writes the summary to <path>, soak_summary.json in the log dir by default
+	std::filesystem::path sampleProfilePath;
+	Doobius::Perf::SamplingProfiler::SamplingConfig samplingConfig{};
 	Doobius::Root::DoobiusRootConfig rootConfig{};
-	DOOBIUS_ROOT().init(rootConfig);
+	bool runLoop = false;
+	Doobius::Soak::SoakConfig soakConfig{};
+	soakConfig.logDir = DOOBIUS_LOG_MNG().getLogDir();
+	soakConfig.summaryPath = soakConfig.logDir / "soak_summary.json";
+	bool runSoak = false;
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (std::string_view(argv[i]) == "--sample-profile") {
+			sampleProfilePath = argv[++i];
+		}
+		else if (std::string_view(argv[i]) == "--sample-hz") {
+			samplingConfig.frequencyHz = std::atoi(argv[++i]);
+		}
+		else if (std::string_view(argv[i]) == "--frames") {
+			rootConfig.engineLoopConfig.maxFrames = std::strtoull(argv[++i], nullptr, 10);
+			runLoop = true;
+		}
+		else if (std::string_view(argv[i]) == "--frame-hz") {
+			rootConfig.engineLoopConfig.targetFrameRateHz = std::atof(argv[++i]);
+		}
+		else if (std::string_view(argv[i]) == "--soak") {
+			soakConfig.durationSec = std::atof(argv[++i]);
+			runSoak = true;
+		}
+		else if (std::string_view(argv[i]) == "--soak-json") {
+			soakConfig.summaryPath = argv[++i];
+		}
+		else if (std::string_view(argv[i]) == "--soak-log-rate") {
+			soakConfig.logRecordsPerSec = std::atof(argv[++i]);
+		}
+	}
+	if (!sampleProfilePath.empty()) {
+		Doobius::Perf::SamplingProfiler::get().start(samplingConfig);
+	}
+
+	DOOBIUS_ROOT().subsystems.registerSubsystem({ "MetricsExporter", {}, [&logDir]() {
+		Doobius::Perf::MetricsRegistry::get().startExporter(logDir / "metrics.prom", std::chrono::seconds(1));
+		return true;
+	}, []() {
+		Doobius::Perf::MetricsRegistry::get().stopExporter();
+	} });
+
+	Doobius::Perf::CodeTimer mainFunc("mainFunc");
+	{
+		DOOBIUS_PROFILE_SCOPE("Startup");
+		DOOBIUS_ROOT().init(rootConfig);
+	}
 	mainFunc.end();
+
+	if (runSoak) {
+		Doobius::Soak::runSoak(soakConfig);
+	}
+	else if (runLoop) {
+		Doobius::EngineLoop& engineLoop = DOOBIUS_ROOT().engineLoop;
+		g_signalLoop = &engineLoop;
+		std::signal(SIGINT, onStopSignal);
+		std::signal(SIGTERM, onStopSignal);
+		engineLoop.run();
+		std::signal(SIGINT, SIG_DFL);
+		std::signal(SIGTERM, SIG_DFL);
+		g_signalLoop = nullptr;
+
+		const Doobius::LoopStats loopStats = engineLoop.getStats();
+		DOOBIUS_CLOG(info) << "Engine loop: " << loopStats.numFrames << " frames, " << loopStats.numFixedSteps << " fixed steps, "
+			<< loopStats.numClampedFrames << " clamped, target " << loopStats.targetIntervalMs << "ms";
+		DOOBIUS_CLOG(info) << "Frame interval ms: mean " << loopStats.meanIntervalMs << " stddev " << loopStats.stdDevIntervalMs
+			<< " min " << loopStats.minIntervalMs << " p50 " << loopStats.p50IntervalMs << " p99 " << loopStats.p99IntervalMs
+			<< " max " << loopStats.maxIntervalMs;
+		DOOBIUS_CLOG(info) << "Frame jitter ms: mean " << loopStats.meanAbsJitterMs << " max " << loopStats.maxAbsJitterMs;
+	}
+
+	if (Doobius::Perf::SamplingProfiler::get().isRunning()) {
+		Doobius::Perf::SamplingProfiler::get().stop();
+		Doobius::Perf::SamplingProfiler::get().writeCollapsedStacks(sampleProfilePath);
+	}
+
+	DOOBIUS_ROOT().shutdown();
+
+#if DOOBIUS_PROFILING_ENABLED
+	Doobius::Perf::Profiler::get().writeChromeTrace(logDir / "startup_trace.json");
+#endif
+#if DOOBIUS_ALLOC_TRACKING_ENABLED
+	Doobius::Perf::AllocTracker::get().logReport();
+#endif
+#if DOOBIUS_MEMORY_DEBUG
+	Doobius::Memory::BlockPools::reportLeaks();
+#endif
 }
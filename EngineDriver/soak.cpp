@@ -0,0 +1,364 @@
+#include "soak.h"
+#include "doobius/common/notif_registry.h"
+#include "doobius/common/observer.h"
+#include "doobius/common/perf_clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Doobius::Literals;
+
+namespace Doobius {
+	namespace Soak {
+		namespace {
+			namespace json = boost::json;
+			using Perf::PerfClock;
+
+			// Churn reuses this many channel/callback names so the interner table stays bounded
+			constexpr int g_churnNamePool = 1024;
+			constexpr std::size_t g_reservoirSize = 1 << 16;
+			constexpr double g_sliceSec = 0.010;
+			// Clock is only read between batches when a workload checks whether its turn is over
+			constexpr int g_opsPerCheck = 64;
+
+			struct SoakPayload {
+				std::uint64_t seq;
+				double value;
+				std::uint32_t channel;
+			};
+
+			/**
+			 * \brief Fixed-size uniform sample of an unbounded latency stream (Vitter's algorithm R). Count, mean and max are
+			 * exact, percentiles come from the sample.
+			 */
+			class LatencyReservoir {
+			private:
+				std::vector<std::int64_t> m_samples;
+				std::size_t m_numSamples = 0;
+				std::uint64_t m_count = 0;
+				double m_sumNs = 0.0;
+				std::int64_t m_maxNs = 0;
+				std::uint64_t m_rngState = 0x9E3779B97F4A7C15ull;
+
+				inline std::uint64_t nextRandom() {
+					m_rngState ^= m_rngState << 13;
+					m_rngState ^= m_rngState >> 7;
+					m_rngState ^= m_rngState << 17;
+					return m_rngState;
+				}
+			public:
+				// Sized and touched up front, filling a reserved buffer during the run would read as RSS growth
+				LatencyReservoir() : m_samples(g_reservoirSize, 0) {}
+
+				inline void add(std::int64_t ns) {
+					++m_count;
+					m_sumNs += static_cast<double>(ns);
+					m_maxNs = std::max(m_maxNs, ns);
+					if (m_numSamples < g_reservoirSize) {
+						m_samples[m_numSamples++] = ns;
+						return;
+					}
+					const std::uint64_t slot = nextRandom() % m_count;
+					if (slot < g_reservoirSize) {
+						m_samples[slot] = ns;
+					}
+				}
+
+				json::object summarize(double activeSec) {
+					json::object summary;
+					summary["ops"] = m_count;
+					summary["active_sec"] = activeSec;
+					summary["ops_per_sec"] = activeSec > 0.0 ? static_cast<double>(m_count) / activeSec : 0.0;
+					if (m_numSamples == 0) {
+						return summary;
+					}
+					std::sort(m_samples.begin(), m_samples.begin() + m_numSamples);
+					auto percentile = [this](double p) {
+						return m_samples[static_cast<std::size_t>(p * static_cast<double>(m_numSamples - 1) + 0.5)];
+					};
+					summary["mean_ns"] = m_sumNs / static_cast<double>(m_count);
+					summary["p50_ns"] = percentile(0.50);
+					summary["p90_ns"] = percentile(0.90);
+					summary["p99_ns"] = percentile(0.99);
+					summary["p999_ns"] = percentile(0.999);
+					summary["max_ns"] = m_maxNs;
+					return summary;
+				}
+			};
+
+			class SoakNotifiee : public Notification::IDirectNotifiee<SoakPayload> {
+			public:
+				std::uint64_t received = 0;
+				double checksum = 0.0;
+
+				SoakNotifiee(const char* name) : Notification::DirectNotifieeCommon(name) {}
+
+				void onNotify(const SoakPayload& data, StringId) override {
+					++received;
+					checksum += data.value;
+				}
+			};
+
+			std::uint64_t readRssBytes() {
+#if defined(_WIN32)
+				PROCESS_MEMORY_COUNTERS counters{};
+				if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+					return 0;
+				}
+				return static_cast<std::uint64_t>(counters.WorkingSetSize);
+#else
+				std::ifstream statm("/proc/self/statm");
+				std::uint64_t totalPages = 0, residentPages = 0;
+				if (!(statm >> totalPages >> residentPages)) {
+					return 0;
+				}
+				return residentPages * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+			}
+
+			std::uint64_t sumLogFileBytes(const std::filesystem::path& logDir) {
+				std::error_code ec;
+				std::uint64_t total = 0;
+				for (const auto& entry : std::filesystem::directory_iterator(logDir, ec)) {
+					if (entry.is_regular_file(ec) && entry.path().extension() == ".log") {
+						total += entry.file_size(ec);
+					}
+				}
+				return total;
+			}
+
+			// Mixed severities at a fixed rate until told to stop. Most records are below the default file threshold, like
+			// a real engine's, so this also exercises the filtered-out path.
+			void logLoop(const std::atomic<bool>& stop, double recordsPerSec, std::uint64_t& outRecords) {
+				BOOST_LOG_NAMED_SCOPE("SoakLogger");
+				const auto interval = recordsPerSec > 0.0
+					? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / recordsPerSec))
+					: std::chrono::steady_clock::duration::zero();
+				auto nextRecord = std::chrono::steady_clock::now();
+				std::uint64_t seq = 0;
+				while (!stop.load(std::memory_order_relaxed)) {
+					switch (seq % 20) {
+					case 0: case 1: case 2: case 3: case 4: case 5: case 6: case 7:
+						DOOBIUS_CLOG_TAG(trace, "Soak/Trace"_sid) << "soak record " << seq << " value " << static_cast<double>(seq) * 0.5;
+						break;
+					case 8: case 9: case 10: case 11: case 12: case 13:
+						DOOBIUS_CLOG_TAG(debug, "Soak/Debug"_sid) << "soak record " << seq << " value " << static_cast<double>(seq) * 0.5;
+						break;
+					case 19:
+						DOOBIUS_CLOG_TAG(warning, "Soak/Warning"_sid) << "soak record " << seq << " value " << static_cast<double>(seq) * 0.5;
+						break;
+					default:
+						DOOBIUS_CLOG_TAG(info, "Soak/Info"_sid) << "soak record " << seq << " value " << static_cast<double>(seq) * 0.5;
+						break;
+					}
+					++seq;
+					if (interval != std::chrono::steady_clock::duration::zero()) {
+						nextRecord += interval;
+						std::this_thread::sleep_until(nextRecord);
+					}
+				}
+				outRecords = seq;
+			}
+		}
+
+		json::object runSoak(const SoakConfig& config)
+		{
+			BOOST_LOG_NAMED_SCOPE("Soak");
+			DOOBIUS_CLOG(info) << "Soak starting for " << config.durationSec << "s: " << config.numChannels << " channels x "
+				<< config.subscribersPerChannel << " subscribers, " << config.directNotifiees << " direct notifiees, "
+				<< config.logRecordsPerSec << " log records/s";
+
+			PerfClock& clock = PerfClock::get();
+			Notification::NotificationRegistry registry("Soak");
+
+			// Everything named up front so the steady state doesn't intern anything new
+			std::vector<StringId> channelNames, churnChannelNames, churnCbNames;
+			std::uint64_t published = 0, delivered = 0;
+			for (int c = 0; c < config.numChannels; ++c) {
+				channelNames.push_back(internString("Soak/Channel" + std::to_string(c)));
+				registry.createNotificationChannel(channelNames.back());
+				for (int s = 0; s < config.subscribersPerChannel; ++s) {
+					const StringId cbName = internString("Soak/Sub" + std::to_string(c) + "_" + std::to_string(s));
+					registry.registerCallback<SoakPayload>([&delivered](const SoakPayload&) { ++delivered; }, cbName);
+					registry.registerCallbackToChannel(cbName, channelNames.back());
+				}
+			}
+			for (int n = 0; n < g_churnNamePool; ++n) {
+				churnChannelNames.push_back(internString("Soak/ChurnChannel" + std::to_string(n)));
+				churnCbNames.push_back(internString("Soak/ChurnCb" + std::to_string(n)));
+			}
+
+			std::vector<SoakNotifiee> notifiees;
+			notifiees.reserve(static_cast<std::size_t>(config.directNotifiees));
+			Notification::DirectNotifier<SoakNotifiee, SoakPayload> directNotifier("Soak/Direct"_sid);
+			for (int n = 0; n < config.directNotifiees; ++n) {
+				notifiees.emplace_back("SoakNotifiee");
+			}
+			for (SoakNotifiee& notifiee : notifiees) {
+				directNotifier.addNotifiee(&notifiee);
+			}
+
+			LatencyReservoir churnLatency, publishLatency, directLatency;
+			std::uint64_t churnDelivered = 0;
+			double churnActiveSec = 0.0, publishActiveSec = 0.0, directActiveSec = 0.0;
+
+			logging::core::get()->flush();
+			const std::uint64_t logBytesBefore = sumLogFileBytes(config.logDir);
+			const std::uint64_t fileRecordsBefore = DOOBIUS_LOG_MNG().getNumFileRecords();
+			const std::uint64_t droppedBefore = DOOBIUS_LOG_MNG().getNumDroppedRecords();
+
+			std::atomic<bool> stopLogging{ false };
+			std::uint64_t logRecords = 0;
+			std::thread logThread(logLoop, std::cref(stopLogging), config.logRecordsPerSec, std::ref(logRecords));
+
+			const std::uint64_t sliceTicks = clock.nsToTicks(g_sliceSec * 1e9);
+			const std::uint64_t startTicks = PerfClock::now();
+			const std::uint64_t endTicks = startTicks + clock.nsToTicks(config.durationSec * 1e9);
+			std::uint64_t nextRssTicks = startTicks;
+			std::vector<std::pair<double, std::uint64_t>> rssSamples;
+			rssSamples.reserve(static_cast<std::size_t>(config.durationSec) + 2);
+			std::uint64_t rssPeak = 0;
+			std::uint64_t seq = 0;
+
+			// Runs op back to back for one slice, timing every call, and returns how long the slice took in seconds
+			auto runSlice = [&](LatencyReservoir& latency, auto&& op) {
+				const std::uint64_t sliceStart = PerfClock::now();
+				const std::uint64_t sliceEnd = sliceStart + sliceTicks;
+				std::uint64_t sliceNow = sliceStart;
+				while (sliceNow < sliceEnd) {
+					for (int i = 0; i < g_opsPerCheck; ++i) {
+						const std::uint64_t opStart = PerfClock::now();
+						op();
+						sliceNow = PerfClock::now();
+						latency.add(static_cast<std::int64_t>(clock.ticksToNs(sliceNow - opStart)));
+					}
+				}
+				return clock.ticksToNs(sliceNow - sliceStart) * 1e-9;
+			};
+
+			while (PerfClock::now() < endTicks) {
+				churnActiveSec += runSlice(churnLatency, [&]() {
+					const std::size_t n = static_cast<std::size_t>(seq % g_churnNamePool);
+					registry.createNotificationChannel(churnChannelNames[n]);
+					registry.registerCallback<SoakPayload>([&churnDelivered](const SoakPayload&) { ++churnDelivered; }, churnCbNames[n]);
+					registry.registerCallbackToChannel(churnCbNames[n], churnChannelNames[n]);
+					registry.updateChannel(churnChannelNames[n], SoakPayload{ seq, 1.0, static_cast<std::uint32_t>(n) });
+					registry.removeCallback(churnCbNames[n]);
+					registry.destroyChannel(churnChannelNames[n]);
+					++seq;
+				});
+				if (!channelNames.empty()) {
+					publishActiveSec += runSlice(publishLatency, [&]() {
+						const std::size_t c = static_cast<std::size_t>(published % channelNames.size());
+						registry.updateChannel(channelNames[c], SoakPayload{ published, static_cast<double>(published), static_cast<std::uint32_t>(c) });
+						++published;
+					});
+				}
+				directActiveSec += runSlice(directLatency, [&]() {
+					directNotifier.notifyAll(SoakPayload{ seq, 0.25, 0 });
+					++seq;
+				});
+
+				const std::uint64_t nowTicks = PerfClock::now();
+				if (nowTicks >= nextRssTicks) {
+					const std::uint64_t rss = readRssBytes();
+					rssSamples.emplace_back(clock.ticksToNs(nowTicks - startTicks) * 1e-9, rss);
+					rssPeak = std::max(rssPeak, rss);
+					nextRssTicks += clock.nsToTicks(1e9);
+				}
+			}
+			const double elapsedSec = clock.ticksToNs(PerfClock::now() - startTicks) * 1e-9;
+
+			stopLogging.store(true, std::memory_order_relaxed);
+			logThread.join();
+			logging::core::get()->flush();
+			const std::uint64_t logBytesAfter = sumLogFileBytes(config.logDir);
+			const std::uint64_t rssEnd = readRssBytes();
+			rssPeak = std::max(rssPeak, rssEnd);
+			rssSamples.emplace_back(elapsedSec, rssEnd);
+
+			// Growth is measured from the first sample after warm-up, and the slope over every post-warm-up sample keeps
+			// a one-off allocation late in the run from reading as a leak rate
+			std::size_t firstSteady = 0;
+			while (firstSteady + 1 < rssSamples.size() && rssSamples[firstSteady].first < config.warmupSec) {
+				++firstSteady;
+			}
+			double sumT = 0.0, sumR = 0.0, sumTT = 0.0, sumTR = 0.0;
+			const double numSteady = static_cast<double>(rssSamples.size() - firstSteady);
+			for (std::size_t i = firstSteady; i < rssSamples.size(); ++i) {
+				const double t = rssSamples[i].first, r = static_cast<double>(rssSamples[i].second);
+				sumT += t;
+				sumR += r;
+				sumTT += t * t;
+				sumTR += t * r;
+			}
+			const double slopeDenom = numSteady * sumTT - sumT * sumT;
+			const double rssSlopePerSec = slopeDenom > 0.0 ? (numSteady * sumTR - sumT * sumR) / slopeDenom : 0.0;
+
+			double directChecksum = 0.0;
+			std::uint64_t directReceived = 0;
+			for (const SoakNotifiee& notifiee : notifiees) {
+				directReceived += notifiee.received;
+				directChecksum += notifiee.checksum;
+			}
+
+			json::object summary;
+			summary["duration_sec"] = elapsedSec;
+			json::object churn = churnLatency.summarize(churnActiveSec);
+			churn["delivered"] = churnDelivered;
+			summary["channel_churn"] = std::move(churn);
+			json::object publish = publishLatency.summarize(publishActiveSec);
+			publish["channels"] = config.numChannels;
+			publish["subscribers_per_channel"] = config.subscribersPerChannel;
+			publish["delivered"] = delivered;
+			publish["deliveries_per_sec"] = publishActiveSec > 0.0 ? static_cast<double>(delivered) / publishActiveSec : 0.0;
+			summary["channel_publish"] = std::move(publish);
+			json::object direct = directLatency.summarize(directActiveSec);
+			direct["notifiees"] = config.directNotifiees;
+			direct["delivered"] = directReceived;
+			direct["deliveries_per_sec"] = directActiveSec > 0.0 ? static_cast<double>(directReceived) / directActiveSec : 0.0;
+			direct["checksum"] = directChecksum;
+			summary["direct_fanout"] = std::move(direct);
+
+			json::object log;
+			log["records_issued"] = logRecords;
+			log["records_per_sec"] = elapsedSec > 0.0 ? static_cast<double>(logRecords) / elapsedSec : 0.0;
+			log["file_records"] = DOOBIUS_LOG_MNG().getNumFileRecords() - fileRecordsBefore;
+			log["dropped_records"] = DOOBIUS_LOG_MNG().getNumDroppedRecords() - droppedBefore;
+			log["bytes_written"] = logBytesAfter >= logBytesBefore ? logBytesAfter - logBytesBefore : logBytesAfter;
+			summary["logging"] = std::move(log);
+
+			json::object rss;
+			rss["samples"] = rssSamples.size();
+			rss["start_bytes"] = rssSamples[firstSteady].second;
+			rss["end_bytes"] = rssEnd;
+			rss["peak_bytes"] = rssPeak;
+			rss["growth_bytes"] = static_cast<std::int64_t>(rssEnd) - static_cast<std::int64_t>(rssSamples[firstSteady].second);
+			rss["growth_bytes_per_min"] = rssSlopePerSec * 60.0;
+			summary["rss"] = std::move(rss);
+
+			DOOBIUS_CLOG(info) << "Soak finished after " << elapsedSec << "s: " << json::serialize(summary);
+			if (!config.summaryPath.empty()) {
+				std::ofstream summaryFile(config.summaryPath);
+				summaryFile << json::serialize(summary) << '\n';
+				if (summaryFile.fail()) {
+					DOOBIUS_CLOG(warning) << "Couldn't write the soak summary to " << config.summaryPath.string();
+				}
+			}
+			return summary;
+		}
+	}
+}
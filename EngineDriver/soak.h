@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+#include <boost/json.hpp>
+
+namespace Doobius {
+	namespace Soak {
+		struct SoakConfig {
+			double durationSec = 60.0;
+			// Written as JSON when the run ends; empty skips writing
+			std::filesystem::path summaryPath;
+			// Log files in here are measured before and after to report log bytes written
+			std::filesystem::path logDir;
+			int numChannels = 64;
+			int subscribersPerChannel = 8;
+			int directNotifiees = 16;
+			// Records per second from the logging thread, 0 logs as fast as it can
+			double logRecordsPerSec = 2000.0;
+			// RSS before the end of warm-up isn't counted as growth
+			double warmupSec = 2.0;
+		};
+
+		/**
+		 * \brief Drives every workload below against the engine modules for durationSec and returns the summary:
+		 * - channel churn: create a channel, subscribe, publish once, unsubscribe and destroy it again
+		 * - publishing: updateChannel round-robin over numChannels channels with subscribersPerChannel callbacks each
+		 * - direct fan-out: DirectNotifier::notifyAll to directNotifiees observers
+		 * - logging: a separate thread logging at mixed severities the whole time
+		 *
+		 * The notification workloads share the calling thread (NotificationRegistry isn't thread-safe) in 10ms turns.
+		 * Latencies are kept in fixed-size reservoirs and names cycle through a fixed set, so the harness itself stops
+		 * allocating after warm-up and RSS growth points at the engine.
+		 */
+		boost::json::object runSoak(const SoakConfig& config);
+	}
+}